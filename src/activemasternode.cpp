@@ -174,7 +174,8 @@ void CActiveMasternode::ManageStateInitial(CConnman& connman)
     // Check socket connectivity
     LogPrintf("CActiveMasternode::ManageStateInitial -- Checking inbound connection to '%s'\n", service.ToString());
     SOCKET hSocket;
-    bool fConnected = ConnectSocket(service, hSocket, nConnectTimeout) && IsSelectableSocket(hSocket);
+    bool fConnected = ConnectSocket(service, hSocket, nConnectTimeout) &&
+                      (connman.GetSocketEventsMode() != SOCKETEVENTS_SELECT || IsSelectableSocket(hSocket));
     CloseSocket(hSocket);
 
     if (!fConnected) {
@@ -9,6 +9,10 @@
 #include "uint256.h"
 #include "amount.h"
 #include "script/script.h"
+#include "compressor.h"
+#include "serialize.h"
+
+#include <ios>
 
 static const std::string BLAST = "BLAST";
 
@@ -310,6 +314,330 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+/**
+ * Order preserving variable length integer used in the compact (v2) address index keys. The top two bits
+ * of the first byte hold the number of bytes that follow it, the value is stored big-endian in the
+ * remaining 30 bits, so keys still sort by value and heights below 2^22 take 3 bytes instead of 4.
+ */
+template<typename Stream>
+inline void WriteOrderedVarInt(Stream& s, uint32_t n)
+{
+    if (n >= (1U << 30))
+        throw std::ios_base::failure("ordered varint out of range");
+    int nExtra = n < (1U << 6) ? 0 : n < (1U << 14) ? 1 : n < (1U << 22) ? 2 : 3;
+    ser_writedata8(s, (nExtra << 6) | (n >> (8 * nExtra)));
+    for (int i = nExtra - 1; i >= 0; i--)
+        ser_writedata8(s, (n >> (8 * i)) & 0xff);
+}
+
+template<typename Stream>
+inline uint32_t ReadOrderedVarInt(Stream& s)
+{
+    uint8_t chFirst = ser_readdata8(s);
+    int nExtra = chFirst >> 6;
+    uint32_t n = chFirst & 0x3f;
+    for (int i = 0; i < nExtra; i++)
+        n = (n << 8) | ser_readdata8(s);
+    return n;
+}
+
+/**
+ * Key of the compact address index ('A'). The asset name is replaced by its id in assetNameTable
+ * (CAssetNameTable::NULL_ID for BLAST) and the transaction by its position in the block: the txid is
+ * stored once per transaction in the txid table (CAddressIndexTxKey) instead of in every entry.
+ */
+struct CAddressIndexCompactKey {
+    unsigned int type;
+    uint160 hashBytes;
+    uint32_t assetId;
+    int blockHeight;
+    unsigned int txindex;
+    unsigned int index;
+    bool spending;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        WriteOrderedVarInt(s, assetId);
+        WriteOrderedVarInt(s, blockHeight);
+        WriteOrderedVarInt(s, txindex);
+        uint64_t nIndex = ((uint64_t)index << 1) | spending;
+        s << VARINT(nIndex);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        assetId = ReadOrderedVarInt(s);
+        blockHeight = ReadOrderedVarInt(s);
+        txindex = ReadOrderedVarInt(s);
+        uint64_t nIndex;
+        s >> VARINT(nIndex);
+        index = nIndex >> 1;
+        spending = nIndex & 1;
+    }
+
+    CAddressIndexCompactKey(const CAddressIndexKey& key, uint32_t assetIdIn) {
+        type = key.type;
+        hashBytes = key.hashBytes;
+        assetId = assetIdIn;
+        blockHeight = key.blockHeight;
+        txindex = key.txindex;
+        index = key.index;
+        spending = key.spending;
+    }
+
+    CAddressIndexCompactKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        assetId = 0;
+        blockHeight = 0;
+        txindex = 0;
+        index = 0;
+        spending = false;
+    }
+
+    bool operator==(const CAddressIndexCompactKey& other) const {
+        return type == other.type && hashBytes == other.hashBytes && assetId == other.assetId && blockHeight == other.blockHeight &&
+               txindex == other.txindex && index == other.index && spending == other.spending;
+    }
+};
+
+//! Prefix of the compact address index keys of one address and asset, optionally starting at a height
+struct CAddressIndexCompactIteratorKey {
+    unsigned int type;
+    uint160 hashBytes;
+    uint32_t assetId;
+    int blockHeight;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        WriteOrderedVarInt(s, assetId);
+        if (blockHeight > 0)
+            WriteOrderedVarInt(s, blockHeight);
+    }
+
+    CAddressIndexCompactIteratorKey(unsigned int addressType, uint160 addressHash, uint32_t assetIdIn, int height = 0) {
+        type = addressType;
+        hashBytes = addressHash;
+        assetId = assetIdIn;
+        blockHeight = height;
+    }
+};
+
+/** Amount of a compact address index entry, with the magnitude compressed like coin amounts */
+struct CAddressIndexCompactValue {
+    CAmount amount;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        uint64_t nAbs = amount < 0 ? -(uint64_t)amount : amount;
+        uint64_t nVal = (CTxOutCompressor::CompressAmount(nAbs) << 1) | (amount < 0);
+        s << VARINT(nVal);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        uint64_t nVal;
+        s >> VARINT(nVal);
+        uint64_t nAbs = CTxOutCompressor::DecompressAmount(nVal >> 1);
+        amount = (nVal & 1) ? -(CAmount)nAbs : (CAmount)nAbs;
+    }
+
+    explicit CAddressIndexCompactValue(CAmount amountIn = 0) : amount(amountIn) {}
+};
+
+/** Position of a transaction in the active chain, key of the txid table ('T') of the compact address index */
+struct CAddressIndexTxKey {
+    int blockHeight;
+    unsigned int txindex;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        WriteOrderedVarInt(s, blockHeight);
+        WriteOrderedVarInt(s, txindex);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        blockHeight = ReadOrderedVarInt(s);
+        txindex = ReadOrderedVarInt(s);
+    }
+
+    CAddressIndexTxKey(int height = 0, unsigned int blockindex = 0) : blockHeight(height), txindex(blockindex) {}
+
+    bool operator!=(const CAddressIndexTxKey& other) const {
+        return blockHeight != other.blockHeight || txindex != other.txindex;
+    }
+};
+
+/**
+ * Key of the compact unspent index ('U'). Outputs are looked up by outpoint when they are spent, when
+ * only the height of the funding transaction is known, so the txid is kept here.
+ */
+struct CAddressUnspentCompactKey {
+    unsigned int type;
+    uint160 hashBytes;
+    uint32_t assetId;
+    uint256 txhash;
+    unsigned int index;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        WriteOrderedVarInt(s, assetId);
+        txhash.Serialize(s);
+        s << VARINT(index);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        assetId = ReadOrderedVarInt(s);
+        txhash.Unserialize(s);
+        s >> VARINT(index);
+    }
+
+    CAddressUnspentCompactKey(const CAddressUnspentKey& key, uint32_t assetIdIn) {
+        type = key.type;
+        hashBytes = key.hashBytes;
+        assetId = assetIdIn;
+        txhash = key.txhash;
+        index = key.index;
+    }
+
+    CAddressUnspentCompactKey() {
+        type = 0;
+        hashBytes.SetNull();
+        assetId = 0;
+        txhash.SetNull();
+        index = 0;
+    }
+
+    bool operator==(const CAddressUnspentCompactKey& other) const {
+        return type == other.type && hashBytes == other.hashBytes && assetId == other.assetId &&
+               txhash == other.txhash && index == other.index;
+    }
+};
+
+/** CAddressUnspentValue with the height as a varint and the amount and script compressed like coins */
+struct CAddressUnspentCompactValue {
+    CAddressUnspentValue& value;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        uint64_t nHeight = value.blockHeight;
+        uint64_t nVal = CTxOutCompressor::CompressAmount(value.satoshis);
+        s << VARINT(nHeight) << VARINT(nVal);
+        CScriptCompressor cscript(value.script);
+        s << cscript;
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        uint64_t nHeight, nVal;
+        s >> VARINT(nHeight) >> VARINT(nVal);
+        value.blockHeight = nHeight;
+        value.satoshis = CTxOutCompressor::DecompressAmount(nVal);
+        CScriptCompressor cscript(value.script);
+        s >> cscript;
+    }
+
+    //! Writers pass the entries they hold as const, Unserialize is only used on values the caller owns
+    explicit CAddressUnspentCompactValue(const CAddressUnspentValue& valueIn) : value(const_cast<CAddressUnspentValue&>(valueIn)) {}
+};
+
+/** Key of the per address and asset totals ('D') kept next to the compact address index */
+struct CAddressBalanceKey {
+    unsigned int type;
+    uint160 hashBytes;
+    uint32_t assetId;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        WriteOrderedVarInt(s, assetId);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        assetId = ReadOrderedVarInt(s);
+    }
+
+    CAddressBalanceKey(unsigned int addressType, uint160 addressHash, uint32_t assetIdIn) {
+        type = addressType;
+        hashBytes = addressHash;
+        assetId = assetIdIn;
+    }
+
+    CAddressBalanceKey() {
+        type = 0;
+        hashBytes.SetNull();
+        assetId = 0;
+    }
+
+    bool operator<(const CAddressBalanceKey& other) const {
+        if (type != other.type)
+            return type < other.type;
+        if (hashBytes != other.hashBytes)
+            return hashBytes < other.hashBytes;
+        return assetId < other.assetId;
+    }
+
+    bool operator!=(const CAddressBalanceKey& other) const {
+        return type != other.type || hashBytes != other.hashBytes || assetId != other.assetId;
+    }
+};
+
+/** What getaddressbalance reports for an address and asset, summed over all its address index entries */
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+    uint64_t txcount;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(VARINT(txcount));
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        txcount = 0;
+    }
+
+    bool IsNull() const {
+        return balance == 0 && received == 0 && txcount == 0;
+    }
+};
+
+//! Order of asset names in the original address index keys, where they are serialized with their length first
+inline bool AddressIndexAssetOrder(const std::string& a, const std::string& b)
+{
+    return a.size() != b.size() ? a.size() < b.size() : a < b;
+}
+
 struct CMempoolAddressDelta
 {
     int64_t time;
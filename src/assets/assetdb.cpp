@@ -12,31 +12,268 @@
 
 #include <boost/thread.hpp>
 
+#include <algorithm>
+#include <set>
+
 static const char ASSET_FLAG = 'A';
 static const char ASSET_ADDRESS_QUANTITY_FLAG = 'B';
 static const char ADDRESS_ASSET_QUANTITY_FLAG = 'C';
 static const char MY_ASSET_FLAG = 'M';
 static const char BLOCK_ASSET_UNDO_DATA = 'U';
 static const char MEMPOOL_REISSUED_TX = 'Z';
+static const char ASSET_PREFIX_COUNT_FLAG = 'N';
+static const char ASSET_HOLDER_STATS_FLAG = 'H';
+static const char ADDRESS_ASSET_COUNT_FLAG = 'K';
+static const char ASSET_ID_FLAG = 'I';
+static const char ASSET_ID_NAME_FLAG = 'J';
+static const char DB_FLAG = 'F';
+static const char DB_BEST_BLOCK = 'b';
+
+static const std::string ASSET_PREFIX_INDEX_FLAG = "assetprefixindex";
+static const std::string ASSET_HOLDER_STATS_INDEX_FLAG = "assetholderstats";
+static const std::string ASSET_NAME_IDS_FLAG = "assetnameids";
 
 static size_t MAX_DATABASE_RESULTS = 50000;
+static const size_t MAX_DATABASE_BATCH_SIZE = 16 << 20;
 
 CAssetsDB::CAssetsDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assets", nCacheSize, fMemory, fWipe) {
 }
 
+/**
+ * Asset data is keyed by (ASSET_FLAG, name). The name is serialized with its size first,
+ * so the keyspace is ordered by name length and then bytewise, and all names of one length
+ * sharing a prefix are adjacent. The prefix count index keeps, for every stored name of
+ * length L and every prefix P of it (including "" and the name itself), a counter under
+ * (ASSET_PREFIX_COUNT_FLAG, (L, P)). Counters of the children of P are adjacent as well,
+ * which lets AssetDir count, rank and seek by position in O(name length * alphabet) reads.
+ */
+static bool AssetKeyLess(const std::string& a, const std::string& b)
+{
+    return a.size() < b.size() || (a.size() == b.size() && a < b);
+}
+
+static bool HasPrefix(const std::string& name, const std::string& prefix)
+{
+    return name.size() >= prefix.size() && name.compare(0, prefix.size(), prefix) == 0;
+}
+
+static std::pair<char, std::pair<uint8_t, std::string> > PrefixCountKey(const size_t nLength, const std::string& prefix)
+{
+    return std::make_pair(ASSET_PREFIX_COUNT_FLAG, std::make_pair((uint8_t)nLength, prefix));
+}
+
+CAssetsDBBatch::CAssetsDBBatch(CAssetsDB& _db) : db(_db), batch(_db)
+{
+}
+
+bool CAssetsDBBatch::AssetExists(const std::string& assetName)
+{
+    auto it = mapAssetExists.find(assetName);
+    if (it == mapAssetExists.end())
+        it = mapAssetExists.emplace(assetName, db.Exists(std::make_pair(ASSET_FLAG, assetName))).first;
+    return it->second;
+}
+
+void CAssetsDBBatch::UpdateAssetPrefixCounts(const std::string& assetName, const int nChange)
+{
+    for (size_t i = 0; i <= assetName.size(); i++) {
+        auto key = std::make_pair((uint8_t)assetName.size(), assetName.substr(0, i));
+        auto it = mapPrefixCounts.find(key);
+        if (it == mapPrefixCounts.end()) {
+            uint32_t nCount = 0;
+            db.Read(PrefixCountKey(key.first, key.second), nCount);
+            it = mapPrefixCounts.emplace(key, nCount).first;
+        }
+
+        if (nChange < 0 && it->second < (uint32_t)-nChange)
+            it->second = 0;
+        else
+            it->second += nChange;
+    }
+}
+
+void CAssetsDBBatch::UpdateAssetHolderStats(const std::string& assetName, const bool fOldEntry, const CAmount nOld, const bool fNewEntry, const CAmount nNew)
+{
+    if (fOldEntry == fNewEntry && nOld == nNew)
+        return;
+
+    auto it = mapHolderStats.find(assetName);
+    if (it == mapHolderStats.end()) {
+        CAssetHolderStats stats;
+        db.Read(std::make_pair(ASSET_HOLDER_STATS_FLAG, assetName), stats);
+        it = mapHolderStats.emplace(assetName, stats).first;
+    }
+
+    // Every stored balance counts as a holder, as the addresses listed for the asset do
+    CAssetHolderStats& stats = it->second;
+    if (!fOldEntry && fNewEntry)
+        stats.nHolders++;
+    else if (fOldEntry && !fNewEntry && stats.nHolders > 0)
+        stats.nHolders--;
+    stats.nSupply += nNew - nOld;
+}
+
+void CAssetsDBBatch::UpdateAddressAssetCount(const std::string& address, const bool fOldEntry, const bool fNewEntry)
+{
+    if (fOldEntry == fNewEntry)
+        return;
+
+    auto it = mapAddressAssetCounts.find(address);
+    if (it == mapAddressAssetCounts.end()) {
+        uint32_t nCount = 0;
+        db.Read(std::make_pair(ADDRESS_ASSET_COUNT_FLAG, address), nCount);
+        it = mapAddressAssetCounts.emplace(address, nCount).first;
+    }
+
+    if (fNewEntry)
+        it->second++;
+    else if (it->second > 0)
+        it->second--;
+}
+
+bool CAssetsDBBatch::GetQuantity(std::map<std::pair<std::string, std::string>, std::pair<bool, CAmount> >& mapQuantity, const char flag, const std::pair<std::string, std::string>& key, CAmount& nAmount)
+{
+    auto it = mapQuantity.find(key);
+    if (it == mapQuantity.end()) {
+        CAmount nRead = 0;
+        bool fExists = db.Read(std::make_pair(flag, key), nRead);
+        it = mapQuantity.emplace(key, std::make_pair(fExists, nRead)).first;
+    }
+    nAmount = it->second.second;
+    return it->second.first;
+}
+
+void CAssetsDBBatch::WriteAssetData(const CNewAsset& asset, const int nHeight, const uint256& blockHash)
+{
+    assetNameTable.GetOrAssign(asset.strName);
+    if (!AssetExists(asset.strName)) {
+        UpdateAssetPrefixCounts(asset.strName, 1);
+        mapAssetExists[asset.strName] = true;
+    }
+    batch.Write(std::make_pair(ASSET_FLAG, asset.strName), CDatabasedAssetData(asset, nHeight, blockHash));
+}
+
+void CAssetsDBBatch::EraseAssetData(const std::string& assetName)
+{
+    if (AssetExists(assetName)) {
+        UpdateAssetPrefixCounts(assetName, -1);
+        mapAssetExists[assetName] = false;
+    }
+    batch.Erase(std::make_pair(ASSET_FLAG, assetName));
+}
+
+void CAssetsDBBatch::WriteAssetAddressQuantity(const std::string& assetName, const std::string& address, const CAmount& quantity)
+{
+    auto key = std::make_pair(assetName, address);
+    CAmount nOld;
+    bool fOldEntry = GetQuantity(mapAssetAddressQuantity, ASSET_ADDRESS_QUANTITY_FLAG, key, nOld);
+    UpdateAssetHolderStats(assetName, fOldEntry, nOld, true, quantity);
+    mapAssetAddressQuantity[key] = std::make_pair(true, quantity);
+    batch.Write(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, key), quantity);
+}
+
+void CAssetsDBBatch::WriteAddressAssetQuantity(const std::string& address, const std::string& assetName, const CAmount& quantity)
+{
+    auto key = std::make_pair(address, assetName);
+    CAmount nOld;
+    UpdateAddressAssetCount(address, GetQuantity(mapAddressAssetQuantity, ADDRESS_ASSET_QUANTITY_FLAG, key, nOld), true);
+    mapAddressAssetQuantity[key] = std::make_pair(true, quantity);
+    batch.Write(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, key), quantity);
+}
+
+void CAssetsDBBatch::EraseAssetAddressQuantity(const std::string& assetName, const std::string& address)
+{
+    auto key = std::make_pair(assetName, address);
+    CAmount nOld;
+    bool fOldEntry = GetQuantity(mapAssetAddressQuantity, ASSET_ADDRESS_QUANTITY_FLAG, key, nOld);
+    UpdateAssetHolderStats(assetName, fOldEntry, nOld, false, 0);
+    mapAssetAddressQuantity[key] = std::make_pair(false, 0);
+    batch.Erase(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, key));
+}
+
+void CAssetsDBBatch::EraseAddressAssetQuantity(const std::string& address, const std::string& assetName)
+{
+    auto key = std::make_pair(address, assetName);
+    CAmount nOld;
+    UpdateAddressAssetCount(address, GetQuantity(mapAddressAssetQuantity, ADDRESS_ASSET_QUANTITY_FLAG, key, nOld), false);
+    mapAddressAssetQuantity[key] = std::make_pair(false, 0);
+    batch.Erase(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, key));
+}
+
+void CAssetsDBBatch::WriteReissuedMempoolState()
+{
+    batch.Write(MEMPOOL_REISSUED_TX, mapReissuedAssets);
+}
+
+void CAssetsDBBatch::WriteBestBlock(const uint256& hashBestBlock)
+{
+    batch.Write(DB_BEST_BLOCK, hashBestBlock);
+}
+
+bool CAssetsDBBatch::Commit(bool fSync)
+{
+    // Names interned since the last write go out with whatever refers to them
+    uint32_t nLastId = CAssetNameTable::NULL_ID;
+    for (const auto& item : assetNameTable.GetUnpersisted()) {
+        batch.Write(std::make_pair(ASSET_ID_FLAG, item.second), item.first);
+        batch.Write(std::make_pair(ASSET_ID_NAME_FLAG, item.first), item.second);
+        nLastId = item.first;
+    }
+
+    // The derived indexes only need their final value written
+    for (const auto& item : mapPrefixCounts) {
+        if (item.second)
+            batch.Write(PrefixCountKey(item.first.first, item.first.second), item.second);
+        else
+            batch.Erase(PrefixCountKey(item.first.first, item.first.second));
+    }
+
+    for (const auto& item : mapHolderStats) {
+        if (item.second.nHolders == 0 && item.second.nSupply == 0)
+            batch.Erase(std::make_pair(ASSET_HOLDER_STATS_FLAG, item.first));
+        else
+            batch.Write(std::make_pair(ASSET_HOLDER_STATS_FLAG, item.first), item.second);
+    }
+
+    for (const auto& item : mapAddressAssetCounts) {
+        if (item.second)
+            batch.Write(std::make_pair(ADDRESS_ASSET_COUNT_FLAG, item.first), item.second);
+        else
+            batch.Erase(std::make_pair(ADDRESS_ASSET_COUNT_FLAG, item.first));
+    }
+
+    bool ret = db.WriteBatch(batch, fSync);
+    if (ret && nLastId != CAssetNameTable::NULL_ID)
+        assetNameTable.SetPersisted(nLastId);
+
+    batch.Clear();
+    mapAssetExists.clear();
+    mapAssetAddressQuantity.clear();
+    mapAddressAssetQuantity.clear();
+    mapPrefixCounts.clear();
+    mapHolderStats.clear();
+    mapAddressAssetCounts.clear();
+    return ret;
+}
+
 bool CAssetsDB::WriteAssetData(const CNewAsset &asset, const int nHeight, const uint256& blockHash)
 {
-    CDatabasedAssetData data(asset, nHeight, blockHash);
-    return Write(std::make_pair(ASSET_FLAG, asset.strName), data);
+    CAssetsDBBatch batch(*this);
+    batch.WriteAssetData(asset, nHeight, blockHash);
+    return batch.Commit();
 }
 
 bool CAssetsDB::WriteAssetAddressQuantity(const std::string &assetName, const std::string &address, const CAmount &quantity)
 {
-    return Write(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)), quantity);
+    CAssetsDBBatch batch(*this);
+    batch.WriteAssetAddressQuantity(assetName, address, quantity);
+    return batch.Commit();
 }
 
 bool CAssetsDB::WriteAddressAssetQuantity(const std::string &address, const std::string &assetName, const CAmount& quantity) {
-    return Write(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)), quantity);
+    CAssetsDBBatch batch(*this);
+    batch.WriteAddressAssetQuantity(address, assetName, quantity);
+    return batch.Commit();
 }
 
 bool CAssetsDB::ReadAssetData(const std::string& strName, CNewAsset& asset, int& nHeight, uint256& blockHash)
@@ -65,7 +302,9 @@ bool CAssetsDB::ReadAddressAssetQuantity(const std::string &address, const std::
 
 bool CAssetsDB::EraseAssetData(const std::string& assetName)
 {
-    return Erase(std::make_pair(ASSET_FLAG, assetName));
+    CAssetsDBBatch batch(*this);
+    batch.EraseAssetData(assetName);
+    return batch.Commit();
 }
 
 bool CAssetsDB::EraseMyAssetData(const std::string& assetName)
@@ -74,11 +313,29 @@ bool CAssetsDB::EraseMyAssetData(const std::string& assetName)
 }
 
 bool CAssetsDB::EraseAssetAddressQuantity(const std::string &assetName, const std::string &address) {
-    return Erase(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)));
+    CAssetsDBBatch batch(*this);
+    batch.EraseAssetAddressQuantity(assetName, address);
+    return batch.Commit();
 }
 
 bool CAssetsDB::EraseAddressAssetQuantity(const std::string &address, const std::string &assetName) {
-    return Erase(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)));
+    CAssetsDBBatch batch(*this);
+    batch.EraseAddressAssetQuantity(address, assetName);
+    return batch.Commit();
+}
+
+bool CAssetsDB::ReadAssetHolderStats(const std::string& assetName, CAssetHolderStats& stats)
+{
+    stats.SetNull();
+    Read(std::make_pair(ASSET_HOLDER_STATS_FLAG, assetName), stats);
+    return true;
+}
+
+bool CAssetsDB::ReadAddressAssetCount(const std::string& address, uint32_t& nCount)
+{
+    nCount = 0;
+    Read(std::make_pair(ADDRESS_ASSET_COUNT_FLAG, address), nCount);
+    return true;
 }
 
 bool EraseAddressAssetQuantity(const std::string &address, const std::string &assetName);
@@ -103,6 +360,11 @@ bool CAssetsDB::WriteReissuedMempoolState()
     return Write(MEMPOOL_REISSUED_TX, mapReissuedAssets);
 }
 
+bool CAssetsDB::ReadBestBlock(uint256& hashBestBlock)
+{
+    return Read(DB_BEST_BLOCK, hashBestBlock);
+}
+
 bool CAssetsDB::ReadReissuedMempoolState()
 {
     mapReissuedAssets.clear();
@@ -116,8 +378,253 @@ bool CAssetsDB::ReadReissuedMempoolState()
     return rv;
 }
 
+bool CAssetsDB::WriteFlag(const std::string &name, bool fValue)
+{
+    return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
+}
+
+bool CAssetsDB::ReadFlag(const std::string &name, bool &fValue)
+{
+    char ch;
+    if (!Read(std::make_pair(DB_FLAG, name), ch))
+        return false;
+    fValue = ch == '1';
+    return true;
+}
+
+/** Erase every key starting with flag. Key_t is the type the keys of that flag deserialize as */
+template <typename Key_t>
+static bool EraseKeysWithFlag(CDBWrapper& db, const char flag)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(flag);
+    CDBBatch batch(db);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        Key_t key;
+        if (!pcursor->GetKey(key) || key.first != flag)
+            break;
+        batch.Erase(key);
+        if (batch.SizeEstimate() > MAX_DATABASE_BATCH_SIZE) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+    return db.WriteBatch(batch);
+}
+
+bool CAssetsDB::BuildAssetPrefixIndex()
+{
+    LogPrintf("%s: Building the asset name prefix index\n", __func__);
+
+    // Remove counters left behind by an interrupted build
+    if (!EraseKeysWithFlag<std::pair<char, std::pair<uint8_t, std::string> > >(*this, ASSET_PREFIX_COUNT_FLAG))
+        return error("%s: failed to erase old prefix counts", __func__);
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CDBBatch batch(*this);
+
+    // Names arrive ordered by (length, name), so every prefix counter is final once the cursor moves past it.
+    // Count in memory and write out each length group as it completes
+    std::map<std::string, uint32_t> mapCounts;
+    size_t nCurrentLength = 0;
+    size_t nAssets = 0;
+    auto fnWriteCounts = [&]() {
+        for (const auto& item : mapCounts)
+            batch.Write(PrefixCountKey(nCurrentLength, item.first), item.second);
+        mapCounts.clear();
+        bool ret = WriteBatch(batch);
+        batch.Clear();
+        return ret;
+    };
+
+    pcursor->Seek(std::make_pair(ASSET_FLAG, std::string()));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, std::string> key;
+        if (!pcursor->GetKey(key) || key.first != ASSET_FLAG)
+            break;
+
+        if (key.second.size() != nCurrentLength) {
+            if (!fnWriteCounts())
+                return error("%s: failed to write prefix counts", __func__);
+            nCurrentLength = key.second.size();
+        }
+
+        for (size_t i = 0; i <= key.second.size(); i++)
+            mapCounts[key.second.substr(0, i)]++;
+        nAssets++;
+        pcursor->Next();
+    }
+    if (!fnWriteCounts())
+        return error("%s: failed to write prefix counts", __func__);
+
+    LogPrintf("%s: Indexed %d asset names\n", __func__, nAssets);
+    return WriteFlag(ASSET_PREFIX_INDEX_FLAG, true);
+}
+
+/**
+ * Count and sum up the balance entries of one index (keyed by (flag, (group, member)) and sorted by
+ * group) per group, handing each finished group to fnGroup(group, nMembers, nTotal).
+ */
+template <typename Callable>
+static bool AggregateQuantityIndex(CDBWrapper& db, const char flag, Callable fnGroup)
+{
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(flag, std::make_pair(std::string(), std::string())));
+
+    std::string group;
+    uint32_t nMembers = 0;
+    CAmount nTotal = 0;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, std::pair<std::string, std::string> > key;
+        if (!pcursor->GetKey(key) || key.first != flag)
+            break;
+
+        CAmount nAmount;
+        if (!pcursor->GetValue(nAmount))
+            return error("%s: failed to read quantity", __func__);
+
+        if (key.second.first != group) {
+            if (nMembers && !fnGroup(group, nMembers, nTotal))
+                return false;
+            group = key.second.first;
+            nMembers = 0;
+            nTotal = 0;
+        }
+
+        nMembers++;
+        nTotal += nAmount;
+        pcursor->Next();
+    }
+
+    if (nMembers && !fnGroup(group, nMembers, nTotal))
+        return false;
+    return true;
+}
+
+bool CAssetsDB::BuildAssetHolderStats()
+{
+    LogPrintf("%s: Building the asset holder totals\n", __func__);
+
+    if (!EraseKeysWithFlag<std::pair<char, std::string> >(*this, ASSET_HOLDER_STATS_FLAG) ||
+            !EraseKeysWithFlag<std::pair<char, std::string> >(*this, ADDRESS_ASSET_COUNT_FLAG))
+        return error("%s: failed to erase old holder totals", __func__);
+
+    CDBBatch batch(*this);
+    auto fnFlush = [&]() {
+        if (batch.SizeEstimate() <= MAX_DATABASE_BATCH_SIZE)
+            return true;
+        bool ret = WriteBatch(batch);
+        batch.Clear();
+        return ret;
+    };
+
+    bool ret = AggregateQuantityIndex(*this, ASSET_ADDRESS_QUANTITY_FLAG, [&](const std::string& assetName, uint32_t nHolders, CAmount nSupply) {
+        CAssetHolderStats stats;
+        stats.nHolders = nHolders;
+        stats.nSupply = nSupply;
+        batch.Write(std::make_pair(ASSET_HOLDER_STATS_FLAG, assetName), stats);
+        return fnFlush();
+    });
+
+    ret = ret && AggregateQuantityIndex(*this, ADDRESS_ASSET_QUANTITY_FLAG, [&](const std::string& address, uint32_t nAssets, CAmount nTotal) {
+        batch.Write(std::make_pair(ADDRESS_ASSET_COUNT_FLAG, address), nAssets);
+        return fnFlush();
+    });
+
+    if (!ret || !WriteBatch(batch))
+        return error("%s: failed to write holder totals", __func__);
+
+    return WriteFlag(ASSET_HOLDER_STATS_INDEX_FLAG, true);
+}
+
+bool CAssetsDB::LoadAssetNames()
+{
+    assetNameTable.Clear();
+
+    std::vector<std::pair<uint32_t, std::string> > vNames;
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(ASSET_ID_NAME_FLAG, (uint32_t)0));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint32_t> key;
+        if (!pcursor->GetKey(key) || key.first != ASSET_ID_NAME_FLAG)
+            break;
+
+        std::string name;
+        if (!pcursor->GetValue(name))
+            return error("%s: failed to read asset name", __func__);
+        vNames.emplace_back(key.second, name);
+        pcursor->Next();
+    }
+
+    // Ids are serialized little endian, so the keys don't come back in id order
+    std::sort(vNames.begin(), vNames.end());
+    for (const auto& item : vNames) {
+        if (!assetNameTable.Load(item.first, item.second))
+            return error("%s: asset name ids are inconsistent at id %u (%s)", __func__, item.first, item.second);
+    }
+
+    return true;
+}
+
+bool CAssetsDB::BuildAssetNameIds()
+{
+    LogPrintf("%s: Assigning ids to the asset names\n", __func__);
+
+    CAssetsDBBatch batch(*this);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(ASSET_FLAG, std::string()));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, std::string> key;
+        if (!pcursor->GetKey(key) || key.first != ASSET_FLAG)
+            break;
+
+        assetNameTable.GetOrAssign(key.second);
+        pcursor->Next();
+    }
+
+    // The batch writes out every id that hasn't been persisted yet
+    if (!batch.Commit())
+        return error("%s: failed to write asset name ids", __func__);
+
+    LogPrintf("%s: Assigned ids to %u asset names\n", __func__, assetNameTable.Size());
+    return WriteFlag(ASSET_NAME_IDS_FLAG, true);
+}
+
+bool CAssetsDB::ReadAssetId(const std::string& assetName, uint32_t& id)
+{
+    return Read(std::make_pair(ASSET_ID_FLAG, assetName), id);
+}
+
 bool CAssetsDB::LoadAssets()
 {
+    if (!LoadAssetNames())
+        return error("%s: failed to load the asset name ids", __func__);
+
+    bool fNameIds = false;
+    if (!ReadFlag(ASSET_NAME_IDS_FLAG, fNameIds) || !fNameIds) {
+        if (!BuildAssetNameIds())
+            return error("%s: failed to assign asset name ids", __func__);
+    }
+
+    bool fPrefixIndex = false;
+    if (!ReadFlag(ASSET_PREFIX_INDEX_FLAG, fPrefixIndex) || !fPrefixIndex) {
+        if (!BuildAssetPrefixIndex())
+            return error("%s: failed to build the asset prefix index", __func__);
+    }
+
+    bool fHolderStats = false;
+    if (fAssetIndex && (!ReadFlag(ASSET_HOLDER_STATS_INDEX_FLAG, fHolderStats) || !fHolderStats)) {
+        if (!BuildAssetHolderStats())
+            return error("%s: failed to build the asset holder totals", __func__);
+    }
+
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(ASSET_FLAG, std::string()));
@@ -134,7 +641,7 @@ bool CAssetsDB::LoadAssets()
 
                 // Loaded enough from database to have in memory.
                 // No need to load everything if it is just going to be removed from the cache
-                if (passetsCache->Size() == (passetsCache->MaxSize() / 2))
+                if (passetsCache->Size() >= (passetsCache->MaxSize() / 2))
                     break;
             } else {
                 return error("%s: failed to read asset", __func__);
@@ -157,7 +664,7 @@ bool CAssetsDB::LoadAssets()
                 CAmount value;
                 if (pcursor3->GetValue(value)) {
                     passets->mapAssetsAddressAmount.insert(
-                            std::make_pair(std::make_pair(key.second.first, key.second.second), value));
+                            std::make_pair(std::make_pair(assetNameTable.GetOrAssign(key.second.first), key.second.second), value));
                     if (passets->mapAssetsAddressAmount.size() > MAX_CACHE_ASSETS_SIZE)
                         break;
                     pcursor3->Next();
@@ -173,75 +680,244 @@ bool CAssetsDB::LoadAssets()
     return true;
 }
 
-bool CAssetsDB::AssetDir(std::vector<CDatabasedAssetData>& assets, const std::string filter, const size_t count, const long start)
+static uint32_t ReadPrefixCount(const CDBSnapshot& snapshot, const size_t nLength, const std::string& prefix)
 {
-    FlushStateToDisk();
+    uint32_t nCount = 0;
+    snapshot.Read(PrefixCountKey(nLength, prefix), nCount);
+    return nCount;
+}
 
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(ASSET_FLAG, std::string()));
+/** Number of stored assets whose name starts with prefix */
+static size_t CountAssetsWithPrefix(const CDBSnapshot& snapshot, const std::string& prefix)
+{
+    size_t nCount = 0;
+    for (size_t nLength = prefix.size(); nLength <= MAX_ASSET_LENGTH; nLength++)
+        nCount += ReadPrefixCount(snapshot, nLength, prefix);
+    return nCount;
+}
+
+/** Visit the counters of the one character extensions of prefix among names of length nLength, in key order */
+template <typename Callable>
+static void ForEachPrefixChild(const CDBSnapshot& snapshot, const size_t nLength, const std::string& prefix, Callable fnVisit)
+{
+    std::unique_ptr<CDBIterator> pcursor(snapshot.NewIterator());
+    pcursor->Seek(PrefixCountKey(nLength, prefix + std::string(1, '\0')));
+    while (pcursor->Valid()) {
+        std::pair<char, std::pair<uint8_t, std::string> > key;
+        if (!pcursor->GetKey(key) || key.first != ASSET_PREFIX_COUNT_FLAG || key.second.first != nLength ||
+                key.second.second.size() != prefix.size() + 1 || !HasPrefix(key.second.second, prefix))
+            break;
+
+        uint32_t nCount = 0;
+        if (!pcursor->GetValue(nCount) || !fnVisit(key.second.second, nCount))
+            break;
+        pcursor->Next();
+    }
+}
+
+/** Number of stored assets starting with prefix that sort before name */
+static size_t RankAsset(const CDBSnapshot& snapshot, const std::string& prefix, const std::string& name)
+{
+    size_t nRank = 0;
+    for (size_t nLength = prefix.size(); nLength < name.size(); nLength++)
+        nRank += ReadPrefixCount(snapshot, nLength, prefix);
+
+    std::string current = prefix;
+    for (size_t i = prefix.size(); i < name.size(); i++) {
+        const std::string bound = name.substr(0, i + 1);
+        ForEachPrefixChild(snapshot, name.size(), current, [&](const std::string& child, uint32_t nCount) {
+            if (child >= bound)
+                return false;
+            nRank += nCount;
+            return true;
+        });
+        current = bound;
+    }
+
+    return nRank;
+}
+
+/** Find the name of the stored asset at position nRank among those starting with prefix */
+static bool SelectAssetByRank(const CDBSnapshot& snapshot, const std::string& prefix, size_t nRank, std::string& name)
+{
+    size_t nLength = prefix.size();
+    for (; nLength <= MAX_ASSET_LENGTH; nLength++) {
+        size_t nCount = ReadPrefixCount(snapshot, nLength, prefix);
+        if (nRank < nCount)
+            break;
+        nRank -= nCount;
+    }
+    if (nLength > MAX_ASSET_LENGTH)
+        return false;
+
+    std::string current = prefix;
+    while (current.size() < nLength) {
+        bool fFound = false;
+        ForEachPrefixChild(snapshot, nLength, current, [&](const std::string& child, uint32_t nCount) {
+            if (nRank < nCount) {
+                current = child;
+                fFound = true;
+                return false;
+            }
+            nRank -= nCount;
+            return true;
+        });
+        if (!fFound)
+            return error("%s: asset prefix index is inconsistent for prefix %s", __func__, current);
+    }
+
+    name = current;
+    return true;
+}
 
+bool CAssetsDB::AssetDir(std::vector<CDatabasedAssetData>& assets, const std::string filter, const size_t count, const long start)
+{
     auto prefix = filter;
     bool wildcard = prefix.back() == '*';
     if (wildcard)
         prefix.pop_back();
 
+    // Take a snapshot of the database together with the asset changes that haven't been flushed to it yet.
+    // Both are captured under cs_main, which the flush holds, so they describe the same chain state and
+    // the listing itself can run without holding any lock.
+    std::map<std::string, CDatabasedAssetData> mapDirty;
+    std::set<std::string> setRemoved;
+    std::unique_ptr<CDBSnapshot> psnapshot;
+    {
+        LOCK(cs_main);
+        psnapshot.reset(new CDBSnapshot(*this));
+        if (passets) {
+            auto fMatches = [&](const std::string& name) {
+                return wildcard ? HasPrefix(name, prefix) : name == prefix;
+            };
+
+            for (const auto& newAsset : passets->setNewAssetsToAdd)
+                if (fMatches(newAsset.asset.strName))
+                    mapDirty[newAsset.asset.strName] = CDatabasedAssetData(newAsset.asset, newAsset.blockHeight, newAsset.blockHash);
+
+            for (const auto& reissue : passets->setNewReissueToAdd) {
+                const std::string& name = reissue.reissue.strName;
+                if (fMatches(name) && passets->mapReissuedAssetData.count(name))
+                    mapDirty[name] = CDatabasedAssetData(passets->mapReissuedAssetData.at(name), reissue.blockHeight, reissue.blockHash);
+            }
+
+            for (const auto& removedAsset : passets->setNewAssetsToRemove)
+                if (fMatches(removedAsset.asset.strName) && !mapDirty.count(removedAsset.asset.strName))
+                    setRemoved.insert(removedAsset.asset.strName);
+        }
+    }
+    const CDBSnapshot& snapshot = *psnapshot;
+
+    // Split the dirty state into names the snapshot doesn't have yet and names it has but that are gone
+    std::vector<std::pair<std::string, bool> > vChanges; // (name, fAdded)
+    for (const auto& item : mapDirty)
+        if (!snapshot.Exists(std::make_pair(ASSET_FLAG, item.first)))
+            vChanges.emplace_back(item.first, true);
+    for (const auto& name : setRemoved)
+        if (snapshot.Exists(std::make_pair(ASSET_FLAG, name)))
+            vChanges.emplace_back(name, false);
+    std::sort(vChanges.begin(), vChanges.end(), [](const std::pair<std::string, bool>& a, const std::pair<std::string, bool>& b) {
+        return AssetKeyLess(a.first, b.first);
+    });
+
+    size_t nAdded = 0;
+    for (const auto& change : vChanges)
+        nAdded += change.second;
+    size_t nStored = wildcard ? CountAssetsWithPrefix(snapshot, prefix) : snapshot.Exists(std::make_pair(ASSET_FLAG, prefix));
+    long table_size = nStored + nAdded - (vChanges.size() - nAdded);
+
     size_t skip = 0;
     if (start >= 0) {
         skip = start;
+    } else if (table_size + start > 0) {
+        // backwards offset
+        skip = table_size + start;
     }
-    else {
-        // compute table size for backwards offset
-        long table_size = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
 
-            std::pair<char, std::string> key;
-            if (pcursor->GetKey(key) && key.first == ASSET_FLAG) {
-                if (prefix == "" ||
-                    (wildcard && key.second.find(prefix) == 0) ||
-                    (!wildcard && key.second == prefix)) {
-                    table_size += 1;
-                }
-            }
-            pcursor->Next();
+    if (skip >= (size_t)table_size || count == 0)
+        return true;
+
+    auto fnLoad = [&](const std::string& name) {
+        auto it = mapDirty.find(name);
+        if (it != mapDirty.end()) {
+            assets.push_back(it->second);
+            return true;
         }
-        skip = table_size + start;
-        pcursor->SeekToFirst();
+
+        CDatabasedAssetData data;
+        if (!snapshot.Read(std::make_pair(ASSET_FLAG, name), data))
+            return error("%s: failed to read asset %s", __func__, name);
+        assets.push_back(data);
+        return true;
+    };
+
+    if (!wildcard)
+        return fnLoad(prefix);
+
+    // Walk the changes in key order to translate the requested position into a position in the snapshot
+    size_t nChange = 0;
+    long nShift = 0;
+    for (; nChange < vChanges.size(); nChange++) {
+        const auto& change = vChanges[nChange];
+        size_t nPosition = RankAsset(snapshot, prefix, change.first) + nShift;
+        if (change.second ? nPosition >= skip : nPosition > skip)
+            break;
+        nShift += change.second ? 1 : -1;
     }
+    size_t nStoredSkip = skip - nShift;
 
+    std::string startName;
+    bool fStored = nStoredSkip < nStored && SelectAssetByRank(snapshot, prefix, nStoredSkip, startName);
 
-    size_t loaded = 0;
-    size_t offset = 0;
+    // Merge the snapshot range starting at startName with the names that were added since
+    auto fnEmitAddedBefore = [&](const std::string* pname) {
+        for (; nChange < vChanges.size() && assets.size() < count; nChange++) {
+            if (pname && !AssetKeyLess(vChanges[nChange].first, *pname))
+                break;
+            if (vChanges[nChange].second && !fnLoad(vChanges[nChange].first))
+                return false;
+        }
+        return true;
+    };
 
-    // Load assets
-    while (pcursor->Valid() && loaded < count) {
-        boost::this_thread::interruption_point();
+    if (fStored) {
+        std::unique_ptr<CDBIterator> pcursor(snapshot.NewIterator());
+        for (size_t nLength = startName.size(); nLength <= MAX_ASSET_LENGTH && assets.size() < count; nLength++) {
+            if (!ReadPrefixCount(snapshot, nLength, prefix))
+                continue;
 
-        std::pair<char, std::string> key;
-        if (pcursor->GetKey(key) && key.first == ASSET_FLAG) {
-            if (prefix == "" ||
-                    (wildcard && key.second.find(prefix) == 0) ||
-                    (!wildcard && key.second == prefix)) {
-                if (offset < skip) {
-                    offset += 1;
-                }
-                else {
-                    CDatabasedAssetData data;
-                    if (pcursor->GetValue(data)) {
-                        assets.push_back(data);
-                        loaded += 1;
+            if (nLength == startName.size())
+                pcursor->Seek(std::make_pair(ASSET_FLAG, startName));
+            else
+                pcursor->Seek(std::make_pair(ASSET_FLAG, prefix + std::string(nLength - prefix.size(), '\0')));
+
+            while (pcursor->Valid() && assets.size() < count) {
+                boost::this_thread::interruption_point();
+
+                std::pair<char, std::string> key;
+                if (!pcursor->GetKey(key) || key.first != ASSET_FLAG || key.second.size() != nLength || !HasPrefix(key.second, prefix))
+                    break;
+
+                if (!fnEmitAddedBefore(&key.second))
+                    return false;
+
+                if (assets.size() < count && !setRemoved.count(key.second)) {
+                    auto it = mapDirty.find(key.second);
+                    if (it != mapDirty.end()) {
+                        assets.push_back(it->second);
                     } else {
-                        return error("%s: failed to read asset", __func__);
+                        CDatabasedAssetData data;
+                        if (!pcursor->GetValue(data))
+                            return error("%s: failed to read asset", __func__);
+                        assets.push_back(data);
                     }
                 }
+                pcursor->Next();
             }
-            pcursor->Next();
-        } else {
-            break;
         }
     }
 
-    return true;
+    return fnEmitAddedBefore(nullptr);
 }
 
 bool CAssetsDB::AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAssetAmount, int& totalEntries, const bool& fGetTotal, const std::string& address, const size_t count, const long start)
@@ -251,17 +927,12 @@ bool CAssetsDB::AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAss
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
     pcursor->Seek(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, std::string())));
 
-    if (fGetTotal) {
-        totalEntries = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
+    // The number of assets held is maintained with every balance write
+    uint32_t nAssets = 0;
+    ReadAddressAssetCount(address, nAssets);
 
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ADDRESS_ASSET_QUANTITY_FLAG && key.second.first == address) {
-                totalEntries++;
-            }
-            pcursor->Next();
-        }
+    if (fGetTotal) {
+        totalEntries = nAssets;
         return true;
     }
 
@@ -270,19 +941,9 @@ bool CAssetsDB::AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAss
         skip = start;
     }
     else {
-        // compute table size for backwards offset
-        long table_size = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
-
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ADDRESS_ASSET_QUANTITY_FLAG && key.second.first == address) {
-                table_size += 1;
-            }
-            pcursor->Next();
-        }
+        // backwards offset
+        long table_size = nAssets;
         skip = table_size + start;
-        pcursor->SeekToFirst();
     }
 
 
@@ -324,17 +985,12 @@ bool CAssetsDB::AssetAddressDir(std::vector<std::pair<std::string, CAmount> >& v
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
     pcursor->Seek(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, std::string())));
 
-    if (fGetTotal) {
-        totalEntries = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
+    // The holder count is maintained with every balance write
+    CAssetHolderStats stats;
+    ReadAssetHolderStats(assetName, stats);
 
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ASSET_ADDRESS_QUANTITY_FLAG && key.second.first == assetName) {
-                totalEntries += 1;
-            }
-            pcursor->Next();
-        }
+    if (fGetTotal) {
+        totalEntries = stats.nHolders;
         return true;
     }
 
@@ -343,19 +999,9 @@ bool CAssetsDB::AssetAddressDir(std::vector<std::pair<std::string, CAmount> >& v
         skip = start;
     }
     else {
-        // compute table size for backwards offset
-        long table_size = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
-
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ASSET_ADDRESS_QUANTITY_FLAG && key.second.first == assetName) {
-                table_size += 1;
-            }
-            pcursor->Next();
-        }
+        // backwards offset
+        long table_size = stats.nHolders;
         skip = table_size + start;
-        pcursor->SeekToFirst();
     }
 
     size_t loaded = 0;
@@ -35,6 +35,32 @@ struct CBlockAssetUndo
     }
 };
 
+/** Totals over every balance of an asset stored in the asset address index, kept in step with it */
+struct CAssetHolderStats
+{
+    uint32_t nHolders;
+    CAmount nSupply;
+
+    CAssetHolderStats()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        nHolders = 0;
+        nSupply = 0;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nHolders);
+        READWRITE(nSupply);
+    }
+};
+
 /** Access to the block database (blocks/index/) */
 class CAssetsDB : public CDBWrapper
 {
@@ -57,6 +83,10 @@ public:
     bool ReadAddressAssetQuantity(const std::string& address, const std::string& assetName, CAmount& quantity);
     bool ReadBlockUndoAssetData(const uint256& blockhash, std::vector<std::pair<std::string, CBlockAssetUndo> >& assetUndoData);
     bool ReadReissuedMempoolState();
+    bool ReadAssetHolderStats(const std::string& assetName, CAssetHolderStats& stats);
+    bool ReadBestBlock(uint256& hashBestBlock);
+    bool ReadAssetId(const std::string& assetName, uint32_t& id);
+    bool ReadAddressAssetCount(const std::string& address, uint32_t& nCount);
 
     // Erase from database functions
     bool EraseAssetData(const std::string& assetName);
@@ -64,8 +94,15 @@ public:
     bool EraseAssetAddressQuantity(const std::string &assetName, const std::string &address);
     bool EraseAddressAssetQuantity(const std::string &address, const std::string &assetName);
 
+    bool WriteFlag(const std::string& name, bool fValue);
+    bool ReadFlag(const std::string& name, bool& fValue);
+
     // Helper functions
     bool LoadAssets();
+    bool BuildAssetPrefixIndex();
+    bool BuildAssetHolderStats();
+    bool LoadAssetNames();
+    bool BuildAssetNameIds();
     bool AssetDir(std::vector<CDatabasedAssetData>& assets, const std::string filter, const size_t count, const long start);
     bool AssetDir(std::vector<CDatabasedAssetData>& assets);
 
@@ -73,5 +110,56 @@ public:
     bool AssetAddressDir(std::vector<std::pair<std::string, CAmount> >& vecAddressAmount, int& totalEntries, const bool& fGetTotal, const std::string& assetName, const size_t count, const long start);
 };
 
+/**
+ * Stages changes to the asset database so a whole cache dump is committed as one atomic LevelDB write.
+ * The derived indexes (name prefix counts, holder totals) are computed against the staged state, so
+ * several changes to the same key within one batch compose, and only their final values are written.
+ */
+class CAssetsDBBatch
+{
+public:
+    explicit CAssetsDBBatch(CAssetsDB& db);
+
+    CAssetsDBBatch(const CAssetsDBBatch&) = delete;
+    CAssetsDBBatch& operator=(const CAssetsDBBatch&) = delete;
+
+    void WriteAssetData(const CNewAsset& asset, const int nHeight, const uint256& blockHash);
+    void WriteAssetAddressQuantity(const std::string& assetName, const std::string& address, const CAmount& quantity);
+    void WriteAddressAssetQuantity(const std::string& address, const std::string& assetName, const CAmount& quantity);
+    void WriteReissuedMempoolState();
+    void WriteBestBlock(const uint256& hashBestBlock);
+
+    void EraseAssetData(const std::string& assetName);
+    void EraseAssetAddressQuantity(const std::string& assetName, const std::string& address);
+    void EraseAddressAssetQuantity(const std::string& address, const std::string& assetName);
+
+    size_t SizeEstimate() const { return batch.SizeEstimate(); }
+
+    //! Write everything staged so far in a single batch and start over with an empty one
+    bool Commit(bool fSync = false);
+
+private:
+    CAssetsDB& db;
+    CDBBatch batch;
+
+    //! Staged state of the keys the derived indexes depend on, read from the database on first use
+    std::map<std::string, bool> mapAssetExists;
+    //! Balances are staged as (stored, quantity), the holder counts include stored zero balances
+    std::map<std::pair<std::string, std::string>, std::pair<bool, CAmount> > mapAssetAddressQuantity;
+    std::map<std::pair<std::string, std::string>, std::pair<bool, CAmount> > mapAddressAssetQuantity;
+
+    //! Staged values of the derived indexes
+    std::map<std::pair<uint8_t, std::string>, uint32_t> mapPrefixCounts;
+    std::map<std::string, CAssetHolderStats> mapHolderStats;
+    std::map<std::string, uint32_t> mapAddressAssetCounts;
+
+    bool AssetExists(const std::string& assetName);
+    bool GetQuantity(std::map<std::pair<std::string, std::string>, std::pair<bool, CAmount> >& mapQuantity, const char flag, const std::pair<std::string, std::string>& key, CAmount& nAmount);
+    void UpdateAssetPrefixCounts(const std::string& assetName, const int nChange);
+    void UpdateAssetHolderStats(const std::string& assetName, const bool fOldEntry, const CAmount nOld, const bool fNewEntry, const CAmount nNew);
+    void UpdateAddressAssetCount(const std::string& address, const bool fOldEntry, const bool fNewEntry);
+
+};
+
 
 #endif //BITCOIN_ASSETDB_H
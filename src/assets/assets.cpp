@@ -3,7 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
-#include <regex>
+#include <algorithm>
 #include <script/script.h>
 #include <version.h>
 #include <streams.h>
@@ -29,85 +29,187 @@
 #include "utilmoneystr.h"
 #include "coins.h"
 #include "wallet/wallet.h"
+#include "hash.h"
+#include "random.h"
 
 std::map<uint256, std::string> mapReissuedTx;
 std::map<std::string, uint256> mapReissuedAssets;
 
+CAssetNameTable assetNameTable;
+
+std::pair<uint32_t, std::string> CAssets::AssetAddressKey(const std::string& assetName, const std::string& address)
+{
+    std::pair<uint32_t, std::string> key;
+    if (FindAssetAddressKey(assetName, address, key))
+        return key;
+
+    uint32_t id = PROVISIONAL_ID_FLAG | vProvisionalNames.size();
+    vProvisionalNames.push_back(assetName);
+    mapProvisionalIds.emplace(assetName, id);
+    return std::make_pair(id, address);
+}
+
+bool CAssets::FindAssetAddressKey(const std::string& assetName, const std::string& address, std::pair<uint32_t, std::string>& key) const
+{
+    // A name interned while this cache holds a provisional id for it keeps using the provisional one
+    uint32_t id;
+    auto it = mapProvisionalIds.find(assetName);
+    if (it != mapProvisionalIds.end())
+        id = it->second;
+    else if (!assetNameTable.GetId(assetName, id))
+        return false;
+
+    key = std::make_pair(id, address);
+    return true;
+}
+
+CAssetCacheHasher::CAssetCacheHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+size_t CAssetCacheHasher::HashBytes(const unsigned char* data, size_t size) const
+{
+    return CSipHasher(k0, k1).Write(data, size).Finalize();
+}
+
+size_t CAssetCacheHasher::HashOutPoint(const COutPoint& out) const
+{
+    return SipHashUint256Extra(k0, k1, out.hash, out.n);
+}
+
 // excluding owner tag ('!')
 static const auto MAX_NAME_LENGTH = 31;
 static const auto MAX_CHANNEL_NAME_LENGTH = 12;
 
-// min lengths are expressed by quantifiers
-static const std::regex ROOT_NAME_CHARACTERS("^[A-Z0-9._]{3,}$");
-static const std::regex SUB_NAME_CHARACTERS("^[A-Z0-9._]+$");
-static const std::regex UNIQUE_TAG_CHARACTERS("^[-A-Za-z0-9@$%&*()[\\]{}_.?:]+$");
-static const std::regex CHANNEL_TAG_CHARACTERS("^[A-Z0-9._]+$");
-static const std::regex VOTE_TAG_CHARACTERS("^[A-Z0-9._]+$");
-
-static const std::regex DOUBLE_PUNCTUATION("^.*[._]{2,}.*$");
-static const std::regex LEADING_PUNCTUATION("^[._].*$");
-static const std::regex TRAILING_PUNCTUATION("^.*[._]$");
-
 static const std::string SUB_NAME_DELIMITER = "/";
 static const std::string UNIQUE_TAG_DELIMITER = "#";
 static const std::string CHANNEL_TAG_DELIMITER = "~";
 static const std::string VOTE_TAG_DELIMITER = "^";
 
-static const std::regex UNIQUE_INDICATOR(R"(^[^^~#!]+#[^~#!\/]+$)");
-static const std::regex CHANNEL_INDICATOR(R"(^[^^~#!]+~[^~#!\/]+$)");
-static const std::regex OWNER_INDICATOR(R"(^[^^~#!]+!$)");
-static const std::regex VOTE_INDICATOR(R"(^[^^~#!]+\^[^~#!\/]+$)");
+/**
+ * Asset names are checked in a single pass over their characters. The accepted language is the one of
+ * the regular expressions these checks replaced, which test/assets/asset_name_tests.cpp keeps:
+ *
+ *   root names       ^[A-Z0-9._]{3,}$, not BLAST or BLASTCOIN
+ *   sub names        ^[A-Z0-9._]+$
+ *   channel tags     ^[A-Z0-9._]+$
+ *   vote tags        ^[A-Z0-9._]+$
+ *   unique tags      ^[-A-Za-z0-9@$%&*()[\]{}_.?:]+$
+ *
+ * Root names, sub names and channel tags also can't start or end with '.' or '_', or contain two of
+ * them in a row.
+ */
+static inline bool IsNameChar(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '_';
+}
+
+static inline bool IsNamePunctuation(char c)
+{
+    return c == '.' || c == '_';
+}
+
+static inline bool IsUniqueTagChar(char c)
+{
+    if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))
+        return true;
 
-static const std::regex BLAST_NAMES("^BLAST$|^BLASTCOIN$");
+    switch (c) {
+        case '-': case '@': case '$': case '%': case '&': case '*': case '(': case ')':
+        case '[': case ']': case '{': case '}': case '_': case '.': case '?': case ':':
+            return true;
+        default:
+            return false;
+    }
+}
+
+//! [begin, end) has at least nMinLength name characters, with punctuation only between other characters
+static bool IsNameSegmentValid(const char* begin, const char* end, size_t nMinLength)
+{
+    if (end - begin < (ptrdiff_t)nMinLength || begin == end)
+        return false;
+
+    if (IsNamePunctuation(*begin) || IsNamePunctuation(*(end - 1)))
+        return false;
+
+    bool fLastPunctuation = false;
+    for (const char* p = begin; p != end; ++p) {
+        if (!IsNameChar(*p))
+            return false;
+        bool fPunctuation = IsNamePunctuation(*p);
+        if (fPunctuation && fLastPunctuation)
+            return false;
+        fLastPunctuation = fPunctuation;
+    }
+
+    return true;
+}
+
+static bool IsRootNameValid(const char* begin, const char* end)
+{
+    if (!IsNameSegmentValid(begin, end, MIN_ASSET_LENGTH))
+        return false;
+
+    std::string::size_type nSize = end - begin;
+    return !(nSize == 5 && std::equal(begin, end, "BLAST")) && !(nSize == 9 && std::equal(begin, end, "BLASTCOIN"));
+}
+
+/**
+ * The names the type indicators accept: <prefix><delimiter><tag>, where the prefix has none of ^ ~ # !
+ * and the tag, which can't be empty, has none of ~ # ! /. The delimiter is the first of ^ ~ # ! in the name.
+ */
+static bool HasTypeIndicator(const std::string& name, char delimiter)
+{
+    std::string::size_type i = name.find_first_of("^~#!");
+    if (i == 0 || i == std::string::npos || name[i] != delimiter || i + 1 == name.size())
+        return false;
+
+    return name.find_first_of("~#!/", i + 1) == std::string::npos;
+}
+
+static bool HasOwnerIndicator(const std::string& name)
+{
+    std::string::size_type i = name.find_first_of("^~#!");
+    return i != 0 && i != std::string::npos && name[i] == '!' && i + 1 == name.size();
+}
 
 bool IsRootNameValid(const std::string& name)
 {
-    return std::regex_match(name, ROOT_NAME_CHARACTERS)
-        && !std::regex_match(name, DOUBLE_PUNCTUATION)
-        && !std::regex_match(name, LEADING_PUNCTUATION)
-        && !std::regex_match(name, TRAILING_PUNCTUATION)
-        && !std::regex_match(name, BLAST_NAMES);
+    return IsRootNameValid(name.data(), name.data() + name.size());
 }
 
 bool IsSubNameValid(const std::string& name)
 {
-    return std::regex_match(name, SUB_NAME_CHARACTERS)
-        && !std::regex_match(name, DOUBLE_PUNCTUATION)
-        && !std::regex_match(name, LEADING_PUNCTUATION)
-        && !std::regex_match(name, TRAILING_PUNCTUATION);
+    return IsNameSegmentValid(name.data(), name.data() + name.size(), 1);
 }
 
 bool IsUniqueTagValid(const std::string& tag)
 {
-    return std::regex_match(tag, UNIQUE_TAG_CHARACTERS);
+    return !tag.empty() && std::all_of(tag.begin(), tag.end(), IsUniqueTagChar);
 }
 
 bool IsVoteTagValid(const std::string& tag)
 {
-    return std::regex_match(tag, VOTE_TAG_CHARACTERS);
+    return !tag.empty() && std::all_of(tag.begin(), tag.end(), IsNameChar);
 }
 
 bool IsChannelTagValid(const std::string& tag)
 {
-    return std::regex_match(tag, CHANNEL_TAG_CHARACTERS)
-        && !std::regex_match(tag, DOUBLE_PUNCTUATION)
-        && !std::regex_match(tag, LEADING_PUNCTUATION)
-        && !std::regex_match(tag, TRAILING_PUNCTUATION);
+    return IsNameSegmentValid(tag.data(), tag.data() + tag.size(), 1);
 }
 
 bool IsNameValidBeforeTag(const std::string& name)
 {
-    std::vector<std::string> parts;
-    boost::split(parts, name, boost::is_any_of(SUB_NAME_DELIMITER));
+    const char* begin = name.data();
+    const char* end = name.data() + name.size();
 
-    if (!IsRootNameValid(parts.front())) return false;
+    const char* segment = std::find(begin, end, SUB_NAME_DELIMITER[0]);
+    if (!IsRootNameValid(begin, segment))
+        return false;
 
-    if (parts.size() > 1)
-    {
-        for (unsigned long i = 1; i < parts.size(); i++)
-        {
-            if (!IsSubNameValid(parts[i])) return false;
-        }
+    while (segment != end) {
+        const char* next = std::find(segment + 1, end, SUB_NAME_DELIMITER[0]);
+        if (!IsNameSegmentValid(segment + 1, next, 1))
+            return false;
+        segment = next;
     }
 
     return true;
@@ -115,18 +217,17 @@ bool IsNameValidBeforeTag(const std::string& name)
 
 bool IsAssetNameASubasset(const std::string& name)
 {
-    std::vector<std::string> parts;
-    boost::split(parts, name, boost::is_any_of(SUB_NAME_DELIMITER));
-
-    if (!IsRootNameValid(parts.front())) return false;
+    std::string::size_type nDelimiter = name.find(SUB_NAME_DELIMITER);
+    if (!IsRootNameValid(name.data(), name.data() + std::min(nDelimiter, name.size())))
+        return false;
 
-    return parts.size() > 1;
+    return nDelimiter != std::string::npos;
 }
 
 bool IsAssetNameValid(const std::string& name, AssetType& assetType, std::string& error)
 {
     assetType = AssetType::INVALID;
-    if (std::regex_match(name, UNIQUE_INDICATOR))
+    if (HasTypeIndicator(name, UNIQUE_TAG_DELIMITER[0]))
     {
         bool ret = IsTypeCheckNameValid(AssetType::UNIQUE, name, error);
         if (ret)
@@ -134,7 +235,7 @@ bool IsAssetNameValid(const std::string& name, AssetType& assetType, std::string
 
         return ret;
     }
-    else if (std::regex_match(name, CHANNEL_INDICATOR))
+    else if (HasTypeIndicator(name, CHANNEL_TAG_DELIMITER[0]))
     {
         bool ret = IsTypeCheckNameValid(AssetType::MSGCHANNEL, name, error);
         if (ret)
@@ -142,7 +243,7 @@ bool IsAssetNameValid(const std::string& name, AssetType& assetType, std::string
 
         return ret;
     }
-    else if (std::regex_match(name, OWNER_INDICATOR))
+    else if (HasOwnerIndicator(name))
     {
         bool ret = IsTypeCheckNameValid(AssetType::OWNER, name, error);
         if (ret)
@@ -150,7 +251,7 @@ bool IsAssetNameValid(const std::string& name, AssetType& assetType, std::string
 
         return ret;
     }
-    else if (std::regex_match(name, VOTE_INDICATOR))
+    else if (HasTypeIndicator(name, VOTE_TAG_DELIMITER[0]))
     {
         bool ret = IsTypeCheckNameValid(AssetType::VOTE, name, error);
         if (ret)
@@ -184,7 +285,7 @@ bool IsAssetNameValid(const std::string& name, AssetType& assetType)
 
 bool IsAssetNameAnOwner(const std::string& name)
 {
-    return IsAssetNameValid(name) && std::regex_match(name, OWNER_INDICATOR);
+    return IsAssetNameValid(name) && HasOwnerIndicator(name);
 }
 
 // TODO get the string translated below
@@ -192,17 +293,17 @@ bool IsTypeCheckNameValid(const AssetType type, const std::string& name, std::st
 {
     if (type == AssetType::UNIQUE) {
         if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
-        std::vector<std::string> parts;
-        boost::split(parts, name, boost::is_any_of(UNIQUE_TAG_DELIMITER));
-        bool valid = IsNameValidBeforeTag(parts.front()) && IsUniqueTagValid(parts.back());
+        std::string front = name.substr(0, name.find(UNIQUE_TAG_DELIMITER));
+        std::string back = name.substr(name.rfind(UNIQUE_TAG_DELIMITER) + 1);
+        bool valid = IsNameValidBeforeTag(front) && IsUniqueTagValid(back);
         if (!valid) { error = "Unique name contains invalid characters (Valid characters are: A-Z a-z 0-9 @ $ % & * ( ) [ ] { } _ . ? : -)";  return false; }
         return true;
     } else if (type == AssetType::MSGCHANNEL) {
         if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
-        std::vector<std::string> parts;
-        boost::split(parts, name, boost::is_any_of(CHANNEL_TAG_DELIMITER));
-        bool valid = IsNameValidBeforeTag(parts.front()) && IsChannelTagValid(parts.back());
-        if (parts.back().size() > MAX_CHANNEL_NAME_LENGTH) { error = "Channel name is greater than max length of " + std::to_string(MAX_CHANNEL_NAME_LENGTH); return false; }
+        std::string front = name.substr(0, name.find(CHANNEL_TAG_DELIMITER));
+        std::string back = name.substr(name.rfind(CHANNEL_TAG_DELIMITER) + 1);
+        bool valid = IsNameValidBeforeTag(front) && IsChannelTagValid(back);
+        if (back.size() > MAX_CHANNEL_NAME_LENGTH) { error = "Channel name is greater than max length of " + std::to_string(MAX_CHANNEL_NAME_LENGTH); return false; }
         if (!valid) { error = "Message Channel name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
         return true;
     } else if (type == AssetType::OWNER) {
@@ -212,9 +313,9 @@ bool IsTypeCheckNameValid(const AssetType type, const std::string& name, std::st
         return true;
     } else if (type == AssetType::VOTE) {
         if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
-        std::vector<std::string> parts;
-        boost::split(parts, name, boost::is_any_of(VOTE_TAG_DELIMITER));
-        bool valid = IsNameValidBeforeTag(parts.front()) && IsVoteTagValid(parts.back());
+        std::string front = name.substr(0, name.find(VOTE_TAG_DELIMITER));
+        std::string back = name.substr(name.rfind(VOTE_TAG_DELIMITER) + 1);
+        bool valid = IsNameValidBeforeTag(front) && IsVoteTagValid(back);
         if (!valid) { error = "Vote name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
         return true;
     } else {
@@ -273,6 +374,16 @@ bool CNewAsset::IsValid(std::string& strError, CAssetsCache& assetCache, bool fC
 {
     strError = "";
 
+    if (!IsNameAvailable(strError, assetCache, fCheckMempool, fCheckDuplicateInputs, fForceDuplicateCheck))
+        return false;
+
+    return IsValid(strError);
+}
+
+bool CNewAsset::IsNameAvailable(std::string& strError, CAssetsCache& assetCache, bool fCheckMempool, bool fCheckDuplicateInputs, bool fForceDuplicateCheck) const
+{
+    strError = "";
+
     // Check our current passets to see if the asset has been created yet
     if (fCheckDuplicateInputs) {
         if (assetCache.CheckIfAssetExists(this->strName, fForceDuplicateCheck)) {
@@ -288,6 +399,13 @@ bool CNewAsset::IsValid(std::string& strError, CAssetsCache& assetCache, bool fC
         }
     }
 
+    return true;
+}
+
+bool CNewAsset::IsValid(std::string& strError) const
+{
+    strError = "";
+
     AssetType assetType;
     if (!IsAssetNameValid(std::string(strName), assetType)) {
         strError = _("Invalid parameter: asset_name must only consist of valid characters and have a size between 3 and 30 characters. See help for more details.");
@@ -541,7 +659,14 @@ bool OwnerFromTransaction(const CTransaction& tx, std::string& ownerName, std::s
     return OwnerAssetFromScript(scriptPubKey, ownerName, strAddress);
 }
 
-bool TransferAssetFromScript(const CScript& scriptPubKey, CAssetTransfer& assetTransfer, std::string& strAddress)
+//! Decoded payloads of asset scripts. Keyed on the whole script, so an entry can never go stale
+static CShardedCache<CScript, CAssetScriptData, CAssetCacheHasher>& AssetScriptCache()
+{
+    static CShardedCache<CScript, CAssetScriptData, CAssetCacheHasher> cache(DEFAULT_ASSET_SCRIPT_CACHE_SIZE);
+    return cache;
+}
+
+static bool DecodeTransferAssetScript(const CScript& scriptPubKey, CAssetTransfer& assetTransfer, std::string& strAddress)
 {
     int nStartingIndex = 0;
     if (!IsScriptTransferAsset(scriptPubKey, nStartingIndex))
@@ -566,6 +691,70 @@ bool TransferAssetFromScript(const CScript& scriptPubKey, CAssetTransfer& assetT
     return true;
 }
 
+bool TransferAssetFromScript(const CScript& scriptPubKey, CAssetTransfer& assetTransfer, std::string& strAddress)
+{
+    if (!IsScriptTransferAsset(scriptPubKey))
+        return false;
+
+    // A transfer is only a name and an amount, so the cached payload is all of it
+    CAssetScriptData data;
+    if (!GetAssetScriptData(scriptPubKey, data))
+        return false;
+
+    assetTransfer = CAssetTransfer(data.assetName, data.nAmount);
+    strAddress = data.strAddress;
+    return true;
+}
+
+bool GetAssetScriptData(const CScript& scriptPubKey, CAssetScriptData& data)
+{
+    int nType = 0;
+    bool fIsOwner = false;
+    if (!scriptPubKey.IsAssetScript(nType, fIsOwner))
+        return false;
+
+    if (AssetScriptCache().Get(scriptPubKey, data))
+        return true;
+
+    data.SetNull();
+    data.nType = nType;
+    data.fIsOwner = fIsOwner;
+
+    if (nType == TX_TRANSFER_ASSET) {
+        CAssetTransfer transfer;
+        if (!DecodeTransferAssetScript(scriptPubKey, transfer, data.strAddress))
+            return false;
+        data.assetName = transfer.strName;
+        data.nAmount = transfer.nAmount;
+    } else if (nType == TX_NEW_ASSET && !fIsOwner) {
+        CNewAsset asset;
+        if (!AssetFromScript(scriptPubKey, asset, data.strAddress))
+            return false;
+        data.assetName = asset.strName;
+        data.nAmount = asset.nAmount;
+    } else if (nType == TX_NEW_ASSET && fIsOwner) {
+        if (!OwnerAssetFromScript(scriptPubKey, data.assetName, data.strAddress))
+            return false;
+        data.nAmount = OWNER_ASSET_AMOUNT;
+    } else if (nType == TX_REISSUE_ASSET) {
+        CReissueAsset reissue;
+        if (!ReissueAssetFromScript(scriptPubKey, reissue, data.strAddress))
+            return false;
+        data.assetName = reissue.strName;
+        data.nAmount = reissue.nAmount;
+    } else {
+        return false;
+    }
+
+    AssetScriptCache().Put(scriptPubKey, data);
+    return true;
+}
+
+void ClearAssetScriptCache()
+{
+    AssetScriptCache().Clear();
+}
+
 bool AssetFromScript(const CScript& scriptPubKey, CNewAsset& assetNew, std::string& strAddress)
 {
     int nStartingIndex = 0;
@@ -963,36 +1152,49 @@ CReissueAsset::CReissueAsset(const std::string &strAssetName, const CAmount &nAm
 bool CReissueAsset::IsValid(std::string &strError, CAssetsCache& assetCache, bool fForceCheckPrimaryAssetExists) const {
     strError = "";
 
-    if (fForceCheckPrimaryAssetExists) {
-        CNewAsset asset;
-        if (!assetCache.GetAssetMetaDataIfExists(this->strName, asset)) {
-            strError = _("Unable to reissue asset: asset_name '") + strName + _("' doesn't exist in the database");
-            return false;
-        }
+    if (fForceCheckPrimaryAssetExists && !IsReissuable(strError, assetCache))
+        return false;
 
-        if (!asset.nReissuable) {
-            // Check to make sure the asset can be reissued
-            strError = _("Unable to reissue asset: reissuable is set to false");
-            return false;
-        }
+    return IsValid(strError);
+}
 
-        if (asset.nAmount + this->nAmount > MAX_MONEY) {
-            strError = _("Unable to reissue asset: asset_name '") + strName +
-                       _("' the amount trying to reissue is to large");
-            return false;
-        }
+bool CReissueAsset::IsReissuable(std::string &strError, CAssetsCache& assetCache) const {
+    strError = "";
 
-        if (!CheckAmountWithUnits(nAmount, asset.units)) {
-            strError = _("Unable to reissue asset: amount must be divisible by the smaller unit assigned to the asset");
-            return false;
-        }
+    CNewAsset asset;
+    if (!assetCache.GetAssetMetaDataIfExists(this->strName, asset)) {
+        strError = _("Unable to reissue asset: asset_name '") + strName + _("' doesn't exist in the database");
+        return false;
+    }
 
-        if (nUnits < asset.units && nUnits != -1) {
-            strError = _("Unable to reissue asset: unit must be larger than current unit selection");
-            return false;
-        }
+    if (!asset.nReissuable) {
+        // Check to make sure the asset can be reissued
+        strError = _("Unable to reissue asset: reissuable is set to false");
+        return false;
+    }
+
+    if (asset.nAmount + this->nAmount > MAX_MONEY) {
+        strError = _("Unable to reissue asset: asset_name '") + strName +
+                   _("' the amount trying to reissue is to large");
+        return false;
     }
 
+    if (!CheckAmountWithUnits(nAmount, asset.units)) {
+        strError = _("Unable to reissue asset: amount must be divisible by the smaller unit assigned to the asset");
+        return false;
+    }
+
+    if (nUnits < asset.units && nUnits != -1) {
+        strError = _("Unable to reissue asset: unit must be larger than current unit selection");
+        return false;
+    }
+
+    return true;
+}
+
+bool CReissueAsset::IsValid(std::string &strError) const {
+    strError = "";
+
     if (strIPFSHash != "" && strIPFSHash.size() != 34) {
         strError = _("Invalid parameter: ipfs_hash must be 34 bytes.");
         return false;
@@ -1054,7 +1256,7 @@ bool CAssetsCache::AddTransferAsset(const CAssetTransfer& transferAsset, const s
 void CAssetsCache::AddToAssetBalance(const std::string& strName, const std::string& address, const CAmount& nAmount)
 {
     if (fAssetIndex) {
-        auto pair = std::make_pair(strName, address);
+        auto pair = AssetAddressKey(strName, address);
         // Add to map address -> amount map
 
         // Get the best amount
@@ -1071,44 +1273,23 @@ void CAssetsCache::AddToAssetBalance(const std::string& strName, const std::stri
 
 bool CAssetsCache::TrySpendCoin(const COutPoint& out, const CTxOut& txOut)
 {
+    // If it isn't an asset tx return true, we only fail if an error occurs
+    if (!txOut.scriptPubKey.IsAssetScript())
+        return true;
+
     // Placeholder strings that will get set if you successfully get the transfer or asset from the script
     std::string address = "";
     std::string assetName = "";
     CAmount nAmount = -1;
 
     // Get the asset tx data
-    int nType = -1;
-    bool fIsOwner = false;
-    if (txOut.scriptPubKey.IsAssetScript(nType, fIsOwner)) {
-
-        // Get the New Asset or Transfer Asset from the scriptPubKey
-        if (nType == TX_NEW_ASSET && !fIsOwner) {
-            CNewAsset asset;
-            if (AssetFromScript(txOut.scriptPubKey, asset, address)) {
-                assetName = asset.strName;
-                nAmount = asset.nAmount;
-            }
-        } else if (nType == TX_TRANSFER_ASSET) {
-            CAssetTransfer transfer;
-            if (TransferAssetFromScript(txOut.scriptPubKey, transfer, address)) {
-                assetName = transfer.strName;
-                nAmount = transfer.nAmount;
-            }
-        } else if (nType == TX_NEW_ASSET && fIsOwner) {
-            if (!OwnerAssetFromScript(txOut.scriptPubKey, assetName, address))
-                return error("%s : ERROR Failed to get owner asset from the OutPoint: %s", __func__,
-                             out.ToString());
-            nAmount = OWNER_ASSET_AMOUNT;
-        } else if (nType == TX_REISSUE_ASSET) {
-            CReissueAsset reissue;
-            if (ReissueAssetFromScript(txOut.scriptPubKey, reissue, address)) {
-                assetName = reissue.strName;
-                nAmount = reissue.nAmount;
-            }
-        }
-    } else {
-        // If it isn't an asset tx return true, we only fail if an error occurs
-        return true;
+    CAssetScriptData data;
+    if (GetAssetScriptData(txOut.scriptPubKey, data)) {
+        address = data.strAddress;
+        assetName = data.assetName;
+        nAmount = data.nAmount;
+    } else if (IsScriptOwnerAsset(txOut.scriptPubKey)) {
+        return error("%s : ERROR Failed to get owner asset from the OutPoint: %s", __func__, out.ToString());
     }
 
     // If we got the address and the assetName, proceed to remove it from the database, and in memory objects
@@ -1116,7 +1297,7 @@ bool CAssetsCache::TrySpendCoin(const COutPoint& out, const CTxOut& txOut)
         if (fAssetIndex) {
             CAssetCacheSpendAsset spend(assetName, address, nAmount);
             if (GetBestAssetAddressAmount(*this, assetName, address)) {
-                auto pair = make_pair(assetName, address);
+                auto pair = AssetAddressKey(assetName, address);
                 if (mapAssetsAddressAmount.count(pair))
                     mapAssetsAddressAmount.at(pair) -= nAmount;
 
@@ -1208,7 +1389,7 @@ bool CAssetsCache::AddBackSpentAsset(const Coin& coin, const std::string& assetN
 {
     if (fAssetIndex) {
         // Update the assets address balance
-        auto pair = std::make_pair(assetName, address);
+        auto pair = AssetAddressKey(assetName, address);
 
         // Get the map address amount from database if the map doesn't have it already
         if (!GetBestAssetAddressAmount(*this, assetName, address))
@@ -1233,7 +1414,7 @@ bool CAssetsCache::UndoTransfer(const CAssetTransfer& transfer, const std::strin
             return error("%s : Failed to get the assets address balance from the database. Asset : %s Address : %s",
                          __func__, transfer.strName, address);
 
-        auto pair = std::make_pair(transfer.strName, address);
+        auto pair = AssetAddressKey(transfer.strName, address);
         if (!mapAssetsAddressAmount.count(pair))
             return error(
                     "%s : Tried undoing a transfer and the map of address amount didn't have the asset address pair. Asset : %s Address : %s",
@@ -1265,7 +1446,7 @@ bool CAssetsCache::RemoveNewAsset(const CNewAsset& asset, const std::string addr
     setNewAssetsToRemove.insert(newAsset);
 
     if (fAssetIndex)
-        mapAssetsAddressAmount[std::make_pair(asset.strName, address)] = 0;
+        mapAssetsAddressAmount[AssetAddressKey(asset.strName, address)] = 0;
 
     return true;
 }
@@ -1285,7 +1466,7 @@ bool CAssetsCache::AddNewAsset(const CNewAsset& asset, const std::string address
 
     if (fAssetIndex) {
         // Insert the asset into the assests address amount map
-        mapAssetsAddressAmount[std::make_pair(asset.strName, address)] = asset.nAmount;
+        mapAssetsAddressAmount[AssetAddressKey(asset.strName, address)] = asset.nAmount;
     }
 
     return true;
@@ -1294,7 +1475,7 @@ bool CAssetsCache::AddNewAsset(const CNewAsset& asset, const std::string address
 //! Changes Memory Only
 bool CAssetsCache::AddReissueAsset(const CReissueAsset& reissue, const std::string address, const COutPoint& out)
 {
-    auto pair = std::make_pair(reissue.strName, address);
+    auto pair = AssetAddressKey(reissue.strName, address);
 
     CNewAsset asset;
     int assetHeight;
@@ -1349,7 +1530,7 @@ bool CAssetsCache::AddReissueAsset(const CReissueAsset& reissue, const std::stri
 //! Changes Memory Only
 bool CAssetsCache::RemoveReissueAsset(const CReissueAsset& reissue, const std::string address, const COutPoint& out, const std::vector<std::pair<std::string, CBlockAssetUndo> >& vUndoIPFS)
 {
-    auto pair = std::make_pair(reissue.strName, address);
+    auto pair = AssetAddressKey(reissue.strName, address);
 
     CNewAsset assetData;
     int height;
@@ -1412,7 +1593,7 @@ bool CAssetsCache::AddOwnerAsset(const std::string& assetsName, const std::strin
 
     if (fAssetIndex) {
         // Insert the asset into the assests address amount map
-        mapAssetsAddressAmount[std::make_pair(assetsName, address)] = OWNER_ASSET_AMOUNT;
+        mapAssetsAddressAmount[AssetAddressKey(assetsName, address)] = OWNER_ASSET_AMOUNT;
     }
 
     return true;
@@ -1429,7 +1610,7 @@ bool CAssetsCache::RemoveOwnerAsset(const std::string& assetsName, const std::st
     setNewOwnerAssetsToRemove.insert(newOwner);
 
     if (fAssetIndex) {
-        auto pair = std::make_pair(assetsName, address);
+        auto pair = AssetAddressKey(assetsName, address);
         mapAssetsAddressAmount[pair] = 0;
     }
 
@@ -1451,213 +1632,85 @@ bool CAssetsCache::RemoveTransfer(const CAssetTransfer &transfer, const std::str
     return true;
 }
 
-bool CAssetsCache::DumpCacheToDatabase()
+bool CAssetsCache::DumpCacheToDatabase(const uint256& hashBestBlock)
 {
     try {
-        bool dirty = false;
-        std::string message;
+        // Every change is staged in one batch and written with a single LevelDB write, so a failure part way
+        // through can't leave some of the asset changes of a flush on disk without the rest
+        CAssetsDBBatch batch(*passetsdb);
+
+        // Sets the indexed balance of an address to the value held in the cache, erasing it when it is empty
+        auto fnUpdateBalance = [this, &batch](const std::string& assetName, const std::string& address, const bool fEraseEmpty) {
+            std::pair<uint32_t, std::string> pair;
+            if (!FindAssetAddressKey(assetName, address, pair) || !mapAssetsAddressAmount.count(pair))
+                return;
+
+            CAmount amount = mapAssetsAddressAmount.at(pair);
+            if (fEraseEmpty && amount == 0) {
+                batch.EraseAssetAddressQuantity(assetName, address);
+                batch.EraseAddressAssetQuantity(address, assetName);
+            } else {
+                batch.WriteAssetAddressQuantity(assetName, address, amount);
+                batch.WriteAddressAssetQuantity(address, assetName, amount);
+            }
+        };
 
         // Remove new assets from the database
         for (auto newAsset : setNewAssetsToRemove) {
             passetsCache->Erase(newAsset.asset.strName);
-            if (!passetsdb->EraseAssetData(newAsset.asset.strName)) {
-                dirty = true;
-                message = "_Failed Erasing New Asset Data from database";
-            }
-
-            if (dirty) {
-                return error("%s : %s", __func__, message);
-            }
+            batch.EraseAssetData(newAsset.asset.strName);
 
             if (fAssetIndex) {
-                if (!passetsdb->EraseAssetAddressQuantity(newAsset.asset.strName, newAsset.address)) {
-                    dirty = true;
-                    message = "_Failed Erasing Address Balance from database";
-                }
-
-                if (!passetsdb->EraseAddressAssetQuantity(newAsset.address, newAsset.asset.strName)) {
-                    dirty = true;
-                    message = "_Failed Erasing New Asset Address Balance from AddressAsset database";
-                }
-            }
-
-            if (dirty) {
-                return error("%s : %s", __func__, message);
+                batch.EraseAssetAddressQuantity(newAsset.asset.strName, newAsset.address);
+                batch.EraseAddressAssetQuantity(newAsset.address, newAsset.asset.strName);
             }
         }
 
         // Add the new assets to the database
         for (auto newAsset : setNewAssetsToAdd) {
             passetsCache->Put(newAsset.asset.strName, CDatabasedAssetData(newAsset.asset, newAsset.blockHeight, newAsset.blockHash));
-            if (!passetsdb->WriteAssetData(newAsset.asset, newAsset.blockHeight, newAsset.blockHash)) {
-                dirty = true;
-                message = "_Failed Writing New Asset Data to database";
-            }
-
-            if (dirty) {
-                return error("%s : %s", __func__, message);
-            }
+            batch.WriteAssetData(newAsset.asset, newAsset.blockHeight, newAsset.blockHash);
 
             if (fAssetIndex) {
-                if (!passetsdb->WriteAssetAddressQuantity(newAsset.asset.strName, newAsset.address,
-                                                          newAsset.asset.nAmount)) {
-                    dirty = true;
-                    message = "_Failed Writing Address Balance to database";
-                }
-
-                if (!passetsdb->WriteAddressAssetQuantity(newAsset.address, newAsset.asset.strName,
-                                                          newAsset.asset.nAmount)) {
-                    dirty = true;
-                    message = "_Failed Writing Address Balance to database";
-                }
-            }
-
-            if (dirty) {
-                return error("%s : %s", __func__, message);
+                batch.WriteAssetAddressQuantity(newAsset.asset.strName, newAsset.address, newAsset.asset.nAmount);
+                batch.WriteAddressAssetQuantity(newAsset.address, newAsset.asset.strName, newAsset.asset.nAmount);
             }
         }
 
         if (fAssetIndex) {
             // Remove the new owners from database
             for (auto ownerAsset : setNewOwnerAssetsToRemove) {
-                if (!passetsdb->EraseAssetAddressQuantity(ownerAsset.assetName, ownerAsset.address)) {
-                    dirty = true;
-                    message = "_Failed Erasing Owner Address Balance from database";
-                }
-
-                if (!passetsdb->EraseAddressAssetQuantity(ownerAsset.address, ownerAsset.assetName)) {
-                    dirty = true;
-                    message = "_Failed Erasing New Owner Address Balance from AddressAsset database";
-                }
-
-                if (dirty) {
-                    return error("%s : %s", __func__, message);
-                }
+                batch.EraseAssetAddressQuantity(ownerAsset.assetName, ownerAsset.address);
+                batch.EraseAddressAssetQuantity(ownerAsset.address, ownerAsset.assetName);
             }
 
             // Add the new owners to database
             for (auto ownerAsset : setNewOwnerAssetsToAdd) {
-                auto pair = std::make_pair(ownerAsset.assetName, ownerAsset.address);
-                if (mapAssetsAddressAmount.count(pair) && mapAssetsAddressAmount.at(pair) > 0) {
-                    if (!passetsdb->WriteAssetAddressQuantity(ownerAsset.assetName, ownerAsset.address,
-                                                              mapAssetsAddressAmount.at(pair))) {
-                        dirty = true;
-                        message = "_Failed Writing Owner Address Balance to database";
-                    }
-
-                    if (!passetsdb->WriteAddressAssetQuantity(ownerAsset.address, ownerAsset.assetName,
-                                                              mapAssetsAddressAmount.at(pair))) {
-                        dirty = true;
-                        message = "_Failed Writing Address Balance to database";
-                    }
-
-                    if (dirty) {
-                        return error("%s : %s", __func__, message);
-                    }
-                }
+                std::pair<uint32_t, std::string> pair;
+                if (FindAssetAddressKey(ownerAsset.assetName, ownerAsset.address, pair) && mapAssetsAddressAmount.count(pair) && mapAssetsAddressAmount.at(pair) > 0)
+                    fnUpdateBalance(ownerAsset.assetName, ownerAsset.address, false);
             }
 
             // Undo the transfering by updating the balances in the database
-
-            for (auto undoTransfer : setNewTransferAssetsToRemove) {
-                auto pair = std::make_pair(undoTransfer.transfer.strName, undoTransfer.address);
-                if (mapAssetsAddressAmount.count(pair)) {
-                    if (mapAssetsAddressAmount.at(pair) == 0) {
-                        if (!passetsdb->EraseAssetAddressQuantity(undoTransfer.transfer.strName,
-                                                                  undoTransfer.address)) {
-                            dirty = true;
-                            message = "_Failed Erasing Address Quantity from database";
-                        }
-
-                        if (!passetsdb->EraseAddressAssetQuantity(undoTransfer.address,
-                                                                  undoTransfer.transfer.strName)) {
-                            dirty = true;
-                            message = "_Failed Erasing UndoTransfer Address Balance from AddressAsset database";
-                        }
-
-                        if (dirty) {
-                            return error("%s : %s", __func__, message);
-                        }
-                    } else {
-                        if (!passetsdb->WriteAssetAddressQuantity(undoTransfer.transfer.strName,
-                                                                  undoTransfer.address,
-                                                                  mapAssetsAddressAmount.at(pair))) {
-                            dirty = true;
-                            message = "_Failed Writing updated Address Quantity to database when undoing transfers";
-                        }
-
-                        if (!passetsdb->WriteAddressAssetQuantity(undoTransfer.address,
-                                                                  undoTransfer.transfer.strName,
-                                                                  mapAssetsAddressAmount.at(pair))) {
-                            dirty = true;
-                            message = "_Failed Writing Address Balance to database";
-                        }
-
-                        if (dirty) {
-                            return error("%s : %s", __func__, message);
-                        }
-                    }
-                }
-            }
-
+            for (auto undoTransfer : setNewTransferAssetsToRemove)
+                fnUpdateBalance(undoTransfer.transfer.strName, undoTransfer.address, true);
 
             // Save the new transfers by updating the quantity in the database
-            for (auto newTransfer : setNewTransferAssetsToAdd) {
-                auto pair = std::make_pair(newTransfer.transfer.strName, newTransfer.address);
-                // During init and reindex it disconnects and verifies blocks, can create a state where vNewTransfer will contain transfers that have already been spent. So if they aren't in the map, we can skip them.
-                if (mapAssetsAddressAmount.count(pair)) {
-                    if (!passetsdb->WriteAssetAddressQuantity(newTransfer.transfer.strName, newTransfer.address,
-                                                              mapAssetsAddressAmount.at(pair))) {
-                        dirty = true;
-                        message = "_Failed Writing new address quantity to database";
-                    }
-
-                    if (!passetsdb->WriteAddressAssetQuantity(newTransfer.address, newTransfer.transfer.strName,
-                                                              mapAssetsAddressAmount.at(pair))) {
-                        dirty = true;
-                        message = "_Failed Writing Address Balance to database";
-                    }
-
-                    if (dirty) {
-                        return error("%s : %s", __func__, message);
-                    }
-                }
-            }
+            // During init and reindex it disconnects and verifies blocks, can create a state where vNewTransfer will contain transfers that have already been spent. So if they aren't in the map, we can skip them.
+            for (auto newTransfer : setNewTransferAssetsToAdd)
+                fnUpdateBalance(newTransfer.transfer.strName, newTransfer.address, false);
         }
 
         for (auto newReissue : setNewReissueToAdd) {
             auto reissue_name = newReissue.reissue.strName;
-            auto pair = make_pair(reissue_name, newReissue.address);
             if (mapReissuedAssetData.count(reissue_name)) {
-                if(!passetsdb->WriteAssetData(mapReissuedAssetData.at(reissue_name), newReissue.blockHeight, newReissue.blockHash)) {
-                    dirty = true;
-                    message = "_Failed Writing reissue asset data to database";
-                }
-
-                if (dirty) {
-                    return error("%s : %s", __func__, message);
-                }
-
+                batch.WriteAssetData(mapReissuedAssetData.at(reissue_name), newReissue.blockHeight, newReissue.blockHash);
                 passetsCache->Erase(reissue_name);
 
                 if (fAssetIndex) {
-                    if (mapAssetsAddressAmount.count(pair) && mapAssetsAddressAmount.at(pair) > 0) {
-                        if (!passetsdb->WriteAssetAddressQuantity(pair.first, pair.second,
-                                                                  mapAssetsAddressAmount.at(pair))) {
-                            dirty = true;
-                            message = "_Failed Writing reissue asset quantity to the address quantity database";
-                        }
-
-                        if (!passetsdb->WriteAddressAssetQuantity(pair.second, pair.first,
-                                                                  mapAssetsAddressAmount.at(pair))) {
-                            dirty = true;
-                            message = "_Failed Writing Address Balance to database";
-                        }
-
-                        if (dirty) {
-                            return error("%s, %s", __func__, message);
-                        }
-                    }
+                    std::pair<uint32_t, std::string> pair;
+                    if (FindAssetAddressKey(reissue_name, newReissue.address, pair) && mapAssetsAddressAmount.count(pair) && mapAssetsAddressAmount.at(pair) > 0)
+                        fnUpdateBalance(reissue_name, newReissue.address, false);
                 }
             }
         }
@@ -1674,43 +1727,10 @@ bool CAssetsCache::DumpCacheToDatabase()
 
             auto reissue_name = undoReissue.reissue.strName;
             if (mapReissuedAssetData.count(reissue_name)) {
-                if(!passetsdb->WriteAssetData(mapReissuedAssetData.at(reissue_name), undoReissue.blockHeight, undoReissue.blockHash)) {
-                    dirty = true;
-                    message = "_Failed Writing undo reissue asset data to database";
-                }
-
-                if (fAssetIndex) {
-                    auto pair = make_pair(undoReissue.reissue.strName, undoReissue.address);
-                    if (mapAssetsAddressAmount.count(pair)) {
-                        if (mapAssetsAddressAmount.at(pair) == 0) {
-                            if (!passetsdb->EraseAssetAddressQuantity(reissue_name, undoReissue.address)) {
-                                dirty = true;
-                                message = "_Failed Erasing Address Balance from database";
-                            }
-
-                            if (!passetsdb->EraseAddressAssetQuantity(undoReissue.address, reissue_name)) {
-                                dirty = true;
-                                message = "_Failed Erasing UndoReissue Balance from AddressAsset database";
-                            }
-                        } else {
-                            if (!passetsdb->WriteAssetAddressQuantity(reissue_name, undoReissue.address,
-                                                                      mapAssetsAddressAmount.at(pair))) {
-                                dirty = true;
-                                message = "_Failed Writing the undo of reissue of asset from database";
-                            }
-
-                            if (!passetsdb->WriteAddressAssetQuantity(undoReissue.address, reissue_name,
-                                                                      mapAssetsAddressAmount.at(pair))) {
-                                dirty = true;
-                                message = "_Failed Writing Address Balance to database";
-                            }
-                        }
-                    }
-                }
+                batch.WriteAssetData(mapReissuedAssetData.at(reissue_name), undoReissue.blockHeight, undoReissue.blockHash);
 
-                if (dirty) {
-                    return error("%s : %s", __func__, message);
-                }
+                if (fAssetIndex)
+                    fnUpdateBalance(reissue_name, undoReissue.address, true);
 
                 passetsCache->Erase(reissue_name);
             }
@@ -1718,67 +1738,22 @@ bool CAssetsCache::DumpCacheToDatabase()
 
         if (fAssetIndex) {
             // Undo the asset spends by updating there balance in the database
-            for (auto undoSpend : vUndoAssetAmount) {
-                auto pair = std::make_pair(undoSpend.assetName, undoSpend.address);
-                if (mapAssetsAddressAmount.count(pair)) {
-                    if (!passetsdb->WriteAssetAddressQuantity(undoSpend.assetName, undoSpend.address,
-                                                              mapAssetsAddressAmount.at(pair))) {
-                        dirty = true;
-                        message = "_Failed Writing updated Address Quantity to database when undoing spends";
-                    }
-
-                    if (!passetsdb->WriteAddressAssetQuantity(undoSpend.address, undoSpend.assetName,
-                                                              mapAssetsAddressAmount.at(pair))) {
-                        dirty = true;
-                        message = "_Failed Writing Address Balance to database";
-                    }
-
-                    if (dirty) {
-                        return error("%s : %s", __func__, message);
-                    }
-                }
-            }
-
+            for (auto undoSpend : vUndoAssetAmount)
+                fnUpdateBalance(undoSpend.assetName, undoSpend.address, false);
 
             // Save the assets that have been spent by erasing the quantity in the database
-            for (auto spentAsset : vSpentAssets) {
-                auto pair = make_pair(spentAsset.assetName, spentAsset.address);
-                if (mapAssetsAddressAmount.count(pair)) {
-                    if (mapAssetsAddressAmount.at(pair) == 0) {
-                        if (!passetsdb->EraseAssetAddressQuantity(spentAsset.assetName, spentAsset.address)) {
-                            dirty = true;
-                            message = "_Failed Erasing a Spent Asset, from database";
-                        }
-
-                        if (!passetsdb->EraseAddressAssetQuantity(spentAsset.address, spentAsset.assetName)) {
-                            dirty = true;
-                            message = "_Failed Erasing a Spent Asset from AddressAsset database";
-                        }
-
-                        if (dirty) {
-                            return error("%s : %s", __func__, message);
-                        }
-                    } else {
-                        if (!passetsdb->WriteAssetAddressQuantity(spentAsset.assetName, spentAsset.address,
-                                                                  mapAssetsAddressAmount.at(pair))) {
-                            dirty = true;
-                            message = "_Failed Erasing a Spent Asset, from database";
-                        }
-
-                        if (!passetsdb->WriteAddressAssetQuantity(spentAsset.address, spentAsset.assetName,
-                                                                  mapAssetsAddressAmount.at(pair))) {
-                            dirty = true;
-                            message = "_Failed Writing Address Balance to database";
-                        }
-
-                        if (dirty) {
-                            return error("%s : %s", __func__, message);
-                        }
-                    }
-                }
-            }
+            for (auto spentAsset : vSpentAssets)
+                fnUpdateBalance(spentAsset.assetName, spentAsset.address, true);
         }
 
+        // Record which chainstate the asset database now matches, so a crash between the coins flush and
+        // this write can be detected at startup
+        if (!hashBestBlock.IsNull())
+            batch.WriteBestBlock(hashBestBlock);
+
+        if (!batch.Commit())
+            return error("%s : Failed to write the asset changes to the database", __func__);
+
         ClearDirtyCache();
 
         return true;
@@ -1808,8 +1783,16 @@ bool CAssetsCache::Flush()
             passets->setNewAssetsToRemove.insert(item);
         }
 
-        for (auto &item : mapAssetsAddressAmount)
-            passets->mapAssetsAddressAmount[item.first] = item.second;
+        // The assets of connected blocks get their interned ids here
+        for (auto &item : mapAssetsAddressAmount) {
+            auto pair = item.first;
+            if (pair.first & PROVISIONAL_ID_FLAG) {
+                const std::string& assetName = vProvisionalNames[pair.first & ~PROVISIONAL_ID_FLAG];
+                if (!passets->FindAssetAddressKey(assetName, pair.second, pair))
+                    pair.first = assetNameTable.GetOrAssign(assetName);
+            }
+            passets->mapAssetsAddressAmount[pair] = item.second;
+        }
 
         for (auto &item : mapReissuedAssetData)
             passets->mapReissuedAssetData[item.first] = item.second;
@@ -1869,7 +1852,8 @@ bool CAssetsCache::Flush()
 size_t CAssetsCache::DynamicMemoryUsage() const
 {
     // TODO make sure this is accurate
-    return memusage::DynamicUsage(mapAssetsAddressAmount) + memusage::DynamicUsage(mapReissuedAssetData);
+    return memusage::DynamicUsage(mapAssetsAddressAmount) + memusage::DynamicUsage(mapReissuedAssetData) +
+           memusage::DynamicUsage(vProvisionalNames) + memusage::DynamicUsage(mapProvisionalIds);
 }
 
 //! Get an estimated size of the cache in bytes that will be needed inorder to save to database
@@ -2258,9 +2242,8 @@ bool CAssetsCache::GetAssetMetaDataIfExists(const std::string &name, CNewAsset &
 
     // Check the cache, if it doesn't exist in the cache. Try and read it from database
     if (passetsCache) {
-        if (passetsCache->Exists(name)) {
-            CDatabasedAssetData data;
-            data = passetsCache->Get(name);
+        CDatabasedAssetData data;
+        if (passetsCache->Get(name, data)) {
             asset = data.asset;
             nHeight = data.nHeight;
             blockHash = data.blockHash;
@@ -2304,57 +2287,15 @@ bool GetAssetInfoFromCoin(const Coin& coin, std::string& strName, CAmount& nAmou
 
 bool GetAssetData(const CScript& script, CAssetOutputEntry& data)
 {
-    // Placeholder strings that will get set if you successfully get the transfer or asset from the script
-    std::string address = "";
-    std::string assetName = "";
-
-    int nType = 0;
-    bool fIsOwner = false;
-    if (!script.IsAssetScript(nType, fIsOwner)) {
+    CAssetScriptData scriptData;
+    if (!GetAssetScriptData(script, scriptData))
         return false;
-    }
-
-    txnouttype type = txnouttype(nType);
-
-    // Get the New Asset or Transfer Asset from the scriptPubKey
-    if (type == TX_NEW_ASSET && !fIsOwner) {
-        CNewAsset asset;
-        if (AssetFromScript(script, asset, address)) {
-            data.type = TX_NEW_ASSET;
-            data.nAmount = asset.nAmount;
-            data.destination = DecodeDestination(address);
-            data.assetName = asset.strName;
-            return true;
-        }
-    } else if (type == TX_TRANSFER_ASSET) {
-        CAssetTransfer transfer;
-        if (TransferAssetFromScript(script, transfer, address)) {
-            data.type = TX_TRANSFER_ASSET;
-            data.nAmount = transfer.nAmount;
-            data.destination = DecodeDestination(address);
-            data.assetName = transfer.strName;
-            return true;
-        }
-    } else if (type == TX_NEW_ASSET && fIsOwner) {
-        if (OwnerAssetFromScript(script, assetName, address)) {
-            data.type = TX_NEW_ASSET;
-            data.nAmount = OWNER_ASSET_AMOUNT;
-            data.destination = DecodeDestination(address);
-            data.assetName = assetName;
-            return true;
-        }
-    } else if (type == TX_REISSUE_ASSET) {
-        CReissueAsset reissue;
-        if (ReissueAssetFromScript(script, reissue, address)) {
-            data.type = TX_REISSUE_ASSET;
-            data.nAmount = reissue.nAmount;
-            data.destination = DecodeDestination(address);
-            data.assetName = reissue.strName;
-            return true;
-        }
-    }
 
-    return false;
+    data.type = txnouttype(scriptData.nType);
+    data.nAmount = scriptData.nAmount;
+    data.assetName = scriptData.assetName;
+    ExtractDestination(script, data.destination);
+    return true;
 }
 
 void GetAllAdministrativeAssets(CWallet *pwallet, std::vector<std::string> &names, int nMinConf)
@@ -2465,21 +2406,23 @@ std::string GetBurnAddress(const AssetType type)
 bool GetBestAssetAddressAmount(CAssetsCache& cache, const std::string& assetName, const std::string& address)
 {
     if (fAssetIndex) {
-        auto pair = make_pair(assetName, address);
+        auto pair = cache.AssetAddressKey(assetName, address);
 
         // If the caches map has the pair, return true because the map already contains the best dirty amount
         if (cache.mapAssetsAddressAmount.count(pair))
             return true;
 
         // If the caches map has the pair, return true because the map already contains the best dirty amount
-        if (passets->mapAssetsAddressAmount.count(pair)) {
-            cache.mapAssetsAddressAmount[pair] = passets->mapAssetsAddressAmount.at(pair);
+        // The global cache keys the asset by its own id
+        std::pair<uint32_t, std::string> pairGlobal;
+        if (passets->FindAssetAddressKey(assetName, address, pairGlobal) && passets->mapAssetsAddressAmount.count(pairGlobal)) {
+            cache.mapAssetsAddressAmount[pair] = passets->mapAssetsAddressAmount.at(pairGlobal);
             return true;
         }
 
         // If the database contains the assets address amount, insert it into the database and return true
         CAmount nDBAmount;
-        if (passetsdb->ReadAssetAddressQuantity(pair.first, pair.second, nDBAmount)) {
+        if (passetsdb->ReadAssetAddressQuantity(assetName, address, nDBAmount)) {
             cache.mapAssetsAddressAmount.insert(make_pair(pair, nDBAmount));
             return true;
         }
@@ -2503,7 +2446,7 @@ bool GetAllMyAssetBalances(std::map<std::string, std::vector<COutput> >& outputs
     for (const auto& pair : outputs) {
         if (prefix.empty() || pair.first.find(prefix) == 0) { // Check for prefix
             CAmount balance = 0;
-            for (auto txout : pair.second) { // Compute balance of asset by summing all Available Outputs
+            for (const auto& txout : pair.second) { // Compute balance of asset by summing all Available Outputs
                 CAssetOutputEntry data;
                 if (GetAssetData(txout.tx->tx->vout[txout.i].scriptPubKey, data))
                     balance += data.nAmount;
@@ -2898,59 +2841,18 @@ void GetTxOutAssetTypes(const std::vector<CTxOut>& vout, int& issues, int& reiss
     }
 }
 
-bool ParseAssetScript(CScript scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount) {
-    int nType;
-    bool fIsOwner;
-    int _nStartingPoint;
-    std::string _strAddress;
-    bool isAsset = false;
-    if (scriptPubKey.IsAssetScript(nType, fIsOwner, _nStartingPoint)) {
-        if (nType == TX_NEW_ASSET) {
-            if (fIsOwner) {
-                if (OwnerAssetFromScript(scriptPubKey, assetName, _strAddress)) {
-                    assetAmount = OWNER_ASSET_AMOUNT;
-                    isAsset = true;
-                } else {
-                    LogPrintf("%s : Couldn't get new owner asset from script: %s", __func__, HexStr(scriptPubKey));
-                }
-            } else {
-                CNewAsset asset;
-                if (AssetFromScript(scriptPubKey, asset, _strAddress)) {
-                    assetName = asset.strName;
-                    assetAmount = asset.nAmount;
-                    isAsset = true;
-                } else {
-                    LogPrintf("%s : Couldn't get new asset from script: %s", __func__, HexStr(scriptPubKey));
-                }
-            }
-        } else if (nType == TX_REISSUE_ASSET) {
-            CReissueAsset asset;
-            if (ReissueAssetFromScript(scriptPubKey, asset, _strAddress)) {
-                assetName = asset.strName;
-                assetAmount = asset.nAmount;
-                isAsset = true;
-            } else {
-                LogPrintf("%s : Couldn't get reissue asset from script: %s", __func__, HexStr(scriptPubKey));
-            }
-        } else if (nType == TX_TRANSFER_ASSET) {
-            CAssetTransfer asset;
-            if (TransferAssetFromScript(scriptPubKey, asset, _strAddress)) {
-                assetName = asset.strName;
-                assetAmount = asset.nAmount;
-                isAsset = true;
-            } else {
-                LogPrintf("%s : Couldn't get transfer asset from script: %s", __func__, HexStr(scriptPubKey));
-            }
-        } else {
-            LogPrintf("%s : Unsupported asset type: %s", __func__, nType);
-        }
-    } else {
-//        LogPrintf("%s : Found no asset in script: %s", __func__, HexStr(scriptPubKey));
-    }
-    if (isAsset) {
-//        LogPrintf("%s : Found assets in script at address %s : %s (%s)", __func__, _strAddress, assetName, assetAmount);
-        hashBytes = uint160(std::vector <unsigned char>(scriptPubKey.begin()+3, scriptPubKey.begin()+23));
-        return true;
+bool ParseAssetScript(const CScript& scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount) {
+    if (!scriptPubKey.IsAssetScript())
+        return false;
+
+    CAssetScriptData data;
+    if (!GetAssetScriptData(scriptPubKey, data)) {
+        LogPrintf("%s : Couldn't get asset from script: %s", __func__, HexStr(scriptPubKey));
+        return false;
     }
-    return false;
+
+    assetName = data.assetName;
+    assetAmount = data.nAmount;
+    hashBytes = uint160(std::vector <unsigned char>(scriptPubKey.begin()+3, scriptPubKey.begin()+23));
+    return true;
 }
\ No newline at end of file
@@ -14,6 +14,7 @@
 #include <set>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <list>
 
 #define BLAST_R 114
@@ -57,14 +58,20 @@ class COutput;
 // 2500 * 82 Bytes == 205 KB (kilobytes) of memory
 #define MAX_CACHE_ASSETS_SIZE 2500
 
+// Decoded asset scripts kept by GetAssetScriptData, roughly 150 bytes each
+static const size_t DEFAULT_ASSET_SCRIPT_CACHE_SIZE = 50000;
+
 // Create map that store that state of current reissued transaction that the mempool as accepted.
 // If an asset name is in this map, any other reissue transactions wont be accepted into the mempool
 extern std::map<uint256, std::string> mapReissuedTx;
 extern std::map<std::string, uint256> mapReissuedAssets;
 
+// Interned ids of the asset names of connected blocks, persisted by the asset database
+extern CAssetNameTable assetNameTable;
+
 class CAssets {
 public:
-    std::map<std::pair<std::string, std::string>, CAmount> mapAssetsAddressAmount; // pair < Asset Name , Address > -> Quantity of tokens in the address
+    std::map<std::pair<uint32_t, std::string>, CAmount> mapAssetsAddressAmount; // pair < Asset Id , Address > -> Quantity of tokens in the address
 
     // Dirty, Gets wiped once flushed to database
     std::map<std::string, CNewAsset> mapReissuedAssetData; // Asset Name -> New Asset Data
@@ -72,11 +79,15 @@ public:
     CAssets(const CAssets& assets) {
         this->mapAssetsAddressAmount = assets.mapAssetsAddressAmount;
         this->mapReissuedAssetData = assets.mapReissuedAssetData;
+        this->vProvisionalNames = assets.vProvisionalNames;
+        this->mapProvisionalIds = assets.mapProvisionalIds;
     }
 
     CAssets& operator=(const CAssets& other) {
         mapAssetsAddressAmount = other.mapAssetsAddressAmount;
         mapReissuedAssetData = other.mapReissuedAssetData;
+        vProvisionalNames = other.vProvisionalNames;
+        mapProvisionalIds = other.mapProvisionalIds;
         return *this;
     }
 
@@ -87,7 +98,25 @@ public:
     void SetNull() {
         mapAssetsAddressAmount.clear();
         mapReissuedAssetData.clear();
+        vProvisionalNames.clear();
+        mapProvisionalIds.clear();
     }
+
+    //! Key into mapAssetsAddressAmount. Names without an interned id get a provisional one, local to this cache
+    std::pair<uint32_t, std::string> AssetAddressKey(const std::string& assetName, const std::string& address);
+
+    //! Like AssetAddressKey without assigning an id, false when the map can't hold a balance of the asset
+    bool FindAssetAddressKey(const std::string& assetName, const std::string& address, std::pair<uint32_t, std::string>& key) const;
+
+protected:
+    //! Provisional ids have this bit set, the rest is the index into vProvisionalNames
+    static const uint32_t PROVISIONAL_ID_FLAG = 0x80000000;
+
+    //! Names of assets issued in blocks that aren't connected yet, or in a block template. They are only
+    //! interned when the cache is flushed into passets, so names that never make it into the chain don't
+    //! take up an id for good
+    std::vector<std::string> vProvisionalNames;
+    std::unordered_map<std::string, uint32_t> mapProvisionalIds;
 };
 
 class CAssetsCache : public CAssets
@@ -102,20 +131,20 @@ public :
     std::vector<CAssetCacheSpendAsset> vSpentAssets;
 
     // New Assets Caches
-    std::set<CAssetCacheNewAsset> setNewAssetsToRemove;
-    std::set<CAssetCacheNewAsset> setNewAssetsToAdd;
+    std::unordered_set<CAssetCacheNewAsset, CAssetCacheHasher> setNewAssetsToRemove;
+    std::unordered_set<CAssetCacheNewAsset, CAssetCacheHasher> setNewAssetsToAdd;
 
     // New Reissue Caches
-    std::set<CAssetCacheReissueAsset> setNewReissueToRemove;
-    std::set<CAssetCacheReissueAsset> setNewReissueToAdd;
+    std::unordered_set<CAssetCacheReissueAsset, CAssetCacheHasher> setNewReissueToRemove;
+    std::unordered_set<CAssetCacheReissueAsset, CAssetCacheHasher> setNewReissueToAdd;
 
     // Ownership Assets Caches
-    std::set<CAssetCacheNewOwner> setNewOwnerAssetsToAdd;
-    std::set<CAssetCacheNewOwner> setNewOwnerAssetsToRemove;
+    std::unordered_set<CAssetCacheNewOwner, CAssetCacheHasher> setNewOwnerAssetsToAdd;
+    std::unordered_set<CAssetCacheNewOwner, CAssetCacheHasher> setNewOwnerAssetsToRemove;
 
     // Transfer Assets Caches
-    std::set<CAssetCacheNewTransfer> setNewTransferAssetsToAdd;
-    std::set<CAssetCacheNewTransfer> setNewTransferAssetsToRemove;
+    std::unordered_set<CAssetCacheNewTransfer, CAssetCacheHasher> setNewTransferAssetsToAdd;
+    std::unordered_set<CAssetCacheNewTransfer, CAssetCacheHasher> setNewTransferAssetsToRemove;
 
     CAssetsCache() : CAssets()
     {
@@ -148,8 +177,7 @@ public :
 
     CAssetsCache& operator=(const CAssetsCache& cache)
     {
-        this->mapAssetsAddressAmount = cache.mapAssetsAddressAmount;
-        this->mapReissuedAssetData = cache.mapReissuedAssetData;
+        CAssets::operator=(cache);
 
         // Copy dirty cache also
         this->vSpentAssets = cache.vSpentAssets;
@@ -209,7 +237,7 @@ public :
     bool Flush();
 
     //! Write asset cache data to database
-    bool DumpCacheToDatabase();
+    bool DumpCacheToDatabase(const uint256& hashBestBlock = uint256());
 
     void ClearDirtyCache() {
 
@@ -230,6 +258,8 @@ public :
 
         mapReissuedAssetData.clear();
         mapAssetsAddressAmount.clear();
+        vProvisionalNames.clear();
+        mapProvisionalIds.clear();
     }
 
    std::string CacheToString() const {
@@ -275,6 +305,10 @@ bool AssetFromScript(const CScript& scriptPubKey, CNewAsset& asset, std::string&
 bool OwnerAssetFromScript(const CScript& scriptPubKey, std::string& assetName, std::string& strAddress);
 bool ReissueAssetFromScript(const CScript& scriptPubKey, CReissueAsset& reissue, std::string& strAddress);
 
+//! Decode any asset script, answering repeat lookups of the same script from a shared cache
+bool GetAssetScriptData(const CScript& scriptPubKey, CAssetScriptData& data);
+void ClearAssetScriptCache();
+
 bool CheckIssueBurnTx(const CTxOut& txOut, const AssetType& type, const int numberIssued);
 bool CheckIssueBurnTx(const CTxOut& txOut, const AssetType& type);
 bool CheckReissueBurnTx(const CTxOut& txOut);
@@ -326,5 +360,5 @@ bool CreateTransferAssetTransaction(CWallet* pwallet, const CCoinControl& coinCo
 bool SendAssetTransaction(CWallet* pwallet, CWalletTx& transaction, CReserveKey& reserveKey, std::pair<int, std::string>& error, std::string& txid);
 
 /** Helper method for extracting address bytes, asset name and amount from an asset script */
-bool ParseAssetScript(CScript scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount);
+bool ParseAssetScript(const CScript& scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount);
 #endif //BLAST_ASSET_PROTOCOL_H
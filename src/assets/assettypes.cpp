@@ -4,10 +4,103 @@
 
 #include "assettypes.h"
 
+#include <boost/thread/locks.hpp>
+
 int IntFromAssetType(AssetType type) {
     return (int)type;
 }
 
 AssetType AssetTypeFromInt(int nType) {
     return (AssetType)nType;
-}
\ No newline at end of file
+}
+
+uint32_t CAssetNameTable::GetOrAssign(const std::string& name)
+{
+    {
+        boost::shared_lock<boost::shared_mutex> lock(mutex);
+        auto it = mapIds.find(name);
+        if (it != mapIds.end())
+            return it->second;
+    }
+
+    boost::unique_lock<boost::shared_mutex> lock(mutex);
+    auto it = mapIds.find(name);
+    if (it != mapIds.end())
+        return it->second;
+
+    dequeNames.push_back(name);
+    uint32_t id = dequeNames.size();
+    mapIds.emplace(name, id);
+    return id;
+}
+
+bool CAssetNameTable::GetId(const std::string& name, uint32_t& id) const
+{
+    boost::shared_lock<boost::shared_mutex> lock(mutex);
+    auto it = mapIds.find(name);
+    if (it == mapIds.end())
+        return false;
+
+    id = it->second;
+    return true;
+}
+
+const std::string& CAssetNameTable::Name(uint32_t id) const
+{
+    boost::shared_lock<boost::shared_mutex> lock(mutex);
+    assert(id != NULL_ID && id <= dequeNames.size());
+    return dequeNames[id - 1];
+}
+
+bool CAssetNameTable::Load(uint32_t id, const std::string& name)
+{
+    boost::unique_lock<boost::shared_mutex> lock(mutex);
+    if (id != dequeNames.size() + 1 || id != nPersisted + 1 || mapIds.count(name))
+        return false;
+
+    dequeNames.push_back(name);
+    mapIds.emplace(name, id);
+    nPersisted = id;
+    return true;
+}
+
+std::vector<std::pair<uint32_t, std::string>> CAssetNameTable::GetUnpersisted() const
+{
+    boost::shared_lock<boost::shared_mutex> lock(mutex);
+    std::vector<std::pair<uint32_t, std::string>> vAssigned;
+    for (uint32_t id = nPersisted + 1; id <= dequeNames.size(); id++)
+        vAssigned.emplace_back(id, dequeNames[id - 1]);
+    return vAssigned;
+}
+
+void CAssetNameTable::SetPersisted(uint32_t nId)
+{
+    boost::unique_lock<boost::shared_mutex> lock(mutex);
+    if (nId > nPersisted && nId <= dequeNames.size())
+        nPersisted = nId;
+}
+
+size_t CAssetNameTable::Size() const
+{
+    boost::shared_lock<boost::shared_mutex> lock(mutex);
+    return dequeNames.size();
+}
+
+size_t CAssetNameTable::DynamicMemoryUsage() const
+{
+    boost::shared_lock<boost::shared_mutex> lock(mutex);
+    size_t nUsage = memusage::DynamicUsage(mapIds) + dequeNames.size() * sizeof(std::string);
+    // Names too long for the small string buffer are stored on the heap, once in the deque and once in mapIds
+    for (const auto& name : dequeNames)
+        if (name.capacity() > 15)
+            nUsage += 2 * memusage::MallocUsage(name.capacity() + 1);
+    return nUsage;
+}
+
+void CAssetNameTable::Clear()
+{
+    boost::unique_lock<boost::shared_mutex> lock(mutex);
+    mapIds.clear();
+    dequeNames.clear();
+    nPersisted = 0;
+}
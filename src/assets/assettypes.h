@@ -9,10 +9,17 @@
 #include <string>
 #include <sstream>
 #include <list>
+#include <deque>
 #include <unordered_map>
+#include <unordered_set>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <boost/thread/shared_mutex.hpp>
 #include "amount.h"
 #include "script/standard.h"
 #include "primitives/transaction.h"
+#include "memusage.h"
 
 #define MAX_UNIT 8
 #define MIN_UNIT 0
@@ -97,6 +104,10 @@ public:
     bool IsNull() const;
 
     bool IsValid(std::string& strError, CAssetsCache& assetCache, bool fCheckMempool = false, bool fCheckDuplicateInputs = true, bool fForceDuplicateCheck = true) const;
+    //! The checks that depend on the asset cache and the mempool: the name mustn't be taken
+    bool IsNameAvailable(std::string& strError, CAssetsCache& assetCache, bool fCheckMempool = false, bool fCheckDuplicateInputs = true, bool fForceDuplicateCheck = true) const;
+    //! The context free checks: name, amount, units and IPFS hash
+    bool IsValid(std::string& strError) const;
 
     std::string ToString();
 
@@ -225,11 +236,88 @@ public:
 
     CReissueAsset(const std::string& strAssetName, const CAmount& nAmount, const int& nUnits, const int& nReissuable, const std::string& strIPFSHash);
     bool IsValid(std::string& strError, CAssetsCache& assetCache, bool fForceCheckPrimaryAssetExists = true) const;
+    //! The checks against the reissued asset in the asset cache
+    bool IsReissuable(std::string& strError, CAssetsCache& assetCache) const;
+    //! The checks that don't need the reissued asset: IPFS hash, amount and units
+    bool IsValid(std::string& strError) const;
     void ConstructTransaction(CScript& script) const;
     bool IsNull() const;
 };
 
 
+/** Asset payload of an output script, as decoded by GetAssetScriptData */
+struct CAssetScriptData
+{
+    int nType;
+    bool fIsOwner;
+    std::string assetName;
+    CAmount nAmount;
+    std::string strAddress;
+
+    CAssetScriptData()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        nType = 0;
+        fIsOwner = false;
+        assetName = "";
+        nAmount = 0;
+        strAddress = "";
+    }
+};
+
+/**
+ * Interning table from asset names to compact 32 bit ids.
+ *
+ * Ids are handed out in increasing order, starting at 1, the first time a name is seen and are never reused or
+ * reassigned, so an id can stand in for the name anywhere the name would otherwise be repeated. New assignments
+ * only live in memory until the next asset database write persists them (see CAssetsDBBatch), which happens in
+ * the same batch as anything on disk that refers to them.
+ *
+ * Names are kept in a deque so references returned by Name() stay valid while new names are added.
+ */
+class CAssetNameTable
+{
+private:
+    mutable boost::shared_mutex mutex;
+    std::unordered_map<std::string, uint32_t> mapIds;
+    std::deque<std::string> dequeNames; // id - 1 -> name
+    uint32_t nPersisted;
+
+public:
+    static const uint32_t NULL_ID = 0;
+
+    CAssetNameTable() : nPersisted(0) {}
+
+    CAssetNameTable(const CAssetNameTable&) = delete;
+    CAssetNameTable& operator=(const CAssetNameTable&) = delete;
+
+    //! Get the id of a name, assigning the next free one if the name hasn't been seen before
+    uint32_t GetOrAssign(const std::string& name);
+
+    //! Get the id of a name without assigning one
+    bool GetId(const std::string& name, uint32_t& id) const;
+
+    //! Get the name of an id. The id must have been assigned.
+    const std::string& Name(uint32_t id) const;
+
+    //! Add an assignment read back from disk. Ids must be loaded in increasing order without gaps.
+    bool Load(uint32_t id, const std::string& name);
+
+    //! Assignments that haven't been persisted yet, in id order
+    std::vector<std::pair<uint32_t, std::string>> GetUnpersisted() const;
+
+    //! Mark all ids up to and including nId as persisted
+    void SetPersisted(uint32_t nId);
+
+    size_t Size() const;
+    size_t DynamicMemoryUsage() const;
+    void Clear();
+};
+
 /** THESE ARE ONLY TO BE USED WHEN ADDING THINGS TO THE CACHE DURING CONNECT AND DISCONNECT BLOCK */
 struct CAssetCacheNewAsset
 {
@@ -250,6 +338,11 @@ struct CAssetCacheNewAsset
     {
         return asset.strName < rhs.asset.strName;
     }
+
+    bool operator==(const CAssetCacheNewAsset& rhs) const
+    {
+        return asset.strName == rhs.asset.strName;
+    }
 };
 
 struct CAssetCacheReissueAsset
@@ -275,6 +368,11 @@ struct CAssetCacheReissueAsset
         return out < rhs.out;
     }
 
+    bool operator==(const CAssetCacheReissueAsset& rhs) const
+    {
+        return out == rhs.out;
+    }
+
 };
 
 struct CAssetCacheNewTransfer
@@ -294,6 +392,11 @@ struct CAssetCacheNewTransfer
     {
         return out < rhs.out;
     }
+
+    bool operator==(const CAssetCacheNewTransfer& rhs) const
+    {
+        return out == rhs.out;
+    }
 };
 
 struct CAssetCacheNewOwner
@@ -312,6 +415,35 @@ struct CAssetCacheNewOwner
 
         return assetName < rhs.assetName;
     }
+
+    bool operator==(const CAssetCacheNewOwner& rhs) const
+    {
+        return assetName == rhs.assetName;
+    }
+};
+
+/**
+ * Hasher for the dirty asset cache sets and the asset script cache. Entries hash on the same fields they compare
+ * equal on: the asset name for new assets and owners, and the outpoint for transfers and reissues. Salted like
+ * SaltedOutpointHasher, so the bucket layout can't be predicted from block contents.
+ */
+class CAssetCacheHasher
+{
+private:
+    /** Salt, not const so the sets stay copy assignable */
+    uint64_t k0, k1;
+
+    size_t HashBytes(const unsigned char* data, size_t size) const;
+    size_t HashOutPoint(const COutPoint& out) const;
+
+public:
+    CAssetCacheHasher();
+
+    size_t operator()(const CAssetCacheNewAsset& item) const { return HashBytes((const unsigned char*)item.asset.strName.data(), item.asset.strName.size()); }
+    size_t operator()(const CAssetCacheReissueAsset& item) const { return HashOutPoint(item.out); }
+    size_t operator()(const CAssetCacheNewTransfer& item) const { return HashOutPoint(item.out); }
+    size_t operator()(const CAssetCacheNewOwner& item) const { return HashBytes((const unsigned char*)item.assetName.data(), item.assetName.size()); }
+    size_t operator()(const CScript& script) const { return HashBytes(script.data(), script.size()); }
 };
 
 struct CAssetCacheUndoAssetAmount
@@ -460,4 +592,208 @@ private:
     size_t maxSize;
 };
 
+/**
+ * Sharded, lock-striped cache with CLOCK (second chance) eviction.
+ *
+ * Keys are hashed onto a fixed number of shards, each guarded by its own
+ * boost::shared_mutex. Lookups only take the shard lock shared and mark the
+ * entry as referenced with a relaxed atomic store, so readers on any shard
+ * never block each other. Inserts and erases take the shard lock exclusively.
+ *
+ * Each shard keeps its entries in a flat ring of at most ceil(max_size / shards)
+ * slots. When a shard is full the clock hand sweeps the ring, clearing the
+ * reference bit of recently used entries and evicting the first entry that
+ * hasn't been used since the last sweep.
+ *
+ * Values are copied out on lookup; no references into the cache escape a lock.
+ */
+template<typename cache_key_t, typename cache_value_t, typename hasher_t = std::hash<cache_key_t>>
+class CShardedCache
+{
+public:
+    static const size_t DEFAULT_SHARDS = 16;
+
+    explicit CShardedCache(size_t max_size, size_t num_shards = DEFAULT_SHARDS)
+        : nMaxSize(max_size), nHits(0), nMisses(0), nEvictions(0)
+    {
+        if (num_shards == 0)
+            num_shards = 1;
+        size_t nShardSize = (max_size + num_shards - 1) / num_shards;
+        if (nShardSize == 0)
+            nShardSize = 1;
+        vShards.reserve(num_shards);
+        for (size_t i = 0; i < num_shards; i++)
+            vShards.emplace_back(new Shard(nShardSize));
+    }
+
+    CShardedCache(const CShardedCache&) = delete;
+    CShardedCache& operator=(const CShardedCache&) = delete;
+
+    void Put(const cache_key_t& key, const cache_value_t& value)
+    {
+        Shard& shard = GetShard(key);
+        boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+
+        auto it = shard.mapIndex.find(key);
+        if (it != shard.mapIndex.end()) {
+            shard.vSlots[it->second].second = value;
+            shard.vReferenced[it->second].store(true, std::memory_order_relaxed);
+            return;
+        }
+
+        if (shard.vSlots.size() < shard.nCapacity) {
+            shard.vSlots.emplace_back(key, value);
+            shard.vReferenced[shard.vSlots.size() - 1].store(false, std::memory_order_relaxed);
+            shard.mapIndex.emplace(key, shard.vSlots.size() - 1);
+            return;
+        }
+
+        // Shard is full, advance the clock hand until we find an entry that hasn't been referenced
+        while (shard.vReferenced[shard.nHand].exchange(false, std::memory_order_relaxed))
+            shard.nHand = (shard.nHand + 1) % shard.vSlots.size();
+
+        size_t nSlot = shard.nHand;
+        shard.mapIndex.erase(shard.vSlots[nSlot].first);
+        shard.vSlots[nSlot] = key_value_pair_t(key, value);
+        shard.mapIndex.emplace(key, nSlot);
+        shard.nHand = (shard.nHand + 1) % shard.vSlots.size();
+        nEvictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Erase(const cache_key_t& key)
+    {
+        Shard& shard = GetShard(key);
+        boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+
+        auto it = shard.mapIndex.find(key);
+        if (it == shard.mapIndex.end())
+            return;
+
+        // Move the last slot into the erased one so the ring stays dense
+        size_t nSlot = it->second;
+        size_t nLast = shard.vSlots.size() - 1;
+        shard.mapIndex.erase(it);
+        if (nSlot != nLast) {
+            shard.vSlots[nSlot] = std::move(shard.vSlots[nLast]);
+            shard.vReferenced[nSlot].store(shard.vReferenced[nLast].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            shard.mapIndex[shard.vSlots[nSlot].first] = nSlot;
+        }
+        shard.vSlots.pop_back();
+        if (shard.nHand >= shard.vSlots.size())
+            shard.nHand = 0;
+    }
+
+    /** Copy the cached value into value. Returns false (and counts a miss) if the key isn't cached */
+    bool Get(const cache_key_t& key, cache_value_t& value) const
+    {
+        const Shard& shard = GetShard(key);
+        boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+
+        auto it = shard.mapIndex.find(key);
+        if (it == shard.mapIndex.end()) {
+            nMisses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        shard.vReferenced[it->second].store(true, std::memory_order_relaxed);
+        value = shard.vSlots[it->second].second;
+        nHits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool Exists(const cache_key_t& key) const
+    {
+        const Shard& shard = GetShard(key);
+        boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+        return shard.mapIndex.count(key) > 0;
+    }
+
+    size_t Size() const
+    {
+        size_t size = 0;
+        for (const auto& shard : vShards) {
+            boost::shared_lock<boost::shared_mutex> lock(shard->mutex);
+            size += shard->vSlots.size();
+        }
+        return size;
+    }
+
+    size_t MaxSize() const
+    {
+        return nMaxSize;
+    }
+
+    size_t ShardCount() const
+    {
+        return vShards.size();
+    }
+
+    void Clear()
+    {
+        for (auto& shard : vShards) {
+            boost::unique_lock<boost::shared_mutex> lock(shard->mutex);
+            shard->mapIndex.clear();
+            shard->vSlots.clear();
+            shard->nHand = 0;
+        }
+    }
+
+    uint64_t Hits() const { return nHits.load(std::memory_order_relaxed); }
+    uint64_t Misses() const { return nMisses.load(std::memory_order_relaxed); }
+    uint64_t Evictions() const { return nEvictions.load(std::memory_order_relaxed); }
+
+    //! Memory used by the index, the slot rings and the reference bits. Dynamic memory owned by keys and values isn't included
+    size_t DynamicMemoryUsage() const
+    {
+        size_t size = memusage::MallocUsage(vShards.capacity() * sizeof(std::unique_ptr<Shard>));
+        for (const auto& shard : vShards) {
+            boost::shared_lock<boost::shared_mutex> lock(shard->mutex);
+            size += memusage::MallocUsage(sizeof(Shard));
+            size += memusage::DynamicUsage(shard->mapIndex);
+            size += memusage::MallocUsage(shard->vSlots.capacity() * sizeof(key_value_pair_t));
+            size += memusage::MallocUsage(shard->nCapacity * sizeof(std::atomic<bool>));
+        }
+        return size;
+    }
+
+private:
+    typedef typename std::pair<cache_key_t, cache_value_t> key_value_pair_t;
+
+    struct Shard
+    {
+        mutable boost::shared_mutex mutex;
+        std::unordered_map<cache_key_t, size_t, hasher_t> mapIndex;
+        std::vector<key_value_pair_t> vSlots;
+        std::unique_ptr<std::atomic<bool>[]> vReferenced;
+        size_t nCapacity;
+        size_t nHand;
+
+        explicit Shard(size_t capacity) : vReferenced(new std::atomic<bool>[capacity]), nCapacity(capacity), nHand(0)
+        {
+            vSlots.reserve(capacity);
+        }
+    };
+
+    const Shard& GetShard(const cache_key_t& key) const
+    {
+        // Mix the high bits in so shard selection doesn't correlate with the bucket choice of the shard's map
+        uint64_t nHash = hasher(key);
+        nHash = (nHash ^ (nHash >> 32)) * 0x9E3779B97F4A7C15ULL;
+        return *vShards[(nHash >> 32) % vShards.size()];
+    }
+
+    Shard& GetShard(const cache_key_t& key)
+    {
+        return const_cast<Shard&>(static_cast<const CShardedCache*>(this)->GetShard(key));
+    }
+
+    std::vector<std::unique_ptr<Shard>> vShards;
+    hasher_t hasher;
+    size_t nMaxSize;
+
+    mutable std::atomic<uint64_t> nHits;
+    mutable std::atomic<uint64_t> nMisses;
+    std::atomic<uint64_t> nEvictions;
+};
+
 #endif //BLAST_NEWASSET_H
@@ -0,0 +1,182 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "auxpow/store.h"
+
+#include "auxpow/auxpow.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "core_memusage.h"
+#include "crypto/common.h"
+#include "streams.h"
+#include "util.h"
+
+#include <stdexcept>
+
+CAuxPowStore* pauxpowstore = nullptr;
+
+//! Network magic plus payload size, written ahead of every record
+static const unsigned int AUXPOW_RECORD_HEADER_SIZE = CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+
+CAuxPowStore::CAuxPowStore(const fs::path& pathIn, bool fWipe, size_t nMaxCacheUsageIn)
+    : path(pathIn), file(nullptr), nSize(0), nCacheUsage(0), nMaxCacheUsage(nMaxCacheUsageIn)
+{
+    fs::create_directories(path.parent_path());
+    if (!fWipe)
+        file = fsbridge::fopen(path, "rb+");
+    if (!file)
+        file = fsbridge::fopen(path, "wb+");
+    if (!file)
+        throw std::runtime_error(strprintf("Unable to open auxpow store %s", path.string()));
+
+    if (fseek(file, 0, SEEK_END) != 0) {
+        fclose(file);
+        throw std::runtime_error(strprintf("Unable to seek to the end of %s", path.string()));
+    }
+    long nEnd = ftell(file);
+    if (nEnd < 0) {
+        fclose(file);
+        throw std::runtime_error(strprintf("Unable to get the size of %s", path.string()));
+    }
+    // Anything after the last record referenced by the block index (e.g. left behind by a crash
+    // before the index was written) is never read, so appending after it is safe
+    nSize = nEnd;
+    LogPrintf("Opened auxpow store %s (%u bytes)\n", path.string(), nSize);
+}
+
+CAuxPowStore::~CAuxPowStore()
+{
+    if (file) {
+        fflush(file);
+        fclose(file);
+    }
+}
+
+bool CAuxPowStore::Write(const CAuxPow& auxpow, uint64_t& nPos)
+{
+    CDataStream ssRecord(SER_DISK, CLIENT_VERSION);
+    unsigned int nPayloadSize = GetSerializeSize(ssRecord, auxpow);
+    ssRecord << FLATDATA(Params().MessageStart()) << nPayloadSize << auxpow;
+
+    LOCK(cs);
+    if (fseek(file, nSize, SEEK_SET) != 0)
+        return error("%s: unable to seek to position %u of %s", __func__, nSize, path.string());
+    if (fwrite(ssRecord.data(), 1, ssRecord.size(), file) != ssRecord.size())
+        return error("%s: failed to append to %s", __func__, path.string());
+
+    nPos = nSize + AUXPOW_RECORD_HEADER_SIZE;
+    nSize += ssRecord.size();
+    return true;
+}
+
+bool CAuxPowStore::Read(uint64_t nPos, CAuxPow& auxpow) const
+{
+    LOCK(cs);
+    return ReadFromDisk(nPos, auxpow);
+}
+
+bool CAuxPowStore::ReadCached(const uint256& hashBlock, uint64_t nPos, std::shared_ptr<CAuxPow>& auxpow)
+{
+    LOCK(cs);
+    auto it = mapCache.find(hashBlock);
+    if (it != mapCache.end()) {
+        listCache.splice(listCache.begin(), listCache, it->second);
+        auxpow = it->second->second;
+        return true;
+    }
+
+    std::shared_ptr<CAuxPow> pauxpow = std::make_shared<CAuxPow>();
+    if (!ReadFromDisk(nPos, *pauxpow))
+        return false;
+
+    size_t nEntryUsage = CacheEntryUsage(*pauxpow);
+    if (nEntryUsage <= nMaxCacheUsage) {
+        while (nCacheUsage + nEntryUsage > nMaxCacheUsage) {
+            nCacheUsage -= CacheEntryUsage(*listCache.back().second);
+            mapCache.erase(listCache.back().first);
+            listCache.pop_back();
+        }
+        listCache.emplace_front(hashBlock, pauxpow);
+        mapCache.emplace(hashBlock, listCache.begin());
+        nCacheUsage += nEntryUsage;
+    }
+    auxpow = std::move(pauxpow);
+    return true;
+}
+
+size_t CAuxPowStore::CacheEntryUsage(const CAuxPow& auxpow)
+{
+    // The auxpow and its shared_ptr control block (allocated together by make_shared), everything it
+    // owns, the list node, the hash map node and its bucket
+    return memusage::MallocUsage(sizeof(CAuxPow) + 2 * sizeof(void*)) +
+           RecursiveDynamicUsage(auxpow.tx) +
+           memusage::DynamicUsage(auxpow.vMerkleBranch) +
+           memusage::DynamicUsage(auxpow.vChainMerkleBranch) +
+           memusage::MallocUsage(sizeof(cache_entry_t) + 2 * sizeof(void*)) +
+           memusage::MallocUsage(sizeof(std::pair<const uint256, std::list<cache_entry_t>::iterator>) + sizeof(void*)) +
+           sizeof(void*);
+}
+
+bool CAuxPowStore::ReadFromDisk(uint64_t nPos, CAuxPow& auxpow) const
+{
+    AssertLockHeld(cs);
+    if (nPos < AUXPOW_RECORD_HEADER_SIZE)
+        return error("%s: invalid auxpow position %u", __func__, nPos);
+
+    if (nPos > nSize)
+        return error("%s: auxpow position %u is past the end of %s", __func__, nPos, path.string());
+    if (fseek(file, nPos - AUXPOW_RECORD_HEADER_SIZE, SEEK_SET) != 0)
+        return error("%s: unable to seek to position %u of %s", __func__, nPos, path.string());
+
+    unsigned char pchHeader[AUXPOW_RECORD_HEADER_SIZE];
+    if (fread(pchHeader, 1, sizeof(pchHeader), file) != sizeof(pchHeader))
+        return error("%s: failed to read the record header at %u", __func__, nPos);
+    if (memcmp(pchHeader, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0)
+        return error("%s: bad record magic at %u", __func__, nPos);
+    unsigned int nPayloadSize = ReadLE32(pchHeader + CMessageHeader::MESSAGE_START_SIZE);
+    if (nPayloadSize > nSize - nPos)
+        return error("%s: record at %u runs past the end of %s", __func__, nPos, path.string());
+
+    std::vector<char> vchRecord(nPayloadSize);
+    if (fread(vchRecord.data(), 1, vchRecord.size(), file) != vchRecord.size())
+        return error("%s: failed to read the auxpow at %u", __func__, nPos);
+
+    try {
+        CDataStream ssRecord(vchRecord, SER_DISK, CLIENT_VERSION);
+        ssRecord >> auxpow;
+    } catch (const std::exception& e) {
+        return error("%s: deserialize or I/O error - %s at %u", __func__, e.what(), nPos);
+    }
+    return true;
+}
+
+bool CAuxPowStore::Flush(bool fSync)
+{
+    LOCK(cs);
+    if (fflush(file) != 0)
+        return error("%s: failed to flush %s", __func__, path.string());
+    if (fSync)
+        FileCommit(file);
+    return true;
+}
+
+uint64_t CAuxPowStore::Size() const
+{
+    LOCK(cs);
+    return nSize;
+}
+
+size_t CAuxPowStore::CacheUsage() const
+{
+    LOCK(cs);
+    return nCacheUsage;
+}
+
+void CAuxPowStore::ClearCache()
+{
+    LOCK(cs);
+    mapCache.clear();
+    listCache.clear();
+    nCacheUsage = 0;
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_AUXPOW_STORE_H
+#define BITCOIN_AUXPOW_STORE_H
+
+#include "fs.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <list>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <unordered_map>
+
+class CAuxPow;
+
+//! -auxpowcache default (MiB)
+static const int64_t DEFAULT_AUXPOW_CACHE_SIZE = 16;
+
+/**
+ * Append-only flat file (blocks/auxpow.dat) holding the auxpow of every merge mined header.
+ *
+ * The block index only keeps the offset of a header's auxpow (CBlockIndex::nAuxPowPos), so the
+ * parent coinbase and merkle branches are not parsed while loading the block index and are read
+ * back from here only when a header is served. Records are laid out like the blk files: network
+ * magic, payload size, serialized auxpow. Offsets point at the payload and are never 0.
+ *
+ * Headers are served in runs of up to 2000, mostly near the tip, so auxpows read through
+ * ReadCached are kept in an LRU keyed by block hash and bounded by their memory usage.
+ */
+class CAuxPowStore
+{
+private:
+    typedef std::pair<uint256, std::shared_ptr<CAuxPow> > cache_entry_t;
+
+    struct CacheHasher
+    {
+        size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    };
+
+    mutable CCriticalSection cs;
+    fs::path path;
+    FILE* file;
+    uint64_t nSize;
+
+    //! Most recently used first
+    std::list<cache_entry_t> listCache;
+    std::unordered_map<uint256, std::list<cache_entry_t>::iterator, CacheHasher> mapCache;
+    size_t nCacheUsage;
+    size_t nMaxCacheUsage;
+
+    bool ReadFromDisk(uint64_t nPos, CAuxPow& auxpow) const;
+    static size_t CacheEntryUsage(const CAuxPow& auxpow);
+
+public:
+    explicit CAuxPowStore(const fs::path& pathIn, bool fWipe = false, size_t nMaxCacheUsageIn = DEFAULT_AUXPOW_CACHE_SIZE << 20);
+    ~CAuxPowStore();
+
+    CAuxPowStore(const CAuxPowStore&) = delete;
+    CAuxPowStore& operator=(const CAuxPowStore&) = delete;
+
+    //! Append an auxpow to the end of the file, returning the offset to store in the block index
+    bool Write(const CAuxPow& auxpow, uint64_t& nPos);
+    //! Read back the auxpow stored at nPos
+    bool Read(uint64_t nPos, CAuxPow& auxpow) const;
+    //! Read the auxpow of block hashBlock, stored at nPos, through the cache. The returned
+    //! auxpow is shared with the cache and must not be modified.
+    bool ReadCached(const uint256& hashBlock, uint64_t nPos, std::shared_ptr<CAuxPow>& auxpow);
+    //! Flush appended records, committing them to disk if fSync is set. Must happen before the
+    //! block index entries referencing them are written.
+    bool Flush(bool fSync = true);
+
+    uint64_t Size() const;
+    size_t CacheUsage() const;
+    void ClearCache();
+};
+
+/** Global variable that points to the auxpow store */
+extern CAuxPowStore* pauxpowstore;
+
+#endif // BITCOIN_AUXPOW_STORE_H
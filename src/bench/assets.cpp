@@ -0,0 +1,75 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "assets/assets.h"
+#include "chainparams.h"
+#include "key.h"
+#include "script/standard.h"
+
+#include <vector>
+
+// A block's worth of asset transfer outputs, each paying a different key
+static std::vector<CScript> SetupTransferScripts(size_t nCount)
+{
+    SelectParams(CBaseChainParams::MAIN);
+
+    std::vector<CScript> vScripts;
+    vScripts.reserve(nCount);
+    for (size_t i = 0; i < nCount; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        CScript script = GetScriptForDestination(key.GetPubKey().GetID());
+        CAssetTransfer transfer("BENCHASSET" + std::to_string(i % 100), (i + 1) * COIN);
+        transfer.ConstructTransaction(script);
+        vScripts.push_back(script);
+    }
+    return vScripts;
+}
+
+// Every output gets decoded about four times while a block goes through validation, the coins cache, the
+// indexes and the wallet. The cold run decodes each script once against an empty cache
+static void AssetScriptDecodeCold(benchmark::State& state)
+{
+    std::vector<CScript> vScripts = SetupTransferScripts(1000);
+    CAssetScriptData data;
+    while (state.KeepRunning()) {
+        ClearAssetScriptCache();
+        for (const CScript& script : vScripts)
+            assert(GetAssetScriptData(script, data));
+    }
+}
+
+static void AssetScriptDecodeBlock(benchmark::State& state)
+{
+    std::vector<CScript> vScripts = SetupTransferScripts(1000);
+    CAssetScriptData data;
+    while (state.KeepRunning()) {
+        ClearAssetScriptCache();
+        for (int nPass = 0; nPass < 4; nPass++)
+            for (const CScript& script : vScripts)
+                assert(GetAssetScriptData(script, data));
+    }
+}
+
+// Mix of every name type plus a few rejects, as seen when checking the asset outputs of a block
+static void AssetNameValidation(benchmark::State& state)
+{
+    const std::vector<std::string> vNames = {
+        "BENCHASSET", "BENCH_ASSET.01", "BENCHASSET/SUB.NAME", "BENCHASSET/SUB/DEEPER_NAME",
+        "BENCHASSET#Unique-Tag@1", "BENCHASSET/SUB#[tag]{1}", "BENCHASSET~Channel_1", "BENCHASSET^VOTE",
+        "BENCHASSET!", "BENCHASSET/SUB!", "BLAST", "_BENCHASSET", "BENCH..ASSET", "BENCHASSET/#TAG",
+        "BENCHASSET~channel", "BE"
+    };
+    AssetType type;
+    std::string strError;
+    while (state.KeepRunning()) {
+        for (const std::string& name : vNames)
+            IsAssetNameValid(name, type, strError);
+    }
+}
+
+BENCHMARK(AssetScriptDecodeCold);
+BENCHMARK(AssetScriptDecodeBlock);
+BENCHMARK(AssetNameValidation);
@@ -0,0 +1,113 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "auxpow/auxpow.h"
+#include "auxpow/store.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "dbwrapper.h"
+#include "random.h"
+
+#include <vector>
+
+// A getheaders reply is at most 2000 headers
+static const unsigned int HEADERS_PER_MESSAGE = 2000;
+
+static CAuxPow MakeBenchAuxPow(unsigned int n)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].scriptSig = CScript() << n << std::vector<unsigned char>(100, 0xab);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 50 * COIN;
+    mtx.vout[0].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0xcd) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    CAuxPow auxpow;
+    auxpow.SetTx(MakeTransactionRef(std::move(mtx)));
+    auxpow.nIndex = 0;
+    FastRandomContext rng(true);
+    for (unsigned int i = 0; i < 10; i++)
+        auxpow.vMerkleBranch.push_back(rng.rand256());
+    auxpow.nChainIndex = 0;
+    auxpow.parentBlockHeader.nNonce = n;
+    return auxpow;
+}
+
+// Before: every header not in mapDirtyAuxPow was a block tree point read deserializing the whole
+// CDiskBlockIndex with its auxpow inline
+static void AuxPowHeadersBlockTree(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    {
+        CDBWrapper db(path, 8 << 20, false, true);
+        std::vector<uint256> vHash;
+        for (unsigned int i = 0; i < HEADERS_PER_MESSAGE; i++) {
+            uint256 hash = ArithToUint256(arith_uint256(i + 1));
+            CBlockIndex index;
+            index.phashBlock = &hash;
+            index.nVersion = AuxPow::BLOCK_VERSION_AUXPOW | 4;
+            CDiskBlockIndex diskindex(&index);
+            diskindex.fLegacyAuxPow = true;
+            diskindex.auxpow = std::make_shared<CAuxPow>(MakeBenchAuxPow(i));
+            db.Write(std::make_pair(std::make_pair('b', hash), 'a'), diskindex);
+            vHash.push_back(hash);
+        }
+
+        while (state.KeepRunning()) {
+            for (const uint256& hash : vHash) {
+                CDiskBlockIndex diskindex;
+                diskindex.fLegacyAuxPow = true;
+                assert(db.Read(std::make_pair(std::make_pair('b', hash), 'a'), diskindex));
+            }
+        }
+    }
+    fs::remove_all(path);
+}
+
+static void AuxPowHeaders(benchmark::State& state, bool fCached)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    {
+        CAuxPowStore store(path / "auxpow.dat", true);
+        std::vector<std::pair<uint256, uint64_t> > vHeaders;
+        for (unsigned int i = 0; i < HEADERS_PER_MESSAGE; i++) {
+            uint64_t nPos;
+            assert(store.Write(MakeBenchAuxPow(i), nPos));
+            vHeaders.emplace_back(ArithToUint256(arith_uint256(i + 1)), nPos);
+        }
+        assert(store.Flush());
+
+        while (state.KeepRunning()) {
+            for (const auto& header : vHeaders) {
+                std::shared_ptr<CAuxPow> auxpow;
+                if (fCached) {
+                    assert(store.ReadCached(header.first, header.second, auxpow));
+                } else {
+                    auxpow = std::make_shared<CAuxPow>();
+                    assert(store.Read(header.second, *auxpow));
+                }
+            }
+        }
+    }
+    fs::remove_all(path);
+}
+
+// After, cold: direct auxpow-only reads from auxpow.dat
+static void AuxPowHeadersStore(benchmark::State& state)
+{
+    AuxPowHeaders(state, false);
+}
+
+// After, warm: the same run of headers served again through the cache, as when several peers sync
+static void AuxPowHeadersCached(benchmark::State& state)
+{
+    AuxPowHeaders(state, true);
+}
+
+BENCHMARK(AuxPowHeadersBlockTree);
+BENCHMARK(AuxPowHeadersStore);
+BENCHMARK(AuxPowHeadersCached);
@@ -0,0 +1,111 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "blockfilereader.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "random.h"
+#include "streams.h"
+#include "txdb.h"
+#include "util.h"
+#include "validation.h"
+
+#include <vector>
+
+static const int BENCH_BLOCK_FILES = 4;
+static const int BENCH_BLOCKS_PER_FILE = 50;
+static const int BENCH_TXS_PER_BLOCK = 400;
+//! -txindex lookups per benchmark iteration
+static const int BENCH_TX_READS = 100;
+
+// Blocks of small payment transactions spread over a few blk files, like the old part of the chain
+// a -txindex node looks up transactions in for getrawtransaction and the address index RPCs
+static void WriteBenchBlockFiles(std::vector<uint256>& vTxid)
+{
+    std::vector<std::pair<uint256, CDiskTxPos> > vTxPos;
+    FastRandomContext rng(true);
+    for (int nFile = 0; nFile < BENCH_BLOCK_FILES; nFile++) {
+        CAutoFile fileout(OpenBlockFile(CDiskBlockPos(nFile, 0)), SER_DISK, CLIENT_VERSION);
+        assert(!fileout.IsNull());
+        for (int nBlock = 0; nBlock < BENCH_BLOCKS_PER_FILE; nBlock++) {
+            CBlock block;
+            block.nVersion = 4;
+            block.nTime = nBlock;
+            for (int i = 0; i < BENCH_TXS_PER_BLOCK; i++) {
+                CMutableTransaction mtx;
+                mtx.vin.resize(1);
+                mtx.vin[0].prevout = COutPoint(rng.rand256(), 0);
+                mtx.vin[0].scriptSig = CScript() << std::vector<unsigned char>(72, 0x30) << std::vector<unsigned char>(33, 0x02);
+                mtx.vout.resize(2);
+                for (CTxOut& txout : mtx.vout) {
+                    txout.nValue = 1 + rng.randrange(100 * COIN);
+                    txout.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << rng.randbytes(20) << OP_EQUALVERIFY << OP_CHECKSIG;
+                }
+                block.vtx.push_back(MakeTransactionRef(std::move(mtx)));
+            }
+
+            unsigned int nSize = GetSerializeSize(fileout, block);
+            fileout << FLATDATA(Params().MessageStart()) << nSize;
+            CDiskBlockPos pos(nFile, ftell(fileout.Get()));
+            fileout << block;
+
+            CDiskTxPos postx(pos, GetSizeOfCompactSize(block.vtx.size()));
+            for (const CTransactionRef& tx : block.vtx) {
+                vTxPos.emplace_back(tx->GetHash(), postx);
+                vTxid.push_back(tx->GetHash());
+                postx.nTxOffset += ::GetSerializeSize(*tx, SER_DISK, CLIENT_VERSION);
+            }
+        }
+    }
+    assert(pblocktree->WriteTxIndex(vTxPos));
+}
+
+static void BlockFileTxReads(benchmark::State& state, bool fMapped)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(path);
+    gArgs.ForceSetArg("-datadir", path.string());
+    ClearDatadirCache();
+    pblocktree = new CBlockTreeDB(1 << 20, true);
+    fTxIndex = true;
+    if (fMapped)
+        pblockfilereader = new CBlockFileReader(GetDataDir() / "blocks");
+
+    std::vector<uint256> vTxid;
+    WriteBenchBlockFiles(vTxid);
+
+    FastRandomContext rng(true);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < BENCH_TX_READS; i++) {
+            CTransactionRef tx;
+            uint256 hashBlock;
+            bool fFound = GetTransaction(vTxid[rng.randrange(vTxid.size())], tx, Params().GetConsensus(), hashBlock, false);
+            assert(fFound);
+        }
+    }
+
+    delete pblockfilereader;
+    pblockfilereader = nullptr;
+    fTxIndex = false;
+    delete pblocktree;
+    pblocktree = nullptr;
+    ClearDatadirCache();
+    fs::remove_all(path);
+}
+
+// Before: every -txindex lookup opened the blk file and read the header and transaction through stdio
+static void BlockFileTxReadsStdio(benchmark::State& state)
+{
+    BlockFileTxReads(state, false);
+}
+
+static void BlockFileTxReadsMapped(benchmark::State& state)
+{
+    BlockFileTxReads(state, true);
+}
+
+BENCHMARK(BlockFileTxReadsStdio);
+BENCHMARK(BlockFileTxReadsMapped);
@@ -0,0 +1,72 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "coins.h"
+#include "script/standard.h"
+#include "txmempool.h"
+
+#include <cassert>
+#include <vector>
+
+static const int ADDRESS_COUNT = 100;
+static const int TX_COUNT = 2000;
+
+// Adds the address and spent index entries of a mempool of P2PKH transactions
+// paying between a small set of addresses, looks up every address and removes
+// the transactions again, like a busy node with -addressindex and -spentindex.
+static void MempoolAddressIndex(benchmark::State& state)
+{
+    std::vector<uint160> vHashes;
+    std::vector<CScript> vScripts;
+    for (int i = 0; i < ADDRESS_COUNT; i++) {
+        uint160 hash;
+        *hash.begin() = i;
+        *(hash.begin() + 1) = i >> 8;
+        vHashes.push_back(hash);
+        vScripts.push_back(GetScriptForDestination(CKeyID(hash)));
+    }
+
+    CCoinsView coinsDummy;
+    CCoinsViewCache view(&coinsDummy);
+    std::vector<CTxMemPoolEntry> vEntries;
+    LockPoints lp;
+    for (int i = 0; i < TX_COUNT; i++) {
+        COutPoint prevout(ArithToUint256(arith_uint256(i + 1)), 0);
+        view.AddCoin(prevout, Coin(CTxOut(10 * COIN, vScripts[i % ADDRESS_COUNT]), 1, false), false);
+
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = prevout;
+        tx.vout.resize(2);
+        tx.vout[0].scriptPubKey = vScripts[(i + 1) % ADDRESS_COUNT];
+        tx.vout[0].nValue = 6 * COIN;
+        tx.vout[1].scriptPubKey = vScripts[(i + 7) % ADDRESS_COUNT];
+        tx.vout[1].nValue = 4 * COIN;
+        vEntries.emplace_back(MakeTransactionRef(tx), 1000, i, 1, false, 4, lp);
+    }
+
+    CTxMemPool pool;
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > results;
+
+    while (state.KeepRunning()) {
+        for (const CTxMemPoolEntry& entry : vEntries) {
+            pool.addAddressIndex(entry, view);
+            pool.addSpentIndex(entry, view);
+        }
+        for (int i = 0; i < ADDRESS_COUNT; i++) {
+            std::vector<std::pair<uint160, int> > addresses(1, std::make_pair(vHashes[i], 1));
+            results.clear();
+            pool.getAddressIndex(addresses, results);
+            assert(results.size() == 3 * TX_COUNT / ADDRESS_COUNT);
+        }
+        for (const CTxMemPoolEntry& entry : vEntries) {
+            pool.removeAddressIndex(entry.GetTx().GetHash());
+            pool.removeSpentIndex(entry.GetTx().GetHash());
+        }
+    }
+}
+
+BENCHMARK(MempoolAddressIndex);
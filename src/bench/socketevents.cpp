@@ -0,0 +1,95 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "netbase.h"
+#include "socketevents.h"
+#include "util.h"
+
+#include <cassert>
+#include <vector>
+
+#ifndef WIN32
+#include <sys/socket.h>
+
+/** Peers sending something in each round, the rest is idle like most connections of a relay node */
+static const int ACTIVE_PEERS = 10;
+
+// One round of the socket handler over nPeers loopback connections: wait for the sockets,
+// the way CConnman::ThreadSocketHandler does, with a few peers that sent a byte, and read it.
+// select() has to be handed every socket again in each round.
+static void SocketEventsRounds(benchmark::State& state, SocketEventsMode mode, int nPeers)
+{
+    RaiseFileDescriptorLimit(2 * nPeers + 100);
+
+    std::vector<SOCKET> vLocal;
+    std::vector<SOCKET> vRemote;
+    CSocketEvents socketEvents(mode);
+    assert(socketEvents.GetMode() == mode);
+    for (int i = 0; i < nPeers; i++) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            assert(!"socketpair failed, not enough file descriptors?");
+        }
+        SetSocketNonBlocking(fds[0], true);
+        vLocal.push_back(fds[0]);
+        vRemote.push_back(fds[1]);
+        socketEvents.Register(fds[0], i, true);
+    }
+
+    std::vector<CSocketWait> vWait;
+    std::vector<CSocketEvent> vEvents;
+    int nNext = 0;
+    char ch = 0;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < ACTIVE_PEERS; i++) {
+            int ret = send(vRemote[(nNext + i * 97) % nPeers], &ch, 1, 0);
+            assert(ret == 1);
+        }
+        nNext++;
+
+        int nRead = 0;
+        while (nRead < ACTIVE_PEERS) {
+            vWait.clear();
+            vEvents.clear();
+            if (mode == SOCKETEVENTS_SELECT) {
+                for (int i = 0; i < nPeers; i++)
+                    vWait.emplace_back(vLocal[i], i, true, false);
+            }
+            socketEvents.Wait(vWait, vEvents, 50);
+            for (const CSocketEvent& event : vEvents) {
+                if (event.fRecv && recv(vLocal[event.nId], &ch, 1, 0) == 1)
+                    nRead++;
+            }
+        }
+    }
+
+    for (int i = 0; i < nPeers; i++) {
+        CloseSocket(vLocal[i]);
+        CloseSocket(vRemote[i]);
+    }
+}
+
+static void SocketEventsSelect500(benchmark::State& state)
+{
+    SocketEventsRounds(state, SOCKETEVENTS_SELECT, 500);
+}
+
+BENCHMARK(SocketEventsSelect500);
+
+#ifdef HAVE_EPOLL
+static void SocketEventsEpoll500(benchmark::State& state)
+{
+    SocketEventsRounds(state, SOCKETEVENTS_EPOLL, 500);
+}
+
+static void SocketEventsEpoll2000(benchmark::State& state)
+{
+    SocketEventsRounds(state, SOCKETEVENTS_EPOLL, 2000);
+}
+
+BENCHMARK(SocketEventsEpoll500);
+BENCHMARK(SocketEventsEpoll2000);
+#endif
+#endif
@@ -0,0 +1,67 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "random.h"
+#include "spentindex.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <cassert>
+#include <vector>
+
+static const int SPENT_ENTRIES = 20000;
+
+// Spent outpoint lookups as getspentinfo and getrawtransaction do them, in a block tree database on disk
+static void SpentIndexLookup(benchmark::State& state, bool fCompact)
+{
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(path);
+    gArgs.ForceSetArg("-datadir", path.string());
+    ClearDatadirCache();
+    {
+        CBlockTreeDB blocktree(8 << 20, false, true);
+        FastRandomContext rng(true);
+        uint160 hashAddress;
+        std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > vSpent;
+        for (int i = 0; i < SPENT_ENTRIES; i++) {
+            vSpent.emplace_back(CSpentIndexKey(rng.rand256(), i % 4),
+                                CSpentIndexValue(rng.rand256(), i % 3, 200000 + i / 10, CAmount(i + 1) * 1000000, 1, hashAddress));
+        }
+        if (fCompact) {
+            assert(blocktree.UpdateSpentIndex(vSpent));
+        } else {
+            for (const auto& entry : vSpent)
+                assert(blocktree.Write(std::make_pair('p', entry.first), entry.second));
+        }
+
+        while (state.KeepRunning()) {
+            for (auto& entry : vSpent) {
+                CSpentIndexValue value;
+                if (fCompact)
+                    assert(blocktree.ReadSpentIndex(entry.first, value));
+                else
+                    assert(blocktree.Read(std::make_pair('p', entry.first), value));
+            }
+        }
+    }
+    gArgs.ForceSetArg("-datadir", "");
+    ClearDatadirCache();
+    fs::remove_all(path);
+}
+
+// Before: 109 byte entries with the full txids and fixed width fields
+static void SpentIndexLookupOriginal(benchmark::State& state)
+{
+    SpentIndexLookup(state, false);
+}
+
+// After: 91 byte entries with varint fields, 71 without an address
+static void SpentIndexLookupCompact(benchmark::State& state)
+{
+    SpentIndexLookup(state, true);
+}
+
+BENCHMARK(SpentIndexLookupOriginal);
+BENCHMARK(SpentIndexLookupCompact);
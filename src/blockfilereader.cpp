@@ -0,0 +1,115 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilereader.h"
+
+#include "tinyformat.h"
+#include "util.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CBlockFileReader* pblockfilereader = nullptr;
+
+CBlockFileMapping::~CBlockFileMapping()
+{
+#ifndef WIN32
+    munmap((void*)pdata, nSize);
+#endif
+}
+
+CBlockFileReader::CBlockFileReader(const fs::path& dirIn, size_t nMaxMappingsIn)
+    : dir(dirIn), nMaxMappings(std::max<size_t>(nMaxMappingsIn, 1))
+{
+}
+
+std::shared_ptr<const CBlockFileMapping> CBlockFileReader::MapFile(const file_key_t& key) const
+{
+#ifndef WIN32
+    // A few dozen files of up to 128 MiB don't fit in a 32 bit address space
+    if (sizeof(void*) < 8)
+        return nullptr;
+
+    fs::path path = dir / strprintf("%s%05u.dat", key.first, key.second);
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* pdata = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pdata == MAP_FAILED) {
+        LogPrintf("%s: mmap of %s failed: %s\n", __func__, path.string(), strerror(errno));
+        return nullptr;
+    }
+    return std::make_shared<const CBlockFileMapping>((const char*)pdata, (size_t)st.st_size);
+#else
+    return nullptr;
+#endif
+}
+
+std::shared_ptr<const CBlockFileMapping> CBlockFileReader::Map(const char* prefix, const CDiskBlockPos& pos, size_t nLength)
+{
+    if (pos.IsNull())
+        return nullptr;
+    file_key_t key(prefix, pos.nFile);
+
+    LOCK(cs);
+    auto it = mapCache.find(key);
+    if (it != mapCache.end()) {
+        if (it->second->second->Contains(pos.nPos, nLength)) {
+            listCache.splice(listCache.begin(), listCache, it->second);
+            return it->second->second;
+        }
+        // The file may have grown since it was mapped
+        listCache.erase(it->second);
+        mapCache.erase(it);
+    }
+
+    std::shared_ptr<const CBlockFileMapping> mapping = MapFile(key);
+    if (!mapping || !mapping->Contains(pos.nPos, nLength))
+        return nullptr;
+
+    listCache.emplace_front(key, mapping);
+    mapCache[key] = listCache.begin();
+    while (listCache.size() > nMaxMappings) {
+        mapCache.erase(listCache.back().first);
+        listCache.pop_back();
+    }
+    return mapping;
+}
+
+void CBlockFileReader::Close(const char* prefix, int nFile)
+{
+    LOCK(cs);
+    auto it = mapCache.find(file_key_t(prefix, nFile));
+    if (it != mapCache.end()) {
+        listCache.erase(it->second);
+        mapCache.erase(it);
+    }
+}
+
+void CBlockFileReader::Clear()
+{
+    LOCK(cs);
+    mapCache.clear();
+    listCache.clear();
+}
+
+size_t CBlockFileReader::MappedFiles() const
+{
+    LOCK(cs);
+    return listCache.size();
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEREADER_H
+#define BITCOIN_BLOCKFILEREADER_H
+
+#include "chain.h"
+#include "fs.h"
+#include "sync.h"
+
+#include <list>
+#include <map>
+#include <memory>
+#include <stddef.h>
+#include <string>
+#include <utility>
+
+//! Number of blk and rev files kept mapped by default
+static const unsigned int DEFAULT_BLOCKFILE_MAPPINGS = 64;
+
+/** A read only mapping of a whole blk or rev file, unmapped when the last reference to it goes away */
+class CBlockFileMapping
+{
+private:
+    const char* pdata;
+    size_t nSize;
+
+public:
+    CBlockFileMapping(const char* pdataIn, size_t nSizeIn) : pdata(pdataIn), nSize(nSizeIn) {}
+    ~CBlockFileMapping();
+
+    CBlockFileMapping(const CBlockFileMapping&) = delete;
+    CBlockFileMapping& operator=(const CBlockFileMapping&) = delete;
+
+    const char* data() const { return pdata; }
+    size_t size() const { return nSize; }
+    bool Contains(unsigned int nPos, size_t nLength) const { return nPos <= nSize && nLength <= nSize - nPos; }
+};
+
+/**
+ * Read only access to the blk and rev files through memory maps, so that reading a block, its undo
+ * data or a single transaction of it takes no system calls once its file is mapped.
+ *
+ * The most recently used files stay mapped, at most nMaxMappings of them. The file blocks are being
+ * appended to is mapped again when a read goes past the end of its mapping. A file that is truncated
+ * or deleted has to be closed here first, reads through mappings taken before still see the old data.
+ *
+ * Files are not mapped on Windows and 32 bit systems, Map returns nullptr there like on any other
+ * failure and callers read through stdio instead.
+ */
+class CBlockFileReader
+{
+private:
+    //! File prefix ("blk" or "rev") and number
+    typedef std::pair<std::string, int> file_key_t;
+    typedef std::pair<file_key_t, std::shared_ptr<const CBlockFileMapping> > cache_entry_t;
+
+    mutable CCriticalSection cs;
+    fs::path dir;
+    size_t nMaxMappings;
+
+    //! Most recently used first
+    std::list<cache_entry_t> listCache;
+    std::map<file_key_t, std::list<cache_entry_t>::iterator> mapCache;
+
+    std::shared_ptr<const CBlockFileMapping> MapFile(const file_key_t& key) const;
+
+public:
+    explicit CBlockFileReader(const fs::path& dirIn, size_t nMaxMappingsIn = DEFAULT_BLOCKFILE_MAPPINGS);
+
+    CBlockFileReader(const CBlockFileReader&) = delete;
+    CBlockFileReader& operator=(const CBlockFileReader&) = delete;
+
+    //! Get a mapping of the file pos is in that holds the nLength bytes at pos
+    std::shared_ptr<const CBlockFileMapping> Map(const char* prefix, const CDiskBlockPos& pos, size_t nLength);
+    //! Drop the mapping of a file before it is truncated or deleted
+    void Close(const char* prefix, int nFile);
+    void Clear();
+
+    size_t MappedFiles() const;
+};
+
+/** Global variable that points to the block file reader, reads go through stdio while it is null */
+extern CBlockFileReader* pblockfilereader;
+
+#endif // BITCOIN_BLOCKFILEREADER_H
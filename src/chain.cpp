@@ -5,7 +5,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chain.h"
-#include "txdb.h"
+#include "auxpow/store.h"
+#include "util.h"
+#include "validation.h"
 
 /**
  * CChain implementation
@@ -24,7 +26,6 @@ void CChain::SetTip(CBlockIndex *pindex) {
 
 CBlockHeader CBlockIndex::GetBlockHeader(const std::map<uint256, std::shared_ptr<CAuxPow> >& mapDirtyAuxPow) const
 {
-    extern CBlockTreeDB *pblocktree;
     CBlockHeader block;
 
     if (nVersion & AuxPow::BLOCK_VERSION_AUXPOW) {
@@ -32,12 +33,13 @@ CBlockHeader CBlockIndex::GetBlockHeader(const std::map<uint256, std::shared_ptr
         if (it != mapDirtyAuxPow.end()) {
             block.auxpow = it->second;
         } else {
-            CDiskBlockIndex diskblockindex;
-            // auxpow is not in memory, load CDiskBlockHeader
-            // from database to get it
-
-            assert(pblocktree->ReadDiskBlockIndex(*phashBlock, diskblockindex));
-            block.auxpow = diskblockindex.auxpow;
+            // auxpow is not in memory, load it through the auxpow store's cache
+            if (!pauxpowstore->ReadCached(*phashBlock, nAuxPowPos, block.auxpow)) {
+                AbortNode(strprintf("%s: failed to read the auxpow of block %s at position %u", __func__, phashBlock->ToString(), nAuxPowPos),
+                          _("Error reading the merged mining data of a block from disk. You will need to rebuild the database using -reindex."));
+                // The node is shutting down, an empty auxpow keeps the header serializable until then
+                block.auxpow = std::make_shared<CAuxPow>();
+            }
         }
     }
 
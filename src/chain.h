@@ -196,6 +196,9 @@ public:
     //! Byte offset within rev?????.dat where this block's undo data is stored
     unsigned int nUndoPos;
 
+    //! Byte offset within auxpow.dat where this block's auxpow is stored, 0 if it has none there
+    uint64_t nAuxPowPos;
+
     //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
     arith_uint256 nChainWork;
 
@@ -233,6 +236,7 @@ public:
         nFile = 0;
         nDataPos = 0;
         nUndoPos = 0;
+        nAuxPowPos = 0;
         nChainWork = arith_uint256();
         nTx = 0;
         nChainTx = 0;
@@ -389,16 +393,19 @@ class CDiskBlockIndex : public CBlockIndex
 public:
     uint256 hashPrev;
 
-    // if this is an aux work block
+    //! Records written before auxpows moved to auxpow.dat carry the whole auxpow inline instead
+    //! of its offset. Set before reading one of those so it can be migrated.
+    bool fLegacyAuxPow;
     std::shared_ptr<CAuxPow> auxpow;
 
     CDiskBlockIndex() {
         hashPrev = uint256();
+        fLegacyAuxPow = false;
     }
 
-    explicit CDiskBlockIndex(const CBlockIndex* pindex, const std::shared_ptr<CAuxPow>& auxpow) : CBlockIndex(*pindex) {
+    explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
-        this->auxpow = auxpow;
+        fLegacyAuxPow = false;
     }
 
     ADD_SERIALIZE_METHODS;
@@ -427,8 +434,12 @@ public:
         READWRITE(nBits);
         READWRITE(nNonce);
         // auxpow is not part of the block hash
-        if ((!(s.GetType() & SER_GETHASH)) && this->IsAuxPow())
-            READWRITE(auxpow);
+        if ((!(s.GetType() & SER_GETHASH)) && this->IsAuxPow()) {
+            if (fLegacyAuxPow)
+                READWRITE(auxpow);
+            else
+                READWRITE(VARINT(nAuxPowPos));
+        }
     }
 
     uint256 GetBlockHash() const
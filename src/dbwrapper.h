@@ -177,6 +177,7 @@ public:
 class CDBWrapper
 {
     friend const std::vector<unsigned char>& dbwrapper_private::GetObfuscateKey(const CDBWrapper &w);
+    friend class CDBSnapshot;
 private:
     //! custom environment this database is using (may be nullptr in case of default environment)
     leveldb::Env* penv;
@@ -224,6 +225,12 @@ public:
 
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
+    {
+        return Read(readoptions, key, value);
+    }
+
+    template <typename K, typename V>
+    bool Read(const leveldb::ReadOptions& options, const K& key, V& value) const
     {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
@@ -231,7 +238,7 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(options, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -258,6 +265,12 @@ public:
 
     template <typename K>
     bool Exists(const K& key) const
+    {
+        return Exists(readoptions, key);
+    }
+
+    template <typename K>
+    bool Exists(const leveldb::ReadOptions& options, const K& key) const
     {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
@@ -265,7 +278,7 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(options, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -341,4 +354,46 @@ public:
 
 };
 
+/**
+ * A consistent read-only view of a CDBWrapper as of the moment it was created.
+ * Reads and iterators made through the snapshot don't observe later writes, so
+ * long scans can run without holding the locks that serialize the writers.
+ */
+class CDBSnapshot
+{
+private:
+    const CDBWrapper &parent;
+    const leveldb::Snapshot *psnapshot;
+
+    //! options used when reading from the snapshot
+    leveldb::ReadOptions readoptions;
+
+    //! options used when iterating over values of the snapshot
+    leveldb::ReadOptions iteroptions;
+
+public:
+    explicit CDBSnapshot(const CDBWrapper &_parent);
+    ~CDBSnapshot();
+
+    CDBSnapshot(const CDBSnapshot&) = delete;
+    CDBSnapshot& operator=(const CDBSnapshot&) = delete;
+
+    template <typename K, typename V>
+    bool Read(const K& key, V& value) const
+    {
+        return parent.Read(readoptions, key, value);
+    }
+
+    template <typename K>
+    bool Exists(const K& key) const
+    {
+        return parent.Exists(readoptions, key);
+    }
+
+    CDBIterator *NewIterator() const
+    {
+        return new CDBIterator(parent, parent.pdb->NewIterator(iteroptions));
+    }
+};
+
 #endif // BITCOIN_DBWRAPPER_H
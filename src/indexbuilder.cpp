@@ -0,0 +1,403 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "indexbuilder.h"
+
+#include "chainparams.h"
+#include "checkqueue.h"
+#include "hash.h"
+#include "primitives/transaction.h"
+#include "sync.h"
+#include "txdb.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validation.h"
+#include "versionbits.h"
+#include "assets/assets.h"
+
+#include <atomic>
+#include <map>
+
+#include <boost/thread.hpp>
+
+/** Milliseconds the index builder waits for more blocks when there is nothing to index */
+static const int64_t INDEX_BUILDER_POLL_INTERVAL = 500;
+
+static CCheckQueue<CIndexBuildCheck> indexbuildcheckqueue(128);
+
+/** Changed with cs_main held, so ConnectBlock and DisconnectBlock see it consistently */
+static std::atomic<bool> fIndexBuilderActive(false);
+
+/** Locked after cs_main where both are taken */
+static CCriticalSection cs_indexbuilder;
+/** The block the indexes are written up to, null for none */
+static uint256 hashIndexBuilderBest;
+/** The last block of the batch being built, -1 for none */
+static int nIndexBuilderClaimedHeight = -1;
+/** Set when a block of the batch being built was disconnected, the batch is thrown away then */
+static bool fIndexBuilderAbortBatch = false;
+
+void GetBlockIndexEntries(const CBlock& block, const CBlockUndo& blockundo, int nHeight, bool fAssets, CBlockIndexEntries& entries)
+{
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction &tx = *(block.vtx[i]);
+        const uint256 txhash = tx.GetHash();
+
+        if (!tx.IsCoinBase() && (fAddressIndex || fSpentIndex)) {
+            const CTxUndo &txundo = blockundo.vtxundo[i - 1];
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const CTxIn &input = tx.vin[j];
+                const CTxOut &prevout = txundo.vprevout[j].out;
+                uint160 hashBytes;
+                int addressType = 0;
+                bool isAsset = false;
+                std::string assetName;
+                CAmount assetAmount;
+
+                if (prevout.scriptPubKey.IsPayToScriptHash()) {
+                    hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
+                    addressType = 2;
+                } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
+                    hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
+                    addressType = 1;
+                } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
+                    hashBytes = Hash160(prevout.scriptPubKey.begin() + 1, prevout.scriptPubKey.end() - 1);
+                    addressType = 1;
+                } else if (fAssets && ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount)) {
+                    addressType = 1;
+                    isAsset = true;
+                }
+
+                if (fAddressIndex && addressType > 0) {
+                    if (isAsset) {
+                        // record spending activity
+                        entries.addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, assetName, nHeight, i, txhash, j, true), assetAmount * -1));
+
+                        // remove address from unspent index
+                        entries.addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, assetName, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
+                    } else {
+                        // record spending activity
+                        entries.addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, i, txhash, j, true), prevout.nValue * -1));
+
+                        // remove address from unspent index
+                        entries.addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
+                    }
+                }
+
+                if (fSpentIndex) {
+                    // add the spent index to determine the txid and input that spent an output
+                    // and to find the amount and address from an input
+                    entries.spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, nHeight, prevout.nValue, addressType, hashBytes)));
+                }
+            }
+        }
+
+        if (!fAddressIndex)
+            continue;
+
+        for (unsigned int k = 0; k < tx.vout.size(); k++) {
+            const CTxOut &out = tx.vout[k];
+            uint160 hashBytes;
+            int addressType;
+
+            if (out.scriptPubKey.IsPayToScriptHash()) {
+                hashBytes = uint160(std::vector<unsigned char>(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22));
+                addressType = 2;
+            } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
+                hashBytes = uint160(std::vector<unsigned char>(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23));
+                addressType = 1;
+            } else if (out.scriptPubKey.IsPayToPublicKey()) {
+                hashBytes = Hash160(out.scriptPubKey.begin() + 1, out.scriptPubKey.end() - 1);
+                addressType = 1;
+            } else {
+                std::string assetName;
+                CAmount assetAmount;
+                if (fAssets && ParseAssetScript(out.scriptPubKey, hashBytes, assetName, assetAmount)) {
+                    // record receiving activity
+                    entries.addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, assetName, nHeight, i, txhash, k, false), assetAmount));
+
+                    // record unspent output
+                    entries.addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, assetName, txhash, k), CAddressUnspentValue(assetAmount, out.scriptPubKey, nHeight)));
+                }
+                continue;
+            }
+
+            // record receiving activity
+            entries.addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, i, txhash, k, false), out.nValue));
+
+            // record unspent output
+            entries.addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight)));
+        }
+    }
+}
+
+CIndexBuildCheck::CIndexBuildCheck(const CBlockIndex* pindex, bool fAssetsIn, CBlockIndexEntries* pentriesIn) :
+    posBlock(pindex->GetBlockPos()), posUndo(pindex->GetUndoPos()), hashBlock(pindex->GetBlockHash()),
+    hashPrevBlock(pindex->pprev->GetBlockHash()), nHeight(pindex->nHeight), fAssets(fAssetsIn), pentries(pentriesIn) {}
+
+bool CIndexBuildCheck::operator()() {
+    CBlock block;
+    if (!ReadBlockFromDisk(block, posBlock, Params().GetConsensus()) || block.GetHash() != hashBlock)
+        return error("%s: failed to read block %s", __func__, hashBlock.ToString());
+
+    CBlockUndo blockundo;
+    if (posUndo.IsNull() || !UndoReadFromDisk(blockundo, posUndo, hashPrevBlock))
+        return error("%s: failed to read undo data of block %s", __func__, hashBlock.ToString());
+
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block %s and undo data inconsistent", __func__, hashBlock.ToString());
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        if (blockundo.vtxundo[i - 1].vprevout.size() != block.vtx[i]->vin.size())
+            return error("%s: transaction %s and undo data inconsistent", __func__, block.vtx[i]->GetHash().ToString());
+    }
+
+    GetBlockIndexEntries(block, blockundo, nHeight, fAssets, *pentries);
+    return true;
+}
+
+void ThreadIndexBuildCheck() {
+    RenameThread("blast-indexch");
+    indexbuildcheckqueue.Thread();
+}
+
+bool InitIndexBuilder(bool fStart)
+{
+    LOCK2(cs_main, cs_indexbuilder);
+    fIndexBuilderActive = false;
+    hashIndexBuilderBest.SetNull();
+    nIndexBuilderClaimedHeight = -1;
+    fIndexBuilderAbortBatch = false;
+
+    if (fStart) {
+        // Pruning could remove the blocks before they are indexed
+        if (!(fAddressIndex || fSpentIndex || fTimestampIndex) || fPruneMode || !gArgs.GetBoolArg("-indexbuilder", DEFAULT_INDEXBUILDER))
+            return pblocktree->EraseIndexBuilderBestBlock();
+        if (!pblocktree->WriteIndexBuilderBestBlock(uint256()))
+            return error("%s: failed to write the index builder state", __func__);
+        // The address balances don't follow the blocks the builder indexes, so they belong to no block until rebuilt
+        if (fAddressIndex && !pblocktree->EraseAddressBalanceBestBlock())
+            return error("%s: failed to write the address balances state", __func__);
+    }
+
+    if (pblocktree->ReadIndexBuilderBestBlock(hashIndexBuilderBest)) {
+        fIndexBuilderActive = true;
+        if (hashIndexBuilderBest.IsNull())
+            LogPrintf("Index builder: building the indexes in the background\n");
+        else
+            LogPrintf("Index builder: building the indexes in the background after block %s\n", hashIndexBuilderBest.ToString());
+    }
+    return true;
+}
+
+bool IndexBuilderActive()
+{
+    return fIndexBuilderActive;
+}
+
+bool IndexBuilderBlockDisconnected(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    LOCK(cs_indexbuilder);
+    if (pindex->nHeight <= nIndexBuilderClaimedHeight)
+        fIndexBuilderAbortBatch = true;
+
+    BlockMap::iterator mi = mapBlockIndex.find(hashIndexBuilderBest);
+    if (mi == mapBlockIndex.end() || mi->second->GetAncestor(pindex->nHeight) != pindex)
+        return false;
+
+    hashIndexBuilderBest = pindex->pprev->GetBlockHash();
+    if (!pblocktree->WriteIndexBuilderBestBlock(hashIndexBuilderBest))
+        AbortNode("Failed to write the index builder state");
+    return true;
+}
+
+/**
+ * Claim the next blocks to index, at most INDEX_BUILDER_BATCH_BLOCKS up to nMinDepth blocks behind the tip,
+ * and set up their checks. Requires cs_main. Returns false if the indexes don't belong to the active chain.
+ */
+static bool ClaimIndexBuilderBlocks(int nMinDepth, std::vector<const CBlockIndex*>& vBlocks, std::vector<CBlockIndexEntries>& vEntries,
+                                    std::vector<CIndexBuildCheck>& vChecks)
+{
+    AssertLockHeld(cs_main);
+    vBlocks.clear();
+    vEntries.clear();
+    vChecks.clear();
+
+    LOCK(cs_indexbuilder);
+    int nHeight = 0;
+    if (!hashIndexBuilderBest.IsNull()) {
+        BlockMap::iterator mi = mapBlockIndex.find(hashIndexBuilderBest);
+        // While reindexing the block may not have been loaded again yet
+        if (mi == mapBlockIndex.end())
+            return true;
+        const CBlockIndex* pindexBest = mi->second;
+        if (!chainActive.Contains(pindexBest)) {
+            // After an unclean shutdown the chainstate can be behind the indexes until the blocks are connected again
+            if (pindexBest->GetAncestor(chainActive.Height()) == chainActive.Tip())
+                return true;
+            return error("%s: the indexes were built up to block %s, which is not on the active chain", __func__, hashIndexBuilderBest.ToString());
+        }
+        nHeight = pindexBest->nHeight;
+    }
+
+    int nEnd = std::min(chainActive.Height() - nMinDepth, nHeight + INDEX_BUILDER_BATCH_BLOCKS);
+    if (nEnd <= nHeight)
+        return true;
+
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    vEntries.resize(nEnd - nHeight);
+    for (int h = nHeight + 1; h <= nEnd; h++) {
+        const CBlockIndex* pindex = chainActive[h];
+        bool fAssets = VersionBitsState(pindex->pprev, consensusParams, Consensus::DEPLOYMENT_ASSETS, versionbitscache) == THRESHOLD_ACTIVE;
+        vChecks.emplace_back(pindex, fAssets, &vEntries[vBlocks.size()]);
+        vBlocks.push_back(pindex);
+    }
+    nIndexBuilderClaimedHeight = nEnd;
+    fIndexBuilderAbortBatch = false;
+    return true;
+}
+
+/** Whether the indexes are written up to the tip, requires cs_main */
+static bool IndexBuilderReachedTip()
+{
+    AssertLockHeld(cs_main);
+    const CBlockIndex* pindexTip = chainActive.Tip();
+    if (!pindexTip)
+        return false;
+    LOCK(cs_indexbuilder);
+    return hashIndexBuilderBest.IsNull() ? pindexTip->nHeight == 0 : hashIndexBuilderBest == pindexTip->GetBlockHash();
+}
+
+/** Derive the index entries of the claimed blocks and write them in one batch */
+static bool BuildIndexBatch(const std::vector<const CBlockIndex*>& vBlocks, std::vector<CBlockIndexEntries>& vEntries,
+                            std::vector<CIndexBuildCheck>& vChecks)
+{
+    int64_t nStart = GetTimeMicros();
+    bool fOk = true;
+    if (fAddressIndex || fSpentIndex) {
+        if (nScriptCheckThreads) {
+            CCheckQueueControl<CIndexBuildCheck> control(&indexbuildcheckqueue);
+            control.Add(vChecks);
+            fOk = control.Wait();
+        } else {
+            for (CIndexBuildCheck& check : vChecks)
+                fOk = fOk && check();
+        }
+    }
+    if (!fOk)
+        return AbortNode("Failed to read blocks for the index builder");
+
+    // Outputs created and spent within the batch never have to reach the unspent index
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    std::map<COutPoint, size_t> mapCreated;
+    std::vector<bool> vSpent;
+    for (CBlockIndexEntries& entries : vEntries) {
+        addressIndex.insert(addressIndex.end(), entries.addressIndex.begin(), entries.addressIndex.end());
+        spentIndex.insert(spentIndex.end(), entries.spentIndex.begin(), entries.spentIndex.end());
+        for (const auto& item : entries.addressUnspentIndex) {
+            COutPoint outpoint(item.first.txhash, item.first.index);
+            if (item.second.IsNull()) {
+                std::map<COutPoint, size_t>::iterator it = mapCreated.find(outpoint);
+                if (it != mapCreated.end()) {
+                    vSpent[it->second] = true;
+                    mapCreated.erase(it);
+                    continue;
+                }
+            } else {
+                mapCreated[outpoint] = addressUnspentIndex.size();
+            }
+            addressUnspentIndex.push_back(item);
+            vSpent.push_back(false);
+        }
+        entries = CBlockIndexEntries();
+    }
+    size_t nUnspent = 0;
+    for (size_t i = 0; i < addressUnspentIndex.size(); i++) {
+        if (!vSpent[i])
+            addressUnspentIndex[nUnspent++] = addressUnspentIndex[i];
+    }
+    addressUnspentIndex.resize(nUnspent);
+
+    // The logical timestamps only ever increase along the chain
+    std::vector<std::pair<uint256, unsigned int> > timestampIndex;
+    if (fTimestampIndex) {
+        unsigned int prevLogicalTS = 0;
+        const CBlockIndex* pindexPrev = vBlocks.front()->pprev;
+        if (pindexPrev->nHeight > 0 && !pblocktree->ReadTimestampBlockIndex(pindexPrev->GetBlockHash(), prevLogicalTS))
+            LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
+        for (const CBlockIndex* pindex : vBlocks) {
+            unsigned int logicalTS = std::max(pindex->nTime, prevLogicalTS + 1);
+            timestampIndex.emplace_back(pindex->GetBlockHash(), logicalTS);
+            prevLogicalTS = logicalTS;
+        }
+    }
+
+    LOCK(cs_indexbuilder);
+    if (fIndexBuilderAbortBatch) {
+        LogPrintf("Index builder: blocks %d to %d were disconnected while being indexed, indexing them again\n", vBlocks.front()->nHeight, vBlocks.back()->nHeight);
+    } else {
+        if (!pblocktree->WriteIndexBuilderBatch(addressIndex, addressUnspentIndex, spentIndex, timestampIndex, vBlocks.back()->GetBlockHash()))
+            return AbortNode("Failed to write the index builder batch");
+        hashIndexBuilderBest = vBlocks.back()->GetBlockHash();
+        LogPrintf("Index builder: indexed blocks %d to %d (%u entries) in %.2fms\n", vBlocks.front()->nHeight, vBlocks.back()->nHeight,
+                  addressIndex.size() + addressUnspentIndex.size() + spentIndex.size(), (GetTimeMicros() - nStart) * 0.001);
+    }
+    nIndexBuilderClaimedHeight = -1;
+    return true;
+}
+
+/**
+ * Leave the indexes to ConnectBlock again, requires cs_main. Rebuilding the address balances scans the whole
+ * address index, so that is left to LoadAddressBalances at the next startup rather than done with cs_main
+ * held, and getaddressbalance sums them up from the address index until then.
+ */
+static bool FinishIndexBuilder()
+{
+    AssertLockHeld(cs_main);
+    const CBlockIndex* pindexTip = chainActive.Tip();
+    if (fAddressIndex && !pblocktree->EraseAddressBalanceBestBlock())
+        return AbortNode("Failed to write the address balances state");
+    if (!pblocktree->EraseIndexBuilderBestBlock())
+        return AbortNode("Failed to write the index builder state");
+
+    fIndexBuilderActive = false;
+    LogPrintf("Index builder: the indexes are complete up to block %s (%d)\n", pindexTip->GetBlockHash().ToString(), pindexTip->nHeight);
+    return true;
+}
+
+void ThreadIndexBuilder()
+{
+    while (IndexBuilderActive()) {
+        boost::this_thread::interruption_point();
+
+        std::vector<const CBlockIndex*> vBlocks;
+        std::vector<CBlockIndexEntries> vEntries;
+        std::vector<CIndexBuildCheck> vChecks;
+        {
+            LOCK(cs_main);
+            // After the initial block download blocks arrive one at a time, the last ones are indexed with
+            // cs_main held so none is connected before the indexes are handed over
+            bool fCaughtUp = !fImporting && !fReindex && !IsInitialBlockDownload();
+            if (!ClaimIndexBuilderBlocks(fCaughtUp ? 0 : INDEX_BUILDER_MIN_DEPTH, vBlocks, vEntries, vChecks)) {
+                AbortNode("The indexes don't match the active chain", _("Corrupted block database detected. You will need to rebuild the database using -reindex-chainstate."));
+                return;
+            }
+            if (fCaughtUp && (vBlocks.empty() ? IndexBuilderReachedTip() : vBlocks.back() == chainActive.Tip())) {
+                if (!vBlocks.empty() && !BuildIndexBatch(vBlocks, vEntries, vChecks))
+                    return;
+                FinishIndexBuilder();
+                return;
+            }
+        }
+
+        if (vBlocks.empty()) {
+            MilliSleep(INDEX_BUILDER_POLL_INTERVAL);
+            continue;
+        }
+        if (!BuildIndexBatch(vBlocks, vEntries, vChecks))
+            return;
+    }
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEXBUILDER_H
+#define BITCOIN_INDEXBUILDER_H
+
+#include "addressindex.h"
+#include "amount.h"
+#include "chain.h"
+#include "coins.h"
+#include "primitives/block.h"
+#include "spentindex.h"
+#include "undo.h"
+
+#include <utility>
+#include <vector>
+
+/**
+ * While the chainstate is rebuilt with -reindex or -reindex-chainstate, the address, spent and timestamp
+ * indexes are left to the index builder. It reads the connected blocks back from disk with their undo
+ * data, derives the entries on the check queue workers and writes them in large batches, staying
+ * INDEX_BUILDER_MIN_DEPTH blocks behind the tip. Once it has caught up it takes over the last blocks with
+ * cs_main held and hands the indexes back to ConnectBlock. The address balances are rebuilt at the next
+ * startup.
+ */
+
+/** Default for -indexbuilder */
+static const bool DEFAULT_INDEXBUILDER = true;
+/** Number of blocks the index builder derives and writes at once */
+static const int INDEX_BUILDER_BATCH_BLOCKS = 500;
+/** The index builder leaves the blocks this close to the tip alone until it hands over */
+static const int INDEX_BUILDER_MIN_DEPTH = 100;
+
+/** Index entries of one block */
+struct CBlockIndexEntries
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+};
+
+/**
+ * Derive the address index (with -addressindex) and spent index (with -spentindex) entries of a block at
+ * height nHeight from the block and its undo data, in the order ConnectBlock records them. fAssets tells
+ * whether assets were deployed for the block.
+ */
+void GetBlockIndexEntries(const CBlock& block, const CBlockUndo& blockundo, int nHeight, bool fAssets, CBlockIndexEntries& entries);
+
+/** Read a block and its undo data from disk and derive its index entries, on a check queue worker */
+class CIndexBuildCheck
+{
+private:
+    CDiskBlockPos posBlock;
+    CDiskBlockPos posUndo;
+    uint256 hashBlock;
+    uint256 hashPrevBlock;
+    int nHeight;
+    bool fAssets;
+    CBlockIndexEntries *pentries;
+
+public:
+    CIndexBuildCheck(): nHeight(0), fAssets(false), pentries(nullptr) {}
+    CIndexBuildCheck(const CBlockIndex* pindex, bool fAssetsIn, CBlockIndexEntries* pentriesIn);
+
+    bool operator()();
+
+    void swap(CIndexBuildCheck &check) {
+        std::swap(posBlock, check.posBlock);
+        std::swap(posUndo, check.posUndo);
+        std::swap(hashBlock, check.hashBlock);
+        std::swap(hashPrevBlock, check.hashPrevBlock);
+        std::swap(nHeight, check.nHeight);
+        std::swap(fAssets, check.fAssets);
+        std::swap(pentries, check.pentries);
+    }
+};
+
+/**
+ * Load the index builder state. With fStart the indexes are about to be rebuilt from the genesis block,
+ * so the builder starts over if it is enabled. Returns false on database errors.
+ */
+bool InitIndexBuilder(bool fStart);
+/** Whether the index builder writes the indexes instead of ConnectBlock, requires cs_main */
+bool IndexBuilderActive();
+/**
+ * Tell the index builder that pindex is disconnected while it is active, requires cs_main. Returns
+ * whether the block's index entries were already written, they have to be erased by the caller then.
+ */
+bool IndexBuilderBlockDisconnected(const CBlockIndex* pindex);
+/** Run the index builder until it has handed the indexes back */
+void ThreadIndexBuilder();
+/** Run an instance of the index building thread */
+void ThreadIndexBuildCheck();
+
+#endif // BITCOIN_INDEXBUILDER_H
@@ -12,6 +12,8 @@
 
 #include "addrman.h"
 #include "amount.h"
+#include "auxpow/store.h"
+#include "blockfilereader.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -20,6 +22,7 @@
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "indexbuilder.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
@@ -271,6 +274,10 @@ void Shutdown()
         pcoinsdbview = nullptr;
         delete pblocktree;
         pblocktree = nullptr;
+        delete pauxpowstore;
+        pauxpowstore = nullptr;
+        delete pblockfilereader;
+        pblockfilereader = nullptr;
         delete passets;
         passets = nullptr;
         delete passetsdb;
@@ -380,6 +387,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     if (showDebug) {
         strUsage += HelpMessageOpt("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize));
+        strUsage += HelpMessageOpt("-auxpowcache=<n>", strprintf("Maximum memory used to cache the auxpow of served headers in megabytes (default: %u)", DEFAULT_AUXPOW_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-blockfilemaps=<n>", strprintf("Number of block and undo files kept memory mapped for reading, 0 to read them through stdio (default: %u)", DEFAULT_BLOCKFILE_MAPPINGS));
     }
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
     if (showDebug)
@@ -398,6 +407,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-parheaders=<n>", strprintf(_("Set the number of threads checking the proof of work of received headers, started in addition to the -par threads (0 or 1 = no extra threads, up to %d, default: %d)"),
+        MAX_HEADERCHECK_THREADS, DEFAULT_HEADERCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
@@ -413,7 +424,8 @@ std::string HelpMessage(HelpMessageMode mode)
 
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
-    strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint, also in prune mode (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-indexbuilder", strprintf(_("Build the address, spent and timestamp indexes in the background while the chain state is rebuilt with -reindex or -reindex-chainstate, starting as many extra threads as -par for it (default: %u)"), DEFAULT_INDEXBUILDER));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info)"));
@@ -431,6 +443,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXRECEIVEBUFFER));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), DEFAULT_MAXSENDBUFFER));
+    strUsage += HelpMessageOpt("-msghandlerthreads=<n>", strprintf(_("Number of threads processing the messages of different peers concurrently, more than one is experimental (1 to %d, default: %d)"), MAX_MSGHANDLER_THREADS, DEFAULT_MSGHANDLER_THREADS));
     strUsage += HelpMessageOpt("-maxtimeadjustment", strprintf(_("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)"), DEFAULT_MAX_TIME_ADJUSTMENT));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
@@ -440,6 +453,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), GetSocketEventsModes(), GetSocketEventsModeName(DEFAULT_SOCKETEVENTS)));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -642,6 +656,8 @@ void CleanupBlockRevFiles()
     // Remove the rev files immediately and insert the blk file paths into an
     // ordered map keyed by block file index.
     LogPrintf("Removing unusable blk?????.dat and rev?????.dat files for -reindex with -prune\n");
+    if (pblockfilereader)
+        pblockfilereader->Clear();
     fs::path blocksdir = GetDataDir() / "blocks";
     for (fs::directory_iterator it(blocksdir); it != fs::directory_iterator(); it++) {
         if (fs::is_regular_file(*it) &&
@@ -875,6 +891,7 @@ int nMaxConnections;
 int nUserMaxConnections;
 int nFD;
 ServiceFlags nLocalServices = NODE_NETWORK;
+SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
 
 } // namespace
 
@@ -958,13 +975,20 @@ bool AppInitParameterInteraction()
         return InitError("Cannot set -bind or -whitebind together with -listen=0");
     }
 
+    std::string strSocketEvents = gArgs.GetArg("-socketevents", GetSocketEventsModeName(DEFAULT_SOCKETEVENTS));
+    if (!ParseSocketEventsMode(strSocketEvents, socketEventsMode)) {
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s"), strSocketEvents, GetSocketEventsModes()));
+    }
+
     // Make sure enough file descriptors are available
     int nBind = std::max(nUserBind, size_t(1));
     nUserMaxConnections = gArgs.GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
-    // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
+    // Trim requested connection counts, to fit into system limitations. select() can't use
+    // sockets above FD_SETSIZE, epoll is only limited by the file descriptor limit.
+    if (socketEventsMode == SOCKETEVENTS_SELECT)
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
     nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1071,6 +1095,13 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // Like nScriptCheckThreads the count includes the thread handing out the checks
+    nHeaderCheckThreads = gArgs.GetArg("-parheaders", DEFAULT_HEADERCHECK_THREADS);
+    if (nHeaderCheckThreads <= 1)
+        nHeaderCheckThreads = 0;
+    else if (nHeaderCheckThreads > MAX_HEADERCHECK_THREADS)
+        nHeaderCheckThreads = MAX_HEADERCHECK_THREADS;
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1287,9 +1318,14 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadAssetCheck);
+        }
     }
+    LogPrintf("Using %u threads for header proof of work checks\n", nHeaderCheckThreads);
+    for (int i = 0; i < nHeaderCheckThreads - 1; i++)
+        threadGroup.create_thread(&ThreadHeaderCheck);
 
     if (!sporkManager.SetSporkAddress(gArgs.GetArg("-sporkaddr", Params().SporkAddress())))
         return InitError(_("Invalid spork address specified with -sporkaddr"));
@@ -1470,10 +1506,13 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+    int64_t nAuxPowCacheSize = std::max(gArgs.GetArg("-auxpowcache", DEFAULT_AUXPOW_CACHE_SIZE), (int64_t)0) << 20;
+    int64_t nBlockFileMaps = std::max(gArgs.GetArg("-blockfilemaps", DEFAULT_BLOCKFILE_MAPPINGS), (int64_t)0);
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for auxpow header cache\n", nAuxPowCacheSize * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
     while (!fLoaded && !fRequestShutdown) {
@@ -1490,8 +1529,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pcoinsdbview;
                 delete pcoinscatcher;
                 delete pblocktree;
+                delete pauxpowstore;
+                delete pblockfilereader;
 
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReset, dbMaxFileSize);
+                pauxpowstore = new CAuxPowStore(GetDataDir() / "blocks" / "auxpow.dat", fReset, nAuxPowCacheSize);
+                pblockfilereader = nBlockFileMaps > 0 ? new CBlockFileReader(GetDataDir() / "blocks", nBlockFileMaps) : nullptr;
 
 
                 delete passets;
@@ -1499,7 +1542,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete passetsCache;
                 passetsdb = new CAssetsDB(nBlockTreeDBCache, false, fReset);
                 passets = new CAssetsCache();
-                passetsCache = new CLRUCache<std::string, CDatabasedAssetData>(MAX_CACHE_ASSETS_SIZE);
+                passetsCache = new CShardedCache<std::string, CDatabasedAssetData>(MAX_CACHE_ASSETS_SIZE);
 
                 // Read for fAssetIndex to make sure that we only load asset address balances if it if true
                 pblocktree->ReadFlag("assetindex", fAssetIndex);
@@ -1597,6 +1640,22 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                // Likewise move the address index to its compact records, asset ids are written to passetsdb
+                if (!pblocktree->UpgradeAddressIndex()) {
+                    strLoadError = _("Error upgrading address index database");
+                    break;
+                }
+                if (!pblocktree->UpgradeSpentIndex()) {
+                    strLoadError = _("Error upgrading spent index database");
+                    break;
+                }
+
+                // Rebuilding the chainstate leaves the indexes to the index builder, which may also be resuming
+                if (!InitIndexBuilder(fReset || fReindexChainState)) {
+                    strLoadError = _("Error initializing the index builder");
+                    break;
+                }
+
                 // ReplayBlocks is a no-op if we cleared the coinsviewdb with -reindex or -reindex-chainstate
                 if (!ReplayBlocks(chainparams, pcoinsdbview)) {
                     strLoadError = _("Unable to replay blocks. You will need to rebuild the database using -reindex-chainstate.");
@@ -1614,6 +1673,14 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                         break;
                     }
                     assert(chainActive.Tip() != nullptr);
+
+                    /** BLAST START */
+                    // The asset database is flushed right after the coins, replay what didn't make it to disk
+                    if (!ReplayAssets(chainparams)) {
+                        strLoadError = _("Unable to replay the asset changes. You will need to rebuild the database using -reindex");
+                        break;
+                    }
+                    /** BLAST END */
                 }
 
                 if (!fReset) {
@@ -1627,6 +1694,20 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     }
                 }
 
+                if (!LoadAddressBalances(chainparams)) {
+                    strLoadError = _("Error loading address balances");
+                    break;
+                }
+
+                // Timestamp index entries now record whether their block is on the main chain
+                {
+                    LOCK(cs_main);
+                    if (!pblocktree->UpgradeTimestampIndex()) {
+                        strLoadError = _("Error upgrading timestamp index database");
+                        break;
+                    }
+                }
+
                 if (!is_coinsview_empty) {
                     uiInterface.InitMessage(_("Verifying blocks..."));
                     if (fHavePruned && gArgs.GetArg("-checkblocks", DEFAULT_CHECKBLOCKS) > MIN_BLOCKS_TO_KEEP) {
@@ -1747,6 +1828,13 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     threadGroup.create_thread(boost::bind(&ThreadImport, vImportFiles));
 
+    if (IndexBuilderActive()) {
+        // The index builder's check threads are only started when it has blocks to index, one for each -par thread
+        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+            threadGroup.create_thread(&ThreadIndexBuildCheck);
+        threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "indexbuild", &ThreadIndexBuilder));
+    }
+
     // Wait for genesis block to be processed
     {
         boost::unique_lock<boost::mutex> lock(cs_GenesisWait);
@@ -1899,7 +1987,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     connOptions.m_msgproc = peerLogic.get();
     connOptions.nSendBufferMaxSize = 1000*gArgs.GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000*gArgs.GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.nMsgHandlerThreads = gArgs.GetArg("-msghandlerthreads", DEFAULT_MSGHANDLER_THREADS);
     connOptions.m_added_nodes = gArgs.GetArgs("-addnode");
+    connOptions.socketEventsMode = socketEventsMode;
 
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
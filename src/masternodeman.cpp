@@ -814,6 +814,12 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         LogPrint(BCLog::MASTERNODE, "MNPING -- Masternode ping, masternode=%s\n", mnp.masternodeOutpoint.ToStringShort());
 
+        // Most pings arrive from several peers, drop the ones seen already without waiting for cs_main
+        {
+            LOCK(cs);
+            if(mapSeenMasternodePing.count(nHash)) return; //seen
+        }
+
         // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
         LOCK2(cs_main, cs);
 
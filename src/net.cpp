@@ -80,6 +80,11 @@ enum BindFlags {
 
 const static std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
+/** Socket event ids of the listen sockets are their index with this bit set, node sockets use the NodeId */
+static const uint64_t LISTEN_SOCKET_ID = 1ULL << 63;
+/** How long the socket handler waits for socket events, the frequency to poll pnode->vSend */
+static const int64_t SOCKET_WAIT_MILLISECONDS = 50;
+
 constexpr const CConnman::CFullyConnectedOnly CConnman::FullyConnectedOnly;
 constexpr const CConnman::CAllNodes CConnman::AllNodes;
 
@@ -442,7 +447,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
         connected = ConnectThroughProxy(proxy, host, port, hSocket, nConnectTimeout, nullptr);
     }
     if (connected) {
-        if (!IsSelectableSocket(hSocket)) {
+        if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return nullptr;
@@ -1107,7 +1112,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1229,23 +1234,14 @@ void CConnman::ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
+        std::vector<CSocketWait> vWait;
+        std::vector<CSocketEvent> vEvents;
+        int64_t nWaitMillis = SOCKET_WAIT_MILLISECONDS;
+        const bool fEpoll = socketEvents->GetMode() == SOCKETEVENTS_EPOLL;
 
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
+        if (!fEpoll) {
+            for (size_t i = 0; i < vhListenSocket.size(); i++)
+                vWait.emplace_back(vhListenSocket[i].socket, LISTEN_SOCKET_ID | i, true, false);
         }
 
         {
@@ -1262,6 +1258,9 @@ void CConnman::ThreadSocketHandler()
                 //   receiving data.
                 // * Hand off all complete messages to the processor, to be handled without
                 //   blocking here.
+                // With epoll every socket is registered once, edge triggered for both directions.
+                // Readiness left over from earlier events is kept in the node, don't wait for
+                // new events if it can be used right away.
 
                 bool select_recv = !pnode->fPauseRecv;
                 bool select_send;
@@ -1274,48 +1273,43 @@ void CConnman::ThreadSocketHandler()
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
 
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
+                if (fEpoll) {
+                    if (!pnode->fSocketRegistered) {
+                        pnode->fSocketRegistered = true;
+                        if (!socketEvents->Register(pnode->hSocket, pnode->GetId(), true))
+                            pnode->fDisconnect = true;
+                    }
+                    if (select_send ? pnode->fSocketWritable : (select_recv && pnode->fSocketReadable))
+                        nWaitMillis = 0;
                     continue;
                 }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
+
+                vWait.emplace_back(pnode->hSocket, pnode->GetId(), !select_send && select_recv, select_send);
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        bool fWaitOk = socketEvents->Wait(vWait, vEvents, nWaitMillis);
         if (interruptNet)
             return;
 
-        if (nSelect == SOCKET_ERROR)
+        if (!fWaitOk)
         {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_WAIT_MILLISECONDS)))
                 return;
         }
 
         //
         // Accept new connections
         //
-        for (const ListenSocket& hListenSocket : vhListenSocket)
+        std::map<NodeId, const CSocketEvent*> mapNodeEvents;
+        for (const CSocketEvent& event : vEvents)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
-            {
-                AcceptConnection(hListenSocket);
+            if (event.nId & LISTEN_SOCKET_ID) {
+                size_t i = event.nId & ~LISTEN_SOCKET_ID;
+                if (i < vhListenSocket.size() && vhListenSocket[i].socket != INVALID_SOCKET && event.fRecv)
+                    AcceptConnection(vhListenSocket[i]);
+            } else {
+                mapNodeEvents[event.nId] = &event;
             }
         }
 
@@ -1340,13 +1334,22 @@ void CConnman::ThreadSocketHandler()
             bool recvSet = false;
             bool sendSet = false;
             bool errorSet = false;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+            auto itEvent = mapNodeEvents.find(pnode->GetId());
+            if (itEvent != mapNodeEvents.end()) {
+                recvSet = itEvent->second->fRecv;
+                sendSet = itEvent->second->fSend;
+                errorSet = itEvent->second->fError;
+            }
+            if (fEpoll) {
+                pnode->fSocketReadable |= recvSet;
+                pnode->fSocketWritable |= sendSet;
+                bool fSendPending;
+                {
+                    LOCK(pnode->cs_vSend);
+                    fSendPending = !pnode->vSendMsg.empty();
+                }
+                recvSet = !fSendPending && !pnode->fPauseRecv && pnode->fSocketReadable;
+                sendSet = fSendPending && pnode->fSocketWritable;
             }
             if (recvSet || errorSet)
             {
@@ -1359,6 +1362,9 @@ void CConnman::ThreadSocketHandler()
                         continue;
                     nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
                 }
+                // A short read drained the socket, wait for the next edge
+                if (nBytes < (int)sizeof(pchBuf))
+                    pnode->fSocketReadable = false;
                 if (nBytes > 0)
                 {
                     bool notify = false;
@@ -1413,6 +1419,9 @@ void CConnman::ThreadSocketHandler()
                 if (nBytes) {
                     RecordBytesSent(nBytes);
                 }
+                // Anything left means the socket buffer is full, wait for the next edge
+                if (!pnode->vSendMsg.empty())
+                    pnode->fSocketWritable = false;
             }
 
             //
@@ -1460,9 +1469,9 @@ void CConnman::WakeMessageHandler()
 {
     {
         std::lock_guard<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = true;
+        nMsgProcWake++;
     }
-    condMsgProc.notify_one();
+    condMsgProc.notify_all();
 }
 
 
@@ -2050,8 +2059,9 @@ bool CConnman::OpenMasternodeConnection(const CAddress &addrConnect)
     return OpenNetworkConnection(addrConnect, false, NULL, NULL, false, false, false, true);
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int nThread)
 {
+    uint64_t nWakeSeen = 0;
     while (!flagInterruptMsgProc)
     {
         std::vector<CNode*> vNodesCopy;
@@ -2065,11 +2075,19 @@ void CConnman::ThreadMessageHandler()
 
         bool fMoreWork = false;
 
-        for (CNode* pnode : vNodesCopy)
+        // Each thread starts at a different node, so they don't all queue up behind the same peers
+        size_t nStart = vNodesCopy.size() * nThread / nMsgHandlerThreads;
+        for (size_t i = 0; i < vNodesCopy.size(); i++)
         {
+            CNode* pnode = vNodesCopy[(nStart + i) % vNodesCopy.size()];
             if (pnode->fDisconnect)
                 continue;
 
+            // Another thread is processing this node's messages
+            TRY_LOCK(pnode->cs_processMessages, lockProcess);
+            if (!lockProcess)
+                continue;
+
             // Receive messages
             bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
@@ -2093,9 +2111,9 @@ void CConnman::ThreadMessageHandler()
 
         std::unique_lock<std::mutex> lock(mutexMsgProc);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this] { return fMsgProcWake; });
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this, nWakeSeen] { return nMsgProcWake != nWakeSeen; });
         }
-        fMsgProcWake = false;
+        nWakeSeen = nMsgProcWake;
     }
 }
 
@@ -2126,7 +2144,7 @@ bool CConnman::BindListenPort(const CService &addrBind, std::string& strError, b
         LogPrintf("%s\n", strError);
         return false;
     }
-    if (!IsSelectableSocket(hListenSocket))
+    if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hListenSocket))
     {
         strError = "Error: Couldn't create a listenable socket for incoming connections";
         LogPrintf("%s\n", strError);
@@ -2287,6 +2305,7 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     semAddnode = nullptr;
     semMasternodeOutbound = nullptr;
     flagInterruptMsgProc = false;
+    nMsgProcWake = 0;
 
     Options connOptions;
     Init(connOptions);
@@ -2339,6 +2358,10 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     LogPrintf("Connection Manager: Start");
 
+    socketEvents.reset(new CSocketEvents(socketEventsMode));
+    socketEventsMode = socketEvents->GetMode();
+    LogPrintf("Connection Manager: Using %s for socket events\n", GetSocketEventsModeName(socketEventsMode));
+
     if (fListen && !InitBinds(connOptions.vBinds, connOptions.vWhiteBinds)) {
         if (clientInterface) {
             clientInterface->ThreadSafeMessageBox(
@@ -2347,6 +2370,8 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         }
         return false;
     }
+    for (size_t i = 0; i < vhListenSocket.size(); i++)
+        socketEvents->Register(vhListenSocket[i].socket, LISTEN_SOCKET_ID | i, false);
 
     LogPrintf("Connection Manager: Adding Seed Nodes\n");
 
@@ -2418,7 +2443,7 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     {
         std::unique_lock<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = false;
+        nMsgProcWake = 0;
     }
 
     // Send and receive from sockets, accept connections
@@ -2447,7 +2472,8 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     threadOpenMasternodeConnections = std::thread(&TraceThread<std::function<void()> >, "mncon", std::function<void()>(std::bind(&CConnman::ThreadOpenMasternodeConnections, this)));    
 
     // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (int i = 0; i < nMsgHandlerThreads; i++)
+        threadMessageHandlers.push_back(std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, i))));
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000);
@@ -2502,8 +2528,10 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (std::thread& threadMessageHandler : threadMessageHandlers)
+        if (threadMessageHandler.joinable())
+            threadMessageHandler.join();
+    threadMessageHandlers.clear();
     if (threadOpenMasternodeConnections.joinable())
         threadOpenMasternodeConnections.join();
     if (threadOpenConnections.joinable())
@@ -2539,6 +2567,7 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+    socketEvents.reset();
     delete semOutbound;
     semOutbound = nullptr;
     delete semAddnode;
@@ -2890,6 +2919,9 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nextSendTimeFeeFilter = 0;
     fPauseRecv = false;
     fPauseSend = false;
+    fSocketRegistered = false;
+    fSocketReadable = false;
+    fSocketWritable = false;
     nProcessQueueSize = 0;
 
     fGetAssetData = false;
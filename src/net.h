@@ -19,6 +19,7 @@
 #include "policy/feerate.h"
 #include "protocol.h"
 #include "random.h"
+#include "socketevents.h"
 #include "streams.h"
 #include "sync.h"
 #include "uint256.h"
@@ -96,6 +97,12 @@ static const bool DEFAULT_BLOCKSONLY = false;
 static const bool DEFAULT_FORCEDNSSEED = true;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/**
+ * Number of threads processing the messages of different peers concurrently. The masternode, masternode
+ * payment, masternode sync and spork handlers haven't been made safe for that yet, so it is one by default.
+ */
+static const int DEFAULT_MSGHANDLER_THREADS = 1;
+static const int MAX_MSGHANDLER_THREADS = 16;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
@@ -158,6 +165,8 @@ public:
         bool m_use_addrman_outgoing = true;
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
+        SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
+        int nMsgHandlerThreads = DEFAULT_MSGHANDLER_THREADS;
     };
 
     void Init(const Options& connOptions) {
@@ -175,6 +184,8 @@ public:
         nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
         vWhitelistedRange = connOptions.vWhitelistedRange;
         vAddedNodes = connOptions.m_added_nodes;
+        socketEventsMode = connOptions.socketEventsMode;
+        nMsgHandlerThreads = std::max(1, std::min(connOptions.nMsgHandlerThreads, MAX_MSGHANDLER_THREADS));
     }
 
     CConnman(uint64_t seed0, uint64_t seed1);
@@ -183,6 +194,7 @@ public:
     void Stop();
     void Interrupt();
     bool GetNetworkActive() const { return fNetworkActive; };
+    SocketEventsMode GetSocketEventsMode() const { return socketEventsMode; };
     void SetNetworkActive(bool active);
     bool OpenNetworkConnection(const CAddress& addrConnect, bool fCountFailure, CSemaphoreGrant *grantOutbound = nullptr, const char *strDest = nullptr, bool fOneShot = false, bool fFeeler = false, bool manual_connection = false, bool fConnectToMasternode = false);
     bool OpenMasternodeConnection(const CAddress& addrConnect);
@@ -381,7 +393,7 @@ private:
     void AddOneShot(const std::string& strDest);
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
-    void ThreadMessageHandler();
+    void ThreadMessageHandler(int nThread);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -440,6 +452,9 @@ private:
     unsigned int nReceiveFloodSize;
 
     std::vector<ListenSocket> vhListenSocket;
+    /** Mode of socketEvents, select() only takes sockets below FD_SETSIZE */
+    SocketEventsMode socketEventsMode;
+    std::unique_ptr<CSocketEvents> socketEvents;
     std::atomic<bool> fNetworkActive;
     banmap_t setBanned;
     CCriticalSection cs_setBanned;
@@ -474,8 +489,9 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake;
+    /** Bumped for waking the message processor, each handler thread waits for it to change */
+    uint64_t nMsgProcWake;
+    int nMsgHandlerThreads;
 
     std::condition_variable condMsgProc;
     std::mutex mutexMsgProc;
@@ -487,7 +503,7 @@ private:
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageHandlers;
     std::thread threadOpenMasternodeConnections;
 };
 extern std::unique_ptr<CConnman> g_connman;
@@ -668,6 +684,8 @@ public:
     size_t nProcessQueueSize;
 
     CCriticalSection cs_sendProcessing;
+    // Held by the message handler thread processing this node's messages, which keeps them in order
+    CCriticalSection cs_processMessages;
 
     std::deque<CInv> vRecvGetData;
     std::deque<CInvAsset> vRecvAssetGetData;
@@ -712,6 +730,11 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Only used by the socket handler thread in epoll mode: whether the socket was added to the epoll
+    // instance, and the edge triggered readiness not yet used up by recv() or send().
+    bool fSocketRegistered;
+    bool fSocketReadable;
+    bool fSocketWritable;
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -721,7 +744,8 @@ public:
     uint256 hashContinue;
     std::atomic<int> nStartingHeight;
 
-    // flood relay
+    // flood relay, other nodes' message handler threads push addresses under cs_addrSend
+    CCriticalSection cs_addrSend;
     std::vector<CAddress> vAddrToSend;
     CRollingBloomFilter addrKnown;
     bool fGetAddr;
@@ -851,6 +875,7 @@ public:
 
     void AddAddressKnown(const CAddress& _addr)
     {
+        LOCK(cs_addrSend);
         addrKnown.insert(_addr.GetKey());
     }
 
@@ -859,6 +884,7 @@ public:
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
+        LOCK(cs_addrSend);
         if (_addr.IsValid() && !addrKnown.contains(_addr.GetKey())) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand.randrange(vAddrToSend.size())] = _addr;
@@ -968,7 +968,10 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     //     return instantsend.AlreadyHave(inv.hash);
 
     case MSG_SPORK:
-        return mapSporks.count(inv.hash);
+        {
+            CSporkMessage spork;
+            return sporkManager.GetSporkByHash(inv.hash, spork);
+        }
 
     case MSG_MASTERNODE_PAYMENT_VOTE:
         return mnpayments.mapMasternodePaymentVotes.count(inv.hash);
@@ -1042,6 +1045,37 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
     std::vector<CInv> vNotFound;
     const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+
+    // If we have a requested block and all of its parents, but have not yet validated it,
+    // we might be in the middle of connecting it (ie in the unlock of cs_main
+    // before ActivateBestChain but after AcceptBlock).
+    // In this case, we need to run ActivateBestChain prior to checking the relay
+    // conditions below. ActivateBestChain takes the chainstate lock before cs_main,
+    // so it has to run before we take cs_main for the whole loop.
+    bool fActivate = false;
+    {
+        LOCK(cs_main);
+        for (const CInv& inv : pfrom->vRecvGetData) {
+            if (inv.type != MSG_BLOCK && inv.type != MSG_FILTERED_BLOCK && inv.type != MSG_CMPCT_BLOCK && inv.type != MSG_WITNESS_BLOCK)
+                continue;
+            BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
+            if (mi != mapBlockIndex.end() && mi->second->nChainTx && !mi->second->IsValid(BLOCK_VALID_SCRIPTS) &&
+                    mi->second->IsValid(BLOCK_VALID_TREE)) {
+                fActivate = true;
+                break;
+            }
+        }
+    }
+    if (fActivate) {
+        std::shared_ptr<const CBlock> a_recent_block;
+        {
+            LOCK(cs_most_recent_block);
+            a_recent_block = most_recent_block;
+        }
+        CValidationState dummy;
+        ActivateBestChain(dummy, Params(), a_recent_block);
+    }
+
     LOCK(cs_main);
 
     while (it != pfrom->vRecvGetData.end()) {
@@ -1071,16 +1105,6 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
                 if (mi != mapBlockIndex.end())
                 {
-                    if (mi->second->nChainTx && !mi->second->IsValid(BLOCK_VALID_SCRIPTS) &&
-                            mi->second->IsValid(BLOCK_VALID_TREE)) {
-                        // If we have the block and all of its parents, but have not yet validated it,
-                        // we might be in the middle of connecting it (ie in the unlock of cs_main
-                        // before ActivateBestChain but after AcceptBlock).
-                        // In this case, we need to run ActivateBestChain prior to checking the relay
-                        // conditions below.
-                        CValidationState dummy;
-                        ActivateBestChain(dummy, Params(), a_recent_block);
-                    }
                     if (chainActive.Contains(mi->second)) {
                         send = true;
                     } else {
@@ -1108,9 +1132,22 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
+                    bool fPeerWantsWitness = State(pfrom->GetId())->fWantsCmpctWitness;
+                    bool fSendCompact = inv.type == MSG_CMPCT_BLOCK && CanDirectFetch(consensusParams) && mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH;
+                    // A full block for MSG_WITNESS_BLOCK, or for a compact block request too old to send compact to a
+                    // peer that takes witnesses, goes out in its stored serialization without being deserialized.
+                    // Witness data can be stored even for blocks from before segwit, in the auxpow parent coinbase,
+                    // so MSG_BLOCK and peers without witnesses get the block stripped
+                    bool fSendRaw = inv.type == MSG_WITNESS_BLOCK || (inv.type == MSG_CMPCT_BLOCK && !fSendCompact && fPeerWantsWitness);
                     std::shared_ptr<const CBlock> pblock;
+                    std::vector<unsigned char> vRawBlock;
                     if (a_recent_block && a_recent_block->GetHash() == (*mi).second->GetBlockHash()) {
                         pblock = a_recent_block;
+                    } else if (fSendRaw && ReadRawBlockFromDisk(vRawBlock, (*mi).second, Params().MessageStart())) {
+                        CSerializedNetMsg msg;
+                        msg.command = NetMsgType::BLOCK;
+                        msg.data = std::move(vRawBlock);
+                        connman->PushMessage(pfrom, std::move(msg));
                     } else {
                         // Send block from disk
                         std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
@@ -1118,7 +1155,10 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                             assert(!"cannot load block from disk");
                         pblock = pblockRead;
                     }
-                    if (inv.type == MSG_BLOCK)
+                    if (!pblock) {
+                        // Already sent from the block file
+                    }
+                    else if (inv.type == MSG_BLOCK)
                         connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
                     else if (inv.type == MSG_WITNESS_BLOCK)
                         connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
@@ -1154,9 +1194,8 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                         // they won't have a useful mempool to match against a compact block,
                         // and we don't feel like constructing the object for them, so
                         // instead we respond with the full, non-compact block.
-                        bool fPeerWantsWitness = State(pfrom->GetId())->fWantsCmpctWitness;
                         int nSendFlags = fPeerWantsWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
-                        if (CanDirectFetch(consensusParams) && mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH) {
+                        if (fSendCompact) {
                             if ((fPeerWantsWitness || !fWitnessesPresentInARecentCompactBlock) && a_recent_compact_block && a_recent_compact_block->header.GetHash() == mi->second->GetBlockHash()) {
                                 connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
                             } else {
@@ -1201,8 +1240,9 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
 
                 if (!push && inv.type == MSG_SPORK) {
-                    if(mapSporks.count(inv.hash)) {
-                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, mapSporks[inv.hash]));
+                    CSporkMessage spork;
+                    if(sporkManager.GetSporkByHash(inv.hash, spork)) {
+                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, spork));
                         push = true;
                     }
                 }
@@ -1943,7 +1983,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             inv.type = State(pfrom->GetId())->fWantsCmpctWitness ? MSG_WITNESS_BLOCK : MSG_BLOCK;
             inv.hash = req.blockhash;
             pfrom->vRecvGetData.push_back(inv);
-            ProcessGetData(pfrom, chainparams.GetConsensus(), connman, interruptMsgProc);
+            // The message processing loop will go around again (without pausing) and we'll respond then (without cs_main)
             return true;
         }
 
@@ -2730,7 +2770,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         }
         pfrom->fSentAddr = true;
 
-        pfrom->vAddrToSend.clear();
+        {
+            LOCK(pfrom->cs_addrSend);
+            pfrom->vAddrToSend.clear();
+        }
         std::vector<CAddress> vAddr = connman->GetAddresses();
         FastRandomContext insecure_rand;
         for (const CAddress &addr : vAddr)
@@ -2951,6 +2994,23 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     return true;
 }
 
+/**
+ * Whether a message may leave rejects or a ban to be sent right after it under cs_main. Messages
+ * from different peers are processed concurrently, and bursts of pings, addresses and sporks
+ * shouldn't queue up on cs_main behind the block and header processing of other peers.
+ */
+static bool MessageNeedsChainLock(const std::string& strCommand)
+{
+    return !(strCommand == NetMsgType::PING ||
+             strCommand == NetMsgType::PONG ||
+             strCommand == NetMsgType::ADDR ||
+             strCommand == NetMsgType::GETADDR ||
+             strCommand == NetMsgType::FEEFILTER ||
+             strCommand == NetMsgType::SPORK ||
+             strCommand == NetMsgType::GETSPORKS ||
+             strCommand == NetMsgType::MNPING);
+}
+
 static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman* connman)
 {
     AssertLockHeld(cs_main);
@@ -3095,6 +3155,10 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
     }
 
+    // SendMessages sends the rejects and bans for the messages that don't touch the chain state
+    if (!MessageNeedsChainLock(strCommand))
+        return fMoreWork;
+
     LOCK(cs_main);
     SendRejectsAndCheckIfBanned(pfrom, connman);
 
@@ -3229,6 +3293,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
         // Message: addr
         //
         if (pto->nNextAddrSend < nNow) {
+            LOCK(pto->cs_addrSend);
             pto->nNextAddrSend = PoissonNextSend(nNow, AVG_ADDRESS_BROADCAST_INTERVAL);
             std::vector<CAddress> vAddr;
             vAddr.reserve(pto->vAddrToSend.size());
@@ -209,6 +209,8 @@ static bool rest_block(HTTPRequest* req,
 
     CBlock block;
     CBlockIndex* pblockindex = nullptr;
+    std::vector<unsigned char> vRawBlock;
+    bool fRawBlock = false;
     {
         LOCK(cs_main);
         if (mapBlockIndex.count(hash) == 0)
@@ -218,12 +220,20 @@ static bool rest_block(HTTPRequest* req,
         if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        // The stored serialization includes witnesses, so it is returned as it is unless they have to be stripped.
+        // Blocks from before segwit can carry them as well, in the auxpow parent coinbase
+        if (rf != RF_JSON && RPCSerializationFlags() == 0)
+            fRawBlock = ReadRawBlockFromDisk(vRawBlock, pblockindex, Params().MessageStart());
+
+        if (!fRawBlock && !ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
     CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    ssBlock << block;
+    if (fRawBlock)
+        ssBlock.write((const char*)vRawBlock.data(), vRawBlock.size());
+    else
+        ssBlock << block;
 
     switch (rf) {
     case RF_BINARY: {
@@ -1026,8 +1026,10 @@ UniValue getcacheinfo(const JSONRPCRequest& request)
                 "  asset address balance:\n"
                 "  my unspent asset:\n"
                 "  reissue data:\n"
-                "  asset metadata map:\n"
-                "  asset metadata list (est):\n"
+                "  asset metadata cache:\n"
+                "  asset metadata entries (est):\n"
+                "  asset metadata stats: {entries, max entries, shards, hits, misses, evictions}\n"
+                "  asset name ids:\n"
                 "  dirty cache (est):\n"
 
 
@@ -1061,8 +1063,18 @@ UniValue getcacheinfo(const JSONRPCRequest& request)
 
     info.push_back(Pair("reissue tracking (memory only)", (int)memusage::DynamicUsage(mapReissuedAssets) + (int)memusage::DynamicUsage(mapReissuedTx)));
     info.push_back(Pair("asset data", descendants));
-    info.push_back(Pair("asset metadata map",  (int)memusage::DynamicUsage(passetsCache->GetItemsMap())));
-    info.push_back(Pair("asset metadata list (est)",  (int)passetsCache->GetItemsList().size() * (32 + 80))); // Max 32 bytes for asset name, 80 bytes max for asset data
+    info.push_back(Pair("asset metadata cache", (int)passetsCache->DynamicMemoryUsage()));
+    info.push_back(Pair("asset metadata entries (est)",  (int)passetsCache->Size() * (32 + 80))); // Max 32 bytes for asset name, 80 bytes max for asset data
+
+    UniValue metadata(UniValue::VOBJ);
+    metadata.push_back(Pair("entries", (int64_t)passetsCache->Size()));
+    metadata.push_back(Pair("max entries", (int64_t)passetsCache->MaxSize()));
+    metadata.push_back(Pair("shards", (int64_t)passetsCache->ShardCount()));
+    metadata.push_back(Pair("hits", (int64_t)passetsCache->Hits()));
+    metadata.push_back(Pair("misses", (int64_t)passetsCache->Misses()));
+    metadata.push_back(Pair("evictions", (int64_t)passetsCache->Evictions()));
+    info.push_back(Pair("asset metadata stats", metadata));
+    info.push_back(Pair("asset name ids", (int)assetNameTable.DynamicMemoryUsage()));
     info.push_back(Pair("dirty cache (est)",  (int)currentActiveAssetCache->GetCacheSize()));
     info.push_back(Pair("dirty cache V2 (est)",  (int)currentActiveAssetCache->GetCacheSizeV2()));
 
@@ -823,26 +823,23 @@ UniValue getblockhashes(const JSONRPCRequest& request)
         }
     }
 
-    std::vector<std::pair<uint256, unsigned int> > blockHashes;
-
-    if (fActiveOnly)
-        LOCK(cs_main);
-
-    if (!GetTimestampIndex(high, low, fActiveOnly, blockHashes)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
-    }
-
+    // The timestamp index records main chain membership itself, so the results are streamed from it
+    // straight into the reply without cs_main
     UniValue result(UniValue::VARR);
-
-    for (std::vector<std::pair<uint256, unsigned int> >::const_iterator it=blockHashes.begin(); it!=blockHashes.end(); it++) {
+    bool fFound = GetTimestampIndex(high, low, fActiveOnly, [&result, fLogicalTS](const uint256& hash, unsigned int logicalTS) {
         if (fLogicalTS) {
             UniValue item(UniValue::VOBJ);
-            item.push_back(Pair("blockhash", it->first.GetHex()));
-            item.push_back(Pair("logicalts", (int)it->second));
+            item.push_back(Pair("blockhash", hash.GetHex()));
+            item.push_back(Pair("logicalts", (int)logicalTS));
             result.push_back(item);
         } else {
-            result.push_back(it->first.GetHex());
+            result.push_back(hash.GetHex());
         }
+        return true;
+    });
+
+    if (!fFound) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
     }
 
     return result;
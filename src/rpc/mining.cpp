@@ -837,10 +837,10 @@ UniValue getauxblock(const JSONRPCRequest& request)
     static std::vector< std::unique_ptr<CBlockTemplate> > vNewBlockTemplate;
     const Consensus::Params& consensusParams = Params().GetConsensus();
 
-    LOCK(cs_main);
-
     if (request.params.size() == 0)
     {
+        LOCK(cs_main);
+
         // Update block
         static unsigned int nTransactionsUpdatedLast;
         static CBlockIndex* pindexPrev;
@@ -914,26 +914,32 @@ UniValue getauxblock(const JSONRPCRequest& request)
         CDataStream ss(vchAuxPow, SER_GETHASH, PROTOCOL_VERSION);
         auto* pow = new CAuxPow();
         ss >> *pow;
-        if (!mapNewBlock.count(hash))
-            return "stale-work";
-
-        CBlock* pblock = mapNewBlock[hash];
-        pblock->SetAuxPow(pow);
 
+        // ProcessNewBlock takes the chainstate lock before cs_main, so only hold cs_main to copy the block out
+        std::shared_ptr<CBlock> spblock;
         bool fBlockPresent = false;
-        BlockMap::iterator mi = mapBlockIndex.find(hash);
-        if (mi != mapBlockIndex.end()) {
-            CBlockIndex *pindex = mi->second;
-            if (pindex->IsValid(BLOCK_VALID_SCRIPTS))
-                return "duplicate";
-            if (pindex->nStatus & BLOCK_FAILED_MASK)
-                return "duplicate-invalid";
-            fBlockPresent = true;
+        {
+            LOCK(cs_main);
+            if (!mapNewBlock.count(hash))
+                return "stale-work";
+
+            CBlock* pblock = mapNewBlock[hash];
+            pblock->SetAuxPow(pow);
+
+            BlockMap::iterator mi = mapBlockIndex.find(hash);
+            if (mi != mapBlockIndex.end()) {
+                CBlockIndex *pindex = mi->second;
+                if (pindex->IsValid(BLOCK_VALID_SCRIPTS))
+                    return "duplicate";
+                if (pindex->nStatus & BLOCK_FAILED_MASK)
+                    return "duplicate-invalid";
+                fBlockPresent = true;
+            }
+            spblock = std::make_shared<CBlock>(*pblock);
         }
 
-        submitblock_StateCatcher sc(pblock->GetHash());
+        submitblock_StateCatcher sc(spblock->GetHash());
         RegisterValidationInterface(&sc);
-        auto spblock = std::make_shared<CBlock>(*pblock);
         bool fAccepted = ProcessNewBlock(Params(), spblock, true, nullptr);
         UnregisterValidationInterface(&sc);
         if (fBlockPresent) {
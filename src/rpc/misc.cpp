@@ -823,8 +823,8 @@ bool getAddressesFromParams(const UniValue& params, std::vector<std::pair<uint16
     return true;
 }
 
-bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
-                std::pair<CAddressUnspentKey, CAddressUnspentValue> b) {
+bool heightSort(const std::pair<CAddressUnspentKey, CAddressUnspentValue>& a,
+                const std::pair<CAddressUnspentKey, CAddressUnspentValue>& b) {
     return a.second.blockHeight < b.second.blockHeight;
 }
 
@@ -833,6 +833,114 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+/** Entries per reply of a paginated address index call that is given a cursor but no limit */
+static const int DEFAULT_ADDRESS_INDEX_PAGE_SIZE = 1000;
+/** Most entries a paginated address index call returns at once */
+static const int MAX_ADDRESS_INDEX_PAGE_SIZE = 50000;
+
+/**
+ * Where a paginated address index call continues. The cursor handed out as "next" is the call it
+ * belongs to, the position in the list of addresses and the index key of the last entry returned for
+ * that address (if any), serialized and hex encoded.
+ */
+template<typename Key>
+struct AddressIndexCursor {
+    bool fPaged;
+    size_t nLimit;
+    size_t nAddress;
+    bool fAfter;
+    Key keyAfter;
+
+    AddressIndexCursor() : fPaged(false), nLimit(0), nAddress(0), fAfter(false) {}
+};
+
+template<typename Key>
+static std::string EncodeAddressIndexCursor(char chCall, size_t nAddress, const Key* pkeyAfter)
+{
+    CDataStream ssCursor(SER_NETWORK, PROTOCOL_VERSION);
+    uint64_t nAddressPos = nAddress;
+    ssCursor << chCall << VARINT(nAddressPos) << (pkeyAfter != nullptr);
+    if (pkeyAfter)
+        ssCursor << *pkeyAfter;
+    return HexStr(ssCursor.begin(), ssCursor.end());
+}
+
+//! Read "limit" and "cursor" from the request object, the call is paginated if either is there
+template<typename Key>
+static void ParseAddressIndexCursor(const UniValue& params, char chCall, const std::vector<std::pair<uint160, int> >& addresses,
+                                    AddressIndexCursor<Key>& cursor)
+{
+    if (!params[0].isObject())
+        return;
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (limitValue.isNull() && cursorValue.isNull())
+        return;
+
+    cursor.fPaged = true;
+    cursor.nLimit = DEFAULT_ADDRESS_INDEX_PAGE_SIZE;
+    if (!limitValue.isNull()) {
+        int nLimit = limitValue.get_int();
+        if (nLimit <= 0 || nLimit > MAX_ADDRESS_INDEX_PAGE_SIZE)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Limit is expected to be between 1 and %d", MAX_ADDRESS_INDEX_PAGE_SIZE));
+        cursor.nLimit = nLimit;
+    }
+    if (cursorValue.isNull())
+        return;
+
+    const std::string& strCursor = cursorValue.get_str();
+    if (!IsHex(strCursor))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    bool fValid = false;
+    try {
+        CDataStream ssCursor(ParseHex(strCursor), SER_NETWORK, PROTOCOL_VERSION);
+        char chCallCursor;
+        uint64_t nAddressPos;
+        ssCursor >> chCallCursor >> VARINT(nAddressPos) >> cursor.fAfter;
+        if (cursor.fAfter)
+            ssCursor >> cursor.keyAfter;
+        cursor.nAddress = nAddressPos;
+        fValid = chCallCursor == chCall && ssCursor.empty() && nAddressPos < addresses.size();
+    } catch (const std::exception&) {
+    }
+    // The cursor has to come from the same call for the same addresses
+    if (fValid && cursor.fAfter) {
+        fValid = cursor.keyAfter.type == (unsigned int)addresses[cursor.nAddress].second &&
+                 cursor.keyAfter.hashBytes == addresses[cursor.nAddress].first;
+    }
+    if (!fValid)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+}
+
+/**
+ * Read one page of a paginated address index call, going through the addresses in order. read(address,
+ * pkeyAfter, nLimit, vEntries, keyLast, fMore) reads the entries of one address. Returns the cursor of
+ * the next page, or an empty string after the last one.
+ */
+template<typename Key, typename Entry, typename Reader>
+static std::string ReadAddressIndexPage(char chCall, const std::vector<std::pair<uint160, int> >& addresses,
+                                        const AddressIndexCursor<Key>& cursor, std::vector<Entry>& vEntries, Reader read)
+{
+    for (size_t i = cursor.nAddress; i < addresses.size(); i++) {
+        if (vEntries.size() >= cursor.nLimit)
+            return EncodeAddressIndexCursor<Key>(chCall, i, nullptr);
+        const Key* pkeyAfter = i == cursor.nAddress && cursor.fAfter ? &cursor.keyAfter : nullptr;
+        Key keyLast;
+        bool fMore = false;
+        if (!read(addresses[i], pkeyAfter, cursor.nLimit - vEntries.size(), vEntries, keyLast, fMore)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        if (fMore)
+            return EncodeAddressIndexCursor(chCall, i, &keyLast);
+    }
+    return "";
+}
+
+static UniValue AddressIndexCursorValue(const std::string& strNext)
+{
+    return strNext.empty() ? NullUniValue : UniValue(strNext);
+}
+
 UniValue getaddressmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 2)
@@ -939,6 +1047,8 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    ],\n"
             "  \"chainInfo\",  (boolean, optional, default false) Include chain info with results\n"
             "  \"assetName\"   (string, optional) Get UTXOs for a particular asset instead of BLAST ('*' for all assets).\n"
+            "  \"limit\"       (number, optional) Return at most this many UTXOs and a cursor to the rest\n"
+            "  \"cursor\"      (string, optional) The \"next\" cursor of the previous page\n"
             "}\n"
             "\nResult\n"
             "[\n"
@@ -952,11 +1062,17 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    \"satoshis\"  (number) The number of satoshis of the output\n"
             "  }\n"
             "]\n"
+            "\nResult (with limit or cursor, UTXOs in index order instead of by height)\n"
+            "{\n"
+            "  \"utxos\"  (array) The UTXOs as above\n"
+            "  \"next\"   (string) Cursor of the next page, null after the last one\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"],\"assetName\":\"MY_ASSET\"}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"],\"assetName\":\"MY_ASSET\"}")
+            + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"],\"limit\":1000}'")
             );
 
     bool includeChainInfo = false;
@@ -980,21 +1096,27 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    AddressIndexCursor<CAddressUnspentCompactKey> cursor;
+    ParseAddressIndexCursor(request.params, 'u', addresses, cursor);
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (assetName == "*") {
-            if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressUnspent((*it).first, (*it).second, assetName, unspentOutputs)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    std::string strNext;
+
+    if (cursor.fPaged) {
+        std::string assetNamePage = assetName == "*" ? "" : assetName;
+        strNext = ReadAddressIndexPage(
+            'u', addresses, cursor, unspentOutputs,
+            [&assetNamePage](const std::pair<uint160, int>& address, const CAddressUnspentCompactKey* pkeyAfter, size_t nLimit,
+                             std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& vOutputs, CAddressUnspentCompactKey& keyLast, bool& fMore) {
+                return GetAddressUnspentPage(address.first, address.second, assetNamePage, pkeyAfter, nLimit, vOutputs, keyLast, fMore);
+            });
+    } else {
+        if (!GetAddressUnspent(addresses, assetName == "*" ? "" : assetName, unspentOutputs)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-    }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+        std::stable_sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    }
 
     UniValue utxos(UniValue::VARR);
 
@@ -1023,13 +1145,18 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         utxos.push_back(output);
     }
 
-    if (includeChainInfo) {
+    if (includeChainInfo || cursor.fPaged) {
         UniValue result(UniValue::VOBJ);
         result.push_back(Pair("utxos", utxos));
+        if (cursor.fPaged) {
+            result.push_back(Pair("next", AddressIndexCursorValue(strNext)));
+        }
 
-        LOCK(cs_main);
-        result.push_back(Pair("hash", chainActive.Tip()->GetBlockHash().GetHex()));
-        result.push_back(Pair("height", (int)chainActive.Height()));
+        if (includeChainInfo) {
+            LOCK(cs_main);
+            result.push_back(Pair("hash", chainActive.Tip()->GetBlockHash().GetHex()));
+            result.push_back(Pair("height", (int)chainActive.Height()));
+        }
         return result;
     } else {
         return utxos;
@@ -1053,6 +1180,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "  \"end\" (number) The end block height\n"
             "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
             "  \"assetName\"   (string, optional) Get deltas for a particular asset instead of BLAST.\n"
+            "  \"limit\"     (number, optional) Return at most this many deltas (more to finish a transaction) and a cursor to the rest\n"
+            "  \"cursor\"    (string, optional) The \"next\" cursor of the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -1065,11 +1194,17 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nResult (with limit or cursor)\n"
+            "{\n"
+            "  \"deltas\"  (array) The deltas as above\n"
+            "  \"next\"    (string) Cursor of the next page, null after the last one\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"],\"assetName\":\"MY_ASSET\"}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"],\"assetName\":\"MY_ASSET\"}")
+            + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"],\"limit\":1000}'")
         );
 
 
@@ -1110,17 +1245,23 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    AddressIndexCursor<CAddressIndexCompactKey> cursor;
+    ParseAddressIndexCursor(request.params, 'd', addresses, cursor);
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::string strNext;
+
+    if (cursor.fPaged) {
+        strNext = ReadAddressIndexPage(
+            'd', addresses, cursor, addressIndex,
+            [&assetName, start, end](const std::pair<uint160, int>& address, const CAddressIndexCompactKey* pkeyAfter, size_t nLimit,
+                                     std::vector<std::pair<CAddressIndexKey, CAmount> >& vEntries, CAddressIndexCompactKey& keyLast, bool& fMore) {
+                return GetAddressIndexPage(address.first, address.second, assetName, start, end, pkeyAfter, nLimit, vEntries, keyLast, fMore);
+            });
+    } else {
+        // Comes out in chain order, the deltas of several addresses interleaved by height
+        if (!GetAddressIndex(addresses, assetName, addressIndex, start, end)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
     }
 
@@ -1167,7 +1308,14 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         result.push_back(Pair("deltas", deltas));
         result.push_back(Pair("start", startInfo));
         result.push_back(Pair("end", endInfo));
+        if (cursor.fPaged) {
+            result.push_back(Pair("next", AddressIndexCursorValue(strNext)));
+        }
 
+        return result;
+    } else if (cursor.fPaged) {
+        result.push_back(Pair("deltas", deltas));
+        result.push_back(Pair("next", AddressIndexCursorValue(strNext)));
         return result;
     } else {
         return deltas;
@@ -1225,27 +1373,19 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         if (!AreAssetsDeployed())
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Assets aren't active.  includeAssets can't be true.");
 
-        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-
         //assetName -> (received, balance)
         std::map<std::string, std::pair<CAmount, CAmount>> balances;
 
-        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin();
-             it != addressIndex.end(); it++) {
-            std::string assetName = it->first.asset;
-            if (balances.count(assetName) == 0) {
-                balances[assetName] = std::make_pair(0, 0);
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            std::vector<std::pair<std::string, CAddressBalanceValue> > addressBalances;
+            if (!GetAddressBalances((*it).first, (*it).second, addressBalances)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
-            if (it->second > 0) {
-                balances[assetName].first += it->second;
+            for (const auto& item : addressBalances) {
+                std::pair<CAmount, CAmount>& balance = balances[item.first];
+                balance.first += item.second.received;
+                balance.second += item.second.balance;
             }
-            balances[assetName].second += it->second;
         }
 
         UniValue result(UniValue::VARR);
@@ -1262,23 +1402,16 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         return result;
 
     } else {
-        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-            if (!GetAddressIndex((*it).first, (*it).second, BLAST, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
-
         CAmount balance = 0;
         CAmount received = 0;
 
-        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it = addressIndex.begin();
-             it != addressIndex.end(); it++) {
-            if (it->second > 0) {
-                received += it->second;
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            CAddressBalanceValue addressBalance;
+            if (!GetAddressBalance((*it).first, (*it).second, BLAST, addressBalance)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
-            balance += it->second;
+            balance += addressBalance.balance;
+            received += addressBalance.received;
         }
 
         UniValue result(UniValue::VOBJ);
@@ -1305,6 +1438,8 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number, optional) The start block height\n"
             "  \"end\" (number, optional) The end block height\n"
+            "  \"limit\" (number, optional) Return the txids of about this many address index entries and a cursor to the rest\n"
+            "  \"cursor\" (string, optional) The \"next\" cursor of the previous page\n"
             "},\n"
             "\"includeAssets\" (boolean, optional, default false)  If true this will return an expanded result which includes asset transactions\n"
             "\nResult:\n"
@@ -1312,11 +1447,18 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nResult (with limit or cursor, txids by address, then asset, then height; a txid is listed again for every\n"
+            "address and asset it touches):\n"
+            "{\n"
+            "  \"txids\"  (array) The transaction ids\n"
+            "  \"next\"   (string) Cursor of the next page, null after the last one\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}', true")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}, true")
+            + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"],\"limit\":1000}'")
         );
 
     std::vector<std::pair<uint160, int> > addresses;
@@ -1345,8 +1487,38 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         if (!AreAssetsDeployed())
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Assets aren't active.  includeAssets can't be true.");
 
+    AddressIndexCursor<CAddressIndexCompactKey> cursor;
+    ParseAddressIndexCursor(request.params, 't', addresses, cursor);
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
+    if (cursor.fPaged) {
+        std::string assetName = includeAssets ? "" : BLAST;
+        if (start <= 0 || end <= 0)
+            start = end = 0;
+        std::string strNext = ReadAddressIndexPage(
+            't', addresses, cursor, addressIndex,
+            [&assetName, start, end](const std::pair<uint160, int>& address, const CAddressIndexCompactKey* pkeyAfter, size_t nLimit,
+                                     std::vector<std::pair<CAddressIndexKey, CAmount> >& vEntries, CAddressIndexCompactKey& keyLast, bool& fMore) {
+                return GetAddressIndexPage(address.first, address.second, assetName, start, end, pkeyAfter, nLimit, vEntries, keyLast, fMore);
+            });
+
+        // Pages end between transactions, so only neighbouring entries share a txid
+        UniValue txids(UniValue::VARR);
+        uint256 txhashLast;
+        for (const auto& entry : addressIndex) {
+            if (entry.first.txhash != txhashLast) {
+                txids.push_back(entry.first.txhash.GetHex());
+                txhashLast = entry.first.txhash;
+            }
+        }
+
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("txids", txids));
+        result.push_back(Pair("next", AddressIndexCursorValue(strNext)));
+        return result;
+    }
+
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
         if (includeAssets) {
             if (start > 0 && end > 0) {
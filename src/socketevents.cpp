@@ -0,0 +1,149 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "socketevents.h"
+
+#include "netbase.h"
+#include "util.h"
+
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+/** Most events taken from the epoll instance at once, the rest is left for the next call */
+static const int MAX_EPOLL_EVENTS = 1024;
+
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& mode)
+{
+    if (strMode == "select") {
+        mode = SOCKETEVENTS_SELECT;
+        return true;
+    }
+#ifdef HAVE_EPOLL
+    if (strMode == "epoll") {
+        mode = SOCKETEVENTS_EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string GetSocketEventsModeName(SocketEventsMode mode)
+{
+    switch (mode) {
+    case SOCKETEVENTS_SELECT: return "select";
+    case SOCKETEVENTS_EPOLL: return "epoll";
+    }
+    return "unknown";
+}
+
+std::string GetSocketEventsModes()
+{
+#ifdef HAVE_EPOLL
+    return "select, epoll";
+#else
+    return "select";
+#endif
+}
+
+CSocketEvents::CSocketEvents(SocketEventsMode modeIn) : mode(modeIn), epollfd(-1)
+{
+#ifdef HAVE_EPOLL
+    if (mode == SOCKETEVENTS_EPOLL) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("epoll_create1 failed: %s, falling back to select\n", NetworkErrorString(WSAGetLastError()));
+            mode = SOCKETEVENTS_SELECT;
+        }
+    }
+#else
+    mode = SOCKETEVENTS_SELECT;
+#endif
+}
+
+CSocketEvents::~CSocketEvents()
+{
+#ifdef HAVE_EPOLL
+    if (epollfd != -1)
+        close(epollfd);
+#endif
+}
+
+bool CSocketEvents::Register(SOCKET hSocket, uint64_t nId, bool fEdgeTriggered)
+{
+#ifdef HAVE_EPOLL
+    if (mode == SOCKETEVENTS_EPOLL) {
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP;
+        if (fEdgeTriggered)
+            event.events |= EPOLLOUT | EPOLLET;
+        event.data.u64 = nId;
+        if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hSocket, &event) != 0) {
+            LogPrintf("epoll_ctl failed: %s\n", NetworkErrorString(WSAGetLastError()));
+            return false;
+        }
+    }
+#endif
+    return true;
+}
+
+bool CSocketEvents::Wait(const std::vector<CSocketWait>& vWait, std::vector<CSocketEvent>& vEvents, int64_t nTimeoutMillis)
+{
+#ifdef HAVE_EPOLL
+    if (mode == SOCKETEVENTS_EPOLL) {
+        struct epoll_event events[MAX_EPOLL_EVENTS];
+        int nEvents = epoll_wait(epollfd, events, MAX_EPOLL_EVENTS, nTimeoutMillis);
+        if (nEvents < 0) {
+            int nErr = WSAGetLastError();
+            if (nErr == WSAEINTR)
+                return true;
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+            return false;
+        }
+        for (int i = 0; i < nEvents; i++) {
+            uint64_t nId = events[i].data.u64;
+            uint32_t nFlags = events[i].events;
+            vEvents.emplace_back(nId, nFlags & EPOLLIN, nFlags & EPOLLOUT, nFlags & (EPOLLERR | EPOLLHUP | EPOLLRDHUP));
+        }
+        return true;
+    }
+#endif
+
+    struct timeval timeout = MillisToTimeval(nTimeoutMillis);
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+
+    for (const CSocketWait& wait : vWait) {
+        FD_SET(wait.hSocket, &fdsetError);
+        if (wait.fRecv)
+            FD_SET(wait.hSocket, &fdsetRecv);
+        if (wait.fSend)
+            FD_SET(wait.hSocket, &fdsetSend);
+        hSocketMax = std::max(hSocketMax, wait.hSocket);
+    }
+
+    int nSelect = select(vWait.empty() ? 0 : hSocketMax + 1, &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (nSelect == SOCKET_ERROR) {
+        if (!vWait.empty()) {
+            LogPrintf("socket select error %s\n", NetworkErrorString(WSAGetLastError()));
+            for (const CSocketWait& wait : vWait)
+                vEvents.emplace_back(wait.nId, true, false, false);
+        }
+        return false;
+    }
+
+    for (const CSocketWait& wait : vWait) {
+        bool fRecv = FD_ISSET(wait.hSocket, &fdsetRecv);
+        bool fSend = FD_ISSET(wait.hSocket, &fdsetSend);
+        bool fError = FD_ISSET(wait.hSocket, &fdsetError);
+        if (fRecv || fSend || fError)
+            vEvents.emplace_back(wait.nId, fRecv, fSend, fError);
+    }
+    return true;
+}
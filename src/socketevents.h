@@ -0,0 +1,90 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SOCKETEVENTS_H
+#define BITCOIN_SOCKETEVENTS_H
+
+#if defined(HAVE_CONFIG_H)
+#include "config/bitcoin-config.h"
+#endif
+
+#include "compat.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/** How the socket handler waits for its sockets */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0,
+    SOCKETEVENTS_EPOLL = 1,
+};
+
+#ifdef HAVE_EPOLL
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_SELECT;
+#endif
+
+bool ParseSocketEventsMode(const std::string& strMode, SocketEventsMode& mode);
+std::string GetSocketEventsModeName(SocketEventsMode mode);
+/** The modes available in this build, for the help message */
+std::string GetSocketEventsModes();
+
+/** A socket to wait for with select(), handed to every CSocketEvents::Wait call */
+struct CSocketWait {
+    SOCKET hSocket;
+    uint64_t nId;
+    bool fRecv;
+    bool fSend;
+
+    CSocketWait(SOCKET hSocketIn, uint64_t nIdIn, bool fRecvIn, bool fSendIn) :
+        hSocket(hSocketIn), nId(nIdIn), fRecv(fRecvIn), fSend(fSendIn) {}
+};
+
+/** What a socket became ready for */
+struct CSocketEvent {
+    uint64_t nId;
+    bool fRecv;
+    bool fSend;
+    bool fError;
+
+    CSocketEvent(uint64_t nIdIn, bool fRecvIn, bool fSendIn, bool fErrorIn) :
+        nId(nIdIn), fRecv(fRecvIn), fSend(fSendIn), fError(fErrorIn) {}
+};
+
+/**
+ * Waits for a set of sockets to become ready. With select() the sockets and what they are waited for are
+ * passed in on every call, and only sockets below FD_SETSIZE can be used. With epoll the sockets are
+ * registered once. Edge triggered ones are reported once each time they become readable or writable,
+ * the caller has to remember that until recv() or send() runs out of data or buffer space.
+ */
+class CSocketEvents
+{
+private:
+    SocketEventsMode mode;
+    int epollfd;
+
+public:
+    /** Falls back to select() if the epoll instance can't be created */
+    explicit CSocketEvents(SocketEventsMode modeIn);
+    ~CSocketEvents();
+
+    CSocketEvents(const CSocketEvents&) = delete;
+    CSocketEvents& operator=(const CSocketEvents&) = delete;
+
+    SocketEventsMode GetMode() const { return mode; }
+
+    /** Register a socket with the epoll instance, level triggered unless fEdgeTriggered. Closing the socket unregisters it. */
+    bool Register(SOCKET hSocket, uint64_t nId, bool fEdgeTriggered);
+
+    /**
+     * Wait up to nTimeoutMillis for the sockets in vWait (select) or the registered ones (epoll) and append
+     * what became ready to vEvents. On failure select() reports every socket in vWait as readable, so the
+     * bad one gets noticed.
+     */
+    bool Wait(const std::vector<CSocketWait>& vWait, std::vector<CSocketEvent>& vEvents, int64_t nTimeoutMillis);
+};
+
+#endif // BITCOIN_SOCKETEVENTS_H
@@ -8,6 +8,8 @@
 
 #include "uint256.h"
 #include "amount.h"
+#include "compressor.h"
+#include "serialize.h"
 
 struct CSpentIndexKey {
     uint256 txid;
@@ -84,6 +86,62 @@ struct CSpentIndexValue {
     }
 };
 
+/** Key of the compact spent index ('P'): the spent txid and the output index as a varint */
+struct CSpentIndexCompactKey {
+    uint256 txid;
+    unsigned int outputIndex;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        txid.Serialize(s);
+        s << VARINT(outputIndex);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        txid.Unserialize(s);
+        s >> VARINT(outputIndex);
+    }
+
+    explicit CSpentIndexCompactKey(const CSpentIndexKey& key) : txid(key.txid), outputIndex(key.outputIndex) {}
+    CSpentIndexCompactKey() : outputIndex(0) {}
+};
+
+/** Value of the compact spent index, with the heights, indexes and amount as varints */
+struct CSpentIndexCompactValue {
+    CSpentIndexValue value;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        value.txid.Serialize(s);
+        s << VARINT(value.inputIndex);
+        s << VARINT(value.blockHeight);
+        uint64_t nAmount = CTxOutCompressor::CompressAmount(value.satoshis);
+        s << VARINT(nAmount);
+        ser_writedata8(s, value.addressType);
+        if (value.addressType != 0)
+            value.addressHash.Serialize(s);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        value.txid.Unserialize(s);
+        s >> VARINT(value.inputIndex);
+        s >> VARINT(value.blockHeight);
+        uint64_t nAmount;
+        s >> VARINT(nAmount);
+        value.satoshis = CTxOutCompressor::DecompressAmount(nAmount);
+        value.addressType = ser_readdata8(s);
+        if (value.addressType != 0)
+            value.addressHash.Unserialize(s);
+        else
+            value.addressHash.SetNull();
+    }
+
+    explicit CSpentIndexCompactValue(const CSpentIndexValue& valueIn) : value(valueIn) {}
+    CSpentIndexCompactValue() {}
+};
+
 struct CSpentIndexKeyCompare
 {
     bool operator()(const CSpentIndexKey& a, const CSpentIndexKey& b) const {
@@ -14,6 +14,8 @@
 
 #include <boost/lexical_cast.hpp>
 
+#include <atomic>
+
 CSporkManager sporkManager;
 
 std::map<uint256, CSporkMessage> mapSporks;
@@ -33,23 +35,24 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
 
         uint256 hash = spork.GetHash();
 
-        std::string strLogMsg;
         {
             LOCK(cs_main);
             pfrom->setAskFor.erase(hash);
-            if(!chainActive.Tip()) return;
-            strLogMsg = strprintf("SPORK -- hash: %s id: %d value: %10d bestHeight: %d peer=%d", hash.ToString(), spork.nSporkID, spork.nValue, chainActive.Height(), pfrom->id);
         }
+        std::string strLogMsg = strprintf("SPORK -- hash: %s id: %d value: %10d bestHeight: %d peer=%d", hash.ToString(), spork.nSporkID, spork.nValue, connman.GetBestHeight(), pfrom->id);
 
-        if(mapSporksActive.count(spork.nSporkID)) {
-            if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
-                LogPrint(BCLog::SPORK, "%s seen\n", strLogMsg);
-                return;
+        {
+            LOCK(cs);
+            if(mapSporksActive.count(spork.nSporkID)) {
+                if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
+                    LogPrint(BCLog::SPORK, "%s seen\n", strLogMsg);
+                    return;
+                } else {
+                    LogPrintf("%s updated\n", strLogMsg);
+                }
             } else {
-                LogPrintf("%s updated\n", strLogMsg);
+                LogPrintf("%s new\n", strLogMsg);
             }
-        } else {
-            LogPrintf("%s new\n", strLogMsg);
         }
 
         if(!spork.CheckSignature(sporkPubKeyID)) {
@@ -59,14 +62,18 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             return;
         }
 
-        mapSporks[hash] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        {
+            LOCK(cs);
+            mapSporks[hash] = spork;
+            mapSporksActive[spork.nSporkID] = spork;
+        }
         spork.Relay(connman);
 
         //does a task if needed
         ExecuteSpork(spork.nSporkID, spork.nValue);
 
     } else if (strCommand == NetMsgType::GETSPORKS) {
+        LOCK(cs);
         for (const auto& pair : mapSporksActive) {
             connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SPORK, pair.second));
         }
@@ -83,18 +90,20 @@ void CSporkManager::ExecuteSpork(int nSporkID, int nValue)
         // this potentially can be a heavy operation, so only allow this to be executed once per 10 minutes
         int64_t nTimeout = 10 * 60;
 
-        static int64_t nTimeExecuted = 0; // i.e. it was never executed before
-
-        if(GetTime() - nTimeExecuted < nTimeout) {
-            LogPrint(BCLog::SPORK, "CSporkManager::ExecuteSpork -- ERROR: Trying to reconsider blocks, too soon - %d/%d\n", GetTime() - nTimeExecuted, nTimeout);
-            return;
-        }
+        // shared by the message handler threads, a run is claimed before it starts so two sporks can't both start one
+        static std::atomic<int64_t> nTimeExecuted(0); // i.e. it was never executed before
 
         if(nValue > nMaxBlocks) {
             LogPrintf("CSporkManager::ExecuteSpork -- ERROR: Trying to reconsider too many blocks %d/%d\n", nValue, nMaxBlocks);
             return;
         }
 
+        int64_t nTimeLast = nTimeExecuted;
+        int64_t nTimeNow = GetTime();
+        if(nTimeNow - nTimeLast < nTimeout || !nTimeExecuted.compare_exchange_strong(nTimeLast, nTimeNow)) {
+            LogPrint(BCLog::SPORK, "CSporkManager::ExecuteSpork -- ERROR: Trying to reconsider blocks, too soon - %d/%d\n", nTimeNow - nTimeLast, nTimeout);
+            return;
+        }
 
         LogPrintf("CSporkManager::ExecuteSpork -- Reconsider Last %d Blocks\n", nValue);
 
@@ -110,6 +119,7 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, CConnman& connman)
 
     if(spork.Sign(sporkPrivKey)) {
         spork.Relay(connman);
+        LOCK(cs);
         mapSporks[spork.GetHash()] = spork;
         mapSporksActive[nSporkID] = spork;
         return true;
@@ -121,6 +131,7 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, CConnman& connman)
 // grab the spork, otherwise say it's off
 bool CSporkManager::IsSporkActive(int nSporkID)
 {
+    LOCK(cs);
     int64_t r = -1;
 
     if(mapSporksActive.count(nSporkID)){
@@ -138,6 +149,7 @@ bool CSporkManager::IsSporkActive(int nSporkID)
 // grab the value of the spork on the network, or the default
 int64_t CSporkManager::GetSporkValue(int nSporkID)
 {
+    LOCK(cs);
     if (mapSporksActive.count(nSporkID))
         return mapSporksActive[nSporkID].nValue;
 
@@ -149,6 +161,16 @@ int64_t CSporkManager::GetSporkValue(int nSporkID)
     return -1;
 }
 
+bool CSporkManager::GetSporkByHash(const uint256& hash, CSporkMessage& sporkRet)
+{
+    LOCK(cs);
+    std::map<uint256, CSporkMessage>::const_iterator it = mapSporks.find(hash);
+    if (it == mapSporks.end())
+        return false;
+    sporkRet = it->second;
+    return true;
+}
+
 int CSporkManager::GetSporkIDByName(const std::string& strName)
 {
     if (strName == "SPORK_2_NEW_SIGS")                         return SPORK_2_NEW_SIGS;
@@ -80,6 +80,8 @@ public:
 class CSporkManager
 {
 private:
+    // Protects mapSporksActive and mapSporks, sporks are processed by several message handler threads
+    mutable CCriticalSection cs;
     std::vector<unsigned char> vchSig;
     std::map<int, CSporkMessage> mapSporksActive;
 
@@ -96,6 +98,7 @@ public:
 
     bool IsSporkActive(int nSporkID);
     int64_t GetSporkValue(int nSporkID);
+    bool GetSporkByHash(const uint256& hash, CSporkMessage& sporkRet);
     int GetSporkIDByName(const std::string& strName);
     std::string GetSporkNameByID(int nSporkID);
 
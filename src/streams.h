@@ -140,6 +140,50 @@ private:
     size_t nPos;
 };
 
+/** Minimal stream for deserializing from a byte range that outlives it, like a mapped file, without copying the range first */
+class CSpanReader
+{
+private:
+    const int nType;
+    const int nVersion;
+    const char* pbegin;
+    const char* pend;
+    const char* pcur;
+
+public:
+    CSpanReader(int nTypeIn, int nVersionIn, const char* pbeginIn, const char* pendIn) :
+        nType(nTypeIn), nVersion(nVersionIn), pbegin(pbeginIn), pend(pendIn), pcur(pbeginIn) {}
+
+    int GetType() const { return nType; }
+    int GetVersion() const { return nVersion; }
+
+    void read(char* pch, size_t nSize)
+    {
+        if (nSize > (size_t)(pend - pcur))
+            throw std::ios_base::failure("CSpanReader::read(): end of data");
+        memcpy(pch, pcur, nSize);
+        pcur += nSize;
+    }
+
+    void ignore(size_t nSize)
+    {
+        if (nSize > (size_t)(pend - pcur))
+            throw std::ios_base::failure("CSpanReader::ignore(): end of data");
+        pcur += nSize;
+    }
+
+    //! Bytes read or skipped so far
+    size_t GetPos() const { return pcur - pbegin; }
+
+    template<typename T>
+    CSpanReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+};
+
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
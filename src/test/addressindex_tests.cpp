@@ -0,0 +1,884 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindex.h"
+#include "assets/assetdb.h"
+#include "assets/assets.h"
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "indexbuilder.h"
+#include "random.h"
+#include "script/interpreter.h"
+#include "streams.h"
+#include "txdb.h"
+#include "utilstrencodings.h"
+#include "validation.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+typedef std::pair<CAddressIndexKey, CAmount> IndexEntry;
+typedef std::pair<CAddressUnspentKey, CAddressUnspentValue> UnspentEntry;
+
+namespace {
+//! Point passetsdb at an in memory asset database for the lifetime of a test
+struct AssetsDBSetup
+{
+    CAssetsDB assetsdb;
+    CAssetsDB* passetsdbOld;
+
+    AssetsDBSetup() : assetsdb(1 << 20, true), passetsdbOld(passetsdb) { passetsdb = &assetsdb; }
+    ~AssetsDBSetup() { passetsdb = passetsdbOld; }
+};
+}
+
+static std::vector<unsigned char> SerializeOrdered(uint32_t n)
+{
+    CDataStream ss(SER_DISK, 0);
+    WriteOrderedVarInt(ss, n);
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+static CScript AddressScript(const uint160& hash)
+{
+    return CScript() << OP_DUP << OP_HASH160 << ToByteVector(hash) << OP_EQUALVERIFY << OP_CHECKSIG;
+}
+
+static void CheckIndexEntries(const std::vector<IndexEntry>& vActual, const std::vector<IndexEntry>& vExpected)
+{
+    BOOST_REQUIRE_EQUAL(vActual.size(), vExpected.size());
+    for (size_t i = 0; i < vActual.size(); i++) {
+        const CAddressIndexKey& a = vActual[i].first;
+        const CAddressIndexKey& b = vExpected[i].first;
+        BOOST_CHECK_EQUAL(a.type, b.type);
+        BOOST_CHECK(a.hashBytes == b.hashBytes);
+        BOOST_CHECK_EQUAL(a.asset, b.asset);
+        BOOST_CHECK_EQUAL(a.blockHeight, b.blockHeight);
+        BOOST_CHECK_EQUAL(a.txindex, b.txindex);
+        BOOST_CHECK(a.txhash == b.txhash);
+        BOOST_CHECK_EQUAL(a.index, b.index);
+        BOOST_CHECK_EQUAL(a.spending, b.spending);
+        BOOST_CHECK_EQUAL(vActual[i].second, vExpected[i].second);
+    }
+}
+
+static void CheckUnspentEntries(const std::vector<UnspentEntry>& vActual, const std::vector<UnspentEntry>& vExpected)
+{
+    BOOST_REQUIRE_EQUAL(vActual.size(), vExpected.size());
+    for (size_t i = 0; i < vActual.size(); i++) {
+        BOOST_CHECK_EQUAL(vActual[i].first.asset, vExpected[i].first.asset);
+        BOOST_CHECK(vActual[i].first.txhash == vExpected[i].first.txhash);
+        BOOST_CHECK_EQUAL(vActual[i].first.index, vExpected[i].first.index);
+        BOOST_CHECK_EQUAL(vActual[i].second.satoshis, vExpected[i].second.satoshis);
+        BOOST_CHECK(vActual[i].second.script == vExpected[i].second.script);
+        BOOST_CHECK_EQUAL(vActual[i].second.blockHeight, vExpected[i].second.blockHeight);
+    }
+}
+
+BOOST_FIXTURE_TEST_SUITE(addressindex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(addressindex_ordered_varint_test)
+{
+    std::vector<uint32_t> vValues = {0, 1, 63, 64, 255, 16383, 16384, 1000000, (1U << 22) - 1, 1U << 22, (1U << 30) - 1};
+    for (int i = 0; i < 1000; i++)
+        vValues.push_back(InsecureRand32() >> (2 + InsecureRandRange(30)));
+    std::sort(vValues.begin(), vValues.end());
+
+    for (size_t i = 0; i < vValues.size(); i++) {
+        CDataStream ss(SER_DISK, 0);
+        WriteOrderedVarInt(ss, vValues[i]);
+        BOOST_CHECK_EQUAL(ReadOrderedVarInt(ss), vValues[i]);
+        BOOST_CHECK(ss.empty());
+        // Keys sort the same way as the values they hold
+        if (i > 0 && vValues[i - 1] != vValues[i])
+            BOOST_CHECK(SerializeOrdered(vValues[i - 1]) < SerializeOrdered(vValues[i]));
+    }
+
+    // Current heights take a byte less than before
+    BOOST_CHECK_EQUAL(SerializeOrdered(1000000).size(), 3U);
+    BOOST_CHECK_EQUAL(SerializeOrdered(63).size(), 1U);
+
+    CDataStream ss(SER_DISK, 0);
+    BOOST_CHECK_THROW(WriteOrderedVarInt(ss, 1U << 30), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_compact_read_write_test)
+{
+    AssetsDBSetup setup;
+    CBlockTreeDB blocktree(1 << 20, true);
+
+    uint160 hashAddress = uint160(ParseHex("00112233445566778899aabbccddeeff00112233"));
+    uint160 hashOther = uint160(ParseHex("ffeeddccbbaa99887766554433221100ffeeddcc"));
+    std::vector<uint256> vTxid;
+    for (int i = 0; i < 6; i++)
+        vTxid.push_back(InsecureRand256());
+
+    // One transaction receiving and spending BLAST, assets on either side of it in name order
+    std::vector<IndexEntry> vBlast = {
+        {CAddressIndexKey(1, hashAddress, 5, 2, vTxid[0], 0, false), 50 * COIN},
+        {CAddressIndexKey(1, hashAddress, 5, 2, vTxid[0], 1, true), -3 * COIN},
+        {CAddressIndexKey(1, hashAddress, 10, 300, vTxid[1], 70000, false), 1},
+    };
+    std::vector<IndexEntry> vZeta = {
+        {CAddressIndexKey(1, hashAddress, "ZETA", 3, 1, vTxid[2], 0, false), 1000 * COIN},
+        {CAddressIndexKey(1, hashAddress, "ZETA", 12, 1, vTxid[3], 4, true), -1000 * COIN},
+    };
+    std::vector<IndexEntry> vAbc = {
+        {CAddressIndexKey(1, hashAddress, "ABC", 7, 0, vTxid[4], 2, false), 12345678},
+    };
+    std::vector<IndexEntry> vOther = {
+        {CAddressIndexKey(2, hashOther, 6, 1, vTxid[5], 0, false), COIN},
+    };
+
+    std::vector<IndexEntry> vWrite;
+    for (const auto* pvec : {&vZeta, &vBlast, &vOther, &vAbc})
+        vWrite.insert(vWrite.end(), pvec->begin(), pvec->end());
+    BOOST_CHECK(blocktree.WriteAddressIndex(vWrite));
+
+    // The asset ids the keys refer to made it to the asset database
+    uint32_t id;
+    BOOST_CHECK(setup.assetsdb.ReadAssetId("ZETA", id));
+    BOOST_CHECK(setup.assetsdb.ReadAssetId("ABC", id));
+    BOOST_CHECK(assetNameTable.GetUnpersisted().empty());
+
+    std::vector<IndexEntry> vRead;
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashAddress, 1, BLAST, vRead));
+    CheckIndexEntries(vRead, vBlast);
+
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashAddress, 1, BLAST, vRead, 6, 10));
+    CheckIndexEntries(vRead, {vBlast[2]});
+
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashAddress, 1, "ZETA", vRead));
+    CheckIndexEntries(vRead, vZeta);
+
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashAddress, 1, "UNKNOWN", vRead));
+    BOOST_CHECK(vRead.empty());
+
+    // All assets come back in the order of the original keys, where names sort by length first
+    std::vector<IndexEntry> vAll;
+    for (const auto* pvec : {&vAbc, &vZeta, &vBlast})
+        vAll.insert(vAll.end(), pvec->begin(), pvec->end());
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashAddress, 1, vRead));
+    CheckIndexEntries(vRead, vAll);
+
+    // ... and with an end height stop at the first entry past it
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashAddress, 1, vRead, 1, 8));
+    CheckIndexEntries(vRead, {vAbc[0], vZeta[0]});
+
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashOther, 2, vRead));
+    CheckIndexEntries(vRead, vOther);
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashOther, 1, vRead));
+    BOOST_CHECK(vRead.empty());
+
+    // Disconnecting the block at height 10
+    BOOST_CHECK(blocktree.EraseAddressIndex({vBlast[2]}));
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashAddress, 1, BLAST, vRead));
+    CheckIndexEntries(vRead, {vBlast[0], vBlast[1]});
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_compact_unspent_test)
+{
+    AssetsDBSetup setup;
+    CBlockTreeDB blocktree(1 << 20, true);
+
+    uint160 hashAddress = uint160(ParseHex("00112233445566778899aabbccddeeff00112233"));
+    CScript script = AddressScript(hashAddress);
+    CScript scriptAsset = script;
+    scriptAsset << std::vector<unsigned char>(30, 0x42) << OP_DROP;
+
+    std::vector<UnspentEntry> vBlast = {
+        {CAddressUnspentKey(1, hashAddress, InsecureRand256(), 0), CAddressUnspentValue(50 * COIN, script, 100)},
+        {CAddressUnspentKey(1, hashAddress, InsecureRand256(), 300), CAddressUnspentValue(1, script, 5000000)},
+    };
+    std::vector<UnspentEntry> vAssets = {
+        {CAddressUnspentKey(1, hashAddress, "ABC", InsecureRand256(), 1), CAddressUnspentValue(7, scriptAsset, 3)},
+        {CAddressUnspentKey(1, hashAddress, "ZETA", InsecureRand256(), 2), CAddressUnspentValue(1000 * COIN, scriptAsset, 4)},
+    };
+    std::sort(vBlast.begin(), vBlast.end(), [](const UnspentEntry& a, const UnspentEntry& b) { return a.first.txhash < b.first.txhash; });
+
+    std::vector<UnspentEntry> vWrite = vAssets;
+    vWrite.insert(vWrite.end(), vBlast.begin(), vBlast.end());
+    BOOST_CHECK(blocktree.UpdateAddressUnspentIndex(vWrite));
+
+    std::vector<UnspentEntry> vRead;
+    BOOST_CHECK(blocktree.ReadAddressUnspentIndex(hashAddress, 1, BLAST, vRead));
+    CheckUnspentEntries(vRead, vBlast);
+
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressUnspentIndex(hashAddress, 1, "ZETA", vRead));
+    CheckUnspentEntries(vRead, {vAssets[1]});
+
+    // Without an asset name only assets are returned
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressUnspentIndex(hashAddress, 1, vRead));
+    CheckUnspentEntries(vRead, vAssets);
+
+    // Spending
+    BOOST_CHECK(blocktree.UpdateAddressUnspentIndex({{vBlast[0].first, CAddressUnspentValue()}, {vAssets[0].first, CAddressUnspentValue()}}));
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressUnspentIndex(hashAddress, 1, BLAST, vRead));
+    CheckUnspentEntries(vRead, {vBlast[1]});
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressUnspentIndex(hashAddress, 1, vRead));
+    CheckUnspentEntries(vRead, {vAssets[1]});
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_page_test)
+{
+    AssetsDBSetup setup;
+    CBlockTreeDB blocktree(1 << 20, true);
+
+    uint160 hashAddress = uint160(ParseHex("00112233445566778899aabbccddeeff00112233"));
+
+    // Ten transactions with one to three BLAST entries each, and a few of an asset
+    std::vector<IndexEntry> vWrite;
+    for (int nHeight = 1; nHeight <= 10; nHeight++) {
+        uint256 txid = InsecureRand256();
+        for (int i = 0; i <= nHeight % 3; i++)
+            vWrite.push_back({CAddressIndexKey(1, hashAddress, nHeight, 1, txid, i, false), nHeight * COIN});
+        if (nHeight % 4 == 0)
+            vWrite.push_back({CAddressIndexKey(1, hashAddress, "ZETA", nHeight, 1, txid, 5, false), COIN});
+    }
+    BOOST_CHECK(blocktree.WriteAddressIndex(vWrite));
+
+    std::vector<IndexEntry> vExpected;
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashAddress, 1, BLAST, vExpected));
+
+    // Pages hold at least the limit, end between transactions and together have everything
+    std::vector<IndexEntry> vPaged;
+    CAddressIndexCompactKey keyAfter;
+    bool fAfter = false;
+    bool fMore = true;
+    int nPages = 0;
+    while (fMore) {
+        std::vector<IndexEntry> vPage;
+        CAddressIndexCompactKey keyLast;
+        BOOST_CHECK(blocktree.ReadAddressIndexPage(hashAddress, 1, BLAST, 0, 0, fAfter ? &keyAfter : nullptr, 4, vPage, keyLast, fMore));
+        if (fMore) {
+            BOOST_CHECK(vPage.size() >= 4);
+            BOOST_CHECK_EQUAL(keyLast.blockHeight, vPage.back().first.blockHeight);
+            BOOST_CHECK_EQUAL(keyLast.index, vPage.back().first.index);
+        }
+        if (!vPaged.empty() && !vPage.empty())
+            BOOST_CHECK(vPaged.back().first.txhash != vPage.front().first.txhash);
+        vPaged.insert(vPaged.end(), vPage.begin(), vPage.end());
+        keyAfter = keyLast;
+        fAfter = true;
+        BOOST_REQUIRE(++nPages <= 10);
+    }
+    BOOST_CHECK(nPages > 1);
+    CheckIndexEntries(vPaged, vExpected);
+
+    // Without an asset the height range applies to every asset, BLAST first
+    std::vector<IndexEntry> vRange;
+    CAddressIndexCompactKey keyLast;
+    BOOST_CHECK(blocktree.ReadAddressIndexPage(hashAddress, 1, "", 3, 8, nullptr, 1000, vRange, keyLast, fMore));
+    BOOST_CHECK(!fMore);
+    std::vector<IndexEntry> vRangeExpected;
+    for (const std::string& assetName : {std::string(BLAST), std::string("ZETA")}) {
+        for (const auto& entry : vWrite) {
+            if (entry.first.asset == assetName && entry.first.blockHeight >= 3 && entry.first.blockHeight <= 8)
+                vRangeExpected.push_back(entry);
+        }
+    }
+    CheckIndexEntries(vRange, vRangeExpected);
+
+    // Unspent outputs page in index order
+    std::vector<UnspentEntry> vUnspent;
+    for (int i = 0; i < 7; i++)
+        vUnspent.push_back({CAddressUnspentKey(1, hashAddress, "ZETA", InsecureRand256(), i), CAddressUnspentValue(i + 1, AddressScript(hashAddress), i)});
+    BOOST_CHECK(blocktree.UpdateAddressUnspentIndex(vUnspent));
+
+    std::vector<UnspentEntry> vUnspentExpected;
+    BOOST_CHECK(blocktree.ReadAddressUnspentIndex(hashAddress, 1, "ZETA", vUnspentExpected));
+    std::vector<UnspentEntry> vUnspentPaged;
+    std::vector<size_t> vPageSizes;
+    CAddressUnspentCompactKey keyUnspentAfter;
+    fAfter = false;
+    fMore = true;
+    while (fMore) {
+        std::vector<UnspentEntry> vPage;
+        CAddressUnspentCompactKey keyUnspentLast;
+        BOOST_CHECK(blocktree.ReadAddressUnspentIndexPage(hashAddress, 1, "", fAfter ? &keyUnspentAfter : nullptr, 3, vPage, keyUnspentLast, fMore));
+        vPageSizes.push_back(vPage.size());
+        vUnspentPaged.insert(vUnspentPaged.end(), vPage.begin(), vPage.end());
+        keyUnspentAfter = keyUnspentLast;
+        fAfter = true;
+        BOOST_REQUIRE(vPageSizes.size() <= 7);
+    }
+    BOOST_CHECK(vPageSizes == std::vector<size_t>({3, 3, 1}));
+    CheckUnspentEntries(vUnspentPaged, vUnspentExpected);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_merged_read_test)
+{
+    AssetsDBSetup setup;
+    CBlockTreeDB blocktree(1 << 20, true);
+
+    std::vector<std::pair<uint160, int> > vAddresses;
+    for (int i = 0; i < 3; i++)
+        vAddresses.emplace_back(uint160(std::vector<unsigned char>(20, i + 1)), 1 + i % 2);
+
+    // Every address gets entries at its own heights, and all of them share the transactions at heights 4 and 8
+    std::vector<IndexEntry> vWrite;
+    std::map<int, uint256> mapTxid;
+    for (int nHeight = 1; nHeight <= 12; nHeight++) {
+        mapTxid[nHeight] = InsecureRand256();
+        for (size_t i = 0; i < vAddresses.size(); i++) {
+            if (nHeight % 4 != 0 && nHeight % 3 != (int)i)
+                continue;
+            vWrite.push_back({CAddressIndexKey(vAddresses[i].second, vAddresses[i].first, nHeight, 2, mapTxid[nHeight], i, false), nHeight * COIN});
+            vWrite.push_back({CAddressIndexKey(vAddresses[i].second, vAddresses[i].first, "ZETA", nHeight, 2, mapTxid[nHeight], 9, false), COIN});
+        }
+    }
+    // Write them out of order, the index doesn't care
+    std::reverse(vWrite.begin(), vWrite.end());
+    BOOST_CHECK(blocktree.WriteAddressIndex(vWrite));
+
+    auto expected = [&](int start, int end) {
+        std::vector<IndexEntry> vExpected;
+        for (int nHeight = 1; nHeight <= 12; nHeight++) {
+            if (start > 0 && (nHeight < start || nHeight > end))
+                continue;
+            for (size_t i = 0; i < vAddresses.size(); i++) {
+                if (nHeight % 4 == 0 || nHeight % 3 == (int)i)
+                    vExpected.push_back({CAddressIndexKey(vAddresses[i].second, vAddresses[i].first, nHeight, 2, mapTxid[nHeight], i, false), nHeight * COIN});
+            }
+        }
+        return vExpected;
+    };
+
+    std::vector<IndexEntry> vRead;
+    BOOST_CHECK(blocktree.ReadAddressIndex(vAddresses, BLAST, vRead));
+    CheckIndexEntries(vRead, expected(0, 0));
+
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(vAddresses, BLAST, vRead, 4, 9));
+    CheckIndexEntries(vRead, expected(4, 9));
+
+    // A single address reads the same as before
+    std::vector<IndexEntry> vSingle;
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(vAddresses[1].first, vAddresses[1].second, BLAST, vSingle));
+    BOOST_CHECK(blocktree.ReadAddressIndex({vAddresses[1]}, BLAST, vRead));
+    CheckIndexEntries(vRead, vSingle);
+
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(vAddresses, "ZETA", vRead));
+    BOOST_CHECK_EQUAL(vRead.size(), expected(0, 0).size());
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(vAddresses, "UNKNOWN", vRead));
+    BOOST_CHECK(vRead.empty());
+
+    // Unspent outputs of several addresses come back address by address
+    std::vector<UnspentEntry> vUnspent;
+    for (size_t i = 0; i < vAddresses.size(); i++)
+        vUnspent.push_back({CAddressUnspentKey(vAddresses[i].second, vAddresses[i].first, BLAST, InsecureRand256(), 0), CAddressUnspentValue(i + 1, CScript(), i)});
+    BOOST_CHECK(blocktree.UpdateAddressUnspentIndex(vUnspent));
+    std::vector<UnspentEntry> vReadUnspent;
+    BOOST_CHECK(blocktree.ReadAddressUnspentIndex(vAddresses, BLAST, vReadUnspent));
+    CheckUnspentEntries(vReadUnspent, vUnspent);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_balance_test)
+{
+    AssetsDBSetup setup;
+    CBlockTreeDB blocktree(1 << 20, true);
+
+    uint160 hashAddress = uint160(ParseHex("00112233445566778899aabbccddeeff00112233"));
+    uint256 txid1 = InsecureRand256();
+    uint256 txid2 = InsecureRand256();
+    uint256 txid3 = InsecureRand256();
+
+    // Block 1 pays the address twice in one transaction plus some of an asset, block 2 spends from it
+    std::vector<IndexEntry> vBlock1 = {
+        {CAddressIndexKey(1, hashAddress, 1, 0, txid1, 0, false), 50 * COIN},
+        {CAddressIndexKey(1, hashAddress, 1, 0, txid1, 1, false), 25 * COIN},
+        {CAddressIndexKey(1, hashAddress, "ZETA", 1, 1, txid2, 0, false), 10 * COIN},
+    };
+    std::vector<IndexEntry> vBlock2 = {
+        {CAddressIndexKey(1, hashAddress, 2, 3, txid3, 0, true), -50 * COIN},
+        {CAddressIndexKey(1, hashAddress, 2, 3, txid3, 1, false), 5 * COIN},
+    };
+    uint256 hashBlock1 = InsecureRand256();
+    uint256 hashBlock2 = InsecureRand256();
+
+    BOOST_CHECK(blocktree.WriteAddressIndex(vBlock1));
+    BOOST_CHECK(blocktree.UpdateAddressBalances(vBlock1, false, hashBlock1));
+    BOOST_CHECK(blocktree.WriteAddressIndex(vBlock2));
+    BOOST_CHECK(blocktree.UpdateAddressBalances(vBlock2, false, hashBlock2));
+
+    uint256 hashBalances;
+    BOOST_CHECK(blocktree.ReadAddressBalanceBestBlock(hashBalances));
+    BOOST_CHECK(hashBalances == hashBlock2);
+
+    auto checkBalances = [&](CAmount nBlast, CAmount nBlastReceived, uint64_t nBlastTxs, bool fAsset) {
+        CAddressBalanceValue balance;
+        BOOST_CHECK(blocktree.ReadAddressBalance(hashAddress, 1, BLAST, balance));
+        BOOST_CHECK_EQUAL(balance.balance, nBlast);
+        BOOST_CHECK_EQUAL(balance.received, nBlastReceived);
+        BOOST_CHECK_EQUAL(balance.txcount, nBlastTxs);
+
+        std::vector<std::pair<std::string, CAddressBalanceValue> > vBalances;
+        BOOST_CHECK(blocktree.ReadAddressBalances(hashAddress, 1, vBalances));
+        BOOST_REQUIRE_EQUAL(vBalances.size(), fAsset ? 2U : 1U);
+        BOOST_CHECK_EQUAL(vBalances[0].first, BLAST);
+        BOOST_CHECK_EQUAL(vBalances[0].second.balance, nBlast);
+        if (fAsset) {
+            BOOST_CHECK_EQUAL(vBalances[1].first, "ZETA");
+            BOOST_CHECK_EQUAL(vBalances[1].second.balance, 10 * COIN);
+            BOOST_CHECK_EQUAL(vBalances[1].second.received, 10 * COIN);
+            BOOST_CHECK_EQUAL(vBalances[1].second.txcount, 1U);
+        }
+    };
+    checkBalances(30 * COIN, 80 * COIN, 2, true);
+
+    // Rebuilding from the index comes to the same totals, and can stop at an earlier height
+    BOOST_CHECK(blocktree.RebuildAddressBalances(2, hashBlock2));
+    checkBalances(30 * COIN, 80 * COIN, 2, true);
+    BOOST_CHECK(blocktree.RebuildAddressBalances(1, hashBlock1));
+    checkBalances(75 * COIN, 75 * COIN, 1, true);
+    BOOST_CHECK(blocktree.UpdateAddressBalances(vBlock2, false, hashBlock2));
+
+    // Disconnecting both blocks leaves nothing behind
+    BOOST_CHECK(blocktree.UpdateAddressBalances(vBlock2, true, hashBlock1));
+    checkBalances(75 * COIN, 75 * COIN, 1, true);
+    BOOST_CHECK(blocktree.UpdateAddressBalances(vBlock1, true, uint256()));
+    std::vector<std::pair<std::string, CAddressBalanceValue> > vBalances;
+    BOOST_CHECK(blocktree.ReadAddressBalances(hashAddress, 1, vBalances));
+    BOOST_CHECK(vBalances.empty());
+
+    BOOST_CHECK(blocktree.RebuildAddressBalances(0, hashBlock1));
+    CAddressBalanceValue balance;
+    BOOST_CHECK(blocktree.ReadAddressBalance(hashAddress, 1, BLAST, balance));
+    BOOST_CHECK(balance.IsNull());
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_disconnect_p2pk_test, TestChain100Setup)
+{
+    AssetsDBSetup setup;
+    const CChainParams& chainparams = Params();
+    bool fAddressIndexOld = fAddressIndex;
+    fAddressIndex = true;
+
+    // Spend the first coinbase, which pays to the public key itself
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    uint160 hashPubKey = coinbaseKey.GetPubKey().GetID();
+    const CTxOut& spent = coinbaseTxns[0].vout[0];
+    BOOST_REQUIRE(spent.scriptPubKey == scriptPubKey);
+
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.emplace_back(COutPoint(coinbaseTxns[0].GetHash(), 0));
+    spend.vout.emplace_back(spent.nValue - CENT, AddressScript(uint160(ParseHex("00112233445566778899aabbccddeeff00112233"))));
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+
+    CBlock block = CreateAndProcessBlock({spend}, scriptPubKey);
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block.GetHash());
+
+    std::vector<IndexEntry> vIndex;
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hashPubKey, 1, vIndex));
+    BOOST_CHECK_EQUAL(std::count_if(vIndex.begin(), vIndex.end(), [](const IndexEntry& entry) { return entry.first.spending; }), 1);
+
+    // Disconnecting the block takes the spend out of the index and puts the coin back in the unspent index
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, chainparams, chainActive.Tip()));
+    }
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state, chainparams));
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block.hashPrevBlock);
+
+    vIndex.clear();
+    BOOST_CHECK(pblocktree->ReadAddressIndex(hashPubKey, 1, vIndex));
+    BOOST_CHECK(vIndex.empty());
+
+    std::vector<UnspentEntry> vUnspent;
+    BOOST_CHECK(pblocktree->ReadAddressUnspentIndex(hashPubKey, 1, vUnspent));
+    CheckUnspentEntries(vUnspent, {
+        {CAddressUnspentKey(1, hashPubKey, coinbaseTxns[0].GetHash(), 0), CAddressUnspentValue(spent.nValue, scriptPubKey, 1)},
+    });
+
+    fAddressIndex = fAddressIndexOld;
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_balance_out_of_step_test, TestChain100Setup)
+{
+    AssetsDBSetup setup;
+    const CChainParams& chainparams = Params();
+    bool fAddressIndexOld = fAddressIndex;
+    fAddressIndex = true;
+
+    // The balances are brought up to the tip at startup
+    uint256 hashBalances;
+    BOOST_CHECK(LoadAddressBalances(chainparams));
+    BOOST_CHECK(pblocktree->ReadAddressBalanceBestBlock(hashBalances));
+    BOOST_CHECK(hashBalances == chainActive.Tip()->GetBlockHash());
+
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    uint160 hashPubKey = coinbaseKey.GetPubKey().GetID();
+    CBlock block1 = CreateAndProcessBlock({}, scriptPubKey);
+    CAmount nValue = block1.vtx[0]->vout[0].nValue;
+    CAddressBalanceValue balance;
+    BOOST_CHECK(GetAddressBalance(hashPubKey, 1, BLAST, balance));
+    BOOST_CHECK_EQUAL(balance.balance, nValue);
+    BOOST_CHECK_EQUAL(balance.txcount, 1U);
+
+    // Connecting a block on balances that are behind only marks them for a rebuild
+    BOOST_CHECK(pblocktree->Write('d', chainActive[50]->GetBlockHash()));
+    CBlock block2 = CreateAndProcessBlock({}, scriptPubKey);
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block2.GetHash());
+    BOOST_CHECK(!pblocktree->ReadAddressBalanceBestBlock(hashBalances));
+
+    // Until then they are summed up from the address index
+    CAmount nTotal = nValue + block2.vtx[0]->vout[0].nValue;
+    BOOST_CHECK(GetAddressBalance(hashPubKey, 1, BLAST, balance));
+    BOOST_CHECK_EQUAL(balance.balance, nTotal);
+    BOOST_CHECK_EQUAL(balance.received, nTotal);
+    BOOST_CHECK_EQUAL(balance.txcount, 2U);
+    std::vector<std::pair<std::string, CAddressBalanceValue> > vBalances;
+    BOOST_CHECK(GetAddressBalances(hashPubKey, 1, vBalances));
+    BOOST_REQUIRE_EQUAL(vBalances.size(), 1U);
+    BOOST_CHECK_EQUAL(vBalances[0].first, BLAST);
+    BOOST_CHECK_EQUAL(vBalances[0].second.balance, nTotal);
+
+    // And the next startup rebuilds them
+    BOOST_CHECK(LoadAddressBalances(chainparams));
+    BOOST_CHECK(pblocktree->ReadAddressBalanceBestBlock(hashBalances));
+    BOOST_CHECK(hashBalances == chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK(GetAddressBalance(hashPubKey, 1, BLAST, balance));
+    BOOST_CHECK_EQUAL(balance.balance, nTotal);
+    BOOST_CHECK_EQUAL(balance.txcount, 2U);
+
+    fAddressIndex = fAddressIndexOld;
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_upgrade_test)
+{
+    AssetsDBSetup setup;
+    CBlockTreeDB blocktree(1 << 20, true);
+
+    uint160 hashAddress = uint160(ParseHex("00112233445566778899aabbccddeeff00112233"));
+    CScript script = AddressScript(hashAddress);
+
+    // Records in the original layout, as written before the compact keys
+    std::vector<IndexEntry> vIndex;
+    std::vector<UnspentEntry> vUnspent;
+    for (int i = 0; i < 200; i++) {
+        uint256 txid = InsecureRand256();
+        std::string assetName = i % 3 ? BLAST : "MIGRATED";
+        vIndex.push_back({CAddressIndexKey(1, hashAddress, assetName, i, i % 7, txid, 0, false), (i + 1) * COIN});
+        vIndex.push_back({CAddressIndexKey(1, hashAddress, assetName, i, i % 7, txid, 1, true), -i});
+        vUnspent.push_back({CAddressUnspentKey(1, hashAddress, assetName, txid, 0), CAddressUnspentValue((i + 1) * COIN, script, i)});
+    }
+    for (const auto& entry : vIndex)
+        BOOST_CHECK(blocktree.Write(std::make_pair('a', entry.first), entry.second));
+    for (const auto& entry : vUnspent)
+        BOOST_CHECK(blocktree.Write(std::make_pair('u', entry.first), entry.second));
+
+    BOOST_CHECK(blocktree.UpgradeAddressIndex());
+    BOOST_CHECK(!blocktree.Exists(std::make_pair('a', vIndex[0].first)));
+    BOOST_CHECK(!blocktree.Exists(std::make_pair('u', vUnspent[0].first)));
+    bool fCompact = false;
+    BOOST_CHECK(blocktree.ReadFlag("addressindexv2", fCompact) && fCompact);
+
+    // Asset names sort by length first, as in the original keys
+    std::vector<IndexEntry> vExpected;
+    for (const std::string& assetName : {BLAST, std::string("MIGRATED")}) {
+        for (const auto& entry : vIndex)
+            if (entry.first.asset == assetName)
+                vExpected.push_back(entry);
+    }
+    std::vector<IndexEntry> vRead;
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashAddress, 1, vRead));
+    CheckIndexEntries(vRead, vExpected);
+
+    std::vector<UnspentEntry> vExpectedUnspent;
+    for (const auto& entry : vUnspent)
+        if (entry.first.asset != BLAST)
+            vExpectedUnspent.push_back(entry);
+    std::sort(vExpectedUnspent.begin(), vExpectedUnspent.end(), [](const UnspentEntry& a, const UnspentEntry& b) { return a.first.txhash < b.first.txhash; });
+    std::vector<UnspentEntry> vReadUnspent;
+    BOOST_CHECK(blocktree.ReadAddressUnspentIndex(hashAddress, 1, vReadUnspent));
+    CheckUnspentEntries(vReadUnspent, vExpectedUnspent);
+
+    // Running it again is a no-op
+    BOOST_CHECK(blocktree.UpgradeAddressIndex());
+    vRead.clear();
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashAddress, 1, vRead));
+    BOOST_CHECK_EQUAL(vRead.size(), vExpected.size());
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_block_entries_test)
+{
+    bool fAddressIndexOld = fAddressIndex;
+    bool fSpentIndexOld = fSpentIndex;
+    fAddressIndex = true;
+    fSpentIndex = true;
+
+    uint160 hashPayee = uint160(ParseHex("00112233445566778899aabbccddeeff00112233"));
+    uint160 hashScript = uint160(ParseHex("ffeeddccbbaa99887766554433221100ffeeddcc"));
+    CScript scriptP2SH = CScript() << OP_HASH160 << ToByteVector(hashScript) << OP_EQUAL;
+
+    // A coinbase and a transaction spending a pay to script hash output to the same address
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.emplace_back(50 * COIN, AddressScript(hashPayee));
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(InsecureRand256(), 3));
+    spend.vout.emplace_back(29 * COIN, AddressScript(hashPayee));
+    spend.vout.emplace_back(0, CScript() << OP_RETURN);
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    block.vtx.push_back(MakeTransactionRef(spend));
+    const uint256 cbhash = block.vtx[0]->GetHash();
+    const uint256 txhash = block.vtx[1]->GetHash();
+
+    CBlockUndo blockundo;
+    blockundo.vtxundo.resize(1);
+    blockundo.vtxundo[0].vprevout.emplace_back(CTxOut(30 * COIN, scriptP2SH), 7, false);
+
+    CBlockIndexEntries entries;
+    GetBlockIndexEntries(block, blockundo, 12, false, entries);
+
+    CheckIndexEntries(entries.addressIndex, {
+        {CAddressIndexKey(1, hashPayee, 12, 0, cbhash, 0, false), 50 * COIN},
+        {CAddressIndexKey(2, hashScript, 12, 1, txhash, 0, true), -30 * COIN},
+        {CAddressIndexKey(1, hashPayee, 12, 1, txhash, 0, false), 29 * COIN},
+    });
+
+    BOOST_REQUIRE_EQUAL(entries.addressUnspentIndex.size(), 3U);
+    BOOST_CHECK(entries.addressUnspentIndex[0].first.txhash == cbhash);
+    BOOST_CHECK_EQUAL(entries.addressUnspentIndex[0].second.satoshis, 50 * COIN);
+    BOOST_CHECK_EQUAL(entries.addressUnspentIndex[0].second.blockHeight, 12);
+    BOOST_CHECK(entries.addressUnspentIndex[1].first.hashBytes == hashScript);
+    BOOST_CHECK(entries.addressUnspentIndex[1].first.txhash == spend.vin[0].prevout.hash);
+    BOOST_CHECK_EQUAL(entries.addressUnspentIndex[1].first.index, 3U);
+    BOOST_CHECK(entries.addressUnspentIndex[1].second.IsNull());
+    BOOST_CHECK(entries.addressUnspentIndex[2].first.txhash == txhash);
+
+    BOOST_REQUIRE_EQUAL(entries.spentIndex.size(), 1U);
+    BOOST_CHECK(entries.spentIndex[0].first.txid == spend.vin[0].prevout.hash);
+    BOOST_CHECK_EQUAL(entries.spentIndex[0].first.outputIndex, 3U);
+    BOOST_CHECK(entries.spentIndex[0].second.txid == txhash);
+    BOOST_CHECK_EQUAL(entries.spentIndex[0].second.satoshis, 30 * COIN);
+    BOOST_CHECK_EQUAL(entries.spentIndex[0].second.addressType, 2);
+    BOOST_CHECK(entries.spentIndex[0].second.addressHash == hashScript);
+
+    fAddressIndex = fAddressIndexOld;
+    fSpentIndex = fSpentIndexOld;
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_builder_batch_test)
+{
+    AssetsDBSetup setup;
+    CBlockTreeDB blocktree(1 << 20, true);
+
+    uint160 hashAddress = uint160(ParseHex("00112233445566778899aabbccddeeff00112233"));
+    uint256 txid = InsecureRand256();
+    uint256 hashBlock = InsecureRand256();
+
+    uint256 hashBest;
+    BOOST_CHECK(!blocktree.ReadIndexBuilderBestBlock(hashBest));
+    BOOST_CHECK(blocktree.WriteIndexBuilderBestBlock(uint256()));
+    BOOST_CHECK(blocktree.ReadIndexBuilderBestBlock(hashBest));
+    BOOST_CHECK(hashBest.IsNull());
+
+    std::vector<IndexEntry> vIndex = {{CAddressIndexKey(1, hashAddress, 5, 1, txid, 0, false), 3 * COIN}};
+    std::vector<UnspentEntry> vUnspent = {{CAddressUnspentKey(1, hashAddress, txid, 0), CAddressUnspentValue(3 * COIN, AddressScript(hashAddress), 5)}};
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > vSpent = {
+        {CSpentIndexKey(InsecureRand256(), 1), CSpentIndexValue(txid, 0, 5, 4 * COIN, 1, hashAddress)},
+    };
+    std::vector<std::pair<uint256, unsigned int> > vTimestamps = {{hashBlock, 1234}};
+    BOOST_CHECK(blocktree.WriteIndexBuilderBatch(vIndex, vUnspent, vSpent, vTimestamps, hashBlock));
+
+    // Everything lands together with the block the builder reached
+    BOOST_CHECK(blocktree.ReadIndexBuilderBestBlock(hashBest));
+    BOOST_CHECK(hashBest == hashBlock);
+    std::vector<IndexEntry> vRead;
+    BOOST_CHECK(blocktree.ReadAddressIndex(hashAddress, 1, vRead));
+    CheckIndexEntries(vRead, vIndex);
+    std::vector<UnspentEntry> vReadUnspent;
+    BOOST_CHECK(blocktree.ReadAddressUnspentIndex(hashAddress, 1, BLAST, vReadUnspent));
+    BOOST_REQUIRE_EQUAL(vReadUnspent.size(), 1U);
+    BOOST_CHECK_EQUAL(vReadUnspent[0].second.satoshis, 3 * COIN);
+    CSpentIndexKey spentKey = vSpent[0].first;
+    CSpentIndexValue spentValue;
+    BOOST_CHECK(blocktree.ReadSpentIndex(spentKey, spentValue));
+    BOOST_CHECK(spentValue.txid == txid);
+    unsigned int logicalTS = 0;
+    BOOST_CHECK(blocktree.ReadTimestampBlockIndex(hashBlock, logicalTS));
+    BOOST_CHECK_EQUAL(logicalTS, 1234U);
+
+    BOOST_CHECK(blocktree.EraseIndexBuilderBestBlock());
+    BOOST_CHECK(!blocktree.ReadIndexBuilderBestBlock(hashBest));
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_timestamp_test)
+{
+    // The timestamp index answers main chain range queries by itself
+    CBlockTreeDB blocktree(1 << 20, true);
+    uint256 hash1 = InsecureRand256();
+    uint256 hash2 = InsecureRand256();
+    uint256 hash3 = InsecureRand256();
+    BOOST_CHECK(blocktree.WriteTimestampIndex(CTimestampIndexKey(100, hash1), CTimestampIndexValue(true)));
+    BOOST_CHECK(blocktree.WriteTimestampIndex(CTimestampIndexKey(200, hash2), CTimestampIndexValue(true)));
+    BOOST_CHECK(blocktree.WriteTimestampIndex(CTimestampIndexKey(300, hash3), CTimestampIndexValue(true)));
+
+    // A disconnected block is only marked off the main chain
+    BOOST_CHECK(blocktree.WriteTimestampIndex(CTimestampIndexKey(200, hash2), CTimestampIndexValue(false)));
+
+    std::vector<std::pair<uint256, unsigned int> > vHashes;
+    BOOST_CHECK(blocktree.ReadTimestampIndex(301, 100, true, vHashes));
+    BOOST_REQUIRE_EQUAL(vHashes.size(), 2U);
+    BOOST_CHECK(vHashes[0].first == hash1);
+    BOOST_CHECK_EQUAL(vHashes[0].second, 100U);
+    BOOST_CHECK(vHashes[1].first == hash3);
+    vHashes.clear();
+    BOOST_CHECK(blocktree.ReadTimestampIndex(300, 101, false, vHashes));
+    BOOST_REQUIRE_EQUAL(vHashes.size(), 1U);
+    BOOST_CHECK(vHashes[0].first == hash2);
+
+    // Streaming stops as soon as the callback asks to
+    int nCalls = 0;
+    BOOST_CHECK(blocktree.ReadTimestampIndex(1000, 0, false, [&nCalls](const uint256& hash, unsigned int timestamp) {
+        return ++nCalls < 2;
+    }));
+    BOOST_CHECK_EQUAL(nCalls, 2);
+
+    // Entries of older versions are marked from the active chain when upgrading
+    uint256 hashMain = InsecureRand256();
+    uint256 hashFork = InsecureRand256();
+    BOOST_CHECK(blocktree.Write(std::make_pair('s', CTimestampIndexKey(400, hashMain)), 0));
+    BOOST_CHECK(blocktree.Write(std::make_pair('s', CTimestampIndexKey(500, hashFork)), 0));
+    CBlockIndex index;
+    BlockMap::iterator mi = mapBlockIndex.emplace(hashMain, &index).first;
+    index.phashBlock = &mi->first;
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(&index);
+        BOOST_CHECK(blocktree.UpgradeTimestampIndex());
+        chainActive.SetTip(nullptr);
+    }
+    mapBlockIndex.erase(mi);
+
+    vHashes.clear();
+    BOOST_CHECK(blocktree.ReadTimestampIndex(1000, 301, true, vHashes));
+    BOOST_REQUIRE_EQUAL(vHashes.size(), 1U);
+    BOOST_CHECK(vHashes[0].first == hashMain);
+    vHashes.clear();
+    BOOST_CHECK(blocktree.ReadTimestampIndex(1000, 301, false, vHashes));
+    BOOST_CHECK_EQUAL(vHashes.size(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_spent_compact_test)
+{
+    CBlockTreeDB blocktree(1 << 20, true);
+    uint160 hashAddress = uint160(ParseHex("00112233445566778899aabbccddeeff00112233"));
+    uint256 txid = InsecureRand256();
+    CSpentIndexKey key(txid, 3);
+    CSpentIndexValue value(InsecureRand256(), 2, 1000, 12 * COIN, 1, hashAddress);
+
+    // An outpoint with the same output index and a txid differing in one early byte, spent in the same block
+    uint256 txidShared = txid;
+    *(txidShared.begin() + 9) ^= 1;
+    CSpentIndexKey keyShared(txidShared, 3);
+    CSpentIndexValue valueShared(InsecureRand256(), 0, 1000, 5, 0, uint160());
+
+    // And one that only differs from it in the last byte of the txid
+    uint256 txidLate = txid;
+    *(txidLate.end() - 1) ^= 1;
+    CSpentIndexKey keyLate(txidLate, 3);
+    CSpentIndexValue valueLate(InsecureRand256(), 1, 1000, 7, 0, uint160());
+
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > vSpent = {{key, value}, {keyShared, valueShared}, {keyLate, valueLate}};
+    BOOST_CHECK(blocktree.UpdateSpentIndex(vSpent));
+
+    CSpentIndexValue valueRead;
+    BOOST_CHECK(blocktree.ReadSpentIndex(key, valueRead));
+    BOOST_CHECK(valueRead.txid == value.txid);
+    BOOST_CHECK_EQUAL(valueRead.inputIndex, 2U);
+    BOOST_CHECK_EQUAL(valueRead.blockHeight, 1000);
+    BOOST_CHECK_EQUAL(valueRead.satoshis, 12 * COIN);
+    BOOST_CHECK_EQUAL(valueRead.addressType, 1);
+    BOOST_CHECK(valueRead.addressHash == hashAddress);
+    BOOST_CHECK(blocktree.ReadSpentIndex(keyShared, valueRead));
+    BOOST_CHECK(valueRead.txid == valueShared.txid);
+    BOOST_CHECK_EQUAL(valueRead.satoshis, 5);
+    BOOST_CHECK(valueRead.addressHash.IsNull());
+    BOOST_CHECK(blocktree.ReadSpentIndex(keyLate, valueRead));
+    BOOST_CHECK(valueRead.txid == valueLate.txid);
+    BOOST_CHECK_EQUAL(valueRead.satoshis, 7);
+    CSpentIndexKey keyOther(txid, 4);
+    BOOST_CHECK(!blocktree.ReadSpentIndex(keyOther, valueRead));
+
+    // Disconnecting the block erases all of them
+    vSpent = {{key, CSpentIndexValue()}, {keyShared, CSpentIndexValue()}, {keyLate, CSpentIndexValue()}};
+    BOOST_CHECK(blocktree.UpdateSpentIndex(vSpent));
+    BOOST_CHECK(!blocktree.ReadSpentIndex(key, valueRead));
+    BOOST_CHECK(!blocktree.ReadSpentIndex(keyShared, valueRead));
+    BOOST_CHECK(!blocktree.ReadSpentIndex(keyLate, valueRead));
+
+    // Original entries take 109 bytes, compact ones 91 with an address hash and 71 without
+    size_t nOriginal = ::GetSerializeSize(std::make_pair('p', key), SER_DISK, CLIENT_VERSION) +
+                       ::GetSerializeSize(value, SER_DISK, CLIENT_VERSION);
+    size_t nCompact = ::GetSerializeSize(std::make_pair('P', CSpentIndexCompactKey(key)), SER_DISK, CLIENT_VERSION) +
+                      ::GetSerializeSize(CSpentIndexCompactValue(value), SER_DISK, CLIENT_VERSION);
+    size_t nCompactNoAddress = ::GetSerializeSize(std::make_pair('P', CSpentIndexCompactKey(keyShared)), SER_DISK, CLIENT_VERSION) +
+                               ::GetSerializeSize(CSpentIndexCompactValue(valueShared), SER_DISK, CLIENT_VERSION);
+    BOOST_CHECK_EQUAL(nOriginal, 109U);
+    BOOST_CHECK_EQUAL(nCompact, 91U);
+    BOOST_CHECK_EQUAL(nCompactNoAddress, 71U);
+}
+
+BOOST_AUTO_TEST_CASE(addressindex_spent_upgrade_test)
+{
+    // Entries of older versions are all moved to the compact index
+    CBlockTreeDB blocktree(1 << 20, true);
+    uint160 hashAddress = uint160(ParseHex("00112233445566778899aabbccddeeff00112233"));
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > vSpent;
+    for (int i = 0; i < 10; i++)
+        vSpent.emplace_back(CSpentIndexKey(InsecureRand256(), i), CSpentIndexValue(InsecureRand256(), i, 100 + i, i * COIN, 2, hashAddress));
+    uint256 txidShared = vSpent[0].first.txid;
+    *(txidShared.begin() + 8) ^= 1;
+    vSpent.emplace_back(CSpentIndexKey(txidShared, 0), CSpentIndexValue(InsecureRand256(), 1, 100, COIN, 0, uint160()));
+    for (const auto& entry : vSpent)
+        BOOST_CHECK(blocktree.Write(std::make_pair('p', entry.first), entry.second));
+
+    BOOST_CHECK(blocktree.UpgradeSpentIndex());
+    size_t nOriginal = 0;
+    for (const auto& entry : vSpent) {
+        CSpentIndexKey key = entry.first;
+        CSpentIndexValue valueRead;
+        BOOST_CHECK(blocktree.ReadSpentIndex(key, valueRead));
+        BOOST_CHECK(valueRead.txid == entry.second.txid);
+        BOOST_CHECK_EQUAL(valueRead.blockHeight, entry.second.blockHeight);
+        BOOST_CHECK_EQUAL(valueRead.satoshis, entry.second.satoshis);
+        BOOST_CHECK(valueRead.addressHash == entry.second.addressHash);
+        if (blocktree.Exists(std::make_pair('p', key)))
+            nOriginal++;
+    }
+    BOOST_CHECK_EQUAL(nOriginal, 0U);
+
+    // Done once
+    bool fCompact = false;
+    BOOST_CHECK(blocktree.ReadFlag("spentindexv2", fCompact) && fCompact);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,334 @@
+// Copyright (c) 2019 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <assets/assets.h>
+#include <assets/assetdb.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <validation.h>
+
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+
+BOOST_FIXTURE_TEST_SUITE(asset_dir_tests, TestingSetup)
+
+    // Reference listing in database key order: by name length, then bytewise
+    static std::vector<std::string> ExpectedDir(std::vector<std::string> names, const std::string& prefix, size_t count, long start)
+    {
+        std::vector<std::string> matching;
+        for (const auto& name : names)
+            if (name.compare(0, prefix.size(), prefix) == 0)
+                matching.push_back(name);
+        std::sort(matching.begin(), matching.end(), [](const std::string& a, const std::string& b) {
+            return a.size() < b.size() || (a.size() == b.size() && a < b);
+        });
+
+        long skip = start >= 0 ? start : std::max(0L, (long)matching.size() + start);
+        std::vector<std::string> result;
+        for (size_t i = skip; i < matching.size() && result.size() < count; i++)
+            result.push_back(matching[i]);
+        return result;
+    }
+
+    static std::vector<std::string> ListDir(CAssetsDB& db, const std::string& filter, size_t count, long start)
+    {
+        std::vector<CDatabasedAssetData> assets;
+        BOOST_CHECK(db.AssetDir(assets, filter, count, start));
+        std::vector<std::string> names;
+        for (const auto& data : assets)
+            names.push_back(data.asset.strName);
+        return names;
+    }
+
+    BOOST_AUTO_TEST_CASE(asset_dir_prefix_index_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Directory Prefix Index Test");
+
+        CAssetsDB db(1 << 20, true, true);
+        BOOST_CHECK(db.LoadAssets());
+
+        std::vector<std::string> names;
+        const std::string roots[] = {"FOO", "FOOBAR", "BAR", "BA", "FO"};
+        for (const auto& root : roots) {
+            for (int i = 0; i < 15; i++) {
+                std::string name = root + std::to_string(i * 7);
+                names.push_back(name);
+                BOOST_CHECK(db.WriteAssetData(CNewAsset(name, CAmount(i)), 1, uint256()));
+            }
+        }
+
+        // Overwriting an existing asset (as reissues do) must not change the counts
+        BOOST_CHECK(db.WriteAssetData(CNewAsset("FOO0", CAmount(100)), 2, uint256()));
+
+        const std::string prefixes[] = {"", "F", "FO", "FOO", "FOOB", "BA", "BAR1", "ZZZ"};
+        const long starts[] = {0, 1, 7, 30, 80, -1, -5, -200};
+        for (const auto& prefix : prefixes)
+            for (long start : starts)
+                BOOST_CHECK(ListDir(db, prefix + "*", 10, start) == ExpectedDir(names, prefix, 10, start));
+
+        // Exact matches
+        BOOST_CHECK(ListDir(db, "FOO7", 10, 0) == std::vector<std::string>{"FOO7"});
+        BOOST_CHECK(ListDir(db, "FOO8", 10, 0).empty());
+
+        // Erasing removes names from the listing and the counts
+        BOOST_CHECK(db.EraseAssetData("FOO14"));
+        BOOST_CHECK(db.EraseAssetData("FOO14"));
+        names.erase(std::find(names.begin(), names.end(), "FOO14"));
+        for (long start : starts)
+            BOOST_CHECK(ListDir(db, "FOO*", 5, start) == ExpectedDir(names, "FOO", 5, start));
+
+        // Rebuilding the index from scratch gives the same answers
+        BOOST_CHECK(db.BuildAssetPrefixIndex());
+        for (const auto& prefix : prefixes)
+            for (long start : starts)
+                BOOST_CHECK(ListDir(db, prefix + "*", 1000, start) == ExpectedDir(names, prefix, 1000, start));
+    }
+
+    BOOST_AUTO_TEST_CASE(asset_dir_dirty_overlay_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Directory Dirty Overlay Test");
+
+        CAssetsDB db(1 << 20, true, true);
+        BOOST_CHECK(db.LoadAssets());
+
+        std::vector<std::string> names;
+        for (int i = 0; i < 20; i++) {
+            std::string name = "ASSET" + std::to_string(i);
+            names.push_back(name);
+            BOOST_CHECK(db.WriteAssetData(CNewAsset(name, CAmount(i)), 1, uint256()));
+        }
+
+        // Changes that are still only in the global asset cache must show up without a flush
+        CAssetsCache* pcache = passets;
+        pcache->setNewAssetsToAdd.insert(CAssetCacheNewAsset(CNewAsset("ASSET3A", CAmount(1)), "", 2, uint256()));
+        pcache->setNewAssetsToAdd.insert(CAssetCacheNewAsset(CNewAsset("ASSET0", CAmount(1)), "", 2, uint256()));
+        pcache->setNewAssetsToRemove.insert(CAssetCacheNewAsset(CNewAsset("ASSET11", CAmount(1)), "", 2, uint256()));
+        pcache->setNewAssetsToRemove.insert(CAssetCacheNewAsset(CNewAsset("ASSET5", CAmount(1)), "", 2, uint256()));
+        names.push_back("ASSET3A");
+        names.erase(std::find(names.begin(), names.end(), "ASSET11"));
+        names.erase(std::find(names.begin(), names.end(), "ASSET5"));
+
+        for (long start = -25; start < 25; start++)
+            for (size_t count : {1, 3, 100})
+                BOOST_CHECK(ListDir(db, "ASSET*", count, start) == ExpectedDir(names, "ASSET", count, start));
+        BOOST_CHECK(ListDir(db, "ASSET5", 10, 0).empty());
+        BOOST_CHECK(ListDir(db, "ASSET3A", 10, 0) == std::vector<std::string>{"ASSET3A"});
+
+        pcache->ClearDirtyCache();
+    }
+
+    BOOST_AUTO_TEST_CASE(asset_holder_stats_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Holder Stats Test");
+
+        CAssetsDB db(1 << 20, true, true);
+
+        auto fnSetBalance = [&db](const std::string& asset, const std::string& address, CAmount amount) {
+            if (amount) {
+                BOOST_CHECK(db.WriteAssetAddressQuantity(asset, address, amount));
+                BOOST_CHECK(db.WriteAddressAssetQuantity(address, asset, amount));
+            } else {
+                BOOST_CHECK(db.EraseAssetAddressQuantity(asset, address));
+                BOOST_CHECK(db.EraseAddressAssetQuantity(address, asset));
+            }
+        };
+
+        fnSetBalance("GOLD", "addr1", 100);
+        fnSetBalance("GOLD", "addr2", 50);
+        fnSetBalance("GOLD", "addr1", 70);
+        fnSetBalance("SILVER", "addr1", 5);
+        fnSetBalance("SILVER", "addr3", 5);
+        fnSetBalance("SILVER", "addr3", 0);
+        fnSetBalance("SILVER", "addr3", 0);
+
+        // A stored zero balance is listed for the asset, so it counts as a holder as well
+        BOOST_CHECK(db.WriteAssetAddressQuantity("COPPER", "addr3", 0));
+        BOOST_CHECK(db.WriteAddressAssetQuantity("addr3", "COPPER", 0));
+
+        auto fnCheck = [&db]() {
+            CAssetHolderStats stats;
+            BOOST_CHECK(db.ReadAssetHolderStats("GOLD", stats));
+            BOOST_CHECK_EQUAL(stats.nHolders, 2U);
+            BOOST_CHECK_EQUAL(stats.nSupply, 120);
+            BOOST_CHECK(db.ReadAssetHolderStats("SILVER", stats));
+            BOOST_CHECK_EQUAL(stats.nHolders, 1U);
+            BOOST_CHECK_EQUAL(stats.nSupply, 5);
+            BOOST_CHECK(db.ReadAssetHolderStats("COPPER", stats));
+            BOOST_CHECK_EQUAL(stats.nHolders, 1U);
+            BOOST_CHECK_EQUAL(stats.nSupply, 0);
+            BOOST_CHECK(db.ReadAssetHolderStats("BRONZE", stats));
+            BOOST_CHECK_EQUAL(stats.nHolders, 0U);
+
+            uint32_t nCount;
+            BOOST_CHECK(db.ReadAddressAssetCount("addr1", nCount));
+            BOOST_CHECK_EQUAL(nCount, 2U);
+            BOOST_CHECK(db.ReadAddressAssetCount("addr3", nCount));
+            BOOST_CHECK_EQUAL(nCount, 1U);
+        };
+        fnCheck();
+
+        // Rebuilding from the balance index gives the same totals
+        BOOST_CHECK(db.BuildAssetHolderStats());
+        fnCheck();
+    }
+
+    BOOST_AUTO_TEST_CASE(asset_db_batch_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset DB Batch Test");
+
+        CAssetsDB db(1 << 20, true, true);
+        BOOST_CHECK(db.WriteAssetData(CNewAsset("GOLD", CAmount(1)), 1, uint256()));
+        BOOST_CHECK(db.WriteAssetAddressQuantity("GOLD", "addr1", 10));
+        BOOST_CHECK(db.WriteAddressAssetQuantity("addr1", "GOLD", 10));
+
+        // Several changes to the same keys within one batch must compose
+        CAssetsDBBatch batch(db);
+        batch.WriteAssetData(CNewAsset("SILVER", CAmount(1)), 2, uint256());
+        batch.WriteAssetData(CNewAsset("SILVER", CAmount(2)), 2, uint256());
+        batch.EraseAssetData("GOLD");
+        batch.WriteAssetData(CNewAsset("GOLD", CAmount(3)), 2, uint256());
+        batch.WriteAssetData(CNewAsset("COPPER", CAmount(1)), 2, uint256());
+        batch.EraseAssetData("COPPER");
+
+        batch.EraseAssetAddressQuantity("GOLD", "addr1");
+        batch.EraseAddressAssetQuantity("addr1", "GOLD");
+        batch.WriteAssetAddressQuantity("GOLD", "addr1", 4);
+        batch.WriteAddressAssetQuantity("addr1", "GOLD", 4);
+        batch.WriteAssetAddressQuantity("GOLD", "addr2", 6);
+        batch.WriteAddressAssetQuantity("addr2", "GOLD", 6);
+        batch.WriteAssetAddressQuantity("SILVER", "addr2", 1);
+        batch.WriteAddressAssetQuantity("addr2", "SILVER", 1);
+        batch.EraseAssetAddressQuantity("SILVER", "addr2");
+        batch.EraseAddressAssetQuantity("addr2", "SILVER");
+
+        uint256 hashBest = uint256S("0x1234");
+        batch.WriteBestBlock(hashBest);
+
+        // Nothing is visible before the commit
+        uint256 hashRead;
+        BOOST_CHECK(!db.ReadBestBlock(hashRead));
+        BOOST_CHECK(ListDir(db, "*", 10, 0) == std::vector<std::string>{"GOLD"});
+
+        BOOST_CHECK(batch.Commit());
+        BOOST_CHECK(db.ReadBestBlock(hashRead));
+        BOOST_CHECK(hashRead == hashBest);
+        BOOST_CHECK(ListDir(db, "*", 10, 0) == (std::vector<std::string>{"GOLD", "SILVER"}));
+        for (long start : {-2, -1, 0, 1})
+            BOOST_CHECK(ListDir(db, "*", 10, start) == ExpectedDir({"GOLD", "SILVER"}, "", 10, start));
+
+        CAssetHolderStats stats;
+        BOOST_CHECK(db.ReadAssetHolderStats("GOLD", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 2U);
+        BOOST_CHECK_EQUAL(stats.nSupply, 10);
+        BOOST_CHECK(db.ReadAssetHolderStats("SILVER", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 0U);
+        BOOST_CHECK_EQUAL(stats.nSupply, 0);
+
+        uint32_t nCount;
+        BOOST_CHECK(db.ReadAddressAssetCount("addr1", nCount));
+        BOOST_CHECK_EQUAL(nCount, 1U);
+        BOOST_CHECK(db.ReadAddressAssetCount("addr2", nCount));
+        BOOST_CHECK_EQUAL(nCount, 1U);
+
+        // The maintained counters match a rebuild from scratch
+        BOOST_CHECK(db.BuildAssetPrefixIndex());
+        BOOST_CHECK(db.BuildAssetHolderStats());
+        BOOST_CHECK(ListDir(db, "*", 10, -1) == std::vector<std::string>{"SILVER"});
+        BOOST_CHECK(db.ReadAssetHolderStats("GOLD", stats));
+        BOOST_CHECK_EQUAL(stats.nHolders, 2U);
+        BOOST_CHECK(db.ReadAddressAssetCount("addr2", nCount));
+        BOOST_CHECK_EQUAL(nCount, 1U);
+    }
+
+    BOOST_AUTO_TEST_CASE(asset_name_ids_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Name Ids Test");
+
+        CAssetsDB db(1 << 20, true, true);
+        BOOST_CHECK(db.LoadAssets());
+        BOOST_CHECK_EQUAL(assetNameTable.Size(), 0U);
+
+        // Ids are handed out in order and don't change when an asset is written again
+        BOOST_CHECK(db.WriteAssetData(CNewAsset("GOLD", CAmount(1)), 1, uint256()));
+        BOOST_CHECK(db.WriteAssetData(CNewAsset("SILVER", CAmount(1)), 1, uint256()));
+        BOOST_CHECK(db.WriteAssetData(CNewAsset("GOLD", CAmount(2)), 2, uint256()));
+        uint32_t id;
+        BOOST_CHECK(db.ReadAssetId("GOLD", id));
+        BOOST_CHECK_EQUAL(id, 1U);
+        BOOST_CHECK(db.ReadAssetId("SILVER", id));
+        BOOST_CHECK_EQUAL(id, 2U);
+        BOOST_CHECK_EQUAL(assetNameTable.Name(2), "SILVER");
+
+        // Names interned in memory are only persisted with the next write
+        BOOST_CHECK_EQUAL(assetNameTable.GetOrAssign("COPPER"), 3U);
+        BOOST_CHECK(!db.ReadAssetId("COPPER", id));
+        BOOST_CHECK(db.EraseAssetData("SILVER"));
+        BOOST_CHECK(db.ReadAssetId("COPPER", id));
+        BOOST_CHECK_EQUAL(id, 3U);
+        BOOST_CHECK_EQUAL(assetNameTable.GetUnpersisted().size(), 0U);
+
+        // Erased assets keep their id, and everything reloads to the same ids
+        BOOST_CHECK(db.LoadAssetNames());
+        BOOST_CHECK_EQUAL(assetNameTable.Size(), 3U);
+        BOOST_CHECK(assetNameTable.GetId("SILVER", id));
+        BOOST_CHECK_EQUAL(id, 2U);
+        BOOST_CHECK_EQUAL(assetNameTable.GetOrAssign("COPPER"), 3U);
+        BOOST_CHECK_EQUAL(assetNameTable.GetOrAssign("TIN"), 4U);
+    }
+
+    BOOST_FIXTURE_TEST_CASE(asset_db_replay_test, TestChain100Setup)
+    {
+        BOOST_TEST_MESSAGE("Running Asset DB Replay Test");
+
+        const CChainParams& chainparams = Params();
+        struct AssetsDBSetup {
+            CAssetsDB db;
+            CAssetsDB* passetsdbOld;
+            AssetsDBSetup() : db(1 << 20, true, true), passetsdbOld(passetsdb) { passetsdb = &db; }
+            ~AssetsDBSetup() { passetsdb = passetsdbOld; }
+        } setup;
+
+        auto fnSetBestBlock = [&setup](const uint256& hash) {
+            CAssetsDBBatch batch(setup.db);
+            batch.WriteBestBlock(hash);
+            BOOST_CHECK(batch.Commit());
+        };
+        auto fnBestBlock = [&setup]() {
+            uint256 hash;
+            BOOST_CHECK(setup.db.ReadBestBlock(hash));
+            return hash;
+        };
+
+        // Nothing recorded yet, or recorded with the coins, leaves nothing to do
+        BOOST_CHECK(ReplayAssets(chainparams));
+        fnSetBestBlock(pcoinsTip->GetBestBlock());
+        BOOST_CHECK(ReplayAssets(chainparams));
+        BOOST_CHECK(fnBestBlock() == chainActive.Tip()->GetBlockHash());
+
+        // An asset flush that fell behind the coins is rolled forward to the tip
+        fnSetBestBlock(chainActive[90]->GetBlockHash());
+        BOOST_CHECK(ReplayAssets(chainparams));
+        BOOST_CHECK(fnBestBlock() == chainActive.Tip()->GetBlockHash());
+
+        // One on a block that was disconnected since is rolled back first
+        uint256 hashOldTip = chainActive.Tip()->GetBlockHash();
+        {
+            LOCK(cs_main);
+            CValidationState state;
+            BOOST_CHECK(InvalidateBlock(state, chainparams, chainActive.Tip()));
+        }
+        BOOST_CHECK(chainActive.Tip()->GetBlockHash() != hashOldTip);
+        fnSetBestBlock(hashOldTip);
+        BOOST_CHECK(ReplayAssets(chainparams));
+        BOOST_CHECK(fnBestBlock() == chainActive.Tip()->GetBlockHash());
+
+        // A block that isn't known can't be replayed from
+        fnSetBestBlock(uint256S("0x1234"));
+        BOOST_CHECK(!ReplayAssets(chainparams));
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,266 @@
+// Copyright (c) 2019 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <assets/assets.h>
+
+#include <test/test_bitcoin.h>
+#include <utilstrencodings.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <regex>
+
+/**
+ * The std::regex implementation of asset name validation that the hand written validator replaced. The
+ * validator has to accept and reject exactly the same names, with the same asset types and errors.
+ */
+namespace regex_reference {
+
+static const auto MAX_NAME_LENGTH = 31;
+static const auto MAX_CHANNEL_NAME_LENGTH = 12;
+
+static const std::regex ROOT_NAME_CHARACTERS("^[A-Z0-9._]{3,}$");
+static const std::regex SUB_NAME_CHARACTERS("^[A-Z0-9._]+$");
+static const std::regex UNIQUE_TAG_CHARACTERS("^[-A-Za-z0-9@$%&*()[\\]{}_.?:]+$");
+static const std::regex CHANNEL_TAG_CHARACTERS("^[A-Z0-9._]+$");
+static const std::regex VOTE_TAG_CHARACTERS("^[A-Z0-9._]+$");
+
+static const std::regex DOUBLE_PUNCTUATION("^.*[._]{2,}.*$");
+static const std::regex LEADING_PUNCTUATION("^[._].*$");
+static const std::regex TRAILING_PUNCTUATION("^.*[._]$");
+
+static const std::string SUB_NAME_DELIMITER = "/";
+static const std::string UNIQUE_TAG_DELIMITER = "#";
+static const std::string CHANNEL_TAG_DELIMITER = "~";
+static const std::string VOTE_TAG_DELIMITER = "^";
+
+static const std::regex UNIQUE_INDICATOR(R"(^[^^~#!]+#[^~#!\/]+$)");
+static const std::regex CHANNEL_INDICATOR(R"(^[^^~#!]+~[^~#!\/]+$)");
+static const std::regex OWNER_INDICATOR(R"(^[^^~#!]+!$)");
+static const std::regex VOTE_INDICATOR(R"(^[^^~#!]+\^[^~#!\/]+$)");
+
+static const std::regex BLAST_NAMES("^BLAST$|^BLASTCOIN$");
+
+bool IsRootNameValid(const std::string& name)
+{
+    return std::regex_match(name, ROOT_NAME_CHARACTERS)
+        && !std::regex_match(name, DOUBLE_PUNCTUATION)
+        && !std::regex_match(name, LEADING_PUNCTUATION)
+        && !std::regex_match(name, TRAILING_PUNCTUATION)
+        && !std::regex_match(name, BLAST_NAMES);
+}
+
+bool IsSubNameValid(const std::string& name)
+{
+    return std::regex_match(name, SUB_NAME_CHARACTERS)
+        && !std::regex_match(name, DOUBLE_PUNCTUATION)
+        && !std::regex_match(name, LEADING_PUNCTUATION)
+        && !std::regex_match(name, TRAILING_PUNCTUATION);
+}
+
+bool IsUniqueTagValid(const std::string& tag)
+{
+    return std::regex_match(tag, UNIQUE_TAG_CHARACTERS);
+}
+
+bool IsVoteTagValid(const std::string& tag)
+{
+    return std::regex_match(tag, VOTE_TAG_CHARACTERS);
+}
+
+bool IsChannelTagValid(const std::string& tag)
+{
+    return std::regex_match(tag, CHANNEL_TAG_CHARACTERS)
+        && !std::regex_match(tag, DOUBLE_PUNCTUATION)
+        && !std::regex_match(tag, LEADING_PUNCTUATION)
+        && !std::regex_match(tag, TRAILING_PUNCTUATION);
+}
+
+bool IsNameValidBeforeTag(const std::string& name)
+{
+    std::vector<std::string> parts;
+    boost::split(parts, name, boost::is_any_of(SUB_NAME_DELIMITER));
+
+    if (!IsRootNameValid(parts.front())) return false;
+
+    if (parts.size() > 1)
+    {
+        for (unsigned long i = 1; i < parts.size(); i++)
+        {
+            if (!IsSubNameValid(parts[i])) return false;
+        }
+    }
+
+    return true;
+}
+
+bool IsAssetNameASubasset(const std::string& name)
+{
+    std::vector<std::string> parts;
+    boost::split(parts, name, boost::is_any_of(SUB_NAME_DELIMITER));
+
+    if (!IsRootNameValid(parts.front())) return false;
+
+    return parts.size() > 1;
+}
+
+bool IsTypeCheckNameValid(const AssetType type, const std::string& name, std::string& error)
+{
+    if (type == AssetType::UNIQUE) {
+        if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
+        std::vector<std::string> parts;
+        boost::split(parts, name, boost::is_any_of(UNIQUE_TAG_DELIMITER));
+        bool valid = IsNameValidBeforeTag(parts.front()) && IsUniqueTagValid(parts.back());
+        if (!valid) { error = "Unique name contains invalid characters (Valid characters are: A-Z a-z 0-9 @ $ % & * ( ) [ ] { } _ . ? : -)";  return false; }
+        return true;
+    } else if (type == AssetType::MSGCHANNEL) {
+        if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
+        std::vector<std::string> parts;
+        boost::split(parts, name, boost::is_any_of(CHANNEL_TAG_DELIMITER));
+        bool valid = IsNameValidBeforeTag(parts.front()) && IsChannelTagValid(parts.back());
+        if (parts.back().size() > MAX_CHANNEL_NAME_LENGTH) { error = "Channel name is greater than max length of " + std::to_string(MAX_CHANNEL_NAME_LENGTH); return false; }
+        if (!valid) { error = "Message Channel name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
+        return true;
+    } else if (type == AssetType::OWNER) {
+        if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
+        bool valid = IsNameValidBeforeTag(name.substr(0, name.size() - 1));
+        if (!valid) { error = "Owner name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
+        return true;
+    } else if (type == AssetType::VOTE) {
+        if (name.size() > MAX_NAME_LENGTH) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH); return false; }
+        std::vector<std::string> parts;
+        boost::split(parts, name, boost::is_any_of(VOTE_TAG_DELIMITER));
+        bool valid = IsNameValidBeforeTag(parts.front()) && IsVoteTagValid(parts.back());
+        if (!valid) { error = "Vote name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
+        return true;
+    } else {
+        if (name.size() > MAX_NAME_LENGTH - 1) { error = "Name is greater than max length of " + std::to_string(MAX_NAME_LENGTH - 1); return false; }
+        if (!IsAssetNameASubasset(name) && name.size() < MIN_ASSET_LENGTH) { error = "Name must contain " + std::to_string(MIN_ASSET_LENGTH) + " characters"; return false; }
+        bool valid = IsNameValidBeforeTag(name);
+        if (!valid && IsAssetNameASubasset(name) && name.size() < 3) { error = "Name must have at least 3 characters (Valid characters are: A-Z 0-9 _ .)";  return false; }
+        if (!valid) { error = "Name contains invalid characters (Valid characters are: A-Z 0-9 _ .) (special characters can't be the first or last characters)";  return false; }
+        return true;
+    }
+}
+
+bool IsAssetNameValid(const std::string& name, AssetType& assetType, std::string& error)
+{
+    assetType = AssetType::INVALID;
+    AssetType type;
+    if (std::regex_match(name, UNIQUE_INDICATOR))
+        type = AssetType::UNIQUE;
+    else if (std::regex_match(name, CHANNEL_INDICATOR))
+        type = AssetType::MSGCHANNEL;
+    else if (std::regex_match(name, OWNER_INDICATOR))
+        type = AssetType::OWNER;
+    else if (std::regex_match(name, VOTE_INDICATOR))
+        type = AssetType::VOTE;
+    else
+        type = IsAssetNameASubasset(name) ? AssetType::SUB : AssetType::ROOT;
+
+    bool ret = regex_reference::IsTypeCheckNameValid(type, name, error);
+    if (ret)
+        assetType = type;
+
+    return ret;
+}
+
+bool IsAssetNameAnOwner(const std::string& name)
+{
+    AssetType type;
+    std::string error;
+    return regex_reference::IsAssetNameValid(name, type, error) && std::regex_match(name, OWNER_INDICATOR);
+}
+
+} // namespace regex_reference
+
+static const AssetType ALL_CHECKED_TYPES[] = {AssetType::ROOT, AssetType::SUB, AssetType::UNIQUE, AssetType::OWNER, AssetType::MSGCHANNEL, AssetType::VOTE};
+
+static void CheckSameAsReference(const std::string& name, bool fCheckTypes)
+{
+    AssetType type, typeRef;
+    std::string error, errorRef;
+    bool ret = IsAssetNameValid(name, type, error);
+    bool retRef = regex_reference::IsAssetNameValid(name, typeRef, errorRef);
+    BOOST_CHECK_MESSAGE(ret == retRef && type == typeRef && error == errorRef, "IsAssetNameValid differs on " + HexStr(name));
+
+    BOOST_CHECK_MESSAGE(IsUniqueTagValid(name) == regex_reference::IsUniqueTagValid(name), "IsUniqueTagValid differs on " + HexStr(name));
+    BOOST_CHECK_MESSAGE(IsAssetNameAnOwner(name) == regex_reference::IsAssetNameAnOwner(name), "IsAssetNameAnOwner differs on " + HexStr(name));
+
+    if (!fCheckTypes)
+        return;
+
+    // The name only has to pass the type check of the type its indicator selects, but the checks are public
+    for (AssetType checkType : ALL_CHECKED_TYPES) {
+        error = errorRef = "";
+        ret = IsTypeCheckNameValid(checkType, name, error);
+        retRef = regex_reference::IsTypeCheckNameValid(checkType, name, errorRef);
+        BOOST_CHECK_MESSAGE(ret == retRef && error == errorRef, "IsTypeCheckNameValid(" + std::to_string(IntFromAssetType(checkType)) + ") differs on " + HexStr(name));
+    }
+}
+
+BOOST_FIXTURE_TEST_SUITE(asset_name_tests, BasicTestingSetup)
+
+    BOOST_AUTO_TEST_CASE(asset_name_exhaustive_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Name Exhaustive Test");
+
+        // Every name up to four characters long over an alphabet with a character of each class that matters,
+        // including the delimiters, a line break and a byte outside of ASCII
+        const std::string alphabet = std::string("AZa09._/#~^!-@\n\xff");
+        std::vector<std::string> names(1, "");
+        for (size_t nLength = 1; nLength <= 4; nLength++) {
+            std::vector<std::string> longer;
+            for (const std::string& name : names) {
+                if (name.size() != nLength - 1)
+                    continue;
+                for (char c : alphabet)
+                    longer.push_back(name + c);
+            }
+            names.insert(names.end(), longer.begin(), longer.end());
+        }
+
+        for (const std::string& name : names)
+            CheckSameAsReference(name, names.size() < 10000 || name.size() <= 3);
+    }
+
+    BOOST_AUTO_TEST_CASE(asset_name_every_byte_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Name Every Byte Test");
+
+        // Every byte in every position of names that are valid for each type
+        const std::vector<std::string> templates = {"ASSET", "ASSET/SUB.A", "ASSET#Tag_1", "ASSET/SUB~CHAN", "ASSET^VOTE", "ASSET/S!"};
+        for (const std::string& base : templates) {
+            CheckSameAsReference(base, true);
+            for (size_t nPos = 0; nPos <= base.size(); nPos++) {
+                for (int c = 0; c < 256; c++) {
+                    std::string replaced = base;
+                    if (nPos < base.size())
+                        replaced[nPos] = (char)c;
+                    else
+                        replaced.push_back((char)c);
+                    CheckSameAsReference(replaced, false);
+                }
+            }
+        }
+    }
+
+    BOOST_AUTO_TEST_CASE(asset_name_random_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset Name Random Test");
+
+        // Names glued together from pieces of real names, so that long and almost valid names get covered
+        const std::vector<std::string> pieces = {"A", "B", "Z9", "ASSET", "BLAST", "BLASTCOIN", "_", ".", "..", "/", "#", "~", "^", "!",
+                                                 "tag", "@$%", "&*()", "[]{}", "?:-", "0", "SUB", " ", "\n", "\x80"};
+        for (int i = 0; i < 20000; i++) {
+            std::string name;
+            int nPieces = 1 + InsecureRandRange(12);
+            for (int j = 0; j < nPieces; j++)
+                name += pieces[InsecureRandRange(pieces.size())];
+            CheckSameAsReference(name, (i % 10) == 0);
+        }
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
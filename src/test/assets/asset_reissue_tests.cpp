@@ -44,7 +44,7 @@ BOOST_FIXTURE_TEST_SUITE(asset_reissue_tests, BasicTestingSetup)
 
         // Check to see if the reissue changed the cache data correctly
         BOOST_CHECK_MESSAGE(cache.mapReissuedAssetData.count("BLASTASSET"), "Map Reissued Asset should contain the asset \"BLASTASSET\"");
-        BOOST_CHECK_MESSAGE(cache.mapAssetsAddressAmount.at(make_pair("BLASTASSET", Params().GlobalBurnAddress())) == CAmount(101 * COIN), "Reissued amount wasn't added to the previous total");
+        BOOST_CHECK_MESSAGE(cache.mapAssetsAddressAmount.at(cache.AssetAddressKey("BLASTASSET", Params().GlobalBurnAddress())) == CAmount(101 * COIN), "Reissued amount wasn't added to the previous total");
 
         // Get the new asset data from the cache
         CNewAsset asset2;
@@ -75,7 +75,7 @@ BOOST_FIXTURE_TEST_SUITE(asset_reissue_tests, BasicTestingSetup)
 
         // Check to see if the reissue removal updated the cache correctly
         BOOST_CHECK_MESSAGE(cache.mapReissuedAssetData.count("BLASTASSET"), "Map of reissued data was removed, even though changes were made and not databased yet");
-        BOOST_CHECK_MESSAGE(cache.mapAssetsAddressAmount.at(make_pair("BLASTASSET", Params().GlobalBurnAddress())) == CAmount(100 * COIN), "Assets total wasn't undone when reissuance was");
+        BOOST_CHECK_MESSAGE(cache.mapAssetsAddressAmount.at(cache.AssetAddressKey("BLASTASSET", Params().GlobalBurnAddress())) == CAmount(100 * COIN), "Assets total wasn't undone when reissuance was");
     }
 
 
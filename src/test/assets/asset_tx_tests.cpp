@@ -13,6 +13,19 @@
 #include <base58.h>
 #include <consensus/validation.h>
 #include <consensus/tx_verify.h>
+#include <validation.h>
+
+namespace {
+//! Point passets at an empty cache for the lifetime of a test
+struct GlobalAssetsSetup
+{
+    CAssetsCache global;
+    CAssetsCache* passetsOld;
+
+    GlobalAssetsSetup() : passetsOld(passets) { passets = &global; }
+    ~GlobalAssetsSetup() { passets = passetsOld; }
+};
+}
 
 BOOST_FIXTURE_TEST_SUITE(asset_tx_tests, BasicTestingSetup)
 
@@ -470,4 +483,60 @@ BOOST_FIXTURE_TEST_SUITE(asset_tx_tests, BasicTestingSetup)
         BOOST_CHECK_MESSAGE(!asset.IsValid(error, cache, false, false), "Test13: " + error);
     }
 
+    BOOST_AUTO_TEST_CASE(asset_tx_context_free_check_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset TX Context Free Check Test");
+
+        SelectParams(CBaseChainParams::MAIN);
+
+        // The name checks look at the global cache too
+        GlobalAssetsSetup setup;
+
+        std::string error;
+        CAssetsCache cache;
+
+        // Without the cache checks IsValid is just the context free checks
+        CNewAsset asset("CHECKASSET", CAmount(100000000), 8, false, false, "");
+        BOOST_CHECK(asset.IsValid(error));
+        BOOST_CHECK(asset.IsNameAvailable(error, cache));
+        asset = CNewAsset("CHECKASSET", CAmount(10000000), 0, false, false, "");
+        BOOST_CHECK(!asset.IsValid(error));
+        BOOST_CHECK_EQUAL(asset.IsValid(error), asset.IsValid(error, cache, false, false));
+
+        BOOST_CHECK(cache.AddNewAsset(CNewAsset("CHECKASSET", CAmount(100 * COIN), 8, 1, 0, ""), Params().GlobalBurnAddress(), 0, uint256()));
+        BOOST_CHECK(!asset.IsNameAvailable(error, cache));
+
+        // A reissue is only checked against the asset it reissues by IsReissuable
+        CReissueAsset reissue("CHECKASSET", CAmount(1 * COIN), 7, 1, "");
+        BOOST_CHECK(reissue.IsValid(error));
+        BOOST_CHECK(!reissue.IsReissuable(error, cache));
+        BOOST_CHECK(!reissue.IsValid(error, cache));
+        reissue = CReissueAsset("CHECKASSET", CAmount(-1), 8, 1, "");
+        BOOST_CHECK(reissue.IsReissuable(error, cache));
+        BOOST_CHECK(!reissue.IsValid(error));
+
+        // An issue transaction without its burn output fails its CAssetCheck
+        CMutableTransaction mutTx;
+        CNewAsset asset2("CHECKASSET2", CAmount(100 * COIN), 8, 1, 0, "");
+        CScript ownerScript = GetScriptForDestination(DecodeDestination(Params().GlobalBurnAddress()));
+        asset2.ConstructOwnerTransaction(ownerScript);
+        CScript script = GetScriptForDestination(DecodeDestination(Params().GlobalBurnAddress()));
+        asset2.ConstructTransaction(script);
+        mutTx.vout.push_back(CTxOut(0, ownerScript));
+        mutTx.vout.push_back(CTxOut(0, script));
+        CTransaction tx(mutTx);
+        BOOST_CHECK(tx.IsNewAsset());
+
+        CAssetCheck check(tx);
+        BOOST_CHECK(!check());
+        BOOST_CHECK_EQUAL(check.GetRejectReason(), "bad-txns-issue-asset-failed-verify");
+
+        // And a transaction without asset outputs has nothing to check
+        CMutableTransaction plainTx;
+        plainTx.vout.push_back(CTxOut(1 * COIN, GetScriptForDestination(DecodeDestination(Params().GlobalBurnAddress()))));
+        CTransaction tx2(plainTx);
+        CAssetCheck check2(tx2);
+        BOOST_CHECK(check2());
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
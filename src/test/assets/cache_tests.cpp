@@ -1,8 +1,37 @@
 
 #include "assets/assets.h"
+#include "assets/assetdb.h"
+#include "base58.h"
+#include "chainparams.h"
+#include "validation.h"
 #include <boost/test/unit_test.hpp>
 #include <test/test_bitcoin.h>
 
+#include <thread>
+
+namespace {
+//! Point passets at an empty cache and turn off the asset index for the lifetime of a test
+struct GlobalAssetsSetup
+{
+    CAssetsCache global;
+    CAssetsCache* passetsOld;
+    bool fAssetIndexOld;
+
+    GlobalAssetsSetup() : passetsOld(passets), fAssetIndexOld(fAssetIndex) { passets = &global; fAssetIndex = false; }
+    ~GlobalAssetsSetup() { passets = passetsOld; fAssetIndex = fAssetIndexOld; }
+};
+
+//! Point passetsdb at an empty in-memory database for the lifetime of a test
+struct AssetsDBSetup
+{
+    CAssetsDB assetsdb;
+    CAssetsDB* passetsdbOld;
+
+    AssetsDBSetup() : assetsdb(1 << 20, true), passetsdbOld(passetsdb) { passetsdb = &assetsdb; }
+    ~AssetsDBSetup() { passetsdb = passetsdbOld; }
+};
+}
+
 BOOST_FIXTURE_TEST_SUITE(cache_tests, BasicTestingSetup)
 
 
@@ -37,5 +66,242 @@ BOOST_AUTO_TEST_CASE(cache_test)
 
 }
 
-BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_CASE(sharded_cache_test)
+{
+    BOOST_TEST_MESSAGE("Running Sharded Cache Test");
+
+    // A single shard makes the CLOCK eviction order deterministic
+    CShardedCache<std::string, CNewAsset> cache(4, 1);
+
+    for (int i = 0; i < 4; i++) {
+        CNewAsset asset("TEST" + std::to_string(i), CAmount(i));
+        cache.Put(asset.strName, asset);
+    }
+    BOOST_CHECK_EQUAL(cache.Size(), 4U);
+
+    // Reference TEST0 so the clock hand gives it a second chance
+    CNewAsset found;
+    BOOST_CHECK(cache.Get("TEST0", found));
+    BOOST_CHECK_EQUAL(found.nAmount, CAmount(0));
+    BOOST_CHECK(!cache.Get("NOTCACHED", found));
+
+    CNewAsset asset("THISWILLEVICT", CAmount(1));
+    cache.Put(asset.strName, asset);
+
+    BOOST_CHECK_EQUAL(cache.Size(), 4U);
+    BOOST_CHECK_MESSAGE(cache.Exists("THISWILLEVICT"), "New asset wasn't added to cache");
+    BOOST_CHECK_MESSAGE(cache.Exists("TEST0"), "Cache evicted a referenced entry");
+    BOOST_CHECK_MESSAGE(!cache.Exists("TEST1"), "Cache didn't evict the first unreferenced entry");
+
+    BOOST_CHECK_EQUAL(cache.Hits(), 1U);
+    BOOST_CHECK_EQUAL(cache.Misses(), 1U);
+    BOOST_CHECK_EQUAL(cache.Evictions(), 1U);
+
+    cache.Erase("TEST0");
+    BOOST_CHECK(!cache.Exists("TEST0"));
+    BOOST_CHECK(cache.Exists("TEST2") && cache.Exists("TEST3"));
+    BOOST_CHECK_EQUAL(cache.Size(), 3U);
+
+    // Sharded cache never grows past its bound
+    CShardedCache<std::string, CNewAsset> sharded(NUM_OF_ASSETS1);
+    for (int i = 0; i < NUM_OF_ASSETS1 * 2; i++) {
+        CNewAsset a("TEST" + std::to_string(i), CAmount(1));
+        sharded.Put(a.strName, a);
+    }
+    BOOST_CHECK(sharded.Size() <= sharded.MaxSize() + sharded.ShardCount());
+    BOOST_CHECK(sharded.Evictions() > 0);
+    BOOST_CHECK(sharded.DynamicMemoryUsage() > 0);
+
+    sharded.Clear();
+    BOOST_CHECK_EQUAL(sharded.Size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(sharded_cache_concurrent_test)
+{
+    CShardedCache<std::string, CNewAsset> cache(1000);
+    for (int i = 0; i < 500; i++) {
+        CNewAsset asset("TEST" + std::to_string(i), CAmount(i));
+        cache.Put(asset.strName, asset);
+    }
+
+    std::atomic<int> nErrors(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&cache, &nErrors, t] {
+            CNewAsset found;
+            for (int i = 0; i < 5000; i++) {
+                int n = (i * 7 + t) % 500;
+                if (!cache.Get("TEST" + std::to_string(n), found) || found.nAmount != CAmount(n))
+                    nErrors++;
+                if (t == 0) {
+                    CNewAsset asset("EXTRA" + std::to_string(i), CAmount(i));
+                    cache.Put(asset.strName, asset);
+                    cache.Erase(asset.strName);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    BOOST_CHECK_EQUAL(nErrors.load(), 0);
+    BOOST_CHECK_EQUAL(cache.Hits(), 20000U);
+}
+
+BOOST_AUTO_TEST_CASE(dirty_set_test)
+{
+    BOOST_TEST_MESSAGE("Running Dirty Set Test");
+
+    SelectParams(CBaseChainParams::MAIN);
 
+    GlobalAssetsSetup setup;
+    CAssetsCache& global = setup.global;
+
+    CNewAsset asset1("DIRTYASSET", CAmount(100 * COIN), 8, 1, 0, "");
+    std::string address = Params().GlobalBurnAddress();
+
+    // Adding and removing moves an entry between the sets, entries are equal by name
+    CAssetsCache cache;
+    BOOST_CHECK(cache.AddNewAsset(asset1, address, 1, uint256()));
+    BOOST_CHECK(!cache.AddNewAsset(asset1, address, 2, uint256()));
+    BOOST_CHECK_EQUAL(cache.setNewAssetsToAdd.size(), 1U);
+    BOOST_CHECK_EQUAL(cache.setNewAssetsToAdd.begin()->blockHeight, 1);
+    BOOST_CHECK(cache.CheckIfAssetExists("DIRTYASSET"));
+
+    BOOST_CHECK(cache.RemoveNewAsset(asset1, address));
+    BOOST_CHECK(cache.setNewAssetsToAdd.empty());
+    BOOST_CHECK_EQUAL(cache.setNewAssetsToRemove.size(), 1U);
+    BOOST_CHECK(!cache.CheckIfAssetExists("DIRTYASSET"));
+
+    // Transfers are keyed on their outpoint
+    COutPoint out1(uint256S("0x01"), 0);
+    COutPoint out2(uint256S("0x01"), 1);
+    BOOST_CHECK(cache.AddTransferAsset(CAssetTransfer("DIRTYASSET", 1), address, out1, CTxOut()));
+    BOOST_CHECK(cache.AddTransferAsset(CAssetTransfer("DIRTYASSET", 1), address, out2, CTxOut()));
+    BOOST_CHECK(cache.AddTransferAsset(CAssetTransfer("DIRTYASSET", 1), address, out1, CTxOut()));
+    BOOST_CHECK_EQUAL(cache.setNewTransferAssetsToAdd.size(), 2U);
+    BOOST_CHECK(cache.setNewTransferAssetsToAdd.count(CAssetCacheNewTransfer(CAssetTransfer(), "", out2)));
+
+    // An empty cache layered on the global one sees its state without copying it
+    BOOST_CHECK(cache.AddNewAsset(asset1, address, 3, uint256()));
+    BOOST_CHECK(cache.Flush());
+    CAssetsCache child;
+    BOOST_CHECK(child.setNewAssetsToAdd.empty());
+    CNewAsset assetRead;
+    BOOST_CHECK(child.GetAssetMetaDataIfExists("DIRTYASSET", assetRead));
+    BOOST_CHECK_EQUAL(assetRead.nAmount, CAmount(100 * COIN));
+
+    // And only its own changes are merged back
+    BOOST_CHECK(child.RemoveNewAsset(asset1, address));
+    BOOST_CHECK(child.Flush());
+    BOOST_CHECK(global.setNewAssetsToAdd.empty());
+    BOOST_CHECK_EQUAL(global.setNewAssetsToRemove.size(), 1U);
+    BOOST_CHECK_EQUAL(global.setNewTransferAssetsToAdd.size(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(provisional_asset_id_test)
+{
+    BOOST_TEST_MESSAGE("Running Provisional Asset Id Test");
+
+    SelectParams(CBaseChainParams::MAIN);
+
+    GlobalAssetsSetup setup;
+    CAssetsCache& global = setup.global;
+    AssetsDBSetup dbSetup;
+    fAssetIndex = true;
+
+    CNewAsset asset("SCRATCHASSET", CAmount(100 * COIN), 8, 1, 0, "");
+    std::string address = Params().GlobalBurnAddress();
+    uint32_t id;
+    size_t nNames = assetNameTable.Size();
+
+    // Caches that are thrown away, like the ones used to test blocks and transactions, don't intern the names they see
+    {
+        CAssetsCache scratch;
+        BOOST_CHECK(scratch.AddNewAsset(asset, address, 1, uint256()));
+        BOOST_CHECK(scratch.AddTransferAsset(CAssetTransfer("SCRATCHASSET", 1), address, COutPoint(uint256S("0x01"), 0), CTxOut()));
+        auto key = scratch.AssetAddressKey("SCRATCHASSET", address);
+        BOOST_CHECK(key == scratch.AssetAddressKey("SCRATCHASSET", address));
+        BOOST_CHECK_EQUAL(scratch.mapAssetsAddressAmount.at(key), CAmount(100 * COIN) + 1);
+    }
+    BOOST_CHECK_EQUAL(assetNameTable.Size(), nNames);
+    BOOST_CHECK(!assetNameTable.GetId("SCRATCHASSET", id));
+
+    // Looking up a balance doesn't either
+    CAssetsCache cache;
+    std::pair<uint32_t, std::string> key;
+    BOOST_CHECK(!cache.FindAssetAddressKey("SCRATCHASSET", address, key));
+    BOOST_CHECK(!GetBestAssetAddressAmount(cache, "SCRATCHASSET", address));
+    BOOST_CHECK_EQUAL(assetNameTable.Size(), nNames);
+
+    // Flushing into the global cache interns the name and rekeys the balance with its id
+    BOOST_CHECK(cache.AddNewAsset(asset, address, 1, uint256()));
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(assetNameTable.GetId("SCRATCHASSET", id));
+    BOOST_CHECK(global.FindAssetAddressKey("SCRATCHASSET", address, key));
+    BOOST_CHECK_EQUAL(key.first, id);
+    BOOST_CHECK_EQUAL(global.mapAssetsAddressAmount.at(key), CAmount(100 * COIN));
+
+    // And a new cache picks the balance up from there
+    CAssetsCache child;
+    BOOST_CHECK(GetBestAssetAddressAmount(child, "SCRATCHASSET", address));
+    BOOST_CHECK_EQUAL(child.mapAssetsAddressAmount.at(child.AssetAddressKey("SCRATCHASSET", address)), CAmount(100 * COIN));
+}
+
+BOOST_AUTO_TEST_CASE(asset_script_cache_test)
+{
+    BOOST_TEST_MESSAGE("Running Asset Script Cache Test");
+
+    SelectParams(CBaseChainParams::MAIN);
+    ClearAssetScriptCache();
+
+    CScript base = GetScriptForDestination(DecodeDestination(Params().GlobalBurnAddress()));
+    std::string address = Params().GlobalBurnAddress();
+
+    CNewAsset asset("SCRIPTCACHE", CAmount(50 * COIN), 8, 1, 0, "");
+    CScript newScript = base;
+    asset.ConstructTransaction(newScript);
+    CScript ownerScript = base;
+    asset.ConstructOwnerTransaction(ownerScript);
+    CScript reissueScript = base;
+    CReissueAsset("SCRIPTCACHE", CAmount(5 * COIN), 8, 1, "").ConstructTransaction(reissueScript);
+    CScript transferScript = base;
+    CAssetTransfer("SCRIPTCACHE", CAmount(7 * COIN)).ConstructTransaction(transferScript);
+
+    // A miss and then a hit decode to the same payload the uncached decoders produce
+    for (int nPass = 0; nPass < 2; nPass++) {
+        CAssetScriptData data;
+        BOOST_CHECK(GetAssetScriptData(newScript, data));
+        BOOST_CHECK_EQUAL(data.nType, TX_NEW_ASSET);
+        BOOST_CHECK(!data.fIsOwner);
+        BOOST_CHECK_EQUAL(data.assetName, "SCRIPTCACHE");
+        BOOST_CHECK_EQUAL(data.nAmount, CAmount(50 * COIN));
+        BOOST_CHECK_EQUAL(data.strAddress, address);
+
+        BOOST_CHECK(GetAssetScriptData(ownerScript, data));
+        BOOST_CHECK(data.fIsOwner);
+        BOOST_CHECK_EQUAL(data.assetName, "SCRIPTCACHE!");
+        BOOST_CHECK_EQUAL(data.nAmount, OWNER_ASSET_AMOUNT);
+
+        BOOST_CHECK(GetAssetScriptData(reissueScript, data));
+        BOOST_CHECK_EQUAL(data.nType, TX_REISSUE_ASSET);
+        BOOST_CHECK_EQUAL(data.nAmount, CAmount(5 * COIN));
+
+        CAssetTransfer transfer;
+        std::string strAddress;
+        BOOST_CHECK(TransferAssetFromScript(transferScript, transfer, strAddress));
+        BOOST_CHECK_EQUAL(transfer.strName, "SCRIPTCACHE");
+        BOOST_CHECK_EQUAL(transfer.nAmount, CAmount(7 * COIN));
+        BOOST_CHECK_EQUAL(strAddress, address);
+
+        // A transfer script is never mistaken for another asset type
+        BOOST_CHECK(!TransferAssetFromScript(newScript, transfer, strAddress));
+    }
+
+    CAssetScriptData data;
+    BOOST_CHECK(!GetAssetScriptData(base, data));
+
+    ClearAssetScriptCache();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,204 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "auxpow/auxpow.h"
+#include "auxpow/store.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "hash.h"
+#include "random.h"
+#include "txdb.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+static CAuxPow MakeAuxPow(unsigned int n)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].scriptSig = CScript() << n << std::vector<unsigned char>(32 + n % 64, 0xab);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = n;
+
+    CAuxPow auxpow;
+    auxpow.SetTx(MakeTransactionRef(std::move(mtx)));
+    auxpow.nIndex = 0;
+    for (unsigned int i = 0; i < n % 8; i++) {
+        auxpow.vMerkleBranch.push_back(InsecureRand256());
+        auxpow.vChainMerkleBranch.push_back(InsecureRand256());
+    }
+    auxpow.nChainIndex = n;
+    auxpow.parentBlockHeader.nNonce = n;
+    return auxpow;
+}
+
+BOOST_FIXTURE_TEST_SUITE(auxpow_store_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(auxpow_store_roundtrip_test)
+{
+    fs::path path = fs::temp_directory_path() / fs::unique_path() / "auxpow.dat";
+
+    std::vector<uint64_t> vPos;
+    std::vector<uint256> vHash;
+    {
+        CAuxPowStore store(path);
+        for (unsigned int i = 0; i < 50; i++) {
+            CAuxPow auxpow = MakeAuxPow(i);
+            uint64_t nPos = 0;
+            BOOST_CHECK(store.Write(auxpow, nPos));
+            BOOST_CHECK(nPos != 0);
+            vPos.push_back(nPos);
+            vHash.push_back(SerializeHash(auxpow));
+        }
+        BOOST_CHECK(store.Flush());
+
+        // Reads work on records that have not been synced yet
+        CAuxPow auxpow;
+        BOOST_CHECK(store.Read(vPos[7], auxpow));
+        BOOST_CHECK(SerializeHash(auxpow) == vHash[7]);
+    }
+
+    // Reopening keeps the records and appends after them
+    CAuxPowStore store(path);
+    uint64_t nSize = store.Size();
+    uint64_t nPos = 0;
+    BOOST_CHECK(store.Write(MakeAuxPow(50), nPos));
+    BOOST_CHECK(nPos > vPos.back() && nPos < store.Size() && nPos > nSize);
+    for (size_t i = 0; i < vPos.size(); i++) {
+        CAuxPow auxpow;
+        BOOST_CHECK(store.Read(vPos[i], auxpow));
+        BOOST_CHECK(SerializeHash(auxpow) == vHash[i]);
+    }
+
+    // Offsets that do not point at a record are rejected
+    CAuxPow auxpow;
+    BOOST_CHECK(!store.Read(0, auxpow));
+    BOOST_CHECK(!store.Read(vPos[1] + 1, auxpow));
+    BOOST_CHECK(!store.Read(store.Size() + 8, auxpow));
+
+    // Wiping starts over
+    CAuxPowStore wiped(path.parent_path() / "wiped.dat", true);
+    BOOST_CHECK_EQUAL(wiped.Size(), 0U);
+
+    fs::remove_all(path.parent_path());
+}
+
+BOOST_AUTO_TEST_CASE(auxpow_store_cache_test)
+{
+    fs::path path = fs::temp_directory_path() / fs::unique_path() / "auxpow.dat";
+    // Room for a handful of entries only
+    CAuxPowStore store(path, false, 8 * 1024);
+
+    std::vector<uint256> vBlockHash;
+    std::vector<uint64_t> vPos;
+    for (unsigned int i = 0; i < 100; i++) {
+        uint64_t nPos;
+        BOOST_CHECK(store.Write(MakeAuxPow(i), nPos));
+        vBlockHash.push_back(InsecureRand256());
+        vPos.push_back(nPos);
+    }
+
+    std::shared_ptr<CAuxPow> auxpow1, auxpow2;
+    BOOST_CHECK(store.ReadCached(vBlockHash[0], vPos[0], auxpow1));
+    BOOST_CHECK(store.CacheUsage() > 0);
+    BOOST_CHECK(store.ReadCached(vBlockHash[0], vPos[0], auxpow2));
+    BOOST_CHECK(auxpow1 == auxpow2);
+
+    for (size_t i = 0; i < vPos.size(); i++) {
+        std::shared_ptr<CAuxPow> auxpow;
+        BOOST_CHECK(store.ReadCached(vBlockHash[i], vPos[i], auxpow));
+        BOOST_CHECK_EQUAL(auxpow->nChainIndex, i);
+        BOOST_CHECK(store.CacheUsage() <= 8 * 1024);
+    }
+
+    // The first entry has been evicted by now, so it's read from disk again
+    BOOST_CHECK(store.ReadCached(vBlockHash[0], vPos[0], auxpow2));
+    BOOST_CHECK(auxpow1 != auxpow2);
+    BOOST_CHECK(SerializeHash(*auxpow1) == SerializeHash(*auxpow2));
+
+    // Failed reads aren't cached
+    std::shared_ptr<CAuxPow> auxpow;
+    uint256 hashMissing = InsecureRand256();
+    BOOST_CHECK(!store.ReadCached(hashMissing, vPos[1] + 1, auxpow));
+    BOOST_CHECK(!store.ReadCached(hashMissing, vPos[1] + 1, auxpow));
+
+    store.ClearCache();
+    BOOST_CHECK_EQUAL(store.CacheUsage(), 0U);
+
+    fs::remove_all(path.parent_path());
+}
+
+BOOST_AUTO_TEST_CASE(auxpow_store_migration_test)
+{
+    fs::path path = fs::temp_directory_path() / fs::unique_path() / "auxpow.dat";
+    CAuxPowStore store(path);
+    CAuxPowStore* pstoreOld = pauxpowstore;
+    pauxpowstore = &store;
+
+    CBlockTreeDB blocktree(1 << 20, true);
+
+    // Write block index entries in the old layout, with the auxpow inline in the 'a' record
+    std::vector<uint256> vBlockHash;
+    std::vector<uint256> vAuxPowHash;
+    uint256 hashPrev;
+    for (unsigned int i = 0; i < 20; i++) {
+        uint256 hash = InsecureRand256();
+        CBlockIndex index;
+        index.phashBlock = &hash;
+        index.nHeight = i;
+        index.nVersion = 4 | (i % 2 ? (int)AuxPow::BLOCK_VERSION_AUXPOW : 0);
+        index.nTime = i;
+
+        CDiskBlockIndex diskindex(&index);
+        diskindex.hashPrev = hashPrev;
+        diskindex.fLegacyAuxPow = true;
+        if (i % 2) {
+            diskindex.auxpow = std::make_shared<CAuxPow>(MakeAuxPow(i));
+            vAuxPowHash.push_back(SerializeHash(*diskindex.auxpow));
+        } else {
+            vAuxPowHash.push_back(uint256());
+        }
+        BOOST_CHECK(blocktree.Write(std::make_pair(std::make_pair('b', hash), 'a'), diskindex));
+        BOOST_CHECK(blocktree.Write(std::make_pair(std::make_pair('b', hash), 'b'), index));
+
+        vBlockHash.push_back(hash);
+        hashPrev = hash;
+    }
+
+    for (int nPass = 0; nPass < 2; nPass++) {
+        std::map<uint256, std::unique_ptr<CBlockIndex> > mapIndex;
+        auto insertBlockIndex = [&mapIndex](const uint256& hash) -> CBlockIndex* {
+            if (hash.IsNull())
+                return nullptr;
+            std::unique_ptr<CBlockIndex>& pindex = mapIndex[hash];
+            if (!pindex)
+                pindex.reset(new CBlockIndex());
+            return pindex.get();
+        };
+        uint64_t nSizeBefore = store.Size();
+        BOOST_CHECK(blocktree.LoadBlockIndexGuts(Params().GetConsensus(), insertBlockIndex));
+        BOOST_CHECK_EQUAL(mapIndex.size(), vBlockHash.size());
+
+        // Only the first load moves anything into the store
+        BOOST_CHECK(nPass == 0 ? store.Size() > nSizeBefore : store.Size() == nSizeBefore);
+
+        for (size_t i = 0; i < vBlockHash.size(); i++) {
+            const CBlockIndex* pindex = mapIndex[vBlockHash[i]].get();
+            BOOST_CHECK_EQUAL(pindex->nHeight, (int)i);
+            BOOST_CHECK(pindex->pprev == (i ? mapIndex[vBlockHash[i - 1]].get() : nullptr));
+            if (vAuxPowHash[i].IsNull()) {
+                BOOST_CHECK_EQUAL(pindex->nAuxPowPos, 0U);
+                continue;
+            }
+            CAuxPow auxpow;
+            BOOST_CHECK(store.Read(pindex->nAuxPowPos, auxpow));
+            BOOST_CHECK(SerializeHash(auxpow) == vAuxPowHash[i]);
+        }
+    }
+
+    pauxpowstore = pstoreOld;
+    fs::remove_all(path.parent_path());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,176 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilereader.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "coins.h"
+#include "consensus/consensus.h"
+#include "crypto/common.h"
+#include "streams.h"
+#include "undo.h"
+#include "validation.h"
+#include "version.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfile_tests, TestChain100Setup)
+
+BOOST_AUTO_TEST_CASE(read_raw_block)
+{
+    LOCK(cs_main);
+    const CChainParams& chainparams = Params();
+
+    for (int nHeight : {1, 50, chainActive.Height()}) {
+        const CBlockIndex* pindex = chainActive[nHeight];
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()));
+
+        // The raw read returns what the block serializes to on the wire
+        std::vector<unsigned char> vRaw;
+        BOOST_CHECK(ReadRawBlockFromDisk(vRaw, pindex, chainparams.MessageStart()));
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << block;
+        BOOST_CHECK(vRaw == std::vector<unsigned char>(ss.begin(), ss.end()));
+    }
+
+    // The header hash is checked against the index
+    CBlockIndex indexWrong = *chainActive.Tip();
+    uint256 hashWrong = chainActive[1]->GetBlockHash();
+    indexWrong.phashBlock = &hashWrong;
+    std::vector<unsigned char> vRaw;
+    BOOST_CHECK(!ReadRawBlockFromDisk(vRaw, &indexWrong, chainparams.MessageStart()));
+
+    // So is the magic of the index header in front of the block
+    CBlockIndex indexMoved = *chainActive.Tip();
+    indexMoved.nDataPos += 1;
+    BOOST_CHECK(!ReadRawBlockFromDisk(vRaw, &indexMoved, chainparams.MessageStart()));
+}
+
+static void AppendToFile(const fs::path& path, const std::vector<unsigned char>& vData)
+{
+    FILE* file = fsbridge::fopen(path, "ab");
+    BOOST_REQUIRE(file);
+    BOOST_CHECK_EQUAL(fwrite(vData.data(), 1, vData.size(), file), vData.size());
+    fclose(file);
+}
+
+BOOST_AUTO_TEST_CASE(block_file_reader)
+{
+#ifndef WIN32
+    if (sizeof(void*) < 8)
+        return;
+
+    fs::path dir = GetDataDir() / "mapped";
+    fs::create_directories(dir);
+    CBlockFileReader reader(dir, 2);
+
+    // Missing files can't be mapped
+    BOOST_CHECK(!reader.Map("blk", CDiskBlockPos(0, 0), 1));
+
+    std::vector<unsigned char> vData(1000);
+    for (unsigned int i = 0; i < vData.size(); i++)
+        vData[i] = i % 251;
+    AppendToFile(dir / "blk00000.dat", vData);
+    std::shared_ptr<const CBlockFileMapping> mapping = reader.Map("blk", CDiskBlockPos(0, 10), 990);
+    BOOST_REQUIRE(mapping);
+    BOOST_CHECK_EQUAL(mapping->size(), 1000U);
+    BOOST_CHECK(std::equal(vData.begin(), vData.end(), (const unsigned char*)mapping->data()));
+    BOOST_CHECK(!reader.Map("blk", CDiskBlockPos(0, 10), 991));
+
+    // A file that grew is mapped again
+    AppendToFile(dir / "blk00000.dat", vData);
+    std::shared_ptr<const CBlockFileMapping> mappingGrown = reader.Map("blk", CDiskBlockPos(0, 1000), 1000);
+    BOOST_REQUIRE(mappingGrown);
+    BOOST_CHECK_EQUAL(mappingGrown->size(), 2000U);
+    BOOST_CHECK(std::equal(vData.begin(), vData.end(), (const unsigned char*)mappingGrown->data() + 1000));
+    BOOST_CHECK(reader.Map("blk", CDiskBlockPos(0, 0), 10) == mappingGrown);
+    // Mappings handed out before stay valid
+    BOOST_CHECK(std::equal(vData.begin(), vData.end(), (const unsigned char*)mapping->data()));
+
+    // Only the most recently used files stay mapped
+    AppendToFile(dir / "rev00000.dat", vData);
+    AppendToFile(dir / "blk00001.dat", vData);
+    BOOST_CHECK(reader.Map("rev", CDiskBlockPos(0, 0), 10));
+    BOOST_CHECK(reader.Map("blk", CDiskBlockPos(1, 0), 10));
+    BOOST_CHECK_EQUAL(reader.MappedFiles(), 2U);
+    BOOST_CHECK(reader.Map("blk", CDiskBlockPos(0, 0), 10) != mappingGrown);
+
+    reader.Close("blk", 0);
+    BOOST_CHECK_EQUAL(reader.MappedFiles(), 1U);
+    reader.Clear();
+    BOOST_CHECK_EQUAL(reader.MappedFiles(), 0U);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(mapped_reads_match_stdio)
+{
+    LOCK(cs_main);
+    const CChainParams& chainparams = Params();
+    BOOST_REQUIRE(pblockfilereader);
+    CBlockFileReader* preader = pblockfilereader;
+
+    for (int nHeight : {1, 50, chainActive.Height()}) {
+        const CBlockIndex* pindex = chainActive[nHeight];
+        CBlock blockMapped;
+        CBlockUndo undoMapped;
+        std::vector<unsigned char> vRawMapped;
+        BOOST_CHECK(ReadBlockFromDisk(blockMapped, pindex, chainparams.GetConsensus()));
+        BOOST_CHECK(UndoReadFromDisk(undoMapped, pindex->GetUndoPos(), pindex->pprev->GetBlockHash()));
+        BOOST_CHECK(ReadRawBlockFromDisk(vRawMapped, pindex, chainparams.MessageStart()));
+
+        pblockfilereader = nullptr;
+        CBlock block;
+        CBlockUndo undo;
+        std::vector<unsigned char> vRaw;
+        BOOST_CHECK(ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()));
+        BOOST_CHECK(UndoReadFromDisk(undo, pindex->GetUndoPos(), pindex->pprev->GetBlockHash()));
+        BOOST_CHECK(ReadRawBlockFromDisk(vRaw, pindex, chainparams.MessageStart()));
+        pblockfilereader = preader;
+
+        BOOST_CHECK(SerializeHash(blockMapped, SER_DISK, CLIENT_VERSION) == SerializeHash(block, SER_DISK, CLIENT_VERSION));
+        BOOST_CHECK(SerializeHash(undoMapped, SER_DISK, CLIENT_VERSION) == SerializeHash(undo, SER_DISK, CLIENT_VERSION));
+        BOOST_CHECK(vRawMapped == vRaw);
+
+        // The undo checksum covers the block hash
+        BOOST_CHECK(!UndoReadFromDisk(undoMapped, pindex->GetUndoPos(), pindex->GetBlockHash()));
+    }
+#ifndef WIN32
+    if (sizeof(void*) == 8)
+        BOOST_CHECK_EQUAL(pblockfilereader->MappedFiles(), 2U);
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(read_raw_block_size_limit)
+{
+    LOCK(cs_main);
+    const CChainParams& chainparams = Params();
+
+    std::vector<unsigned char> vRaw;
+    BOOST_REQUIRE(ReadRawBlockFromDisk(vRaw, chainActive.Tip(), chainparams.MessageStart()));
+
+    // An index header claiming more than a block can hold is rejected even when the file is large enough to map it
+    CBlockIndex indexLarge = *chainActive.Tip();
+    indexLarge.nFile = chainActive.Tip()->nFile + 1;
+    indexLarge.nDataPos = 8;
+    fs::path path = GetBlockPosFilename(indexLarge.GetBlockPos(), "blk");
+    std::vector<unsigned char> vData(chainparams.MessageStart(), chainparams.MessageStart() + CMessageHeader::MESSAGE_START_SIZE);
+    vData.resize(8);
+    WriteLE32(vData.data() + CMessageHeader::MESSAGE_START_SIZE, MAX_BLOCK_SERIALIZED_SIZE_RIP2 + 1);
+    vData.insert(vData.end(), vRaw.begin(), vRaw.begin() + 80);
+    AppendToFile(path, vData);
+    fs::resize_file(path, 8 + MAX_BLOCK_SERIALIZED_SIZE_RIP2 + 1);
+
+    std::vector<unsigned char> vLarge;
+    BOOST_CHECK(!ReadRawBlockFromDisk(vLarge, &indexLarge, chainparams.MessageStart()));
+    BOOST_CHECK(vLarge.size() <= MAX_BLOCK_SERIALIZED_SIZE_RIP2);
+
+    if (pblockfilereader)
+        pblockfilereader->Close("blk", indexLarge.nFile);
+    fs::remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
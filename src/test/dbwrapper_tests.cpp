@@ -361,4 +361,37 @@ BOOST_FIXTURE_TEST_SUITE(dbwrapper_tests, BasicTestingSetup)
     }
 
 
+    BOOST_AUTO_TEST_CASE(dbwrapper_snapshot)
+    {
+        BOOST_TEST_MESSAGE("Running dbWrapper Snapshot Test");
+
+        fs::path ph = fs::temp_directory_path() / fs::unique_path();
+        CDBWrapper dbw(ph, (1 << 20), true, false, true);
+
+        uint256 in = InsecureRand256();
+        uint256 res;
+        BOOST_CHECK(dbw.Write('a', in));
+
+        CDBSnapshot snapshot(dbw);
+        BOOST_CHECK(dbw.Write('a', InsecureRand256()));
+        BOOST_CHECK(dbw.Write('b', in));
+        BOOST_CHECK(dbw.Erase('a'));
+
+        // The snapshot still sees the state from when it was taken
+        BOOST_CHECK(snapshot.Read('a', res));
+        BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+        BOOST_CHECK(!snapshot.Exists('b'));
+        BOOST_CHECK(!dbw.Exists('a'));
+
+        std::unique_ptr<CDBIterator> it(snapshot.NewIterator());
+        it->Seek('a');
+        char key;
+        BOOST_CHECK(it->Valid() && it->GetKey(key) && key == 'a');
+        BOOST_CHECK(it->GetValue(res));
+        BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+        it->Next();
+        BOOST_CHECK(!it->Valid());
+    }
+
+
 BOOST_AUTO_TEST_SUITE_END()
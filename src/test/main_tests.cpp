@@ -6,6 +6,7 @@
 #include "chainparams.h"
 #include "validation.h"
 #include "net.h"
+#include "pow.h"
 
 #include "test/test_bitcoin.h"
 
@@ -123,4 +124,53 @@ BOOST_FIXTURE_TEST_SUITE(main_tests, TestingSetup)
         BOOST_CHECK(Test());
     }
 
+    BOOST_AUTO_TEST_CASE(headers_pow_batch_test)
+    {
+        BOOST_TEST_MESSAGE("Running Headers PoW Batch Test");
+
+        // Regtest's pow limit lets the headers be ground in a couple of tries
+        const std::unique_ptr<CChainParams> regtestParams = CreateChainParams(CBaseChainParams::REGTEST);
+        const Consensus::Params& params = regtestParams->GetConsensus();
+
+        for (int nRound = 0; nRound < 40; nRound++) {
+            std::vector<CBlockHeader> headers(InsecureRandRange(300) + 1);
+            for (CBlockHeader& header : headers) {
+                header.nVersion = 4;
+                header.hashPrevBlock = InsecureRand256();
+                header.hashMerkleRoot = InsecureRand256();
+                header.nBits = UintToArith256(params.powLimit).GetCompact();
+                do {
+                    header.nNonce = InsecureRand32();
+                } while (!CheckBlockProofOfWork(&header, params));
+
+                // Sprinkle in headers with too little work and merge mined headers with a bogus auxpow
+                if (InsecureRandRange(150) == 0) {
+                    do {
+                        header.nNonce = InsecureRand32();
+                    } while (CheckBlockProofOfWork(&header, params));
+                } else if (InsecureRandRange(150) == 0) {
+                    header.nVersion |= AuxPow::BLOCK_VERSION_AUXPOW;
+                    header.auxpow = std::make_shared<CAuxPow>();
+                }
+            }
+
+            size_t nExpected = headers.size();
+            for (size_t i = 0; i < headers.size(); i++) {
+                if (!CheckBlockProofOfWork(&headers[i], params)) {
+                    nExpected = i;
+                    break;
+                }
+            }
+
+            LOCK(cs_main);
+            BOOST_CHECK_EQUAL(CheckHeadersProofOfWork(headers, params), nExpected);
+
+            // Same result when checked on this thread only
+            int nThreads = nHeaderCheckThreads;
+            nHeaderCheckThreads = 0;
+            BOOST_CHECK_EQUAL(CheckHeadersProofOfWork(headers, params), nExpected);
+            nHeaderCheckThreads = nThreads;
+        }
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,7 +3,9 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "coins.h"
 #include "policy/policy.h"
+#include "script/standard.h"
 #include "txmempool.h"
 #include "util.h"
 
@@ -597,4 +599,115 @@ BOOST_FIXTURE_TEST_SUITE(mempool_tests, TestingSetup)
         SetMockTime(0);
     }
 
+    BOOST_AUTO_TEST_CASE(mempool_address_index_test)
+    {
+        BOOST_TEST_MESSAGE("Running Mempool Address Index Test");
+
+        CTxMemPool pool;
+        TestMemPoolEntryHelper entry;
+        CCoinsView coinsDummy;
+        CCoinsViewCache view(&coinsDummy);
+
+        uint160 hashA = uint160(ParseHex("0101010101010101010101010101010101010101"));
+        uint160 hashB = uint160(ParseHex("0202020202020202020202020202020202020202"));
+        CScript scriptA = GetScriptForDestination(CKeyID(hashA));
+        CScript scriptB = GetScriptForDestination(CKeyID(hashB));
+
+        // Funding outputs of both addresses
+        COutPoint outA(uint256S("aa"), 0);
+        COutPoint outB(uint256S("bb"), 1);
+        view.AddCoin(outA, Coin(CTxOut(5 * COIN, scriptA), 1, false), false);
+        view.AddCoin(outB, Coin(CTxOut(3 * COIN, scriptB), 1, false), false);
+
+        // tx1 spends A's output and pays both addresses
+        CMutableTransaction tx1;
+        tx1.vin.resize(1);
+        tx1.vin[0].prevout = outA;
+        tx1.vout.resize(2);
+        tx1.vout[0].scriptPubKey = scriptB;
+        tx1.vout[0].nValue = 2 * COIN;
+        tx1.vout[1].scriptPubKey = scriptA;
+        tx1.vout[1].nValue = 3 * COIN;
+        CTxMemPoolEntry entry1 = entry.Time(10).FromTx(tx1);
+        pool.addUnchecked(tx1.GetHash(), entry1);
+        pool.addAddressIndex(entry1, view);
+        pool.addSpentIndex(entry1, view);
+
+        // tx2 spends B's output and pays A
+        CMutableTransaction tx2;
+        tx2.vin.resize(1);
+        tx2.vin[0].prevout = outB;
+        tx2.vout.resize(1);
+        tx2.vout[0].scriptPubKey = scriptA;
+        tx2.vout[0].nValue = 1 * COIN;
+        CTxMemPoolEntry entry2 = entry.Time(20).FromTx(tx2);
+        pool.addUnchecked(tx2.GetHash(), entry2);
+        pool.addAddressIndex(entry2, view);
+        pool.addSpentIndex(entry2, view);
+
+        std::vector<std::pair<uint160, int> > addressesA(1, std::make_pair(hashA, 1));
+        std::vector<std::pair<uint160, int> > addressesB(1, std::make_pair(hashB, 1));
+        std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > results;
+
+        // The entries of an address come back in the order they were added
+        BOOST_CHECK(pool.getAddressIndex(addressesA, results));
+        BOOST_CHECK_EQUAL(results.size(), 3);
+        BOOST_CHECK(results[0].first.txhash == tx1.GetHash());
+        BOOST_CHECK_EQUAL(results[0].first.spending, 1);
+        BOOST_CHECK_EQUAL(results[0].second.amount, -5 * COIN);
+        BOOST_CHECK(results[0].second.prevhash == outA.hash);
+        BOOST_CHECK(results[1].first.txhash == tx1.GetHash());
+        BOOST_CHECK_EQUAL(results[1].first.index, 1);
+        BOOST_CHECK_EQUAL(results[1].second.amount, 3 * COIN);
+        BOOST_CHECK(results[2].first.txhash == tx2.GetHash());
+        BOOST_CHECK_EQUAL(results[2].second.amount, 1 * COIN);
+        BOOST_CHECK_EQUAL(results[2].second.time, 20);
+
+        results.clear();
+        BOOST_CHECK(pool.getAddressIndex(addressesB, BLAST, results));
+        BOOST_CHECK_EQUAL(results.size(), 2);
+        results.clear();
+        BOOST_CHECK(pool.getAddressIndex(addressesB, "ASSET", results));
+        BOOST_CHECK(results.empty());
+
+        CSpentIndexKey spentKey(outA.hash, outA.n);
+        CSpentIndexValue spentValue;
+        BOOST_CHECK(pool.getSpentIndex(spentKey, spentValue));
+        BOOST_CHECK(spentValue.txid == tx1.GetHash());
+        BOOST_CHECK_EQUAL(spentValue.inputIndex, 0);
+        BOOST_CHECK_EQUAL(spentValue.satoshis, 5 * COIN);
+        BOOST_CHECK_EQUAL(spentValue.addressType, 1);
+        BOOST_CHECK(spentValue.addressHash == hashA);
+
+        // Removing tx1 unlinks its entries from the middle and the head of the lists
+        pool.removeRecursive(tx1);
+        results.clear();
+        BOOST_CHECK(pool.getAddressIndex(addressesA, results));
+        BOOST_CHECK_EQUAL(results.size(), 1);
+        BOOST_CHECK(results[0].first.txhash == tx2.GetHash());
+        results.clear();
+        BOOST_CHECK(pool.getAddressIndex(addressesB, results));
+        BOOST_CHECK_EQUAL(results.size(), 1);
+        BOOST_CHECK_EQUAL(results[0].first.spending, 1);
+        BOOST_CHECK(!pool.getSpentIndex(spentKey, spentValue));
+        CSpentIndexKey spentKeyB(outB.hash, outB.n);
+        BOOST_CHECK(pool.getSpentIndex(spentKeyB, spentValue));
+
+        // A transaction added again is linked at the tail
+        pool.addUnchecked(tx1.GetHash(), entry1);
+        pool.addAddressIndex(entry1, view);
+        results.clear();
+        BOOST_CHECK(pool.getAddressIndex(addressesA, results));
+        BOOST_CHECK_EQUAL(results.size(), 3);
+        BOOST_CHECK(results[0].first.txhash == tx2.GetHash());
+        BOOST_CHECK(results[2].first.txhash == tx1.GetHash());
+
+        pool.clear();
+        results.clear();
+        BOOST_CHECK(pool.getAddressIndex(addressesA, results));
+        BOOST_CHECK(pool.getAddressIndex(addressesB, results));
+        BOOST_CHECK(results.empty());
+        BOOST_CHECK(!pool.getSpentIndex(spentKeyB, spentValue));
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -11,6 +11,7 @@
 #include "streams.h"
 #include "net.h"
 #include "netbase.h"
+#include "socketevents.h"
 #include "chainparams.h"
 #include "util.h"
 
@@ -198,4 +199,65 @@ BOOST_FIXTURE_TEST_SUITE(net_tests, BasicTestingSetup)
         BOOST_CHECK(pnode2->fFeeler == false);
     }
 
+#ifndef WIN32
+    static void CheckSocketEvents(SocketEventsMode mode)
+    {
+        CSocketEvents socketEvents(mode);
+        BOOST_CHECK_EQUAL(socketEvents.GetMode(), mode);
+
+        int fds[2];
+        BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        SOCKET hSocket = fds[0];
+        SOCKET hRemote = fds[1];
+        BOOST_CHECK(SetSocketNonBlocking(hSocket, true));
+        BOOST_CHECK(socketEvents.Register(hSocket, 7, true));
+
+        std::vector<CSocketWait> vWait;
+        std::vector<CSocketEvent> vEvents;
+        if (mode == SOCKETEVENTS_SELECT)
+            vWait.emplace_back(hSocket, 7, true, false);
+
+        // Nothing to read yet, the epoll instance reports the socket as writable once
+        BOOST_CHECK(socketEvents.Wait(vWait, vEvents, 0));
+        for (const CSocketEvent& event : vEvents) {
+            BOOST_CHECK_EQUAL(event.nId, 7U);
+            BOOST_CHECK(!event.fRecv);
+        }
+
+        char ch = 'x';
+        BOOST_CHECK_EQUAL(send(hRemote, &ch, 1, 0), 1);
+        vEvents.clear();
+        BOOST_CHECK(socketEvents.Wait(vWait, vEvents, 1000));
+        BOOST_REQUIRE_EQUAL(vEvents.size(), 1U);
+        BOOST_CHECK_EQUAL(vEvents[0].nId, 7U);
+        BOOST_CHECK(vEvents[0].fRecv);
+        BOOST_CHECK_EQUAL(recv(hSocket, &ch, 1, 0), 1);
+
+        // The peer hanging up shows as readable (and an error with epoll)
+        CloseSocket(hRemote);
+        vEvents.clear();
+        BOOST_CHECK(socketEvents.Wait(vWait, vEvents, 1000));
+        BOOST_REQUIRE_EQUAL(vEvents.size(), 1U);
+        BOOST_CHECK(vEvents[0].fRecv);
+        BOOST_CHECK_EQUAL(recv(hSocket, &ch, 1, 0), 0);
+        CloseSocket(hSocket);
+    }
+
+    BOOST_AUTO_TEST_CASE(socket_events_test)
+    {
+        SocketEventsMode mode;
+        BOOST_CHECK(ParseSocketEventsMode("select", mode));
+        BOOST_CHECK_EQUAL(mode, SOCKETEVENTS_SELECT);
+        BOOST_CHECK(!ParseSocketEventsMode("poll", mode));
+        BOOST_CHECK_EQUAL(GetSocketEventsModeName(SOCKETEVENTS_SELECT), "select");
+
+        CheckSocketEvents(SOCKETEVENTS_SELECT);
+#ifdef HAVE_EPOLL
+        BOOST_CHECK(ParseSocketEventsMode("epoll", mode));
+        BOOST_CHECK_EQUAL(mode, SOCKETEVENTS_EPOLL);
+        CheckSocketEvents(SOCKETEVENTS_EPOLL);
+#endif
+    }
+#endif
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "test_bitcoin.h"
+#include "auxpow/store.h"
+#include "blockfilereader.h"
 #include "chainparams.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
@@ -72,6 +74,8 @@ TestingSetup::TestingSetup(const std::string &chainName) : BasicTestingSetup(cha
 
     mempool.setSanityCheck(1.0);
     pblocktree = new CBlockTreeDB(1 << 20, true);
+    pauxpowstore = new CAuxPowStore(GetDataDir() / "blocks" / "auxpow.dat");
+    pblockfilereader = new CBlockFileReader(GetDataDir() / "blocks");
     pcoinsdbview = new CCoinsViewDB(1 << 23, true);
     pcoinsTip = new CCoinsViewCache(pcoinsdbview);
     if (!LoadGenesisBlock(chainparams))
@@ -88,8 +92,13 @@ TestingSetup::TestingSetup(const std::string &chainName) : BasicTestingSetup(cha
         }
     }
     nScriptCheckThreads = 3;
-    for (int i = 0; i < nScriptCheckThreads - 1; i++)
+    for (int i = 0; i < nScriptCheckThreads - 1; i++) {
         threadGroup.create_thread(&ThreadScriptCheck);
+        threadGroup.create_thread(&ThreadAssetCheck);
+    }
+    nHeaderCheckThreads = 3;
+    for (int i = 0; i < nHeaderCheckThreads - 1; i++)
+        threadGroup.create_thread(&ThreadHeaderCheck);
     g_connman = std::unique_ptr<CConnman>(new CConnman(0x1337, 0x1337)); // Deterministic randomness for tests.
     connman = g_connman.get();
     peerLogic.reset(new PeerLogicValidation(connman));
@@ -107,6 +116,9 @@ TestingSetup::~TestingSetup()
     delete pcoinsTip;
     delete pcoinsdbview;
     delete pblocktree;
+    delete pauxpowstore;
+    delete pblockfilereader;
+    pblockfilereader = nullptr;
     delete passets;
     fs::remove_all(pathTemp);
 }
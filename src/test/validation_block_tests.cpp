@@ -0,0 +1,96 @@
+// Copyright (c) 2018 The BLAST Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain.h"
+#include "chainparams.h"
+#include "coins.h"
+#include "consensus/merkle.h"
+#include "miner.h"
+#include "pow.h"
+#include "validation.h"
+#include "test/test_bitcoin.h"
+
+#include <atomic>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validation_block_tests, TestChain100Setup)
+
+/** Build a block on hashPrev from the template, the branch number keeps the blocks of different branches apart */
+static std::shared_ptr<const CBlock> BuildBlock(const CBlock& tmpl, const uint256& hashPrev, int nHeight, uint32_t nTime, int nBranch)
+{
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>(tmpl);
+    pblock->hashPrevBlock = hashPrev;
+    pblock->nTime = nTime;
+    pblock->nNonce = 0;
+
+    CMutableTransaction txCoinbase(*pblock->vtx[0]);
+    txCoinbase.vin[0].scriptSig = CScript() << nHeight << CScriptNum(nBranch);
+    pblock->vtx.resize(1);
+    pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
+    pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
+
+    while (!CheckProofOfWork(pblock->GetHash(), pblock->nBits, Params().GetConsensus())) ++pblock->nNonce;
+    return pblock;
+}
+
+BOOST_AUTO_TEST_CASE(competing_blocks_concurrent)
+{
+    const CChainParams& chainparams = Params();
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_REQUIRE(pblocktemplate);
+    const CBlock& tmpl = pblocktemplate->block;
+
+    const CBlockIndex* pindexFork;
+    {
+        LOCK(cs_main);
+        pindexFork = chainActive.Tip();
+    }
+
+    // Two peers each relay a branch off the tip, the second one a block longer than the first
+    std::vector<std::shared_ptr<const CBlock>> vBranch[2];
+    for (int nBranch = 0; nBranch < 2; nBranch++) {
+        uint256 hashPrev = pindexFork->GetBlockHash();
+        for (int i = 0; i < 5 + nBranch; i++) {
+            std::shared_ptr<const CBlock> pblock = BuildBlock(tmpl, hashPrev, pindexFork->nHeight + 1 + i, tmpl.nTime + i, nBranch);
+            hashPrev = pblock->GetHash();
+            vBranch[nBranch].push_back(pblock);
+        }
+    }
+
+    // Process both branches at the same time, the way the message handler threads of the two peers do
+    std::atomic<int> nFailed(0);
+    std::vector<std::thread> vThreads;
+    for (int nBranch = 0; nBranch < 2; nBranch++) {
+        vThreads.emplace_back([&, nBranch] {
+            for (const std::shared_ptr<const CBlock>& pblock : vBranch[nBranch]) {
+                if (!ProcessNewBlock(chainparams, pblock, true, nullptr))
+                    nFailed++;
+            }
+        });
+    }
+    for (std::thread& thread : vThreads)
+        thread.join();
+    BOOST_CHECK_EQUAL(nFailed, 0);
+
+    // The node ends on the longer branch, and the active chain and the coins view agree on it
+    LOCK(cs_main);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == vBranch[1].back()->GetHash());
+    BOOST_CHECK(pcoinsTip->GetBestBlock() == chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK(chainActive[pindexFork->nHeight] == pindexFork);
+    for (size_t i = 0; i < vBranch[1].size(); i++)
+        BOOST_CHECK(chainActive[pindexFork->nHeight + 1 + i]->GetBlockHash() == vBranch[1][i]->GetHash());
+
+    // The shorter branch is stored, but none of it is active
+    for (const std::shared_ptr<const CBlock>& pblock : vBranch[0]) {
+        BlockMap::iterator mi = mapBlockIndex.find(pblock->GetHash());
+        BOOST_REQUIRE(mi != mapBlockIndex.end());
+        BOOST_CHECK(mi->second->nStatus & BLOCK_HAVE_DATA);
+        BOOST_CHECK(!chainActive.Contains(mi->second));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -69,6 +69,34 @@ struct CTimestampIndexKey {
     }
 };
 
+struct CTimestampIndexValue {
+    bool fMainChain;
+
+    size_t GetSerializeSize() const {
+        return 1;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, fMainChain);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        fMainChain = ser_readdata8(s) != 0;
+    }
+
+    CTimestampIndexValue(bool fMainChainIn) {
+        fMainChain = fMainChainIn;
+    }
+
+    CTimestampIndexValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        fMainChain = false;
+    }
+};
+
 struct CTimestampBlockIndexKey {
     uint256 blockHash;
 
@@ -6,6 +6,8 @@
 
 #include "txdb.h"
 
+#include "assets/assetdb.h"
+#include "auxpow/store.h"
 #include "chainparams.h"
 #include "hash.h"
 #include "random.h"
@@ -16,7 +18,9 @@
 #include "init.h"
 #include "validation.h"
 
+#include <queue>
 #include <stdint.h>
+#include <tuple>
 
 #include <boost/thread.hpp>
 
@@ -26,10 +30,18 @@ static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSINDEX_COMPACT = 'A';
+static const char DB_ADDRESSUNSPENTINDEX_COMPACT = 'U';
+static const char DB_ADDRESSINDEX_TXID = 'T';
+static const char DB_ADDRESSBALANCE = 'D';
+static const char DB_ADDRESSBALANCE_BEST_BLOCK = 'd';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_SPENTINDEX_COMPACT = 'P';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_BLOCK_INDEX_HEADER = 'h';
+//! Pre auxpow store header records, which carried the auxpow inline. Migrated on load.
 static const char DB_BLOCK_INDEX_AUXPOW = 'a';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -37,6 +49,14 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_INDEX_BUILDER_BEST_BLOCK = 'I';
+
+//! Set once the address index only holds compact ('A', 'U' and 'T') records
+static const std::string ADDRESS_INDEX_COMPACT_FLAG = "addressindexv2";
+//! Set once the timestamp index entries record whether their block is on the main chain
+static const std::string TIMESTAMP_INDEX_CHAIN_FLAG = "timestampindexv2";
+//! Set once the spent index entries moved to the compact ('P') records
+static const std::string SPENT_INDEX_COMPACT_FLAG = "spentindexv2";
 
 namespace {
 
@@ -239,20 +259,14 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     }
     batch.Write(DB_LAST_BLOCK, nLastFile);
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
-        const std::map<uint256, std::shared_ptr<CAuxPow> >::const_iterator auxIt = auxpows.find((*it)->GetBlockHash());
-        if (auxIt != auxpows.end()) {
-            batch.Write(std::make_pair(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), DB_BLOCK_INDEX_AUXPOW), CDiskBlockIndex(*it, auxIt->second));
+        if (auxpows.count((*it)->GetBlockHash())) {
+            batch.Write(std::make_pair(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), DB_BLOCK_INDEX_HEADER), CDiskBlockIndex(*it));
         }
         batch.Write(std::make_pair(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), DB_BLOCK_INDEX), **it);
     }
     return WriteBatch(batch, true);
 }
 
-bool CBlockTreeDB::ReadDiskBlockIndex(const uint256 &blkid, CDiskBlockIndex &diskblockindex)
-{
-    return Read(std::make_pair(std::make_pair(DB_BLOCK_INDEX, blkid), DB_BLOCK_INDEX_AUXPOW), diskblockindex);
-}
-
 bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
     return Read(std::make_pair(DB_TXINDEX, txid), pos);
 }
@@ -265,137 +279,344 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
 }
 
 bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(std::make_pair(DB_SPENTINDEX, key), value);
+    CSpentIndexCompactValue compact;
+    if (!Read(std::make_pair(DB_SPENTINDEX_COMPACT, CSpentIndexCompactKey(key)), compact))
+        return false;
+    value = compact.value;
+    return true;
 }
 
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
+static void BatchUpdateSpentIndex(CDBBatch& batch, const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
     for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
+            batch.Erase(std::make_pair(DB_SPENTINDEX_COMPACT, CSpentIndexCompactKey(it->first)));
         } else {
-            batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
+            batch.Write(std::make_pair(DB_SPENTINDEX_COMPACT, CSpentIndexCompactKey(it->first)), CSpentIndexCompactValue(it->second));
         }
     }
-    return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
+bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
     CDBBatch batch(*this);
+    BatchUpdateSpentIndex(batch, vect);
+    return WriteBatch(batch);
+}
+
+/** The id of an asset in the compact address index keys, BLAST has none of its own */
+static uint32_t AddressIndexAssetId(const std::string& assetName)
+{
+    return assetName == BLAST ? CAssetNameTable::NULL_ID : assetNameTable.GetOrAssign(assetName);
+}
+
+static bool FindAddressIndexAssetId(const std::string& assetName, uint32_t& assetId)
+{
+    assetId = CAssetNameTable::NULL_ID;
+    return assetName == BLAST || assetNameTable.GetId(assetName, assetId);
+}
+
+static bool AddressIndexAssetName(uint32_t assetId, std::string& assetName)
+{
+    if (assetId == CAssetNameTable::NULL_ID) {
+        assetName = BLAST;
+        return true;
+    }
+    if (assetId > assetNameTable.Size())
+        return error("%s: unknown asset id %u", __func__, assetId);
+    assetName = assetNameTable.Name(assetId);
+    return true;
+}
+
+/** Asset ids referenced by the compact keys have to reach the asset database before the keys do */
+static bool PersistAddressIndexAssetIds()
+{
+    if (assetNameTable.GetUnpersisted().empty())
+        return true;
+    if (!passetsdb)
+        return error("%s: no asset database to write the asset ids to", __func__);
+
+    CAssetsDBBatch batch(*passetsdb);
+    return batch.Commit();
+}
+
+//! Sort entries of several assets into the order of the original keys, keeping the order within an asset
+template<typename Entry>
+static void SortByAddressIndexAsset(std::vector<Entry>& vEntries)
+{
+    std::stable_sort(vEntries.begin(), vEntries.end(), [](const Entry& a, const Entry& b) {
+        return AddressIndexAssetOrder(a.first.asset, b.first.asset);
+    });
+}
+
+static void BatchUpdateAddressUnspentIndex(CDBBatch& batch, const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+            uint32_t assetId;
+            if (FindAddressIndexAssetId(it->first.asset, assetId))
+                batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX_COMPACT, CAddressUnspentCompactKey(it->first, assetId)));
         } else {
-            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX_COMPACT, CAddressUnspentCompactKey(it->first, AddressIndexAssetId(it->first.asset))),
+                        CAddressUnspentCompactValue(it->second));
         }
     }
-    return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
+    CDBBatch batch(*this);
+    BatchUpdateAddressUnspentIndex(batch, vect);
+    if (!PersistAddressIndexAssetIds())
+        return false;
+    return WriteBatch(batch);
+}
 
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+static bool ReadAddressUnspentIndexCompact(CDBIterator& cursor, uint160 addressHash, int type, const uint32_t* passetId,
+                                           const CAddressUnspentCompactKey* pkeyAfter, size_t nLimit,
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                                           CAddressUnspentCompactKey& keyLast, bool& fMore) {
 
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
+    // BLAST outputs sort first, so without an asset the scan starts at the first asset id
+    uint32_t assetIdStart = passetId ? *passetId : CAssetNameTable::NULL_ID + 1;
+    if (pkeyAfter) {
+        cursor.Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX_COMPACT, *pkeyAfter));
+    } else {
+        cursor.Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX_COMPACT, CAddressIndexCompactIteratorKey(type, addressHash, assetIdStart)));
+    }
 
-    while (pcursor->Valid()) {
+    fMore = false;
+    while (cursor.Valid()) {
         boost::this_thread::interruption_point();
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash
-                && (assetName.empty() || key.second.asset == assetName)) {
+        std::pair<char,CAddressUnspentCompactKey> key;
+        if (cursor.GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX_COMPACT && key.second.type == (unsigned int)type
+                && key.second.hashBytes == addressHash && (!passetId || key.second.assetId == *passetId)) {
+            if (pkeyAfter && key.second == *pkeyAfter) {
+                cursor.Next();
+                continue;
+            }
+            if (nLimit > 0 && unspentOutputs.size() >= nLimit) {
+                fMore = true;
+                break;
+            }
             CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
+            CAddressUnspentCompactValue compactValue(nValue);
+            std::string assetName;
+            if (!cursor.GetValue(compactValue))
                 return error("failed to get address unspent value");
-            }
+            if (!AddressIndexAssetName(key.second.assetId, assetName))
+                return false;
+            unspentOutputs.push_back(std::make_pair(CAddressUnspentKey(type, addressHash, assetName, key.second.txhash, key.second.index), nValue));
+            keyLast = key.second;
+            cursor.Next();
         } else {
             break;
         }
     }
-
     return true;
 }
 
+bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+
+    uint32_t assetId;
+    if (!FindAddressIndexAssetId(assetName, assetId))
+        return true;
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    CAddressUnspentCompactKey keyLast;
+    bool fMore;
+    return ReadAddressUnspentIndexCompact(*pcursor, addressHash, type, &assetId, nullptr, 0, unspentOutputs, keyLast, fMore);
+}
+
 bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vOutputs;
+    CAddressUnspentCompactKey keyLast;
+    bool fMore;
+    if (!ReadAddressUnspentIndexCompact(*pcursor, addressHash, type, nullptr, nullptr, 0, vOutputs, keyLast, fMore))
+        return false;
+    SortByAddressIndexAsset(vOutputs);
+    unspentOutputs.insert(unspentOutputs.end(), vOutputs.begin(), vOutputs.end());
+    return true;
+}
 
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+bool CBlockTreeDB::ReadAddressUnspentIndex(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                if (key.second.asset != "BLAST") {
-                    unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                }
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
-            }
-        } else {
-            break;
-        }
+    uint32_t assetId;
+    if (!assetName.empty() && !FindAddressIndexAssetId(assetName, assetId))
+        return true;
+
+    // One snapshot for all addresses, so a block connected meanwhile shows up for all of them or none
+    CDBSnapshot snapshot(*this);
+    boost::scoped_ptr<CDBIterator> pcursor(snapshot.NewIterator());
+    for (const auto& address : addresses) {
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vOutputs;
+        CAddressUnspentCompactKey keyLast;
+        bool fMore;
+        if (!ReadAddressUnspentIndexCompact(*pcursor, address.first, address.second, assetName.empty() ? nullptr : &assetId,
+                                            nullptr, 0, vOutputs, keyLast, fMore))
+            return false;
+        if (assetName.empty())
+            SortByAddressIndexAsset(vOutputs);
+        unspentOutputs.insert(unspentOutputs.end(), vOutputs.begin(), vOutputs.end());
     }
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndexPage(uint160 addressHash, int type, std::string assetName,
+                                               const CAddressUnspentCompactKey* pkeyAfter, size_t nLimit,
+                                               std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                                               CAddressUnspentCompactKey &keyLast, bool &fMore) {
 
+    fMore = false;
+    uint32_t assetId;
+    if (!assetName.empty() && !FindAddressIndexAssetId(assetName, assetId))
+        return true;
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vOutputs;
+    if (!ReadAddressUnspentIndexCompact(*pcursor, addressHash, type, assetName.empty() ? nullptr : &assetId, pkeyAfter, nLimit, vOutputs, keyLast, fMore))
+        return false;
+    unspentOutputs.insert(unspentOutputs.end(), vOutputs.begin(), vOutputs.end());
     return true;
 }
 
+static void BatchWriteAddressIndex(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+    CAddressIndexTxKey txKeyLast(-1);
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        batch.Write(std::make_pair(DB_ADDRESSINDEX_COMPACT, CAddressIndexCompactKey(it->first, AddressIndexAssetId(it->first.asset))),
+                    CAddressIndexCompactValue(it->second));
+        // The entries of a transaction are next to each other, its txid only needs writing once
+        CAddressIndexTxKey txKey(it->first.blockHeight, it->first.txindex);
+        if (txKey != txKeyLast) {
+            batch.Write(std::make_pair(DB_ADDRESSINDEX_TXID, txKey), it->first.txhash);
+            txKeyLast = txKey;
+        }
+    }
+}
+
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    BatchWriteAddressIndex(batch, vect);
+    if (!PersistAddressIndexAssetIds())
+        return false;
     return WriteBatch(batch);
 }
 
 bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        uint32_t assetId;
+        if (FindAddressIndexAssetId(it->first.asset, assetId))
+            batch.Erase(std::make_pair(DB_ADDRESSINDEX_COMPACT, CAddressIndexCompactKey(it->first, assetId)));
+        // Only used to disconnect whole blocks, so no other entry refers to the transaction any more
+        batch.Erase(std::make_pair(DB_ADDRESSINDEX_TXID, CAddressIndexTxKey(it->first.blockHeight, it->first.txindex)));
+    }
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+bool CBlockTreeDB::ReadAddressIndexCompact(uint160 addressHash, int type, const uint32_t* passetId, int start, int end,
+                                           const CAddressIndexCompactKey* pkeyAfter, size_t nLimit,
+                                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                           CAddressIndexCompactKey& keyLast, bool& fMore) {
 
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    // The txid rows are read from the same snapshot as the entries, a block disconnected meanwhile can't
+    // remove them in between
+    CDBSnapshot snapshot(*this);
+    boost::scoped_ptr<CDBIterator> pcursor(snapshot.NewIterator());
 
-    if (!assetName.empty() && start > 0 && end > 0) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX,
-                                     CAddressIndexIteratorHeightKey(type, addressHash, assetName, start)));
-    } else if (!assetName.empty()) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
+    if (pkeyAfter) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX_COMPACT, *pkeyAfter));
+    } else if (passetId) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX_COMPACT, CAddressIndexCompactIteratorKey(type, addressHash, *passetId, start)));
     } else {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX_COMPACT, CAddressIndexIteratorKey(type, addressHash)));
     }
 
+    fMore = false;
+    size_t nEntries = 0;
+    CAddressIndexTxKey txKeyLast(-1);
+    uint256 txhashLast;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
-        std::pair<char,CAddressIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash
-                && (assetName.empty() || key.second.asset == assetName)) {
+        std::pair<char,CAddressIndexCompactKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX_COMPACT && key.second.type == (unsigned int)type
+                && key.second.hashBytes == addressHash && (!passetId || key.second.assetId == *passetId)) {
+            if (pkeyAfter && key.second == *pkeyAfter) {
+                pcursor->Next();
+                continue;
+            }
+            // Skip over the heights outside of [start, end] of each asset
+            if (start > 0 && key.second.blockHeight < start) {
+                pcursor->Seek(std::make_pair(DB_ADDRESSINDEX_COMPACT, CAddressIndexCompactIteratorKey(type, addressHash, key.second.assetId, start)));
+                continue;
+            }
             if (end > 0 && key.second.blockHeight > end) {
+                if (passetId)
+                    break;
+                pcursor->Seek(std::make_pair(DB_ADDRESSINDEX_COMPACT, CAddressIndexCompactIteratorKey(type, addressHash, key.second.assetId + 1)));
+                continue;
+            }
+
+            // Pages end between transactions, so no transaction is split across them
+            CAddressIndexTxKey txKey(key.second.blockHeight, key.second.txindex);
+            if (nLimit > 0 && nEntries >= nLimit && (txKey != txKeyLast || key.second.assetId != keyLast.assetId)) {
+                fMore = true;
                 break;
             }
-            CAmount nValue;
-            if (pcursor->GetValue(nValue)) {
-                addressIndex.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
+
+            CAddressIndexCompactValue nValue;
+            if (!pcursor->GetValue(nValue))
                 return error("failed to get address index value");
+
+            std::string assetNameEntry;
+            if (!AddressIndexAssetName(key.second.assetId, assetNameEntry))
+                return false;
+
+            if (txKey != txKeyLast) {
+                if (!snapshot.Read(std::make_pair(DB_ADDRESSINDEX_TXID, txKey), txhashLast))
+                    return error("failed to get the txid at height %d position %u", txKey.blockHeight, txKey.txindex);
+                txKeyLast = txKey;
             }
+
+            addressIndex.push_back(std::make_pair(CAddressIndexKey(type, addressHash, assetNameEntry, key.second.blockHeight, key.second.txindex,
+                                                                   txhashLast, key.second.index, key.second.spending), nValue.amount));
+            keyLast = key.second;
+            nEntries++;
+            pcursor->Next();
         } else {
             break;
         }
     }
+    return true;
+}
 
+bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                    int start, int end) {
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+    CAddressIndexCompactKey keyLast;
+    bool fMore;
+    if (!assetName.empty()) {
+        uint32_t assetId;
+        if (!FindAddressIndexAssetId(assetName, assetId))
+            return true;
+        if (!ReadAddressIndexCompact(addressHash, type, &assetId, start > 0 && end > 0 ? start : 0, end,
+                                     nullptr, 0, vEntries, keyLast, fMore))
+            return false;
+    } else {
+        if (!ReadAddressIndexCompact(addressHash, type, nullptr, 0, 0, nullptr, 0, vEntries, keyLast, fMore))
+            return false;
+        // Keep the results of the original keys, which went through the assets by name and stopped at
+        // the first entry past the end height
+        SortByAddressIndexAsset(vEntries);
+        if (end > 0) {
+            auto itEnd = std::find_if(vEntries.begin(), vEntries.end(), [end](const std::pair<CAddressIndexKey, CAmount>& entry) {
+                return entry.first.blockHeight > end;
+            });
+            vEntries.erase(itEnd, vEntries.end());
+        }
+    }
+    addressIndex.insert(addressIndex.end(), vEntries.begin(), vEntries.end());
     return true;
 }
 
@@ -406,39 +627,496 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return CBlockTreeDB::ReadAddressIndex(addressHash, type, "", addressIndex, start, end);
 }
 
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
+namespace {
+//! The next entry of one address in ReadAddressIndex over several addresses
+struct AddressIndexMergeEntry {
+    CAddressIndexCompactKey key;
+    size_t nCursor;
+};
+
+//! Orders the heap so the entry that comes first in the chain is on top, ties going to the earlier address
+struct AddressIndexMergeAfter {
+    bool operator()(const AddressIndexMergeEntry& a, const AddressIndexMergeEntry& b) const {
+        return std::tie(a.key.blockHeight, a.key.txindex, a.nCursor, a.key.index, a.key.spending) >
+               std::tie(b.key.blockHeight, b.key.txindex, b.nCursor, b.key.index, b.key.spending);
+    }
+};
+}
+
+bool CBlockTreeDB::ReadAddressIndex(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                    int start, int end) {
+
+    uint32_t assetId;
+    if (!FindAddressIndexAssetId(assetName, assetId))
+        return true;
+    if (start <= 0 || end <= 0)
+        start = end = 0;
+
+    // The keys of one address and asset are in chain order already, so the addresses are merged as they're
+    // read, from one snapshot so a block connected meanwhile shows up for all of them or none
+    CDBSnapshot snapshot(*this);
+    std::vector<std::unique_ptr<CDBIterator> > vCursors;
+    std::priority_queue<AddressIndexMergeEntry, std::vector<AddressIndexMergeEntry>, AddressIndexMergeAfter> heap;
+
+    auto pushNext = [&](size_t nCursor) -> bool {
+        CDBIterator& cursor = *vCursors[nCursor];
+        const std::pair<uint160, int>& address = addresses[nCursor];
+        std::pair<char, CAddressIndexCompactKey> key;
+        if (!cursor.Valid() || !cursor.GetKey(key) || key.first != DB_ADDRESSINDEX_COMPACT || key.second.type != (unsigned int)address.second ||
+                key.second.hashBytes != address.first || key.second.assetId != assetId || (end > 0 && key.second.blockHeight > end))
+            return false;
+        heap.push(AddressIndexMergeEntry{key.second, nCursor});
+        return true;
+    };
+
+    for (size_t i = 0; i < addresses.size(); i++) {
+        vCursors.emplace_back(snapshot.NewIterator());
+        vCursors[i]->Seek(std::make_pair(DB_ADDRESSINDEX_COMPACT, CAddressIndexCompactIteratorKey(addresses[i].second, addresses[i].first, assetId, start)));
+        pushNext(i);
+    }
+
+    CAddressIndexTxKey txKeyLast(-1);
+    uint256 txhashLast;
+    while (!heap.empty()) {
+        boost::this_thread::interruption_point();
+        AddressIndexMergeEntry entry = heap.top();
+        heap.pop();
+        CDBIterator& cursor = *vCursors[entry.nCursor];
+
+        CAddressIndexCompactValue nValue;
+        if (!cursor.GetValue(nValue))
+            return error("failed to get address index value");
+
+        // Entries of the same transaction come out next to each other, whichever address they belong to
+        CAddressIndexTxKey txKey(entry.key.blockHeight, entry.key.txindex);
+        if (txKey != txKeyLast) {
+            if (!snapshot.Read(std::make_pair(DB_ADDRESSINDEX_TXID, txKey), txhashLast))
+                return error("failed to get the txid at height %d position %u", txKey.blockHeight, txKey.txindex);
+            txKeyLast = txKey;
+        }
+
+        addressIndex.push_back(std::make_pair(CAddressIndexKey(entry.key.type, entry.key.hashBytes, assetName, entry.key.blockHeight, entry.key.txindex,
+                                                               txhashLast, entry.key.index, entry.key.spending), nValue.amount));
+        cursor.Next();
+        pushNext(entry.nCursor);
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressIndexPage(uint160 addressHash, int type, std::string assetName, int start, int end,
+                                        const CAddressIndexCompactKey* pkeyAfter, size_t nLimit,
+                                        std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                        CAddressIndexCompactKey &keyLast, bool &fMore) {
+
+    fMore = false;
+    uint32_t assetId;
+    if (!assetName.empty() && !FindAddressIndexAssetId(assetName, assetId))
+        return true;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+    if (!ReadAddressIndexCompact(addressHash, type, assetName.empty() ? nullptr : &assetId, start, end, pkeyAfter, nLimit, vEntries, keyLast, fMore))
+        return false;
+    addressIndex.insert(addressIndex.end(), vEntries.begin(), vEntries.end());
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressBalanceBestBlock(uint256& hashBlock) {
+    return Read(DB_ADDRESSBALANCE_BEST_BLOCK, hashBlock);
+}
+
+bool CBlockTreeDB::EraseAddressBalanceBestBlock() {
+    return Erase(DB_ADDRESSBALANCE_BEST_BLOCK);
+}
+
+bool CBlockTreeDB::UpdateAddressBalances(const std::vector<std::pair<CAddressIndexKey, CAmount> >&vect, bool fUndo, const uint256& hashBlock) {
+    // Sum up the changes per address and asset first. The entries of a transaction are next to each
+    // other, so counting changes of position counts the transactions.
+    std::map<CAddressBalanceKey, std::pair<CAddressBalanceValue, CAddressIndexTxKey> > mapDelta;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        auto& delta = mapDelta[CAddressBalanceKey(it->first.type, it->first.hashBytes, AddressIndexAssetId(it->first.asset))];
+        delta.first.balance += it->second;
+        if (it->second > 0)
+            delta.first.received += it->second;
+        CAddressIndexTxKey txKey(it->first.blockHeight, it->first.txindex);
+        if (delta.first.txcount == 0 || txKey != delta.second) {
+            delta.first.txcount++;
+            delta.second = txKey;
+        }
+    }
+
     CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
+    for (const auto& item : mapDelta) {
+        CAddressBalanceValue balance;
+        Read(std::make_pair(DB_ADDRESSBALANCE, item.first), balance);
+        const CAddressBalanceValue& delta = item.second.first;
+        if (fUndo) {
+            balance.balance -= delta.balance;
+            balance.received -= delta.received;
+            balance.txcount -= delta.txcount;
+        } else {
+            balance.balance += delta.balance;
+            balance.received += delta.received;
+            balance.txcount += delta.txcount;
+        }
+        if (balance.IsNull())
+            batch.Erase(std::make_pair(DB_ADDRESSBALANCE, item.first));
+        else
+            batch.Write(std::make_pair(DB_ADDRESSBALANCE, item.first), balance);
+    }
+    batch.Write(DB_ADDRESSBALANCE_BEST_BLOCK, hashBlock);
+
+    if (!PersistAddressIndexAssetIds())
+        return false;
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes) {
+bool CBlockTreeDB::ReadAddressBalance(uint160 addressHash, int type, std::string assetName, CAddressBalanceValue& balance) {
+    balance.SetNull();
+    uint32_t assetId;
+    if (FindAddressIndexAssetId(assetName, assetId))
+        Read(std::make_pair(DB_ADDRESSBALANCE, CAddressBalanceKey(type, addressHash, assetId)), balance);
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressBalances(uint160 addressHash, int type, std::vector<std::pair<std::string, CAddressBalanceValue> >& balances) {
 
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
-    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+    pcursor->Seek(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)));
 
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
-        std::pair<char, CTimestampIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
-            if (fActiveOnly) {
-                if (HashOnchainActive(key.second.blockHash)) {
-                    hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
+        std::pair<char, CAddressBalanceKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSBALANCE && key.second.type == (unsigned int)type
+                && key.second.hashBytes == addressHash) {
+            CAddressBalanceValue balance;
+            std::string assetName;
+            if (!pcursor->GetValue(balance))
+                return error("failed to get address balance");
+            if (!AddressIndexAssetName(key.second.assetId, assetName))
+                return false;
+            balances.emplace_back(assetName, balance);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::RebuildAddressBalances(int nMaxHeight, const uint256& hashBlock) {
+    LogPrintf("Rebuilding address balances up to height %d...\n", nMaxHeight);
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    CDBBatch batch(*this);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    // Until the last batch is written the balances don't belong to any block
+    batch.Erase(DB_ADDRESSBALANCE_BEST_BLOCK);
+    pcursor->Seek(DB_ADDRESSBALANCE);
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressBalanceKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSBALANCE)
+            break;
+        batch.Erase(key);
+        if (batch.SizeEstimate() > batch_size) {
+            if (!WriteBatch(batch))
+                return error("%s: failed to erase address balances", __func__);
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+
+    // The compact keys are sorted by address and asset, so every total is summed up from one run of
+    // entries. The genesis block has no entries.
+    int64_t nBalances = 0;
+    bool fHaveBalance = false;
+    CAddressBalanceKey balanceKey;
+    CAddressBalanceValue balance;
+    CAddressIndexTxKey txKeyLast;
+    auto fnWriteBalance = [&]() {
+        if (fHaveBalance && !balance.IsNull()) {
+            batch.Write(std::make_pair(DB_ADDRESSBALANCE, balanceKey), balance);
+            nBalances++;
+        }
+    };
+
+    pcursor->Seek(DB_ADDRESSINDEX_COMPACT);
+    while (nMaxHeight > 0 && pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressIndexCompactKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX_COMPACT)
+            break;
+
+        const CAddressIndexCompactKey& entry = key.second;
+        if (entry.blockHeight <= nMaxHeight) {
+            CAddressIndexCompactValue value;
+            if (!pcursor->GetValue(value))
+                return error("%s: failed to read address index entry", __func__);
+
+            CAddressBalanceKey entryKey(entry.type, entry.hashBytes, entry.assetId);
+            if (!fHaveBalance || entryKey != balanceKey) {
+                fnWriteBalance();
+                if (batch.SizeEstimate() > batch_size) {
+                    if (!WriteBatch(batch))
+                        return error("%s: failed to write address balances", __func__);
+                    batch.Clear();
                 }
-            } else {
-                hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
+                fHaveBalance = true;
+                balanceKey = entryKey;
+                balance.SetNull();
             }
 
-            pcursor->Next();
-        } else {
+            balance.balance += value.amount;
+            if (value.amount > 0)
+                balance.received += value.amount;
+            CAddressIndexTxKey txKey(entry.blockHeight, entry.txindex);
+            if (balance.txcount == 0 || txKey != txKeyLast) {
+                balance.txcount++;
+                txKeyLast = txKey;
+            }
+        }
+        pcursor->Next();
+    }
+    fnWriteBalance();
+
+    batch.Write(DB_ADDRESSBALANCE_BEST_BLOCK, hashBlock);
+    if (!WriteBatch(batch, true))
+        return error("%s: failed to write address balances", __func__);
+
+    LogPrintf("Rebuilt %d address balances\n", nBalances);
+    return true;
+}
+
+bool CBlockTreeDB::UpgradeAddressIndex() {
+    bool fCompact = false;
+    if (ReadFlag(ADDRESS_INDEX_COMPACT_FLAG, fCompact) && fCompact)
+        return true;
+
+    // Nothing to upgrade on new databases and nodes without the address index
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    char chPrefix;
+    pcursor->Seek(DB_ADDRESSINDEX);
+    bool fIndex = pcursor->Valid() && pcursor->GetKey(chPrefix) && chPrefix == DB_ADDRESSINDEX;
+    pcursor->Seek(DB_ADDRESSUNSPENTINDEX);
+    fIndex |= pcursor->Valid() && pcursor->GetKey(chPrefix) && chPrefix == DB_ADDRESSUNSPENTINDEX;
+    if (!fIndex)
+        return WriteFlag(ADDRESS_INDEX_COMPACT_FLAG, true);
+
+    LogPrintf("Upgrading address index database...\n");
+    uiInterface.ShowProgress(_("Upgrading address index database"), 0, true);
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    CDBBatch batch(*this);
+    int64_t nEntries = 0;
+    int64_t nUnspent = 0;
+
+    // Every old record is erased in the batch that writes its replacement, so an interrupted upgrade
+    // picks up where it stopped
+    auto fnWriteBatch = [&]() {
+        if (!PersistAddressIndexAssetIds() || !WriteBatch(batch))
+            return false;
+        batch.Clear();
+        return true;
+    };
+
+    pcursor->Seek(DB_ADDRESSINDEX);
+    while (pcursor->Valid() && !ShutdownRequested()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX)
+            break;
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("%s: failed to read address index entry", __func__);
+
+        const CAddressIndexKey& entry = key.second;
+        batch.Write(std::make_pair(DB_ADDRESSINDEX_COMPACT, CAddressIndexCompactKey(entry, AddressIndexAssetId(entry.asset))),
+                    CAddressIndexCompactValue(nValue));
+        batch.Write(std::make_pair(DB_ADDRESSINDEX_TXID, CAddressIndexTxKey(entry.blockHeight, entry.txindex)), entry.txhash);
+        batch.Erase(key);
+
+        if (++nEntries % 100000 == 0)
+            LogPrintf("Upgraded %d address index entries...\n", nEntries);
+        if (batch.SizeEstimate() > batch_size && !fnWriteBatch())
+            return error("%s: failed to write upgraded address index entries", __func__);
+        pcursor->Next();
+    }
+
+    pcursor->Seek(DB_ADDRESSUNSPENTINDEX);
+    while (pcursor->Valid() && !ShutdownRequested()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CAddressUnspentKey> keyUnspent;
+        if (!pcursor->GetKey(keyUnspent) || keyUnspent.first != DB_ADDRESSUNSPENTINDEX)
+            break;
+        CAddressUnspentValue value;
+        if (!pcursor->GetValue(value))
+            return error("%s: failed to read address unspent index entry", __func__);
+
+        batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX_COMPACT, CAddressUnspentCompactKey(keyUnspent.second, AddressIndexAssetId(keyUnspent.second.asset))),
+                    CAddressUnspentCompactValue(value));
+        batch.Erase(keyUnspent);
+
+        ++nUnspent;
+        if (batch.SizeEstimate() > batch_size && !fnWriteBatch())
+            return error("%s: failed to write upgraded address unspent index entries", __func__);
+        pcursor->Next();
+    }
+
+    if (!fnWriteBatch())
+        return error("%s: failed to write upgraded address index entries", __func__);
+    uiInterface.ShowProgress("", 100, false);
+    if (ShutdownRequested()) {
+        LogPrintf("Address index upgrade interrupted after %d entries and %d unspent outputs\n", nEntries, nUnspent);
+        return false;
+    }
+
+    CompactRange(DB_ADDRESSINDEX, static_cast<char>(DB_ADDRESSINDEX + 1));
+    CompactRange(DB_ADDRESSUNSPENTINDEX, static_cast<char>(DB_ADDRESSUNSPENTINDEX + 1));
+    LogPrintf("Upgraded %d address index entries and %d unspent outputs\n", nEntries, nUnspent);
+    return WriteFlag(ADDRESS_INDEX_COMPACT_FLAG, true);
+}
+
+bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex, const CTimestampIndexValue &value) {
+    CDBBatch batch(*this);
+    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), value);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly,
+                                      const std::function<bool(const uint256&, unsigned int)> &fn) {
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CTimestampIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_TIMESTAMPINDEX || key.second.timestamp >= high)
             break;
+
+        if (fActiveOnly) {
+            CTimestampIndexValue value;
+            if (!pcursor->GetValue(value))
+                return error("%s: failed to read timestamp index entry", __func__);
+            if (!value.fMainChain) {
+                pcursor->Next();
+                continue;
+            }
         }
+        if (!fn(key.second.blockHash, key.second.timestamp))
+            break;
+
+        pcursor->Next();
     }
 
     return true;
 }
 
+bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes) {
+    return ReadTimestampIndex(high, low, fActiveOnly, [&hashes](const uint256& hash, unsigned int timestamp) {
+        hashes.push_back(std::make_pair(hash, timestamp));
+        return true;
+    });
+}
+
+bool CBlockTreeDB::UpgradeTimestampIndex() {
+    bool fUpgraded = false;
+    if (ReadFlag(TIMESTAMP_INDEX_CHAIN_FLAG, fUpgraded) && fUpgraded)
+        return true;
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(0)));
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    CDBBatch batch(*this);
+    int64_t nEntries = 0;
+
+    // Rewriting an entry is idempotent, an interrupted upgrade simply runs again
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CTimestampIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_TIMESTAMPINDEX)
+            break;
+
+        batch.Write(key, CTimestampIndexValue(HashOnchainActive(key.second.blockHash)));
+        ++nEntries;
+        if (batch.SizeEstimate() > batch_size) {
+            if (!WriteBatch(batch))
+                return error("%s: failed to write upgraded timestamp index entries", __func__);
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+
+    if (!WriteBatch(batch))
+        return error("%s: failed to write upgraded timestamp index entries", __func__);
+    if (nEntries > 0)
+        LogPrintf("Upgraded %d timestamp index entries\n", nEntries);
+    return WriteFlag(TIMESTAMP_INDEX_CHAIN_FLAG, true);
+}
+
+bool CBlockTreeDB::UpgradeSpentIndex() {
+    bool fCompact = false;
+    if (ReadFlag(SPENT_INDEX_COMPACT_FLAG, fCompact) && fCompact)
+        return true;
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    char chPrefix;
+    pcursor->Seek(DB_SPENTINDEX);
+    if (!pcursor->Valid() || !pcursor->GetKey(chPrefix) || chPrefix != DB_SPENTINDEX)
+        return WriteFlag(SPENT_INDEX_COMPACT_FLAG, true);
+
+    LogPrintf("Compacting spent index database...\n");
+    uiInterface.ShowProgress(_("Compacting spent index database"), 0, true);
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    CDBBatch batch(*this);
+    int64_t nEntries = 0;
+    uint64_t nBytesBefore = 0;
+    uint64_t nBytesAfter = 0;
+
+    // Every entry is erased in the batch that writes its compact replacement, so an interrupted upgrade
+    // picks up where it stopped
+    while (pcursor->Valid() && !ShutdownRequested()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CSpentIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_SPENTINDEX)
+            break;
+        CSpentIndexValue value;
+        if (!pcursor->GetValue(value))
+            return error("%s: failed to read spent index entry", __func__);
+
+        size_t nSize = ::GetSerializeSize(key, SER_DISK, CLIENT_VERSION) + ::GetSerializeSize(value, SER_DISK, CLIENT_VERSION);
+        nBytesBefore += nSize;
+        ++nEntries;
+
+        std::pair<char, CSpentIndexCompactKey> keyCompact(DB_SPENTINDEX_COMPACT, CSpentIndexCompactKey(key.second));
+        CSpentIndexCompactValue valueCompact(value);
+        batch.Write(keyCompact, valueCompact);
+        batch.Erase(key);
+        nBytesAfter += ::GetSerializeSize(keyCompact, SER_DISK, CLIENT_VERSION) + ::GetSerializeSize(valueCompact, SER_DISK, CLIENT_VERSION);
+
+        if (batch.SizeEstimate() > batch_size) {
+            if (!WriteBatch(batch))
+                return error("%s: failed to write compacted spent index entries", __func__);
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+
+    if (!WriteBatch(batch))
+        return error("%s: failed to write compacted spent index entries", __func__);
+    uiInterface.ShowProgress("", 100, false);
+    if (ShutdownRequested()) {
+        LogPrintf("Spent index compaction interrupted after %d entries\n", nEntries);
+        return false;
+    }
+
+    CompactRange(DB_SPENTINDEX, static_cast<char>(DB_SPENTINDEX + 1));
+    LogPrintf("Compacted %d spent index entries, %d bytes down to %d bytes\n", nEntries, nBytesBefore, nBytesAfter);
+    return WriteFlag(SPENT_INDEX_COMPACT_FLAG, true);
+}
+
 bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
     CDBBatch batch(*this);
     batch.Write(std::make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
@@ -455,6 +1133,38 @@ bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &lt
     return true;
 }
 
+bool CBlockTreeDB::ReadIndexBuilderBestBlock(uint256 &hashBlock) {
+    return Read(DB_INDEX_BUILDER_BEST_BLOCK, hashBlock);
+}
+
+bool CBlockTreeDB::WriteIndexBuilderBestBlock(const uint256 &hashBlock) {
+    return Write(DB_INDEX_BUILDER_BEST_BLOCK, hashBlock);
+}
+
+bool CBlockTreeDB::EraseIndexBuilderBestBlock() {
+    return Erase(DB_INDEX_BUILDER_BEST_BLOCK, true);
+}
+
+bool CBlockTreeDB::WriteIndexBuilderBatch(const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                          const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &addressUnspentIndex,
+                                          const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &spentIndex,
+                                          const std::vector<std::pair<uint256, unsigned int> > &timestampIndex,
+                                          const uint256 &hashBlock) {
+    CDBBatch batch(*this);
+    BatchWriteAddressIndex(batch, addressIndex);
+    BatchUpdateAddressUnspentIndex(batch, addressUnspentIndex);
+    BatchUpdateSpentIndex(batch, spentIndex);
+    for (const auto& item : timestampIndex) {
+        batch.Write(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexKey(item.second, item.first)), CTimestampIndexValue(true));
+        batch.Write(std::make_pair(DB_BLOCKHASHINDEX, CTimestampBlockIndexKey(item.first)), CTimestampBlockIndexValue(item.second));
+    }
+    batch.Write(DB_INDEX_BUILDER_BEST_BLOCK, hashBlock);
+
+    if (!PersistAddressIndexAssetIds())
+        return false;
+    return WriteBatch(batch);
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -471,58 +1181,79 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    auto ssKeySet(std::make_pair(std::make_pair(DB_BLOCK_INDEX, uint256()), DB_BLOCK_INDEX_AUXPOW));
-    pcursor->Seek(ssKeySet);
+    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+
+    // Every block has a header record and a 'b' record holding its status and positions, which is
+    // rewritten on every status change and so takes precedence for those fields
+    CDBBatch batch(*this);
+    size_t nMigrated = 0;
 
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<std::pair<char, uint256>, char> key;
-        if (pcursor->GetKey(key) && key.first.first == DB_BLOCK_INDEX) {
-
-            assert(key.second == DB_BLOCK_INDEX_AUXPOW);
+        if (!pcursor->GetKey(key) || key.first.first != DB_BLOCK_INDEX)
+            break;
 
+        CBlockIndex* pindexNew = insertBlockIndex(key.first.second);
+        if (key.second == DB_BLOCK_INDEX) {
+            if (!pcursor->GetValue(*pindexNew))
+                return error("%s: failed to read value", __func__);
+        } else if (key.second == DB_BLOCK_INDEX_HEADER || key.second == DB_BLOCK_INDEX_AUXPOW) {
             CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                uint256 hash              = key.first.second;
-                CBlockIndex* pindexNew = insertBlockIndex(hash);
-                // CBlockIndex* pindexNew = insertBlockIndex(key.first.second);
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                pcursor->Next(); // now we should be on the 'b' subkey
-                pcursor->GetKey(key);
-//                pcursor->GetValue(*pindexNew);
-
-                // BLAST: Disable PoW Sanity check while loading block index from disk.
-                // We use the sha256 hash for the block index for performance reasons, which is recorded for later use.
-
-                // CheckProofOfWork() uses the PoW hash which is discarded after a block is accepted.
-                //While it is technically feasible to verify the PoW, doing so takes several minutes as it
-                // requires recomputing every PoW hash during every BLAST startup.
-                // We opt instead to simply trust the data that is on your local disk.
-                //if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams))
-                //    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
-
-                pcursor->GetValue(*pindexNew);
-                pcursor->Next();
-            } else {
+            diskindex.fLegacyAuxPow = key.second == DB_BLOCK_INDEX_AUXPOW;
+            if (!pcursor->GetValue(diskindex))
                 return error("%s: failed to read value", __func__);
+
+            // Construct block index object
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nTx            = diskindex.nTx;
+            pindexNew->nAuxPowPos     = diskindex.nAuxPowPos;
+
+            // BLAST: Disable PoW Sanity check while loading block index from disk.
+            // We use the sha256 hash for the block index for performance reasons, which is recorded for later use.
+
+            // CheckProofOfWork() uses the PoW hash which is discarded after a block is accepted.
+            //While it is technically feasible to verify the PoW, doing so takes several minutes as it
+            // requires recomputing every PoW hash during every BLAST startup.
+            // We opt instead to simply trust the data that is on your local disk.
+            //if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams))
+            //    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+
+            if (diskindex.fLegacyAuxPow) {
+                // One time migration: move the auxpow into the auxpow store and replace the record
+                // with one referencing it
+                if (diskindex.IsAuxPow() && diskindex.auxpow) {
+                    if (!pauxpowstore->Write(*diskindex.auxpow, pindexNew->nAuxPowPos))
+                        return error("%s: failed to migrate the auxpow of %s", __func__, key.first.second.ToString());
+                    diskindex.nAuxPowPos = pindexNew->nAuxPowPos;
+                }
+                diskindex.fLegacyAuxPow = false;
+                batch.Write(std::make_pair(key.first, DB_BLOCK_INDEX_HEADER), diskindex);
+                batch.Erase(key);
+                nMigrated++;
+
+                if (batch.SizeEstimate() > (size_t)nDefaultDbBatchSize) {
+                    if (!pauxpowstore->Flush() || !WriteBatch(batch))
+                        return error("%s: failed to write migrated block index entries", __func__);
+                    batch.Clear();
+                }
             }
         } else {
-            break;
+            return error("%s: unknown block index record for %s", __func__, key.first.second.ToString());
         }
+        pcursor->Next();
+    }
+
+    if (nMigrated > 0) {
+        if (!pauxpowstore->Flush() || !WriteBatch(batch, true))
+            return error("%s: failed to write migrated block index entries", __func__);
+        LogPrintf("Moved the auxpow of %u block index entries to the auxpow store\n", nMigrated);
     }
 
     return true;
@@ -113,6 +113,12 @@ private:
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
+private:
+    bool ReadAddressIndexCompact(uint160 addressHash, int type, const uint32_t* passetId, int start, int end,
+                                 const CAddressIndexCompactKey* pkeyAfter, size_t nLimit,
+                                 std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                 CAddressIndexCompactKey &keyLast, bool &fMore);
+
 public:
     explicit CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, size_t maxFileSize = 2 << 20);
 
@@ -120,7 +126,6 @@ public:
     CBlockTreeDB& operator=(const CBlockTreeDB&) = delete;
 
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo, const std::map<uint256, std::shared_ptr<CAuxPow> >& auxpows);
-    bool ReadDiskBlockIndex(const uint256 &blkid, CDiskBlockIndex& diskblockindex);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &info);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindexing);
@@ -129,11 +134,23 @@ public:
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
+    //! Move spent index entries from the original 'p' records to the compact 'P' ones
+    bool UpgradeSpentIndex();
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    //! Unspent outputs of several addresses, read from one snapshot. An empty asset name reads all assets.
+    bool ReadAddressUnspentIndex(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    //! Read up to nLimit (0 for no limit) unspent outputs of an address in index order, starting after
+    //! *pkeyAfter if given. An empty asset name reads all assets. fMore is set when the limit cut the read short,
+    //! keyLast is then where to continue.
+    bool ReadAddressUnspentIndexPage(uint160 addressHash, int type, std::string assetName,
+                                     const CAddressUnspentCompactKey* pkeyAfter, size_t nLimit,
+                                     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect,
+                                     CAddressUnspentCompactKey &keyLast, bool &fMore);
     bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
@@ -142,10 +159,51 @@ public:
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                           int start = 0, int end = 0);
-    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
+    //! Entries of one asset of several addresses, read from one snapshot and merged into chain order (by
+    //! height and position in the block, then by the order of the addresses)
+    bool ReadAddressIndex(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                          int start = 0, int end = 0);
+    //! Like ReadAddressUnspentIndexPage for the address index entries between heights start and end (0 for
+    //! unbounded) of each asset. A page can run past nLimit to finish a transaction.
+    bool ReadAddressIndexPage(uint160 addressHash, int type, std::string assetName, int start, int end,
+                              const CAddressIndexCompactKey* pkeyAfter, size_t nLimit,
+                              std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                              CAddressIndexCompactKey &keyLast, bool &fMore);
+    //! Add (or with fUndo, subtract) the address index entries of a block to the address balances,
+    //! which then belong to block hashBlock
+    bool UpdateAddressBalances(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fUndo, const uint256 &hashBlock);
+    bool ReadAddressBalanceBestBlock(uint256 &hashBlock);
+    //! Mark the address balances as out of step with the chain, they are then rebuilt at the next startup
+    bool EraseAddressBalanceBestBlock();
+    bool ReadAddressBalance(uint160 addressHash, int type, std::string assetName, CAddressBalanceValue &balance);
+    bool ReadAddressBalances(uint160 addressHash, int type, std::vector<std::pair<std::string, CAddressBalanceValue> > &balances);
+    //! Recompute the address balances from the address index entries up to nMaxHeight
+    bool RebuildAddressBalances(int nMaxHeight, const uint256 &hashBlock);
+    //! Move address index entries from the original 'a' and 'u' records to the compact ones
+    bool UpgradeAddressIndex();
+    //! Record a block in the timestamp index, together with whether it is on the main chain
+    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex, const CTimestampIndexValue &value);
+    //! Pass the block hashes with a logical timestamp in [low, high) to fn in timestamp order, until it returns
+    //! false. With fActiveOnly the blocks off the main chain are skipped, no lock is needed either way.
+    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly,
+                            const std::function<bool(const uint256&, unsigned int)> &fn);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
+    //! Record main chain membership in timestamp index entries written before it was kept, requires cs_main
+    bool UpgradeTimestampIndex();
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
     bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
+    //! The block up to which the index builder has written the indexes, if it is active
+    bool ReadIndexBuilderBestBlock(uint256 &hashBlock);
+    bool WriteIndexBuilderBestBlock(const uint256 &hashBlock);
+    bool EraseIndexBuilderBestBlock();
+    //! Write the index entries of a run of blocks together with the block the index builder reached in one
+    //! batch. The timestamp index gets the logical timestamp of each block hash.
+    bool WriteIndexBuilderBatch(const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &addressUnspentIndex,
+                                const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > &spentIndex,
+                                const std::vector<std::pair<uint256, unsigned int> > &timestampIndex,
+                                const uint256 &hashBlock);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
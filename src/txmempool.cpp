@@ -422,7 +422,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
 {
     LOCK(cs);
     const CTransaction& tx = entry.GetTx();
-    std::vector<CMempoolAddressDeltaKey> inserted;
+    std::vector<AddressDeltaNode> inserted;
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -432,20 +432,17 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), BLAST, txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            inserted.emplace_back(key, delta);
         } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), BLAST, txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            inserted.emplace_back(key, delta);
         } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
             uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
             CMempoolAddressDeltaKey key(1, hashBytes, BLAST, txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            inserted.emplace_back(key, delta);
         } else {
             /** BLAST START */
             if (AreAssetsDeployed()) {
@@ -455,8 +452,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
                 if (ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount)) {
                     CMempoolAddressDeltaKey key(1, hashBytes, assetName, txhash, j, 1);
                     CMempoolAddressDelta delta(entry.GetTime(), assetAmount * -1, input.prevout.hash, input.prevout.n);
-                    mapAddress.insert(std::make_pair(key, delta));
-                    inserted.push_back(key);
+                    inserted.emplace_back(key, delta);
                 }
             }
             /** BLAST END */
@@ -468,20 +464,15 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
         if (out.scriptPubKey.IsPayToScriptHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), BLAST, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            inserted.emplace_back(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
         } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), BLAST, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            inserted.emplace_back(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
         } else if (out.scriptPubKey.IsPayToPublicKey()) {
             uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, hashBytes, BLAST, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            inserted.emplace_back(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
         } else {
             /** BLAST START */
             if (AreAssetsDeployed()) {
@@ -489,17 +480,30 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
                 std::string assetName;
                 CAmount assetAmount;
                 if (ParseAssetScript(out.scriptPubKey, hashBytes, assetName, assetAmount)) {
-                    std::pair<addressDeltaMap::iterator, bool> ret;
                     CMempoolAddressDeltaKey key(1, hashBytes, assetName, txhash, k, 0);
-                    mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), assetAmount)));
-                    inserted.push_back(key);
+                    inserted.emplace_back(key, CMempoolAddressDelta(entry.GetTime(), assetAmount));
                 }
             }
             /** BLAST END */
         }
     }
 
-    mapAddressInserted.insert(std::make_pair(txhash, inserted));
+    if (inserted.empty())
+        return;
+    std::pair<addressDeltaMapInserted::iterator, bool> ret = mapAddressInserted.emplace(txhash, std::move(inserted));
+    if (!ret.second)
+        return;
+
+    // Append the entries to the lists of their addresses
+    for (AddressDeltaNode& node : ret.first->second) {
+        AddressDeltaList& list = mapAddress[std::make_pair(node.key.addressBytes, node.key.type)];
+        node.prev = list.tail;
+        if (list.tail)
+            list.tail->next = &node;
+        else
+            list.head = &node;
+        list.tail = &node;
+    }
 }
 
 bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
@@ -507,12 +511,12 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
 {
     LOCK(cs);
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first,
-                                                                                       assetName));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second
-                && (*ait).first.asset == assetName) {
-            results.push_back(*ait);
-            ait++;
+        addressDeltaMap::const_iterator ait = mapAddress.find(*it);
+        if (ait == mapAddress.end())
+            continue;
+        for (const AddressDeltaNode* node = ait->second.head; node; node = node->next) {
+            if (node->key.asset == assetName)
+                results.push_back(std::make_pair(node->key, node->delta));
         }
     }
     return true;
@@ -523,11 +527,11 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
 {
     LOCK(cs);
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
-        }
+        addressDeltaMap::const_iterator ait = mapAddress.find(*it);
+        if (ait == mapAddress.end())
+            continue;
+        for (const AddressDeltaNode* node = ait->second.head; node; node = node->next)
+            results.push_back(std::make_pair(node->key, node->delta));
     }
     return true;
 }
@@ -538,9 +542,19 @@ bool CTxMemPool::removeAddressIndex(const uint256 txhash)
     addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
 
     if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
+        for (AddressDeltaNode& node : it->second) {
+            addressDeltaMap::iterator ait = mapAddress.find(std::make_pair(node.key.addressBytes, node.key.type));
+            AddressDeltaList& list = ait->second;
+            if (node.prev)
+                node.prev->next = node.next;
+            else
+                list.head = node.next;
+            if (node.next)
+                node.next->prev = node.prev;
+            else
+                list.tail = node.prev;
+            if (!list.head)
+                mapAddress.erase(ait);
         }
         mapAddressInserted.erase(it);
     }
@@ -553,7 +567,7 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
     LOCK(cs);
 
     const CTransaction& tx = entry.GetTx();
-    std::vector<CSpentIndexKey> inserted;
+    std::vector<COutPoint> inserted;
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -576,15 +590,14 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
             addressType = 0;
         }
 
-        CSpentIndexKey key = CSpentIndexKey(input.prevout.hash, input.prevout.n);
         CSpentIndexValue value = CSpentIndexValue(txhash, j, -1, prevout.nValue, addressType, addressHash);
 
-        mapSpent.insert(std::make_pair(key, value));
-        inserted.push_back(key);
+        mapSpent.insert(std::make_pair(input.prevout, value));
+        inserted.push_back(input.prevout);
 
     }
 
-    mapSpentInserted.insert(std::make_pair(txhash, inserted));
+    mapSpentInserted.emplace(txhash, std::move(inserted));
 }
 
 bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
@@ -592,7 +605,7 @@ bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     LOCK(cs);
     mapSpentIndex::iterator it;
 
-    it = mapSpent.find(key);
+    it = mapSpent.find(COutPoint(key.txid, key.outputIndex));
     if (it != mapSpent.end()) {
         value = it->second;
         return true;
@@ -606,9 +619,8 @@ bool CTxMemPool::removeSpentIndex(const uint256 txhash)
     mapSpentIndexInserted::iterator it = mapSpentInserted.find(txhash);
 
     if (it != mapSpentInserted.end()) {
-        std::vector<CSpentIndexKey> keys = (*it).second;
-        for (std::vector<CSpentIndexKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapSpent.erase(*mit);
+        for (const COutPoint& outpoint : it->second) {
+            mapSpent.erase(outpoint);
         }
         mapSpentInserted.erase(it);
     }
@@ -780,14 +792,14 @@ void CTxMemPool::removeConflicts(const CTransaction &tx)
  */
 void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight)
 {
-    std::set<CAssetCacheNewAsset> set;
+    std::unordered_set<CAssetCacheNewAsset, CAssetCacheHasher> set;
     removeForBlock(vtx, nBlockHeight, set);
 }
 
 /**
  * Called when a block is connected. Removes from mempool and updates the miner fee estimator.
  */
-void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight, std::set<CAssetCacheNewAsset>& setNewAssets)
+void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight, std::unordered_set<CAssetCacheNewAsset, CAssetCacheHasher>& setNewAssets)
 {
     LOCK(cs);
     std::vector<const CTxMemPoolEntry*> entries;
@@ -860,6 +872,10 @@ void CTxMemPool::_clear()
     ++nTransactionsUpdated;
     mapAssetToHash.clear();
     mapHashToAsset.clear();
+    mapAddress.clear();
+    mapAddressInserted.clear();
+    mapSpent.clear();
+    mapSpentInserted.clear();
 }
 
 void CTxMemPool::clear()
@@ -1330,3 +1346,5 @@ bool CTxMemPool::TransactionWithinChainLimit(const uint256& txid, size_t chainLi
 }
 
 SaltedTxidHasher::SaltedTxidHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+SaltedAddressHasher::SaltedAddressHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
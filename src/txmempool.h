@@ -11,6 +11,7 @@
 #include <memory>
 #include <set>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 #include <string>
@@ -341,6 +342,21 @@ public:
     }
 };
 
+/** Hasher for the (hash, type) addresses of the mempool address index */
+class SaltedAddressHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedAddressHasher();
+
+    size_t operator()(const std::pair<uint160, int>& address) const {
+        return CSipHasher(k0, k1).Write(address.second).Write(address.first.begin(), address.first.size()).Finalize();
+    }
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain transactions
  * that may be included in the next block.
@@ -494,16 +510,36 @@ private:
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
+    /** An address index entry of a mempool transaction, linked into the list of its address */
+    struct AddressDeltaNode {
+        CMempoolAddressDeltaKey key;
+        CMempoolAddressDelta delta;
+        AddressDeltaNode* prev;
+        AddressDeltaNode* next;
+
+        AddressDeltaNode(const CMempoolAddressDeltaKey& keyIn, const CMempoolAddressDelta& deltaIn) :
+            key(keyIn), delta(deltaIn), prev(nullptr), next(nullptr) {}
+    };
+
+    /** The entries of an address, in the order their transactions were added */
+    struct AddressDeltaList {
+        AddressDeltaNode* head;
+        AddressDeltaNode* tail;
+
+        AddressDeltaList() : head(nullptr), tail(nullptr) {}
+    };
+
+    typedef std::unordered_map<std::pair<uint160, int>, AddressDeltaList, SaltedAddressHasher> addressDeltaMap;
     addressDeltaMap mapAddress;
 
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
+    //! Owns the nodes of each transaction, they are linked once the vector is in place and never move
+    typedef std::unordered_map<uint256, std::vector<AddressDeltaNode>, SaltedTxidHasher> addressDeltaMapInserted;
     addressDeltaMapInserted mapAddressInserted;
 
-    typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
+    typedef std::unordered_map<COutPoint, CSpentIndexValue, SaltedOutpointHasher> mapSpentIndex;
     mapSpentIndex mapSpent;
 
-    typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
+    typedef std::unordered_map<uint256, std::vector<COutPoint>, SaltedTxidHasher> mapSpentIndexInserted;
     mapSpentIndexInserted mapSpentInserted;
 
     void UpdateParent(txiter entry, txiter parent, bool add);
@@ -549,7 +585,7 @@ public:
     void removeRecursive(const CTransaction &tx, MemPoolRemovalReason reason = MemPoolRemovalReason::UNKNOWN);
     void removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMemPoolHeight, int flags);
     void removeConflicts(const CTransaction &tx);
-    void removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight, std::set<CAssetCacheNewAsset>& setNewAssets );
+    void removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight, std::unordered_set<CAssetCacheNewAsset, CAssetCacheHasher>& setNewAssets );
     void removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight);
 
     void clear();
@@ -7,6 +7,8 @@
 #include "validation.h"
 
 #include "arith_uint256.h"
+#include "auxpow/store.h"
+#include "blockfilereader.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -18,6 +20,7 @@
 #include "cuckoocache.h"
 #include "fs.h"
 #include "hash.h"
+#include "indexbuilder.h"
 #include "init.h"
 #include "policy/fees.h"
 #include "policy/policy.h"
@@ -80,6 +83,7 @@ CBlockIndex *pindexBestHeader = nullptr;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+int nHeaderCheckThreads = 0;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fTxIndex = false;
@@ -159,6 +163,13 @@ namespace {
      */
     std::multimap<CBlockIndex*, CBlockIndex*> mapBlocksUnlinked;
 
+    /**
+     * Serializes ActivateBestChain. It releases cs_main between steps, and the
+     * message handler threads of different peers may call it at the same time.
+     * Always taken before cs_main.
+     */
+    CCriticalSection cs_chainstate;
+
     CCriticalSection cs_LastBlockFile;
     std::vector<CBlockFileInfo> vinfoBlockFile;
     int nLastBlockFile = 0;
@@ -213,7 +224,7 @@ CAssetsDB *passetsdb = nullptr;
 CAssetsCache *passets = nullptr;
 
 CAssetsCache *tmpAssetCache = nullptr;
-CLRUCache<std::string, CDatabasedAssetData> *passetsCache = nullptr;
+CShardedCache<std::string, CDatabasedAssetData> *passetsCache = nullptr;
 
 enum FlushStateMode {
     FLUSH_STATE_NONE,
@@ -1014,6 +1025,18 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const
     return true;
 }
 
+bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly,
+                       const std::function<bool(const uint256&, unsigned int)> &fn)
+{
+    if (!fTimestampIndex)
+        return error("Timestamp index not enabled");
+
+    if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, fn))
+        return error("Unable to get hashes for timestamps");
+
+    return true;
+}
+
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 {
     if (!fSpentIndex)
@@ -1030,9 +1053,9 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 
 bool HashOnchainActive(const uint256 &hash)
 {
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    BlockMap::const_iterator it = mapBlockIndex.find(hash);
 
-    if (!chainActive.Contains(pblockindex)) {
+    if (it == mapBlockIndex.end() || !chainActive.Contains(it->second)) {
         return false;
     }
 
@@ -1063,6 +1086,32 @@ bool GetAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool GetAddressIndex(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressIndex(addresses, assetName, addressIndex, start, end))
+        return error("unable to get txids for addresses");
+
+    return true;
+}
+
+bool GetAddressIndexPage(uint160 addressHash, int type, std::string assetName, int start, int end,
+                         const CAddressIndexCompactKey* pkeyAfter, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                         CAddressIndexCompactKey &keyLast, bool &fMore)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressIndexPage(addressHash, type, assetName, start, end, pkeyAfter, nLimit, addressIndex, keyLast, fMore))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
 bool GetAddressUnspent(uint160 addressHash, int type, std::string assetName,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
 {
@@ -1087,6 +1136,150 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     return true;
 }
 
+bool GetAddressUnspent(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressUnspentIndex(addresses, assetName, unspentOutputs))
+        return error("unable to get txids for addresses");
+
+    return true;
+}
+
+bool GetAddressUnspentPage(uint160 addressHash, int type, std::string assetName,
+                           const CAddressUnspentCompactKey* pkeyAfter, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                           CAddressUnspentCompactKey &keyLast, bool &fMore)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressUnspentIndexPage(addressHash, type, assetName, pkeyAfter, nLimit, unspentOutputs, keyLast, fMore))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+/**
+ * Sum up address index entries into balances per asset, the way the block tree maintains them. Used while
+ * the maintained balances are out of step with the chain.
+ */
+static void SumAddressBalances(const std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex,
+                               std::map<std::string, CAddressBalanceValue>& balances)
+{
+    std::map<std::string, std::pair<int, unsigned int> > mapLastTx;
+    for (const auto& entry : addressIndex) {
+        CAddressBalanceValue& balance = balances[entry.first.asset];
+        balance.balance += entry.second;
+        if (entry.second > 0)
+            balance.received += entry.second;
+        std::pair<int, unsigned int> tx(entry.first.blockHeight, entry.first.txindex);
+        auto it = mapLastTx.find(entry.first.asset);
+        if (it == mapLastTx.end() || it->second != tx) {
+            balance.txcount++;
+            mapLastTx[entry.first.asset] = tx;
+        }
+    }
+}
+
+bool GetAddressBalance(uint160 addressHash, int type, std::string assetName, CAddressBalanceValue &balance)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    uint256 hashBalances;
+    if (!pblocktree->ReadAddressBalanceBestBlock(hashBalances)) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        if (!GetAddressIndex(addressHash, type, assetName, addressIndex))
+            return error("unable to get txids for address");
+        std::map<std::string, CAddressBalanceValue> balances;
+        SumAddressBalances(addressIndex, balances);
+        balance = balances[assetName];
+        return true;
+    }
+
+    if (!pblocktree->ReadAddressBalance(addressHash, type, assetName, balance))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
+bool GetAddressBalances(uint160 addressHash, int type,
+                        std::vector<std::pair<std::string, CAddressBalanceValue> > &balances)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    uint256 hashBalances;
+    if (!pblocktree->ReadAddressBalanceBestBlock(hashBalances)) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        if (!GetAddressIndex(addressHash, type, addressIndex))
+            return error("unable to get txids for address");
+        std::map<std::string, CAddressBalanceValue> mapBalances;
+        SumAddressBalances(addressIndex, mapBalances);
+        for (const auto& item : mapBalances) {
+            if (!item.second.IsNull())
+                balances.push_back(item);
+        }
+        return true;
+    }
+
+    if (!pblocktree->ReadAddressBalances(addressHash, type, balances))
+        return error("unable to get balances for address");
+
+    return true;
+}
+
+/**
+ * Add the address index entries of a connected block to the address balances, or subtract those of a
+ * disconnected one. Unlike the entries the balances can't simply be written again, so blocks that were
+ * already counted before an unclean shutdown are skipped. Anything else out of step marks the balances
+ * to be rebuilt by LoadAddressBalances at the next startup, rather than rebuilding them with cs_main held,
+ * and they are summed up from the address index until then.
+ */
+static bool UpdateAddressBalances(const std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex, const CBlockIndex* pindex, bool fUndo)
+{
+    const CBlockIndex* pindexFrom = fUndo ? pindex : pindex->pprev;
+    const CBlockIndex* pindexTo = fUndo ? pindex->pprev : pindex;
+
+    uint256 hashBalances;
+    if (!pblocktree->ReadAddressBalanceBestBlock(hashBalances))
+        return true;
+    if (hashBalances == pindexFrom->GetBlockHash())
+        return pblocktree->UpdateAddressBalances(addressIndex, fUndo, pindexTo->GetBlockHash());
+
+    BlockMap::iterator mi = mapBlockIndex.find(hashBalances);
+    if (!fUndo && mi != mapBlockIndex.end() && mi->second->GetAncestor(pindex->nHeight) == pindex)
+        return true;
+
+    LogPrintf("%s: address balances are at block %s instead of %s, they are rebuilt at the next startup\n", __func__, hashBalances.ToString(), pindexFrom->GetBlockHash().ToString());
+    return pblocktree->EraseAddressBalanceBestBlock();
+}
+
+/**
+ * Map the block or undo data at pos and the nExtra bytes following it through pblockfilereader, taking
+ * its size from the index header in front of it. Returns nullptr if that can't be done, the data is then
+ * read through stdio.
+ */
+static std::shared_ptr<const CBlockFileMapping> MapDiskData(const char* prefix, const CDiskBlockPos& pos, unsigned int nExtra, unsigned int& nSize)
+{
+    if (!pblockfilereader || pos.IsNull() || pos.nPos < 8)
+        return nullptr;
+    CDiskBlockPos posHeader(pos.nFile, pos.nPos - 8);
+    std::shared_ptr<const CBlockFileMapping> mapping = pblockfilereader->Map(prefix, posHeader, 8);
+    if (!mapping)
+        return nullptr;
+    const char* pheader = mapping->data() + posHeader.nPos;
+    if (memcmp(pheader, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0)
+        return nullptr;
+    nSize = ReadLE32((const unsigned char*)pheader + CMessageHeader::MESSAGE_START_SIZE);
+    if (!mapping->Contains(pos.nPos, (size_t)nSize + nExtra))
+        mapping = pblockfilereader->Map(prefix, pos, (size_t)nSize + nExtra);
+    return mapping;
+}
+
 /** Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus::Params& consensusParams, uint256 &hashBlock, bool fAllowSlow)
 {
@@ -1104,16 +1297,29 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
     if (fTxIndex) {
         CDiskTxPos postx;
         if (pblocktree->ReadTxIndex(hash, postx)) {
-            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-            if (file.IsNull())
-                return error("%s: OpenBlockFile failed", __func__);
             CBlockHeader header;
-            try {
-                file >> header;
-                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                file >> txOut;
-            } catch (const std::exception& e) {
-                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            unsigned int nSize;
+            std::shared_ptr<const CBlockFileMapping> mapping = MapDiskData("blk", postx, 0, nSize);
+            if (mapping) {
+                try {
+                    CSpanReader reader(SER_DISK, CLIENT_VERSION, mapping->data() + postx.nPos, mapping->data() + postx.nPos + nSize);
+                    reader >> header;
+                    reader.ignore(postx.nTxOffset);
+                    reader >> txOut;
+                } catch (const std::exception& e) {
+                    return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+                }
+            } else {
+                CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+                if (file.IsNull())
+                    return error("%s: OpenBlockFile failed", __func__);
+                try {
+                    file >> header;
+                    fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
+                    file >> txOut;
+                } catch (const std::exception& e) {
+                    return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+                }
             }
             hashBlock = header.GetHash();
             if (txOut->GetHash() != hash)
@@ -1181,17 +1387,29 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    unsigned int nSize;
+    std::shared_ptr<const CBlockFileMapping> mapping = MapDiskData("blk", pos, 0, nSize);
+    if (mapping) {
+        try {
+            CSpanReader reader(SER_DISK, CLIENT_VERSION, mapping->data() + pos.nPos, mapping->data() + pos.nPos + nSize);
+            reader >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+    } else {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
 
-    // Read block
-    try {
-        filein >> block;
-    }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        // Read block
+        try {
+            filein >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Check the header
@@ -1211,6 +1429,49 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
+{
+    CDiskBlockPos pos = pindex->GetBlockPos();
+    if (pos.nPos < 8)
+        return error("%s: Block position %s is before the index header", __func__, pos.ToString());
+
+    unsigned int nSize;
+    std::shared_ptr<const CBlockFileMapping> mapping = MapDiskData("blk", pos, 0, nSize);
+    if (mapping && nSize >= 80 && nSize <= MAX_BLOCK_SERIALIZED_SIZE_RIP2) {
+        block.assign(mapping->data() + pos.nPos, mapping->data() + pos.nPos + nSize);
+    } else {
+        // Start at the index header written by WriteBlockToDisk, a mapped size that's out of range is
+        // read again and reported here
+        pos.nPos -= 8;
+
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+        try {
+            CMessageHeader::MessageStartChars blkStart;
+            filein >> FLATDATA(blkStart) >> nSize;
+            if (memcmp(blkStart, messageStart, CMessageHeader::MESSAGE_START_SIZE))
+                return error("%s: Block magic mismatch at %s", __func__, pos.ToString());
+            if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE_RIP2)
+                return error("%s: Invalid block size %u at %s", __func__, nSize, pos.ToString());
+
+            block.resize(nSize);
+            filein.read((char*)block.data(), nSize);
+        }
+        catch (const std::exception& e) {
+            return error("%s: Read from block file failed: %s at %s", __func__, e.what(), pos.ToString());
+        }
+    }
+
+    // The block hash only covers the 80 byte pure header, the auxpow and transactions follow it
+    if (Hash(block.begin(), block.begin() + 80) != pindex->GetBlockHash())
+        return error("%s: Block hash doesn't match index for %s at %s", __func__, pindex->ToString(), pos.ToString());
+
+    return true;
+}
+
 BlockSubsidies::BlockSubsidies(const CAmount& reward): total(reward) {
     // Calculate the individual subsidies for the miner, the masternode and the devs based on the total reward
     const auto& params = Params().GetConsensus();
@@ -1466,6 +1727,75 @@ bool CScriptCheck::operator()() {
     return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata), &error);
 }
 
+bool CAssetCheck::operator()() {
+    const CTransaction& tx = *ptx;
+    std::string strError;
+
+    if (tx.IsNewAsset()) {
+        if (!tx.VerifyNewAsset(strError)) {
+            strRejectReason = "bad-txns-issue-asset-failed-verify";
+            return false;
+        }
+
+        CNewAsset asset;
+        std::string strAddress;
+        if (!AssetFromTransaction(tx, asset, strAddress)) {
+            strRejectReason = "bad-txns-issue-asset-serialization";
+            return false;
+        }
+
+        if (!IsNewOwnerTxValid(tx, asset.strName, strAddress, strError)) {
+            strRejectReason = strError;
+            return false;
+        }
+
+        if (!asset.IsValid(strError)) {
+            strRejectReason = "bad-txns-issue-asset";
+            return false;
+        }
+    } else if (tx.IsReissueAsset()) {
+        if (!tx.VerifyReissueAsset(strError)) {
+            strRejectReason = strError;
+            return false;
+        }
+
+        CReissueAsset reissue;
+        std::string strAddress;
+        if (!ReissueAssetFromTransaction(tx, reissue, strAddress)) {
+            strRejectReason = "bad-txns-reissue-asset-serialization";
+            return false;
+        }
+
+        if (!reissue.IsValid(strError)) {
+            strRejectReason = strError;
+            return false;
+        }
+    } else if (tx.IsNewUniqueAsset()) {
+        if (!tx.VerifyNewUniqueAsset(strError)) {
+            strRejectReason = "bad-txns-issue-unique-asset-failed-verify";
+            return false;
+        }
+
+        for (const auto& out : tx.vout) {
+            if (IsScriptNewUniqueAsset(out.scriptPubKey)) {
+                CNewAsset asset;
+                std::string strAddress;
+                if (!AssetFromScript(out.scriptPubKey, asset, strAddress)) {
+                    strRejectReason = "bad-txns-connect-block-issue-unique-asset-serialization";
+                    return false;
+                }
+
+                if (!asset.IsValid(strError)) {
+                    strRejectReason = strError;
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -1613,8 +1943,33 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
+} // namespace
+
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
+    unsigned int nSize;
+    std::shared_ptr<const CBlockFileMapping> mapping = MapDiskData("rev", pos, sizeof(uint256), nSize);
+    if (mapping) {
+        // The mapped bytes are hashed as they are, so the checksum is verified before deserializing
+        const char* pdata = mapping->data() + pos.nPos;
+        CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+        hasher << hashBlock;
+        hasher.write(pdata, nSize);
+        uint256 hashChecksum;
+        memcpy(hashChecksum.begin(), pdata + nSize, sizeof(uint256));
+        if (hashChecksum != hasher.GetHash())
+            return error("%s: Checksum mismatch", __func__);
+
+        try {
+            CSpanReader reader(SER_DISK, CLIENT_VERSION, pdata, pdata + nSize);
+            reader >> blockundo;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+        return true;
+    }
+
     // Open history file to read
     CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
@@ -1640,7 +1995,7 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
 }
 
 /** Abort with a message */
-bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
+bool AbortNode(const std::string& strMessage, const std::string& userMessage)
 {
     SetMiscWarning(strMessage);
     LogPrintf("*** %s\n", strMessage);
@@ -1658,8 +2013,6 @@ bool AbortNode(CValidationState& state, const std::string& strMessage, const std
     return state.Error(strMessage);
 }
 
-} // namespace
-
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -1753,7 +2106,9 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
     // undo transactions in reverse order
-    CAssetsCache tempCache(*assetsCache);
+    // Spends of the block's own outputs only need to be parsed, not recorded. Lookups fall through to passets,
+    // so an empty cache behaves the same as a copy of the callers cache without paying for the copy
+    CAssetsCache tempCache;
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = *(block.vtx[i]);
         uint256 hash = tx.GetHash();
@@ -1974,8 +2329,12 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
 
                     } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
                         uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, j, false), prevout.nValue));
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, j), CAddressUnspentValue()));
+
+                        // undo spending activity
+                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
+
+                        // restore unspent index
+                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight)));
                     } else {
                         /** BLAST START */
                         if (AreAssetsDeployed()) {
@@ -2013,17 +2372,37 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
+    // The index builder only leaves the entries it has written already to be erased, the address
+    // balances are rebuilt when it hands over
+    bool fIndexBuilderActive = IndexBuilderActive();
+    if (!ignoreAddressIndex && fIndexBuilderActive && !IndexBuilderBlockDisconnected(pindex))
+        ignoreAddressIndex = true;
+
     if (!ignoreAddressIndex && fAddressIndex) {
         if (!pblocktree->EraseAddressIndex(addressIndex)) {
             error("Failed to delete address index");
             return DISCONNECT_FAILED;
         }
+        if (!fIndexBuilderActive && !UpdateAddressBalances(addressIndex, pindex, true)) {
+            error("Failed to update address balances");
+            return DISCONNECT_FAILED;
+        }
         if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
             error("Failed to write address unspent index");
             return DISCONNECT_FAILED;
         }
     }
 
+    // The block stays in the timestamp index, it is only marked as off the main chain
+    if (!ignoreAddressIndex && fTimestampIndex) {
+        unsigned int logicalTS;
+        if (pblocktree->ReadTimestampBlockIndex(pindex->GetBlockHash(), logicalTS) &&
+            !pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash()), CTimestampIndexValue(false))) {
+            error("Failed to write timestamp index");
+            return DISCONNECT_FAILED;
+        }
+    }
+
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
@@ -2033,6 +2412,11 @@ void static FlushBlockFile(bool fFinalize = false)
 
     CDiskBlockPos posOld(nLastBlockFile, 0);
 
+    if (fFinalize && pblockfilereader) {
+        pblockfilereader->Close("blk", nLastBlockFile);
+        pblockfilereader->Close("rev", nLastBlockFile);
+    }
+
     FILE *fileOld = OpenBlockFile(posOld);
     if (fileOld) {
         if (fFinalize)
@@ -2059,6 +2443,20 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CAssetCheck> assetcheckqueue(128);
+
+void ThreadAssetCheck() {
+    RenameThread("blast-assetch");
+    assetcheckqueue.Thread();
+}
+
+static CCheckQueue<CHeaderPoWCheck> headercheckqueue(128);
+
+void ThreadHeaderCheck() {
+    RenameThread("blast-headerch");
+    headercheckqueue.Thread();
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2343,6 +2741,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     std::vector<std::pair<std::string, CBlockAssetUndo> > vUndoAssetData;
 
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    // Asset checks can't be skipped like scripts below the assumed valid block
+    CCheckQueueControl<CAssetCheck> assetControl(nScriptCheckThreads ? &assetcheckqueue : nullptr);
+    std::vector<const CTransaction*> vAssetCheckTxs;
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
@@ -2355,14 +2756,9 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
-
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
-        const uint256 txhash = tx.GetHash();
 
         nInputs += tx.vin.size();
 
@@ -2406,72 +2802,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                 return state.DoS(100, error("%s: contains a non-BIP68-final transaction", __func__),
                                  REJECT_INVALID, "bad-txns-nonfinal");
             }
-
-            if (fAddressIndex || fSpentIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut &prevout = view.AccessCoin(tx.vin[j].prevout).out;
-                    uint160 hashBytes;
-                    int addressType;
-                    bool isAsset = false;
-                    std::string assetName;
-                    CAmount assetAmount;
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        hashBytes = Hash160(prevout.scriptPubKey.begin() + 1, prevout.scriptPubKey.end() - 1);
-                        addressType = 1;
-                    } else {
-                        /** BLAST START */
-                        if (AreAssetsDeployed()) {
-                            hashBytes.SetNull();
-                            addressType = 0;
-
-                            if (ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount)) {
-                                addressType = 1;
-                                isAsset = true;
-                            }
-                        }
-                        /** BLAST END */
-                    }
-
-                    if (fAddressIndex && addressType > 0) {
-                        /** BLAST START */
-                        if (isAsset) {
-//                            std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                      << ", " << i << ", " << txhash.GetHex() << ", " << j << ", " << "true" << ", " << assetAmount * -1 << std::endl;
-
-                            // record spending activity
-                            addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, assetName, pindex->nHeight, i, txhash, j, true), assetAmount * -1));
-
-                            // remove address from unspent index
-                            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, assetName, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                        /** BLAST END */
-                        } else {
-                            // record spending activity
-                            addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
-
-                            // remove address from unspent index
-                            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                        }
-                    }
-                    /** BLAST END */
-
-                    if (fSpentIndex) {
-                        // add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
-                    }
-                }
-
-            }
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -2496,43 +2826,52 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
 
         /** BLAST START */
         if (assetsCache) {
+            // Queues the context free checks of an asset transaction next to its scripts, or runs them here
+            // without check threads. Only the checks against the asset cache are done in block order below
+            auto fnCheckAssetTx = [&]() -> bool {
+                CAssetCheck check(tx);
+                if (nScriptCheckThreads) {
+                    std::vector<CAssetCheck> vChecks(1);
+                    check.swap(vChecks[0]);
+                    assetControl.Add(vChecks);
+                    vAssetCheckTxs.push_back(&tx);
+                    return true;
+                }
+                if (!check())
+                    return state.DoS(100, false, REJECT_INVALID, check.GetRejectReason());
+                return true;
+            };
+
             if (tx.IsNewAsset())
             {
                 if (!AreAssetsDeployed())
                     return state.DoS(100, false, REJECT_INVALID, "bad-txns-new-asset-when-assets-is-not-active");
 
-                std::string strError = "";
-                if (!tx.VerifyNewAsset(strError))
-                    return state.DoS(100, false, REJECT_INVALID, "bad-txns-issue-asset-failed-verify");
-
-                CNewAsset asset;
-                std::string strAddress;
-                if (!AssetFromTransaction(tx, asset, strAddress))
-                    return state.DoS(100, false, REJECT_INVALID, "bad-txns-issue-asset-serialization");
-
-
-                if(!IsNewOwnerTxValid(tx, asset.strName, strAddress, strError))
-                    return state.DoS(100, false, REJECT_INVALID, strError);
-
-                if (!asset.IsValid(strError, *assetsCache))
-                    return state.DoS(100, error("%s: %s", __func__, strError), REJECT_INVALID, "bad-txns-issue-asset");
+                if (!fnCheckAssetTx())
+                    return false;
 
+                // A malformed issue is rejected by its CAssetCheck
+                CAssetScriptData data;
+                if (GetAssetScriptData(tx.vout[tx.vout.size() - 1].scriptPubKey, data)) {
+                    CNewAsset asset;
+                    asset.strName = data.assetName;
+                    std::string strError;
+                    if (!asset.IsNameAvailable(strError, *assetsCache))
+                        return state.DoS(100, error("%s: %s", __func__, strError), REJECT_INVALID, "bad-txns-issue-asset");
+                }
             }
             else if (tx.IsReissueAsset())
             {
                 if (!AreAssetsDeployed())
                     return state.DoS(100, false, REJECT_INVALID, "bad-txns-reissue-asset-when-assets-is-not-active");
 
-                std::string strError;
-                if (!tx.VerifyReissueAsset(strError))
-                    return state.DoS(100, false, REJECT_INVALID, strError);
-                
+                if (!fnCheckAssetTx())
+                    return false;
+
                 CReissueAsset reissue;
                 std::string strAddress;
-                if (!ReissueAssetFromTransaction(tx, reissue, strAddress))
-                    return state.DoS(100, false, REJECT_INVALID, "bad-txns-reissue-asset-serialization");
-
-                if (!reissue.IsValid(strError, *assetsCache))
+                std::string strError;
+                if (ReissueAssetFromTransaction(tx, reissue, strAddress) && !reissue.IsReissuable(strError, *assetsCache))
                     return state.DoS(100, false, REJECT_INVALID, strError);
             }
             else if (tx.IsNewUniqueAsset())
@@ -2540,86 +2879,24 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                 if (!AreAssetsDeployed())
                     return state.DoS(100, false, REJECT_INVALID, "bad-txns-issue-unique-asset-when-assets-is-not-active");
 
-                std::string error;
-                if (!tx.VerifyNewUniqueAsset(error))
-                    return state.DoS(100, false, REJECT_INVALID, "bad-txns-issue-unique-asset-failed-verify");
+                if (!fnCheckAssetTx())
+                    return false;
 
-                for (auto out : tx.vout)
+                for (const auto& out : tx.vout)
                 {
-                    if (IsScriptNewUniqueAsset(out.scriptPubKey))
+                    CAssetScriptData data;
+                    if (IsScriptNewUniqueAsset(out.scriptPubKey) && GetAssetScriptData(out.scriptPubKey, data))
                     {
                         CNewAsset asset;
-                        std::string strAddress;
-                        if (!AssetFromScript(out.scriptPubKey, asset, strAddress))
-                            return state.DoS(100, false, REJECT_INVALID, "bad-txns-connect-block-issue-unique-asset-serialization");
-
-                        std::string strError = "";
-                        if (!asset.IsValid(strError, *assetsCache))
+                        asset.strName = data.assetName;
+                        std::string strError;
+                        if (!asset.IsNameAvailable(strError, *assetsCache))
                             return state.DoS(100, false, REJECT_INVALID, strError);
                     }
                 }
             }
         }
         /** BLAST END */
-        if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin() + 1, out.scriptPubKey.end() - 1));
-                    addressIndex.push_back(
-                            std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, txhash, k, false),
-                                           out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, txhash, k),
-                                                                 CAddressUnspentValue(out.nValue, out.scriptPubKey,
-                                                                                      pindex->nHeight)));
-                } else {
-                    /** BLAST START */
-                    if (AreAssetsDeployed()) {
-                        std::string assetName;
-                        CAmount assetAmount;
-                        uint160 hashBytes;
-
-                        if (ParseAssetScript(out.scriptPubKey, hashBytes, assetName, assetAmount)) {
-//                            std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                      << ", " << i << ", " << txhash.GetHex() << ", " << k << ", " << "true" << ", " << assetAmount << std::endl;
-
-                            // record receiving activity
-                            addressIndex.push_back(std::make_pair(
-                                    CAddressIndexKey(1, hashBytes, assetName, pindex->nHeight, i, txhash, k, false),
-                                    assetAmount));
-
-                            // record unspent output
-                            addressUnspentIndex.push_back(
-                                    std::make_pair(CAddressUnspentKey(1, hashBytes, assetName, txhash, k),
-                                                   CAddressUnspentValue(assetAmount, out.scriptPubKey,
-                                                                        pindex->nHeight)));
-                        }
-                    } else {
-                        continue;
-                    }
-                    /** BLAST END */
-                }
-            }
-        }
 
         CTxUndo undoDummy;
         if (i > 0) {
@@ -2645,6 +2922,19 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
+    // Invalid assets are reported before the payee checks, which don't penalize the peer, as they were
+    // when the asset checks ran inline
+    if (!assetControl.Wait()) {
+        // The queue only reports that a check failed, rerun them in block order to reject with its reason
+        for (const CTransaction* ptx : vAssetCheckTxs) {
+            CAssetCheck check(*ptx);
+            if (!check())
+                return state.DoS(100, error("%s: asset check on %s failed with %s", __func__, ptx->GetHash().ToString(), check.GetRejectReason()),
+                                 REJECT_INVALID, check.GetRejectReason());
+        }
+        return state.DoS(100, error("%s: asset CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
+    }
+
     if (!IsBlockPayeeValid(*block.vtx[0], pindex->nHeight, nFees)) {
 		{
 			LOCK(cs_main);
@@ -2695,18 +2985,31 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
 
+    // While the index builder is catching up after a reindex it writes the indexes of this block later
+    if (IndexBuilderActive())
+        ignoreAddressIndex = true;
+
+    // The outputs spent by the block are in its undo data now
+    CBlockIndexEntries indexEntries;
+    if (!ignoreAddressIndex && (fAddressIndex || fSpentIndex))
+        GetBlockIndexEntries(block, blockundo, pindex->nHeight, AreAssetsDeployed(), indexEntries);
+
     if (!ignoreAddressIndex && fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
+        if (!pblocktree->WriteAddressIndex(indexEntries.addressIndex)) {
             return AbortNode(state, "Failed to write address index");
         }
 
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
+        if (!UpdateAddressBalances(indexEntries.addressIndex, pindex, false)) {
+            return AbortNode(state, "Failed to update address balances");
+        }
+
+        if (!pblocktree->UpdateAddressUnspentIndex(indexEntries.addressUnspentIndex)) {
             return AbortNode(state, "Failed to write address unspent index");
         }
     }
 
     if (!ignoreAddressIndex && fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
+        if (!pblocktree->UpdateSpentIndex(indexEntries.spentIndex))
             return AbortNode(state, "Failed to write transaction index");
 
     if (!ignoreAddressIndex && fTimestampIndex) {
@@ -2723,7 +3026,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
         }
 
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
+        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash()), CTimestampIndexValue(true)))
             return AbortNode(state, "Failed to write timestamp index");
 
         if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
@@ -2841,9 +3144,19 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                 std::vector<const CBlockIndex*> vBlocks;
                 vBlocks.reserve(setDirtyBlockIndex.size());
                 for (std::set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end(); ) {
-                    vBlocks.push_back(*it);
+                    // Append the auxpow of newly written headers to the auxpow store, which the index entries reference by offset
+                    CBlockIndex* pindex = *it;
+                    std::map<uint256, std::shared_ptr<CAuxPow> >::const_iterator auxIt = mapDirtyAuxPow.find(pindex->GetBlockHash());
+                    if (auxIt != mapDirtyAuxPow.end() && auxIt->second && (pindex->nVersion & AuxPow::BLOCK_VERSION_AUXPOW) && pindex->nAuxPowPos == 0) {
+                        if (!pauxpowstore->Write(*auxIt->second, pindex->nAuxPowPos))
+                            return AbortNode(state, "Failed to write to the auxpow store");
+                    }
+                    vBlocks.push_back(pindex);
                     setDirtyBlockIndex.erase(it++);
                 }
+                if (!pauxpowstore->Flush()) {
+                    return AbortNode(state, "Failed to flush the auxpow store");
+                }
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks, mapDirtyAuxPow)) {
                     return AbortNode(state, "Failed to write to block index database");
                 }
@@ -2873,14 +3186,12 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                 return AbortNode(state, "Failed to write to coin database");
 
             /** BLAST START */
-            // Flush the assetstate
-            if (AreAssetsDeployed()) {
-                // Flush the assetstate
-                auto currentActiveAssetCache = GetCurrentAssetCache();
-                if (currentActiveAssetCache) {
-                    if (!currentActiveAssetCache->DumpCacheToDatabase())
-                        return AbortNode(state, "Failed to write to asset database");
-                }
+            // Flush the assetstate. This also runs before assets are deployed so the asset database
+            // always records the same best block as the coins database it was flushed with
+            auto currentActiveAssetCache = GetCurrentAssetCache();
+            if (currentActiveAssetCache) {
+                if (!currentActiveAssetCache->DumpCacheToDatabase(pcoinsTip->GetBestBlock()))
+                    return AbortNode(state, "Failed to write to asset database");
             }
 
             // Write the reissue mempool data to database
@@ -3144,7 +3455,7 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
 
     /** BLAST START */
     // Initialize sets used from removing asset entries from the mempool
-    std::set<CAssetCacheNewAsset> setNewAssetsAddedInBlock;
+    std::unordered_set<CAssetCacheNewAsset, CAssetCacheHasher> setNewAssetsAddedInBlock;
     /** BLAST END */
 
     {
@@ -3172,10 +3483,9 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         int64_t nTimeAssetsStart = GetTimeMicros();
         /** BLAST START */
         // Get the newly created assets, from the connectblock assetCache so we can remove the correct assets from the mempool
-        setNewAssetsAddedInBlock = assetCache.setNewAssetsToAdd;
-        for (auto it : passets->setNewAssetsToAdd) {
-            if (setNewAssetsAddedInBlock.count(it))
-                setNewAssetsAddedInBlock.erase(it);
+        for (const auto& it : assetCache.setNewAssetsToAdd) {
+            if (!passets->setNewAssetsToAdd.count(it))
+                setNewAssetsAddedInBlock.insert(it);
         }
 
         // Remove all tx hashes, that were marked as reissued script from the mapReissuedTx.
@@ -3414,6 +3724,8 @@ bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams,
     // us in the middle of ProcessNewBlock - do not assume pblock is set
     // sanely for performance or correctness!
 
+    LOCK(cs_chainstate);
+
     CBlockIndex *pindexMostWork = nullptr;
     CBlockIndex *pindexNewTip = nullptr;
     int nStopAtHeight = gArgs.GetArg("-stopatheight", DEFAULT_STOPATHEIGHT);
@@ -3767,6 +4079,36 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
     return true;
 }
 
+bool CHeaderPoWCheck::operator()() {
+    *pfValid = CheckBlockProofOfWork(pheader, *pparams);
+    return true;
+}
+
+size_t CheckHeadersProofOfWork(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams)
+{
+    AssertLockHeld(cs_main);
+
+    std::vector<char> vValid(headers.size(), true);
+    std::vector<CHeaderPoWCheck> vChecks;
+    vChecks.reserve(headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        // Known headers are accepted as duplicates without being checked again
+        if (!mapBlockIndex.count(headers[i].GetHash()))
+            vChecks.emplace_back(headers[i], consensusParams, &vValid[i]);
+    }
+
+    if (nHeaderCheckThreads) {
+        CCheckQueueControl<CHeaderPoWCheck> control(&headercheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    } else {
+        for (CHeaderPoWCheck& check : vChecks)
+            check();
+    }
+
+    return std::find(vValid.begin(), vValid.end(), false) - vValid.begin();
+}
+
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckAssetDuplicate, bool fForceDuplicateCheck)
 {
     // These are checks that are independent of context.
@@ -3926,25 +4268,29 @@ bool DisconnectBlocks(int blocks)
 
 void ReprocessBlocks(int nBlocks)
 {
-    LOCK(cs_main);
+    // Keep other threads from activating a chain between the disconnects and our ActivateBestChain
+    LOCK(cs_chainstate);
+    {
+        LOCK(cs_main);
 
-    std::map<uint256, int64_t>::iterator it = mapRejectedBlocks.begin();
-    while(it != mapRejectedBlocks.end()){
-        //use a window twice as large as is usual for the nBlocks we want to reset
-        if((*it).second  > GetTime() - (nBlocks*60*5)) {
-            BlockMap::iterator mi = mapBlockIndex.find((*it).first);
-            if (mi != mapBlockIndex.end() && (*mi).second) {
+        std::map<uint256, int64_t>::iterator it = mapRejectedBlocks.begin();
+        while(it != mapRejectedBlocks.end()){
+            //use a window twice as large as is usual for the nBlocks we want to reset
+            if((*it).second  > GetTime() - (nBlocks*60*5)) {
+                BlockMap::iterator mi = mapBlockIndex.find((*it).first);
+                if (mi != mapBlockIndex.end() && (*mi).second) {
 
-                CBlockIndex* pindex = (*mi).second;
-                LogPrintf("ReprocessBlocks -- %s\n", (*it).first.ToString());
+                    CBlockIndex* pindex = (*mi).second;
+                    LogPrintf("ReprocessBlocks -- %s\n", (*it).first.ToString());
 
-                ResetBlockFailureFlags(pindex);
+                    ResetBlockFailureFlags(pindex);
+                }
             }
+            ++it;
         }
-        ++it;
-    }
 
-    DisconnectBlocks(nBlocks);
+        DisconnectBlocks(nBlocks);
+    }
 
     CValidationState state;
     ActivateBestChain(state, Params());
@@ -4137,7 +4483,7 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckPOW = true)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
@@ -4156,7 +4502,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), fCheckPOW))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -4189,9 +4535,13 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
 {
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        // Check the proof of work of a whole headers message in parallel first. Headers ahead of the first
+        // one failing it are accepted without checking it again, and the failing one goes through the
+        // usual checks so it's rejected with the same DoS score as before.
+        size_t nFirstBadPoW = headers.size() > 1 ? CheckHeadersProofOfWork(headers, chainparams.GetConsensus()) : 0;
+        for (size_t i = 0; i < headers.size(); i++) {
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!AcceptBlockHeader(headers[i], state, chainparams, &pindex, i >= nFirstBadPoW)) {
                 return false;
             }
             if (ppindex) {
@@ -4346,7 +4696,8 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
     indexDummy.nHeight = pindexPrev->nHeight + 1;
 
     /** BLAST START */
-    CAssetsCache assetCache = *GetCurrentAssetCache();
+    // Starts empty, lookups fall through to the global asset cache
+    CAssetsCache assetCache;
     /** BLAST END */
 
     // NOTE: CheckBlockHeader is called by CheckBlock
@@ -4418,6 +4769,10 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        if (pblockfilereader) {
+            pblockfilereader->Close("blk", *it);
+            pblockfilereader->Close("rev", *it);
+        }
         fs::remove(GetBlockPosFilename(pos, "blk"));
         fs::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -4750,8 +5105,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     CValidationState state;
     int reportDone = 0;
 
-    auto currentActiveAssetCache = GetCurrentAssetCache();
-    CAssetsCache assetCache(*currentActiveAssetCache);
+    CAssetsCache assetCache;
     LogPrintf("[0%%]...");
     for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
     {
@@ -4845,7 +5199,9 @@ static bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs,
             }
         }
         // Pass check = true as every addition may be an overwrite.
-        AddCoins(inputs, *tx, pindex->nHeight, pindex->GetBlockHash(), true, assetsCache);
+        // The asset undo data was written when the block was first connected
+        std::pair<std::string, CBlockAssetUndo> undoAssetData;
+        AddCoins(inputs, *tx, pindex->nHeight, pindex->GetBlockHash(), true, assetsCache, &undoAssetData);
     }
     return true;
 }
@@ -4855,8 +5211,8 @@ bool ReplayBlocks(const CChainParams& params, CCoinsView* view)
     LOCK(cs_main);
 
     CCoinsViewCache cache(view);
-    auto currentActiveAssetCache = GetCurrentAssetCache();
-    CAssetsCache assetsCache(*currentActiveAssetCache);
+    // Only the changes made while replaying are flushed back into the global asset cache
+    CAssetsCache assetsCache;
 
     std::vector<uint256> hashHeads = view->GetHeadBlocks();
     if (hashHeads.empty()) return true; // We're already in a consistent state.
@@ -4918,6 +5274,93 @@ bool ReplayBlocks(const CChainParams& params, CCoinsView* view)
     return true;
 }
 
+bool ReplayAssets(const CChainParams& params)
+{
+    LOCK(cs_main);
+
+    // The asset database records the coins best block it was last flushed with
+    uint256 hashAssets;
+    if (!passetsdb->ReadBestBlock(hashAssets) || hashAssets == pcoinsTip->GetBestBlock())
+        return true;
+
+    BlockMap::iterator mi = mapBlockIndex.find(hashAssets);
+    if (mi == mapBlockIndex.end())
+        return error("ReplayAssets(): the asset database is at unknown block %s", hashAssets.ToString());
+    const CBlockIndex* pindexAssets = mi->second;
+    const CBlockIndex* pindexTip = chainActive.Tip();
+    const CBlockIndex* pindexFork = LastCommonAncestor(pindexAssets, pindexTip);
+    assert(pindexFork != nullptr);
+
+    uiInterface.ShowProgress(_("Replaying blocks..."), 0, false);
+    LogPrintf("Replaying the asset changes from %s (%i) to %s (%i)\n", pindexAssets->GetBlockHash().ToString(), pindexAssets->nHeight,
+              pindexTip->GetBlockHash().ToString(), pindexTip->nHeight);
+
+    // Asset changes are applied along with the coins they come from. Take a scratch copy of the coins to
+    // where the assets are first, without touching the assets
+    CCoinsViewCache coins(pcoinsTip);
+    for (const CBlockIndex* pindex = pindexTip; pindex != pindexFork; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, params.GetConsensus()))
+            return error("ReplayAssets(): ReadBlockFromDisk() failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+        if (DisconnectBlock(block, pindex, coins, nullptr, true) == DISCONNECT_FAILED)
+            return error("ReplayAssets(): DisconnectBlock failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+    }
+    for (int nHeight = pindexFork->nHeight + 1; nHeight <= pindexAssets->nHeight; ++nHeight) {
+        if (!RollforwardBlock(pindexAssets->GetAncestor(nHeight), coins, params))
+            return false;
+    }
+
+    // Then roll the assets back to the fork and forward to the tip with them
+    CAssetsCache assetsCache;
+    for (const CBlockIndex* pindex = pindexAssets; pindex != pindexFork; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, params.GetConsensus()))
+            return error("ReplayAssets(): ReadBlockFromDisk() failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+        LogPrintf("Rolling back the assets of %s (%i)\n", pindex->GetBlockHash().ToString(), pindex->nHeight);
+        if (DisconnectBlock(block, pindex, coins, &assetsCache, true) == DISCONNECT_FAILED)
+            return error("ReplayAssets(): DisconnectBlock failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+    }
+    for (int nHeight = pindexFork->nHeight + 1; nHeight <= pindexTip->nHeight; ++nHeight) {
+        const CBlockIndex* pindex = pindexTip->GetAncestor(nHeight);
+        LogPrintf("Rolling forward the assets of %s (%i)\n", pindex->GetBlockHash().ToString(), nHeight);
+        if (!RollforwardBlock(pindex, coins, params, &assetsCache))
+            return false;
+    }
+
+    // The coins were only needed to follow the assets, write just the assets with the tip as their best block
+    if (!assetsCache.Flush() || !passets->DumpCacheToDatabase(pindexTip->GetBlockHash()))
+        return error("ReplayAssets(): failed to write the asset database");
+
+    uiInterface.ShowProgress("", 100, false);
+    return true;
+}
+
+bool LoadAddressBalances(const CChainParams& chainparams)
+{
+    LOCK(cs_main);
+    if (!fAddressIndex)
+        return true;
+
+    // The index builder doesn't keep them, they are rebuilt at the first startup after it has caught up
+    if (IndexBuilderActive())
+        return true;
+
+    // Reindexing connects every block again on top of empty balances
+    const CBlockIndex* pindexTip = chainActive.Tip();
+    if (!pindexTip)
+        return pblocktree->RebuildAddressBalances(0, chainparams.GetConsensus().hashGenesisBlock);
+
+    // After an unclean shutdown they can be ahead of the tip, the blocks connected again are skipped
+    uint256 hashBalances;
+    if (pblocktree->ReadAddressBalanceBestBlock(hashBalances)) {
+        BlockMap::iterator mi = mapBlockIndex.find(hashBalances);
+        if (mi != mapBlockIndex.end() && mi->second->GetAncestor(pindexTip->nHeight) == pindexTip)
+            return true;
+    }
+
+    return pblocktree->RebuildAddressBalances(pindexTip->nHeight, pindexTip->GetBlockHash());
+}
+
 bool RewindBlockIndex(const CChainParams& params)
 {
     LOCK(cs_main);
@@ -27,6 +27,7 @@
 
 #include <algorithm>
 #include <exception>
+#include <functional>
 #include <map>
 #include <set>
 #include <stdint.h>
@@ -49,6 +50,7 @@ class CBlockPolicyEstimator;
 class CTxMemPool;
 class CValidationState;
 class CTxUndo;
+class CBlockUndo;
 struct ChainTxData;
 
 class CAssetsDB;
@@ -92,6 +94,10 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of header proof of work checking threads allowed */
+static const int MAX_HEADERCHECK_THREADS = 16;
+/** -parheaders default (number of header proof of work checking threads, including the caller's) */
+static const int DEFAULT_HEADERCHECK_THREADS = 4;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -189,6 +195,7 @@ extern CConditionVariable cvBlockChange;
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
 extern int nScriptCheckThreads;
+extern int nHeaderCheckThreads;
 extern bool fTxIndex;
 extern bool fAssetIndex;
 extern bool fAddressIndex;
@@ -293,10 +300,16 @@ bool LoadGenesisBlock(const CChainParams& chainparams);
 bool LoadBlockIndex(const CChainParams& chainparams);
 /** Update the chain tip based on database information. */
 bool LoadChainTip(const CChainParams& chainparams);
+/** Make sure the address balances match the address index at the chain tip, rebuilding them if they don't */
+bool LoadAddressBalances(const CChainParams& chainparams);
 /** Unload database information */
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the asset checking thread */
+void ThreadAssetCheck();
+/** Run an instance of the header proof of work checking thread */
+void ThreadHeaderCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 bool IsInitialSyncSpeedUp();
@@ -436,10 +449,70 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the context free asset checks of one block transaction: the layout of its asset
+ * scripts, burn and owner outputs, and the validity of names, amounts, units and IPFS hashes. The checks
+ * against the asset cache stay on the thread connecting the block.
+ */
+class CAssetCheck
+{
+private:
+    const CTransaction *ptx;
+    std::string strRejectReason;
+
+public:
+    CAssetCheck(): ptx(nullptr) {}
+    explicit CAssetCheck(const CTransaction& txIn) : ptx(&txIn) {}
+
+    bool operator()();
+
+    void swap(CAssetCheck &check) {
+        std::swap(ptx, check.ptx);
+        strRejectReason.swap(check.strRejectReason);
+    }
+
+    const std::string& GetRejectReason() const { return strRejectReason; }
+};
+
+/**
+ * Closure representing the proof of work check of one header of a headers message, which for a merge
+ * mined header means the auxpow merkle branches and the parent header's work. The result goes to a slot of
+ * its own instead of failing the batch, so the caller can still tell which header was the first bad one.
+ */
+class CHeaderPoWCheck
+{
+private:
+    const CBlockHeader *pheader;
+    const Consensus::Params *pparams;
+    char *pfValid;
+
+public:
+    CHeaderPoWCheck(): pheader(nullptr), pparams(nullptr), pfValid(nullptr) {}
+    CHeaderPoWCheck(const CBlockHeader& headerIn, const Consensus::Params& paramsIn, char* pfValidIn) :
+        pheader(&headerIn), pparams(&paramsIn), pfValid(pfValidIn) {}
+
+    bool operator()();
+
+    void swap(CHeaderPoWCheck &check) {
+        std::swap(pheader, check.pheader);
+        std::swap(pparams, check.pparams);
+        std::swap(pfValid, check.pfValid);
+    }
+};
+
+/**
+ * Check the proof of work of the headers not in mapBlockIndex yet, spread over the check queue workers.
+ * Returns the index of the first header failing it, or headers.size() if none does.
+ */
+size_t CheckHeadersProofOfWork(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams);
+
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes);
+/** Stream the block hashes with a logical timestamp in [low, high) to fn until it returns false, without cs_main */
+bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly,
+                       const std::function<bool(const uint256&, unsigned int)> &fn);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool HashOnchainActive(const uint256 &hash);
 bool GetAddressIndex(uint160 addressHash, int type, std::string assetName,
@@ -450,12 +523,38 @@ bool GetAddressIndex(uint160 addressHash, int type,
                      int start = 0, int end = 0);
 bool GetAddressUnspent(uint160 addressHash, int type, std::string assetName,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetAddressIndex(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                     int start = 0, int end = 0);
+bool GetAddressIndexPage(uint160 addressHash, int type, std::string assetName, int start, int end,
+                         const CAddressIndexCompactKey* pkeyAfter, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                         CAddressIndexCompactKey &keyLast, bool &fMore);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetAddressUnspent(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                       std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetAddressUnspentPage(uint160 addressHash, int type, std::string assetName,
+                           const CAddressUnspentCompactKey* pkeyAfter, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                           CAddressUnspentCompactKey &keyLast, bool &fMore);
+bool GetAddressBalance(uint160 addressHash, int type, std::string assetName, CAddressBalanceValue &balance);
+bool GetAddressBalances(uint160 addressHash, int type,
+                        std::vector<std::pair<std::string, CAddressBalanceValue> > &balances);
 
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/**
+ * Read a block as it is stored in its blk file, without deserializing it. The stored serialization
+ * includes witnesses and is what NetMsgType::BLOCK carries for peers that asked for them. Only the
+ * header hash is checked against the index.
+ */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart);
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock);
+
+/** Abort with a message */
+bool AbortNode(const std::string& strMessage, const std::string& userMessage = "");
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -492,6 +591,9 @@ public:
 /** Replay blocks that aren't fully applied to the database. */
 bool ReplayBlocks(const CChainParams& params, CCoinsView* view);
 
+/** Bring the asset database to the chain tip when its last flush didn't make it to disk with the coins. */
+bool ReplayAssets(const CChainParams& params);
+
 /** Find the last common block between the parameter chain and a locator. */
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator);
 
@@ -521,8 +623,8 @@ extern CBlockTreeDB *pblocktree;
 extern CAssetsDB *passetsdb;
 /** Global variable that point to the active assets (protexted by cs_main) */
 extern CAssetsCache *passets;
-/** Global variable that point to the assets LRU Cache (protexted by cs_main) */
-extern CLRUCache<std::string, CDatabasedAssetData> *passetsCache;
+/** Global variable that points to the asset metadata cache (the pointer is protected by cs_main, the entries by per-shard locks) */
+extern CShardedCache<std::string, CDatabasedAssetData> *passetsCache;
 /** BLAST END */
 
 /**
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "wallet/wallet.h"
+#include "assets/assets.h"
 #include "chainparams.h"
 
 #include <set>
@@ -716,4 +717,87 @@ BOOST_FIXTURE_TEST_SUITE(wallet_tests, WalletTestingSetup)
         BOOST_CHECK_EQUAL(list.begin()->second.size(), 2L);
     }
 
+    class TestAssetIndex
+    {
+    public:
+        static bool Contains(const CWallet& wallet, const std::string& assetName, const COutPoint& outpoint)
+        {
+            auto it = wallet.mapAssetOutPoints.find(assetName);
+            return it != wallet.mapAssetOutPoints.end() && it->second.count(outpoint);
+        }
+
+        static void MarkConflicted(CWallet& wallet, const uint256& hashBlock, const uint256& hashTx)
+        {
+            wallet.MarkConflicted(hashBlock, hashTx);
+        }
+    };
+
+    static uint256 AddSpend(CWallet& wallet, const COutPoint& outpoint, uint32_t lockTime)
+    {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(outpoint);
+        tx.vout.emplace_back(1 * COIN, CScript() << OP_TRUE);
+        tx.nLockTime = lockTime;
+        CWalletTx wtx(&wallet, MakeTransactionRef(tx));
+        BOOST_CHECK(wallet.AddToWallet(wtx));
+        return wtx.GetHash();
+    }
+
+    BOOST_AUTO_TEST_CASE(asset_outpoint_index_test)
+    {
+        BOOST_TEST_MESSAGE("Running Asset OutPoint Index Test");
+
+        CKey key;
+        key.MakeNewKey(true);
+        CScript scriptAsset = GetScriptForDestination(key.GetPubKey().GetID());
+        CAssetTransfer("WALLETASSET", 10 * COIN).ConstructTransaction(scriptAsset);
+
+        CMutableTransaction txAsset;
+        txAsset.vin.emplace_back(COutPoint(GetRandHash(), 0));
+        txAsset.vout.emplace_back(0, scriptAsset);
+        COutPoint outpoint(txAsset.GetHash(), 0);
+
+        // Adding a transaction indexes our asset outputs
+        {
+            CWallet wallet(std::unique_ptr<CWalletDBWrapper>(new CWalletDBWrapper(&bitdb, "wallet_asset_index.dat")));
+            bool fFirstRun;
+            BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_LOAD_OK);
+            AddKey(wallet, key);
+            LOCK2(cs_main, wallet.cs_wallet);
+            BOOST_CHECK(wallet.AddToWallet(CWalletTx(&wallet, MakeTransactionRef(txAsset))));
+            BOOST_CHECK(TestAssetIndex::Contains(wallet, "WALLETASSET", outpoint));
+
+            // A record that can't be read, which only is a noncritical error
+            CDB batch(wallet.GetDBHandle());
+            BOOST_CHECK(batch.Write(std::make_pair(std::string("name"), std::string("corrupt")), (uint32_t)5));
+        }
+
+        // The index is built when a wallet with noncritical errors is loaded, as init goes on with it
+        CWallet wallet(std::unique_ptr<CWalletDBWrapper>(new CWalletDBWrapper(&bitdb, "wallet_asset_index.dat")));
+        bool fFirstRun;
+        BOOST_CHECK_EQUAL(wallet.LoadWallet(fFirstRun), DB_NONCRITICAL_ERROR);
+        LOCK2(cs_main, wallet.cs_wallet);
+        BOOST_CHECK(TestAssetIndex::Contains(wallet, "WALLETASSET", outpoint));
+
+        // Spending the output drops it, abandoning the spend puts it back
+        uint256 hashSpend = AddSpend(wallet, outpoint, 1);
+        BOOST_CHECK(!TestAssetIndex::Contains(wallet, "WALLETASSET", outpoint));
+        BOOST_CHECK(wallet.AbandonTransaction(hashSpend));
+        BOOST_CHECK(TestAssetIndex::Contains(wallet, "WALLETASSET", outpoint));
+
+        // So does a spend conflicting with a block
+        uint256 hashConflicted = AddSpend(wallet, outpoint, 2);
+        BOOST_CHECK(!TestAssetIndex::Contains(wallet, "WALLETASSET", outpoint));
+        TestAssetIndex::MarkConflicted(wallet, chainActive.Tip()->GetBlockHash(), hashConflicted);
+        BOOST_CHECK(TestAssetIndex::Contains(wallet, "WALLETASSET", outpoint));
+
+        // And zapping the spend
+        std::vector<uint256> vHashIn = {AddSpend(wallet, outpoint, 3)};
+        BOOST_CHECK(!TestAssetIndex::Contains(wallet, "WALLETASSET", outpoint));
+        std::vector<uint256> vHashOut;
+        BOOST_CHECK_EQUAL(wallet.ZapSelectTx(vHashIn, vHashOut), DB_LOAD_OK);
+        BOOST_CHECK_EQUAL(vHashOut.size(), 1U);
+        BOOST_CHECK(TestAssetIndex::Contains(wallet, "WALLETASSET", outpoint));
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
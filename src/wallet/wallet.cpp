@@ -577,6 +577,84 @@ void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
     std::pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
     SyncMetaData(range);
+
+    if (IsSpentByActiveTx(outpoint))
+        RemoveAssetOutPoint(outpoint);
+}
+
+/**
+ * Like IsSpent, but only looks at the state stored on the spending
+ * transactions so it can be used without cs_main. An outpoint whose
+ * spenders have all been abandoned or marked conflicted may be
+ * spendable again.
+ */
+bool CWallet::IsSpentByActiveTx(const COutPoint& outpoint) const
+{
+    std::pair<TxSpends::const_iterator, TxSpends::const_iterator> range;
+    range = mapTxSpends.equal_range(outpoint);
+
+    for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
+        std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(it->second);
+        if (mit != mapWallet.end()) {
+            const CWalletTx& wtx = mit->second;
+            bool fConflicted = wtx.nIndex == -1 && !wtx.hashUnset();
+            if (!wtx.isAbandoned() && !fConflicted)
+                return true;
+        }
+    }
+    return false;
+}
+
+void CWallet::AddAssetOutPoints(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet); // mapAssetOutPoints
+
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        const CTxOut& txout = wtx.tx->vout[i];
+        if (!txout.scriptPubKey.IsAssetScript())
+            continue;
+
+        COutPoint outpoint(wtx.GetHash(), i);
+        if (IsSpentByActiveTx(outpoint) || IsMine(txout) == ISMINE_NO)
+            continue;
+
+        CAssetScriptData data;
+        if (GetAssetScriptData(txout.scriptPubKey, data))
+            mapAssetOutPoints[data.assetName].insert(outpoint);
+    }
+}
+
+void CWallet::RemoveAssetOutPoint(const COutPoint& outpoint)
+{
+    AssertLockHeld(cs_wallet); // mapAssetOutPoints
+
+    if (mapAssetOutPoints.empty())
+        return;
+
+    std::map<uint256, CWalletTx>::const_iterator mit = mapWallet.find(outpoint.hash);
+    if (mit == mapWallet.end() || outpoint.n >= mit->second.tx->vout.size())
+        return;
+
+    CAssetScriptData data;
+    if (!GetAssetScriptData(mit->second.tx->vout[outpoint.n].scriptPubKey, data))
+        return;
+
+    auto it = mapAssetOutPoints.find(data.assetName);
+    if (it == mapAssetOutPoints.end())
+        return;
+
+    it->second.erase(outpoint);
+    if (it->second.empty())
+        mapAssetOutPoints.erase(it);
+}
+
+void CWallet::RebuildAssetOutPoints()
+{
+    AssertLockHeld(cs_wallet); // mapAssetOutPoints
+
+    mapAssetOutPoints.clear();
+    for (const auto& item : mapWallet)
+        AddAssetOutPoints(item.second);
 }
 
 
@@ -940,6 +1018,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
         }
     }
 
+    // Also picks up outputs of known transactions that became ours through a key import and rescan
+    AddAssetOutPoints(wtx);
+
     //// debug print
     LogPrintf("AddToWallet %s  %s%s\n", wtxIn.GetHash().ToString(), (fInsertedNew ? "new" : ""), (fUpdated ? "update" : ""));
 
@@ -1120,6 +1201,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
                 auto it = mapWallet.find(txin.prevout.hash);
                 if (it != mapWallet.end()) {
                     it->second.MarkDirty();
+                    AddAssetOutPoints(it->second);
                 }
             }
         }
@@ -1183,6 +1265,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
                 auto it = mapWallet.find(txin.prevout.hash);
                 if (it != mapWallet.end()) {
                     it->second.MarkDirty();
+                    AddAssetOutPoints(it->second);
                 }
             }
         }
@@ -2200,27 +2283,24 @@ void CWallet::AvailableCoinsAll(std::vector<COutput>& vCoins, std::map<std::stri
         std::map<std::string, CAmount> mapAssetTotals;
         std::map<uint256, COutPoint> mapOutPoints;
         std::set<std::string> setAssetMaxFound;
-        // Turn the OutPoints into a map that is easily interatable.
-        for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
-            const uint256 &wtxid = it->first;
-            const CWalletTx *pcoin = &(*it).second;
-
+        // Checks shared by every output of a transaction, sets the depth and whether it's safe to spend from
+        auto fnTxAvailable = [&](const CWalletTx* pcoin, int& nDepth, bool& safeTx) -> bool {
             if (!CheckFinalTx(*pcoin))
-                continue;
+                return false;
 
             if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
-                continue;
+                return false;
 
-            int nDepth = pcoin->GetDepthInMainChain();
+            nDepth = pcoin->GetDepthInMainChain();
             if (nDepth < 0)
-                continue;
+                return false;
 
             // We should not consider coins which aren't at least in our mempool
             // It's possible for these to be conflicted via ancestors which we may never be able to detect
             if (nDepth == 0 && !pcoin->InMempool())
-                continue;
+                return false;
 
-            bool safeTx = pcoin->IsTrusted();
+            safeTx = pcoin->IsTrusted();
 
             // We should not consider coins from transactions that are replacing
             // other transactions.
@@ -2254,145 +2334,173 @@ void CWallet::AvailableCoinsAll(std::vector<COutput>& vCoins, std::map<std::stri
             }
 
             if (fOnlySafe && !safeTx) {
-                continue;
+                return false;
             }
 
             if (nDepth < nMinDepth || nDepth > nMaxDepth)
-                continue;
+                return false;
 
-            for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
+            return true;
+        };
 
-                int nType;
-                bool fIsOwner;
-                bool isAssetScript = pcoin->tx->vout[i].scriptPubKey.IsAssetScript(nType, fIsOwner);
-                if (coinControl && !isAssetScript && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(COutPoint((*it).first, i)))
-                    continue;
+        auto fnAddOutput = [&](const uint256& wtxid, const CWalletTx* pcoin, unsigned int i, int nDepth, bool safeTx) {
+            int nType;
+            bool fIsOwner;
+            bool isAssetScript = pcoin->tx->vout[i].scriptPubKey.IsAssetScript(nType, fIsOwner);
+            if (coinControl && !isAssetScript && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(COutPoint(wtxid, i)))
+                return;
 
-                if (coinControl && isAssetScript && coinControl->HasAssetSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsAssetSelected(COutPoint((*it).first, i)))
-                    continue;
+            if (coinControl && isAssetScript && coinControl->HasAssetSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsAssetSelected(COutPoint(wtxid, i)))
+                return;
 
-                if (IsLockedCoin((*it).first, i) && nCoinType != ONLY_1000)
-                    continue;
+            if (IsLockedCoin(wtxid, i) && nCoinType != ONLY_1000)
+                return;
 
-                if (IsSpent(wtxid, i))
-                    continue;
+            if (IsSpent(wtxid, i))
+                return;
 
-                isminetype mine = IsMine(pcoin->tx->vout[i]);
+            isminetype mine = IsMine(pcoin->tx->vout[i]);
 
-                if (mine == ISMINE_NO) {
-                    continue;
-                }
+            if (mine == ISMINE_NO) {
+                return;
+            }
 
-                bool fSpendableIn = ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
-                                    (coinControl && coinControl->fAllowWatchOnly &&
-                                     (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO);
-                bool fSolvableIn = (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO;
-
-                std::string address;
-                CAssetTransfer assetTransfer;
-                CNewAsset asset;
-                CReissueAsset reissue;
-                std::string ownerName;
-                bool fWasNewAssetOutPoint = false;
-                bool fWasTransferAssetOutPoint = false;
-                bool fWasOwnerAssetOutPoint = false;
-                bool fWasReissueAssetOutPoint = false;
-                std::string strAssetName;
-
-                // Looking for Asset Tx OutPoints Only
-                if (fGetAssets && AreAssetsDeployed() && isAssetScript) {
-
-                    if ( nType == TX_TRANSFER_ASSET) {
-                        if (TransferAssetFromScript(pcoin->tx->vout[i].scriptPubKey, assetTransfer, address)) {
-                            strAssetName = assetTransfer.strName;
-                            fWasTransferAssetOutPoint = true;
-                        }
-                    } else if ( nType == TX_NEW_ASSET && !fIsOwner) {
-                        if (AssetFromScript(pcoin->tx->vout[i].scriptPubKey, asset, address)) {
-                            strAssetName = asset.strName;
-                            fWasNewAssetOutPoint = true;
-                        }
-                    } else if ( nType == TX_NEW_ASSET && fIsOwner) {
-                        if (OwnerAssetFromScript(pcoin->tx->vout[i].scriptPubKey, ownerName, address)) {
-                            strAssetName = ownerName;
-                            fWasOwnerAssetOutPoint = true;
-                        }
-                    } else if ( nType == TX_REISSUE_ASSET) {
-                        if (ReissueAssetFromScript(pcoin->tx->vout[i].scriptPubKey, reissue, address)) {
-                            strAssetName = reissue.strName;
-                            fWasReissueAssetOutPoint = true;
-                        }
-                    } else {
-                        continue;
-                    }
+            bool fSpendableIn = ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
+                                (coinControl && coinControl->fAllowWatchOnly &&
+                                 (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO);
+            bool fSolvableIn = (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO;
 
-                    if (fWasNewAssetOutPoint || fWasTransferAssetOutPoint || fWasOwnerAssetOutPoint || fWasReissueAssetOutPoint) {
+            std::string address;
+            CAssetTransfer assetTransfer;
+            CNewAsset asset;
+            CReissueAsset reissue;
+            std::string ownerName;
+            bool fWasNewAssetOutPoint = false;
+            bool fWasTransferAssetOutPoint = false;
+            bool fWasOwnerAssetOutPoint = false;
+            bool fWasReissueAssetOutPoint = false;
+            std::string strAssetName;
+
+            // Looking for Asset Tx OutPoints Only
+            if (fGetAssets && AreAssetsDeployed() && isAssetScript) {
+
+                if ( nType == TX_TRANSFER_ASSET) {
+                    if (TransferAssetFromScript(pcoin->tx->vout[i].scriptPubKey, assetTransfer, address)) {
+                        strAssetName = assetTransfer.strName;
+                        fWasTransferAssetOutPoint = true;
+                    }
+                } else if ( nType == TX_NEW_ASSET && !fIsOwner) {
+                    if (AssetFromScript(pcoin->tx->vout[i].scriptPubKey, asset, address)) {
+                        strAssetName = asset.strName;
+                        fWasNewAssetOutPoint = true;
+                    }
+                } else if ( nType == TX_NEW_ASSET && fIsOwner) {
+                    if (OwnerAssetFromScript(pcoin->tx->vout[i].scriptPubKey, ownerName, address)) {
+                        strAssetName = ownerName;
+                        fWasOwnerAssetOutPoint = true;
+                    }
+                } else if ( nType == TX_REISSUE_ASSET) {
+                    if (ReissueAssetFromScript(pcoin->tx->vout[i].scriptPubKey, reissue, address)) {
+                        strAssetName = reissue.strName;
+                        fWasReissueAssetOutPoint = true;
+                    }
+                } else {
+                    return;
+                }
 
-                        // If we already have the maximum amount or size for this asset, skip it
-                        if (setAssetMaxFound.count(strAssetName))
-                            continue;
+                if (fWasNewAssetOutPoint || fWasTransferAssetOutPoint || fWasOwnerAssetOutPoint || fWasReissueAssetOutPoint) {
 
-                        // Initialize the map vector is it doesn't exist yet
-                        if (!mapAssetCoins.count(strAssetName)) {
-                            std::vector<COutput> vOutput;
-                            mapAssetCoins.insert(std::make_pair(strAssetName, vOutput));
-                        }
+                    // If we already have the maximum amount or size for this asset, skip it
+                    if (setAssetMaxFound.count(strAssetName))
+                        return;
 
-                        // Add the COutput to the map of available Asset Coins
-                        mapAssetCoins.at(strAssetName).push_back(
-                                COutput(pcoin, i, nDepth, fSpendableIn, fSolvableIn, safeTx));
-
-                        // Initialize the map of current asset totals
-                        if (!mapAssetTotals.count(strAssetName))
-                            mapAssetTotals[strAssetName] = 0;
-
-                        // Update the map of totals depending the which type of asset tx we are looking at
-                        if (fWasNewAssetOutPoint)
-                            mapAssetTotals[strAssetName] += asset.nAmount;
-                        else if (fWasTransferAssetOutPoint)
-                            mapAssetTotals[strAssetName] += assetTransfer.nAmount;
-                        else if (fWasReissueAssetOutPoint)
-                            mapAssetTotals[strAssetName] += reissue.nAmount;
-                        else if (fWasOwnerAssetOutPoint)
-                            mapAssetTotals[strAssetName] = OWNER_ASSET_AMOUNT;
-
-                        // Checks the sum amount of all UTXO's, and adds to the set of assets that we found the max for
-                        if (nMinimumSumAmount != MAX_MONEY) {
-                            if (mapAssetTotals[strAssetName] >= nMinimumSumAmount)
-                                setAssetMaxFound.insert(strAssetName);
-                        }
+                    // Initialize the map vector is it doesn't exist yet
+                    if (!mapAssetCoins.count(strAssetName)) {
+                        std::vector<COutput> vOutput;
+                        mapAssetCoins.insert(std::make_pair(strAssetName, vOutput));
+                    }
 
-                        // Checks the maximum number of UTXO's, and addes to set of of asset that we found the max for
-                        if (nMaximumCount > 0 && mapAssetCoins[strAssetName].size() >= nMaximumCount) {
+                    // Add the COutput to the map of available Asset Coins
+                    mapAssetCoins.at(strAssetName).push_back(
+                            COutput(pcoin, i, nDepth, fSpendableIn, fSolvableIn, safeTx));
+
+                    // Initialize the map of current asset totals
+                    if (!mapAssetTotals.count(strAssetName))
+                        mapAssetTotals[strAssetName] = 0;
+
+                    // Update the map of totals depending the which type of asset tx we are looking at
+                    if (fWasNewAssetOutPoint)
+                        mapAssetTotals[strAssetName] += asset.nAmount;
+                    else if (fWasTransferAssetOutPoint)
+                        mapAssetTotals[strAssetName] += assetTransfer.nAmount;
+                    else if (fWasReissueAssetOutPoint)
+                        mapAssetTotals[strAssetName] += reissue.nAmount;
+                    else if (fWasOwnerAssetOutPoint)
+                        mapAssetTotals[strAssetName] = OWNER_ASSET_AMOUNT;
+
+                    // Checks the sum amount of all UTXO's, and adds to the set of assets that we found the max for
+                    if (nMinimumSumAmount != MAX_MONEY) {
+                        if (mapAssetTotals[strAssetName] >= nMinimumSumAmount)
                             setAssetMaxFound.insert(strAssetName);
-                        }
                     }
-                }
 
-                if (fGetBLAST) { // Looking for BLAST Tx OutPoints Only
-                    if (fBLASTLimitHit) // We hit our limit
-                        continue;
+                    // Checks the maximum number of UTXO's, and addes to set of of asset that we found the max for
+                    if (nMaximumCount > 0 && mapAssetCoins[strAssetName].size() >= nMaximumCount) {
+                        setAssetMaxFound.insert(strAssetName);
+                    }
+                }
+            }
 
-                    // We only want BLAST OutPoints. Don't include Asset OutPoints
-                    if (isAssetScript)
-                        continue;
+            if (fGetBLAST) { // Looking for BLAST Tx OutPoints Only
+                if (fBLASTLimitHit) // We hit our limit
+                    return;
 
-                    vCoins.push_back(COutput(pcoin, i, nDepth, fSpendableIn, fSolvableIn, safeTx));
+                // We only want BLAST OutPoints. Don't include Asset OutPoints
+                if (isAssetScript)
+                    return;
 
-                    // Checks the sum amount of all UTXO's.
-                    if (nMinimumSumAmount != MAX_MONEY) {
-                        nTotal += pcoin->tx->vout[i].nValue;
+                vCoins.push_back(COutput(pcoin, i, nDepth, fSpendableIn, fSolvableIn, safeTx));
 
-                        if (nTotal >= nMinimumSumAmount) {
-                            fBLASTLimitHit = true;
-                        }
-                    }
+                // Checks the sum amount of all UTXO's.
+                if (nMinimumSumAmount != MAX_MONEY) {
+                    nTotal += pcoin->tx->vout[i].nValue;
 
-                    // Checks the maximum number of UTXO's.
-                    if (nMaximumCount > 0 && vCoins.size() >= nMaximumCount) {
+                    if (nTotal >= nMinimumSumAmount) {
                         fBLASTLimitHit = true;
                     }
+                }
+
+                // Checks the maximum number of UTXO's.
+                if (nMaximumCount > 0 && vCoins.size() >= nMaximumCount) {
+                    fBLASTLimitHit = true;
+                }
+            }
+        };
+
+        if (fGetBLAST || !fGetAssets) {
+            for (std::map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it) {
+                int nDepth;
+                bool safeTx;
+                if (!fnTxAvailable(&it->second, nDepth, safeTx))
                     continue;
+
+                for (unsigned int i = 0; i < it->second.tx->vout.size(); i++)
+                    fnAddOutput(it->first, &it->second, i, nDepth, safeTx);
+            }
+        } else {
+            // Only asset outputs were asked for, so walk the asset index instead of the whole wallet
+            for (const auto& item : mapAssetOutPoints) {
+                for (const COutPoint& outpoint : item.second) {
+                    std::map<uint256, CWalletTx>::const_iterator it = mapWallet.find(outpoint.hash);
+                    if (it == mapWallet.end())
+                        continue;
+
+                    int nDepth;
+                    bool safeTx;
+                    if (!fnTxAvailable(&it->second, nDepth, safeTx))
+                        continue;
+
+                    fnAddOutput(it->first, &it->second, outpoint.n, nDepth, safeTx);
                 }
             }
         }
@@ -3789,6 +3897,10 @@ DBErrors CWallet::LoadWallet(bool& fFirstRunRet)
     // This wallet is in its first run if all of these are empty
     fFirstRunRet = mapKeys.empty() && mapCryptedKeys.empty() && mapWatchKeys.empty() && setWatchOnly.empty() && mapScripts.empty();
 
+    // Transactions can be read before the keys that make their outputs ours, so index once everything is loaded.
+    // A wallet with noncritical errors is still used, so this comes before returning them
+    RebuildAssetOutPoints();
+
     if (nLoadWalletRet != DB_LOAD_OK)
         return nLoadWalletRet;
 
@@ -3804,6 +3916,10 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
     for (uint256 hash : vHashOut)
         mapWallet.erase(hash);
 
+    // Outputs spent by a zapped transaction can be spendable again
+    if (!vHashOut.empty())
+        RebuildAssetOutPoints();
+
     if (nZapSelectTxRet == DB_NEED_REWRITE)
     {
         if (dbw->Rewrite("\x04pool"))
@@ -677,12 +677,18 @@ private:
 };
 
 
+namespace wallet_tests
+{
+    class TestAssetIndex;
+}
+
 /** 
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
  */
 class CWallet final : public CCryptoKeyStore, public CValidationInterface
 {
+friend class wallet_tests::TestAssetIndex; // for test access to mapAssetOutPoints and MarkConflicted
 private:
     static std::atomic<bool> fFlushScheduled;
     std::atomic<bool> fAbortRescan;
@@ -719,6 +725,19 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /**
+     * Our asset outputs by asset name, so asset balances, listings and asset coin selection only look at
+     * outputs that can still be spent instead of the whole wallet history. It holds every asset output of
+     * ours that might be unspent: an output is dropped once a wallet transaction that isn't abandoned or
+     * conflicted spends it, and put back if that spend is abandoned, conflicted or zapped. Callers still
+     * check IsSpent, the index only has to be a superset of the unspent outputs.
+     */
+    std::map<std::string, std::set<COutPoint> > mapAssetOutPoints;
+    bool IsSpentByActiveTx(const COutPoint& outpoint) const;
+    void AddAssetOutPoints(const CWalletTx& wtx);
+    void RemoveAssetOutPoint(const COutPoint& outpoint);
+    void RebuildAssetOutPoints();
+
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
 